@@ -25,6 +25,7 @@ struct ApplicationParameters
 {
 	Path applicationPath;
 	Path applicationDirectory;
+	GeometrySettings geometrySettings;
 
 	ApplicationParameters(int argc, char* argv[])
 	{
@@ -38,6 +39,18 @@ struct ApplicationParameters
 
 				i += 1;
 			}
+			// Full precision vertices instead of the compact ones
+			else if (strcmp(argv[i], "-vertexFormat") == 0 && i + 1 < argc)
+			{
+				geometrySettings.vertexFormat = strcmp(argv[i + 1], "float32") == 0 ? MeshDescriptor::EVertexFormat::Float32 : MeshDescriptor::EVertexFormat::Compact;
+
+				i += 1;
+			}
+			// 32 bit indices for every mesh
+			else if (strcmp(argv[i], "-fullIndices") == 0)
+			{
+				geometrySettings.use16BitIndices = false;
+			}
 		}
 
 		applicationDirectory = Path(getApplicationPath(commandLineInput));
@@ -59,7 +72,7 @@ int main(int argc, char* argv[])
 #endif
 	// todo - override validation layers value on command line argument
 
-	engine.init(validationLayers);
+	engine.init(validationLayers, parameters.geometrySettings);
 
 	engine.run();
 
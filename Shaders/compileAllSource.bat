@@ -1,4 +1,4 @@
-set "AllowExt=.vert .frag"
+set "AllowExt=.vert .frag .comp"
 
 set arg1="%1\Bin\glslc.exe"
 if not exist %arg1% (
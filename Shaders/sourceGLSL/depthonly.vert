@@ -23,13 +23,15 @@ layout(set = 1, binding = 0) uniform ViewBlockUBO
 	vec4 cameraPosition;
 } viewUBO;
 
-layout( push_constant ) uniform constants
+// Written per draw by the CPU, the indirect command of a draw sets firstInstance to its index
+layout(std430, set = 4, binding = 0) readonly buffer TransformsBlockSSBO
 {
-	mat4 model_matrix;
-} pushConstants;
+	mat4 model_matrix[];
+} transforms;
 
 void main()
 {
-    mat4 render_matrix = viewUBO.view_persp_matrix * pushConstants.model_matrix;
+	mat4 model_matrix = transforms.model_matrix[gl_InstanceIndex];
+    mat4 render_matrix = viewUBO.view_persp_matrix * model_matrix;
     gl_Position = render_matrix * vec4(inPosition.xyz, 1.0);
 }
@@ -23,11 +23,6 @@ layout(set = 1, binding = 0) uniform ViewBlockUBO
 	vec4 cameraPosition;
 } viewUBO;
 
-layout( push_constant ) uniform constants
-{
-	mat4 model_matrix;
-} pushConstants;
-
 void main() 
 {
 	outUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
@@ -6,11 +6,15 @@ layout(location = 1) in vec2 uv;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec3 inColor;
 
+// Set for the compact vertex format, inNormal.xy then holds the octahedral encoded normal (MeshDescriptor::EVertexFormat)
+layout(constant_id = 0) const bool OCTAHEDRAL_NORMALS = false;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec4 fragLightSpacePos;
 layout(location = 4) out vec4 bias_ambient;
+layout(location = 5) flat out uint materialIndex;
 
 layout(set = 0, binding = 0) uniform ConstantsBlockUBO
 {
@@ -33,10 +37,25 @@ layout(set = 1, binding = 0) uniform ViewBlockUBO
 	vec4 cameraPosition;
 } viewUBO;
 
-layout( push_constant ) uniform constants
+// Written per draw by the CPU, the indirect command of a draw sets firstInstance to its index
+layout(std430, set = 4, binding = 0) readonly buffer TransformsBlockSSBO
+{
+	mat4 model_matrix[];
+} transforms;
+
+// Slot of the draw's texture in the texture table, written next to its transform
+layout(std430, set = 4, binding = 1) readonly buffer MaterialsBlockSSBO
 {
-	mat4 model_matrix;
-} pushConstants;
+	uint material_index[];
+} materials;
+
+vec3 octDecode(vec2 p)
+{
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
 
 #define DEPTH_BIAS bias_ambient.x * 10
 #define NORMAL_BIAS bias_ambient.y
@@ -53,13 +72,17 @@ vec3 applyShadowBias(vec3 positionWS, vec3 normalWS, vec3 lightDirection)
 
 void main()
 {
-	vec3 worldSpacePos = (pushConstants.model_matrix * vec4(inPosition.xyz, 1.0)).xyz;
+	mat4 model_matrix = transforms.model_matrix[gl_InstanceIndex];
+	vec3 worldSpacePos = (model_matrix * vec4(inPosition.xyz, 1.0)).xyz;
     gl_Position = viewUBO.view_persp_matrix * vec4(worldSpacePos, 1.0);
 
 	bias_ambient = constUBO.bias_ambient;
+	materialIndex = materials.material_index[gl_InstanceIndex];
 
-    mat3 normalMatrix = mat3(transpose(inverse(pushConstants.model_matrix)));
-    fragNormal = normalMatrix * inNormal;
+    // The model matrix may scale the compact positions back to the mesh bounds, the normal has to be renormalized
+    vec3 normal = OCTAHEDRAL_NORMALS ? octDecode(inNormal.xy) : inNormal;
+    mat3 normalMatrix = mat3(transpose(inverse(model_matrix)));
+    fragNormal = normalize(normalMatrix * normal);
 
 	vec3 lightDir = vec3(
 		constUBO.world_to_light[0][2],
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_KHR_vulkan_glsl : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "forward.glsl"
+
+// Without shaderSampledImageArrayDynamicIndexing every material binds a set with only its own texture.
+layout(set = 3, binding = 0) uniform sampler2D materialTexture;
+
+void main()
+{
+    vec4 color = texture(materialTexture, fragTexCoord);
+    float shadowMap = shadowCalculation(fragLightSpacePos);
+    float attenuation = mix(1.0, AMBIENT, shadowMap);
+
+    outColor = color * attenuation;
+}
\ No newline at end of file
@@ -3,11 +3,18 @@
 #include "Scene.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "VertexQuantization.h"
 #include "FileManager/Directories.h"
 #include "Loaders/Model/ModelLoaderOptions.h"
 
 #include "Profiling/ProfileMarker.h"
 #include "Loaders/Model/Common.h"
+#include "Math/Frustum.h"
+#include "Math/BoundsAABB.h"
+#include "Math/FrustumCulling.h"
+#include "Math/BVH.h"
+#include "Math/MeshSimplifier.h"
+#include "Math/MeshOptimizer.h"
 
 #include <iostream>
 #include <sstream>
@@ -195,3 +202,357 @@ TEST(Serialization, SceneBinary)
 		stream.close();
 	}
 }
+
+TEST(Serialization, SceneMappedCache)
+{
+	Scene scene(nullptr, nullptr);
+	const auto modelPaths = Directories::getModels_IntelSponza();
+	const auto fullPath = Directories::getBinaryTargetPath(modelPaths.front().filePath, true);
+
+	for (auto& model : modelPaths)
+	{
+		auto meshCount = scene.getMeshes().size();
+		scene.tryInitializeFromFile(model);
+
+		EXPECT_TRUE(scene.getMeshes().size() - meshCount > 0);
+	}
+
+	// WRITE
+	EXPECT_TRUE(scene.writeMappedCache(fullPath));
+
+	// READ
+	{
+		Scene loadedScene(nullptr, nullptr);
+		EXPECT_TRUE(Directories::isMappedSceneCache(fullPath));
+		EXPECT_TRUE(loadedScene.tryInitializeFromFile(Loader::ModelLoaderOptions(Path(fullPath), 1.0f)));
+
+		AssertEqual( scene.getTransforms(), loadedScene.getTransforms() );
+		AssertEqual( scene.getMeshes(), loadedScene.getMeshes() );
+		AssertEqual( scene.getMaterials(), loadedScene.getMaterials() );
+		AssertEqual( scene.getRendererIDs(), loadedScene.getRendererIDs() );
+	}
+}
+
+TEST(Serialization, ImportDeterminism)
+{
+	const auto modelPaths = Directories::getModels_CrytekSponza();
+
+	Scene serialScene(nullptr, nullptr), parallelScene(nullptr, nullptr);
+	for (auto& model : modelPaths)
+	{
+		EXPECT_TRUE(serialScene.tryInitializeFromFile(Loader::ModelLoaderOptions(Path(model.filePath), model.sizeModifier, 1)));
+		EXPECT_TRUE(parallelScene.tryInitializeFromFile(Loader::ModelLoaderOptions(Path(model.filePath), model.sizeModifier, 0)));
+	}
+
+	AssertEqual( serialScene.getTransforms(), parallelScene.getTransforms() );
+	AssertEqual( serialScene.getMeshes(), parallelScene.getMeshes() );
+	AssertEqual( serialScene.getMaterials(), parallelScene.getMaterials() );
+	AssertEqual( serialScene.getRendererIDs(), parallelScene.getRendererIDs() );
+}
+
+TEST(Benchmark, FrustumCulling)
+{
+	const auto projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+	const auto view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const auto frustum = Frustum(projection * view);
+
+	srand(42);
+	for (const size_t count : { 10000u, 100000u, 1000000u })
+	{
+		std::vector<BoundsAABB> bounds(count);
+		BoundsSoA boundsSoA;
+		boundsSoA.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			bounds[i] = BoundsAABB(glm::vec3(genFloat(-200.f, 200.f), genFloat(-200.f, 200.f), genFloat(-200.f, 200.f)),
+				genFloat(0.1f, 5.f), genFloat(0.1f, 5.f), genFloat(0.1f, 5.f));
+			boundsSoA.set(i, bounds[i]);
+		}
+
+		std::vector<uint64_t> expected((count + 63) / 64);
+		{
+			ProfileMarker _("Frustum::isOnFrustum - " + std::to_string(count) + " boxes");
+			for (size_t i = 0; i < count; i++)
+				expected[i / 64] |= static_cast<uint64_t>(frustum.isOnFrustum(bounds[i])) << (i % 64);
+		}
+
+		for (const auto path : { FrustumCulling::EPath::Scalar, FrustumCulling::EPath::SSE, FrustumCulling::EPath::AVX2 })
+		{
+			if (path == FrustumCulling::EPath::AVX2 && FrustumCulling::getBestPath() != FrustumCulling::EPath::AVX2)
+				continue;
+
+			std::vector<uint64_t> visibility(expected.size());
+			{
+				ProfileMarker _("FrustumCulling::cull " + std::string(FrustumCulling::getPathName(path)) + " - " + std::to_string(count) + " boxes");
+				FrustumCulling::cull(frustum, boundsSoA, visibility.data(), path);
+			}
+			EXPECT_EQ(expected, visibility);
+		}
+	}
+}
+
+TEST(Benchmark, BVHCulling)
+{
+	Scene scene(nullptr, nullptr);
+	for (auto& model : Directories::getModels_IntelSponza())
+	{
+		EXPECT_TRUE(scene.tryInitializeFromFile(model));
+	}
+
+	// World bounds of every submesh, the scene is tiled on a grid so the hierarchy has more than a couple of thousand boxes to work with
+	std::vector<BoundsAABB> sceneBounds;
+	for (const auto& renderer : scene.getRendererIDs())
+	{
+		const auto& mesh = scene.getMeshes()[renderer.meshID];
+		const auto& localToWorld = scene.getTransforms()[renderer.transformID].getLocalToWorld();
+		for (uint32_t submesh = 0; submesh < mesh.getSubmeshes().size(); submesh++)
+		{
+			if (const auto* bounds = mesh.getBounds(submesh))
+				sceneBounds.push_back(bounds->getTransformed(localToWorld));
+		}
+	}
+	ASSERT_FALSE(sceneBounds.empty());
+
+	auto sceneMin = glm::vec3(std::numeric_limits<float>::max()), sceneMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (const auto& bounds : sceneBounds)
+	{
+		sceneMin = glm::min(sceneMin, bounds.center - bounds.extents);
+		sceneMax = glm::max(sceneMax, bounds.center + bounds.extents);
+	}
+	const auto sceneSize = sceneMax - sceneMin;
+
+	const auto projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, glm::length(sceneSize) * 2.0f);
+	const auto view = glm::lookAt(sceneMin + sceneSize * glm::vec3(0.5f, 0.3f, 0.5f), sceneMin + sceneSize * glm::vec3(2.0f, 0.3f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const auto frustum = Frustum(projection * view);
+
+	for (const uint32_t gridSize : { 1u, 4u, 16u })
+	{
+		BoundsSoA boundsSoA;
+		boundsSoA.resize(sceneBounds.size() * gridSize * gridSize);
+		size_t index = 0;
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			for (uint32_t z = 0; z < gridSize; z++)
+			{
+				const auto offset = glm::translate(glm::mat4(1.0f), glm::vec3(x * sceneSize.x, 0.0f, z * sceneSize.z));
+				for (const auto& bounds : sceneBounds)
+					boundsSoA.setTransformed(index++, bounds, offset);
+			}
+		}
+		const auto label = " - " + std::to_string(boundsSoA.size()) + " boxes";
+
+		std::vector<uint64_t> expected((boundsSoA.size() + 63) / 64);
+		{
+			ProfileMarker _("FrustumCulling::cull" + label);
+			FrustumCulling::cull(frustum, boundsSoA, expected.data());
+		}
+
+		BVH bvh;
+		{
+			ProfileMarker _("BVH::build" + label);
+			bvh.build(boundsSoA);
+		}
+
+		std::vector<uint64_t> visibility(expected.size());
+		{
+			ProfileMarker _("BVH::query" + label);
+			bvh.query(frustum, visibility.data());
+		}
+		EXPECT_EQ(expected, visibility);
+
+		// Everything moves a little, the topology is kept
+		for (size_t i = 0; i < boundsSoA.size(); i++)
+			boundsSoA.centerY[i] += 0.1f;
+
+		{
+			ProfileMarker _("BVH::refit" + label);
+			bvh.refit(boundsSoA);
+		}
+
+		FrustumCulling::cull(frustum, boundsSoA, expected.data());
+		bvh.query(frustum, visibility.data());
+		EXPECT_EQ(expected, visibility);
+	}
+}
+
+// A gently rolling height field of gridSize by gridSize quads with two triangles each, the border of the grid is open.
+void createHeightField(uint32_t gridSize, std::vector<glm::vec3>& positions, std::vector<MeshDescriptor::TVertexIndices>& indices)
+{
+	for (uint32_t z = 0; z <= gridSize; z++)
+	{
+		for (uint32_t x = 0; x <= gridSize; x++)
+			positions.emplace_back(x * 0.1f, std::sin(x * 0.05f) * std::cos(z * 0.05f) * 0.5f, z * 0.1f);
+	}
+	for (uint32_t z = 0; z < gridSize; z++)
+	{
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			const auto i = z * (gridSize + 1) + x;
+			indices.insert(indices.end(), { i, i + gridSize + 1, i + 1, i + 1, i + gridSize + 1, i + gridSize + 2 });
+		}
+	}
+}
+
+Mesh createHeightFieldMesh(uint32_t gridSize, std::vector<glm::vec3>& positions, std::vector<MeshDescriptor::TVertexIndices>& indices)
+{
+	std::vector<glm::vec2> uvs(positions.size());
+	std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+	std::vector<glm::vec3> colors;
+
+	SubMesh submesh(indices);
+	submesh.m_bounds = BoundsAABB(glm::vec3(gridSize * 0.05f, 0.0f, gridSize * 0.05f), gridSize * 0.05f, 0.5f, gridSize * 0.05f);
+	return Mesh(positions, uvs, normals, colors, std::move(submesh));
+}
+
+TEST(Benchmark, MeshSimplification)
+{
+	// The open border has to stay where it is
+	constexpr uint32_t gridSize = 256u;
+	std::vector<glm::vec3> positions;
+	std::vector<MeshDescriptor::TVertexIndices> indices;
+	createHeightField(gridSize, positions, indices);
+
+	const auto vertexCount = positions.size();
+	const auto indexCount = indices.size();
+	auto mesh = createHeightFieldMesh(gridSize, positions, indices);
+	{
+		ProfileMarker _("Mesh::generateLods - " + std::to_string(indexCount / 3) + " triangles");
+		mesh.generateLods(4, 0.5f, 0.02f);
+	}
+
+	const auto& lods = mesh.getSubmeshes()[0].m_lods;
+	ASSERT_FALSE(lods.empty());
+
+	auto previousCount = indexCount;
+	for (const auto& lod : lods)
+	{
+		EXPECT_LT(lod.size(), previousCount);
+		EXPECT_EQ(lod.size() % 3, 0u);
+		for (auto index : lod)
+			ASSERT_LT(index, vertexCount);
+
+		previousCount = lod.size();
+	}
+
+	// Same input, same collapses
+	std::vector<MeshDescriptor::TVertexIndices> repeated;
+	MeshSimplifier::simplify(repeated, mesh.getSubmeshes()[0].m_indices, mesh.getPositions(), static_cast<size_t>(indexCount * 0.5f) / 3 * 3,
+		glm::length(mesh.getSubmeshes()[0].m_bounds.extents) * 2.0f * 0.02f);
+	EXPECT_EQ(lods[0], repeated);
+}
+
+TEST(Benchmark, VertexCacheOptimization)
+{
+	// The height field with its triangles in random order, about as bad as an exporter gets
+	constexpr uint32_t gridSize = 256u;
+	std::vector<glm::vec3> positions;
+	std::vector<MeshDescriptor::TVertexIndices> indices;
+	createHeightField(gridSize, positions, indices);
+
+	std::vector<std::array<MeshDescriptor::TVertexIndices, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+		triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+
+	srand(42);
+	for (size_t i = triangles.size() - 1; i > 0; i--)
+		std::swap(triangles[i], triangles[rand() % (i + 1)]);
+
+	indices.clear();
+	for (const auto& triangle : triangles)
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+
+	// Every triangle has to survive with its winding, compared by position since the vertices get renumbered
+	const auto getTriangles = [](const std::vector<MeshDescriptor::TVertexIndices>& indices, const std::vector<glm::vec3>& positions)
+	{
+		std::vector<std::array<float, 9>> result;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			// Rotated so the smallest vertex leads, that keeps the winding
+			std::array<glm::vec3, 3> p = { positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]] };
+			const auto less = [](const glm::vec3& a, const glm::vec3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+			std::rotate(p.begin(), std::min_element(p.begin(), p.end(), less), p.end());
+			result.push_back({ p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z });
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+	const auto expectedTriangles = getTriangles(indices, positions);
+
+	auto mesh = createHeightFieldMesh(gridSize, positions, indices);
+
+	MeshOptimizer::CacheStats before{}, after{};
+	{
+		ProfileMarker _("Mesh::optimizeForGpu - " + std::to_string(triangles.size()) + " triangles");
+		mesh.optimizeForGpu(before, after);
+	}
+
+	// Shuffled triangles miss on almost every vertex, a regular grid can get down to an ACMR of 0.5 and an ATVR of 1
+	EXPECT_GT(before.getACMR(), 2.5f);
+	EXPECT_GT(before.getATVR(), 5.0f);
+	EXPECT_LT(after.getACMR(), 0.8f);
+	EXPECT_LT(after.getATVR(), 1.5f);
+	EXPECT_EQ(expectedTriangles, getTriangles(mesh.getSubmeshes()[0].m_indices, mesh.getPositions()));
+
+	// The vertices come in the order the indices first use them
+	MeshDescriptor::TVertexIndices nextVertex = 0;
+	for (auto index : mesh.getSubmeshes()[0].m_indices)
+	{
+		ASSERT_LE(index, nextVertex);
+		nextVertex = std::max(nextVertex, index + 1);
+	}
+}
+
+TEST(Serialization, VertexQuantization)
+{
+	srand(7);
+	const auto random = [](float min, float max) { return min + (max - min) * (rand() / static_cast<float>(RAND_MAX)); };
+
+	std::vector<glm::vec3> positions(4096);
+	for (auto& position : positions)
+		position = glm::vec3(random(-13.0f, 13.0f), random(0.0f, 0.25f), random(-2.0f, 5.0f));
+
+	// Within half a step of 16 bits on every axis of the bounds
+	const auto range = VertexQuantization::PositionRange::fromPositions(positions);
+	const auto maxPositionError = range.scale * (0.5f / 65535.0f) + 1e-6f;
+	for (const auto& position : positions)
+	{
+		const auto decoded = VertexQuantization::decodePosition(VertexQuantization::encodePosition(position, range), range);
+		const auto error = glm::abs(decoded - position);
+		ASSERT_LE(error.x, maxPositionError.x);
+		ASSERT_LE(error.y, maxPositionError.y);
+		ASSERT_LE(error.z, maxPositionError.z);
+	}
+
+	// The dequantization matrix of the draw and the renormalization in the shader bring the normals back
+	const auto normalMatrix = glm::mat3(glm::transpose(glm::inverse(range.getDequantizationMatrix())));
+	float minNormalDot = 1.0f;
+	float minTransformedDot = 1.0f;
+	for (size_t i = 0; i < 4096; i++)
+	{
+		auto normal = glm::vec3(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f));
+		if (glm::length(normal) < 1e-3f)
+			continue;
+		normal = glm::normalize(normal);
+
+		const auto decoded = VertexQuantization::decodeNormal(VertexQuantization::encodeNormal(normal));
+		minNormalDot = std::min(minNormalDot, glm::dot(decoded, normal));
+
+		const auto quantized = VertexQuantization::decodeNormal(VertexQuantization::encodeNormal(range.toQuantizedNormal(normal)));
+		minTransformedDot = std::min(minTransformedDot, glm::dot(glm::normalize(normalMatrix * quantized), normal));
+	}
+	EXPECT_GT(minNormalDot, 0.99999f);
+	EXPECT_GT(minTransformedDot, 0.9999f);
+
+	// The axes and the poles sit exactly on the octahedron
+	for (const auto& axis : { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) })
+		EXPECT_GT(glm::dot(VertexQuantization::decodeNormal(VertexQuantization::encodeNormal(axis)), axis), 0.99999f);
+
+	// Half floats keep 11 bits of mantissa, the uvs of tiled textures stay well inside a texel of a 4k texture
+	for (size_t i = 0; i < 4096; i++)
+	{
+		const auto uv = glm::vec2(random(-4.0f, 4.0f), random(0.0f, 1.0f));
+		const auto error = glm::abs(VertexQuantization::decodeUV(VertexQuantization::encodeUV(uv)) - uv);
+		ASSERT_LE(error.x, std::max(std::abs(uv.x), 1.0f) / 2048.0f);
+		ASSERT_LE(error.y, std::max(std::abs(uv.y), 1.0f) / 2048.0f);
+	}
+}
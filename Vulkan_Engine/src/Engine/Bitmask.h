@@ -1,4 +1,7 @@
 #pragma once
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 template<typename T>
 static T bitFlagAppend(T state, T flag)
@@ -16,4 +19,25 @@ template<typename T>
 static bool bitFlagPresent(T state, T flag)
 {
 	return (state & (1 << flag)) != 0;
-}
\ No newline at end of file
+}
+
+// Index of the lowest set bit, the value must not be zero.
+static uint32_t lowestBitIndex(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+static uint32_t bitCount(uint64_t value)
+{
+#ifdef _MSC_VER
+	return static_cast<uint32_t>(__popcnt64(value));
+#else
+	return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+}
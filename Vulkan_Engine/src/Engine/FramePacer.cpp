@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "FramePacer.h"
+
+FramePacer::FramePacer()
+	: m_frameStart(Clock::now()), m_deadline(m_frameStart), m_intervals(), m_intervalCount(0), m_nextInterval(0), m_frameInterval_us(0),
+	m_predictedWork_us(0), m_missedDeadlineCount(0) { }
+
+float FramePacer::waitForNextFrame(FramePacing pacing, int targetFps)
+{
+	const auto now = Clock::now();
+	auto start = now;
+
+	if (pacing == FramePacing::Uncapped || targetFps <= 0)
+	{
+		// Switching to a capped pacing doesn't count the uncapped frames as late
+		m_deadline = now;
+	}
+	else
+	{
+		const auto period = std::chrono::microseconds(std::micro::den / targetFps);
+
+		// The previous frame overran its period, the schedule restarts from now instead of rushing the following frames to catch up
+		if (now > m_deadline + c_deadlineTolerance)
+		{
+			m_missedDeadlineCount += 1;
+			m_deadline = now;
+		}
+
+		start = m_deadline;
+		if (pacing == FramePacing::JustInTime)
+		{
+			const auto predictedWork = std::chrono::microseconds(m_predictedWork_us) + c_safetyMargin;
+			if (predictedWork < period)
+				start += period - predictedWork;
+		}
+
+		sleepUntil(start);
+		m_deadline += period;
+
+		// The intervals are measured from the actual start, an overshooting sleep shows up as jitter
+		start = Clock::now();
+	}
+
+	const auto interval = std::chrono::duration_cast<std::chrono::microseconds>(start - m_frameStart).count();
+	m_frameStart = start;
+
+	m_frameInterval_us = interval;
+	m_intervals[m_nextInterval] = interval;
+	m_nextInterval = (m_nextInterval + 1u) % c_historySize;
+	m_intervalCount = std::min(m_intervalCount + 1u, c_historySize);
+
+	return static_cast<float>(interval) / static_cast<float>(std::milli::den);
+}
+
+void FramePacer::endFrame(int64_t cpuTime_us, int64_t gpuTime_us)
+{
+	// The GPU works on the previous frame while the CPU records the next one, the slower of the two sets the pace.
+	// Rises with a slow frame right away and decays slowly, starting late misses the deadline while starting early only costs latency
+	const auto work_us = std::max(cpuTime_us, gpuTime_us);
+	m_predictedWork_us = std::max(work_us, (m_predictedWork_us * 15 + work_us) / 16);
+}
+
+int64_t FramePacer::getJitter_us() const
+{
+	if (m_intervalCount < 2u)
+		return 0;
+
+	double mean = 0.0;
+	for (uint32_t i = 0; i < m_intervalCount; i++)
+		mean += static_cast<double>(m_intervals[i]);
+	mean /= m_intervalCount;
+
+	double variance = 0.0;
+	for (uint32_t i = 0; i < m_intervalCount; i++)
+	{
+		const auto delta = static_cast<double>(m_intervals[i]) - mean;
+		variance += delta * delta;
+	}
+
+	return static_cast<int64_t>(std::sqrt(variance / m_intervalCount));
+}
+
+void FramePacer::sleepUntil(Clock::time_point time) const
+{
+	if (time - Clock::now() > c_spinDuration)
+		std::this_thread::sleep_until(time - c_spinDuration);
+
+	while (Clock::now() < time)
+		std::this_thread::yield();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+
+enum class FramePacing : int
+{
+	// Starts the next frame as soon as the previous one was submitted
+	Uncapped = 0,
+	// Starts the frames on a fixed grid of the target frame rate
+	FixedRate = 1,
+	// Keeps the grid of the target frame rate, but starts each frame as late as the predicted CPU and GPU time allow to finish it
+	// before the period is over, so the input is sampled closer to the present
+	JustInTime = 2
+};
+
+// Decides when the main loop starts the next frame, timed with steady_clock. Sleeping is only as precise as the OS scheduler tick,
+// so the pacer sleeps until shortly before the start and spins for the rest.
+class FramePacer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// The frame intervals the jitter is measured over
+	constexpr static uint32_t c_historySize = 120u;
+
+	FramePacer();
+
+	// Blocks until the next frame should start, returns the time since the previous one started in milliseconds.
+	float waitForNextFrame(FramePacing pacing, int targetFps);
+	// The CPU time of the frame that was just recorded and submitted, without the waits for the frame slot and the swapchain image,
+	// and the latest GPU time read back (0 when it isn't measured).
+	void endFrame(int64_t cpuTime_us, int64_t gpuTime_us);
+
+	int64_t getFrameInterval_us() const { return m_frameInterval_us; }
+	// Standard deviation of the frame intervals in the history
+	int64_t getJitter_us() const;
+	// Frames that could not start on their schedule because the previous one overran its period, since startup
+	size_t getMissedDeadlineCount() const { return m_missedDeadlineCount; }
+	int64_t getPredictedWork_us() const { return m_predictedWork_us; }
+
+private:
+	// Late by less than this still counts as on schedule
+	constexpr static std::chrono::microseconds c_deadlineTolerance{ 500 };
+	// Just in time starts this much earlier than the prediction asks for
+	constexpr static std::chrono::microseconds c_safetyMargin{ 1000 };
+	// The sleep ends this much before the start, the rest is spent spinning
+	constexpr static std::chrono::microseconds c_spinDuration{ 2000 };
+
+	Clock::time_point m_frameStart;
+	// The end of the current frame's period, the next one is scheduled from it
+	Clock::time_point m_deadline;
+
+	std::array<int64_t, c_historySize> m_intervals;
+	uint32_t m_intervalCount;
+	uint32_t m_nextInterval;
+	int64_t m_frameInterval_us;
+
+	int64_t m_predictedWork_us;
+	size_t m_missedDeadlineCount;
+
+	void sleepUntil(Clock::time_point time) const;
+};
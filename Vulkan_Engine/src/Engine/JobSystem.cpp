@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace
+{
+	struct Batch
+	{
+		const std::function<void(size_t)>* job;
+		size_t count;
+		// Workers that may join the calling thread
+		size_t maxHelpers;
+
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> finished{ 0 };
+		// Guarded by the pool's mutex
+		size_t helpers = 0;
+
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+	};
+
+	// Jobs are picked up one at a time, so uneven job sizes still balance across the threads
+	void runJobs(Batch& batch)
+	{
+		for (size_t i = batch.next++; i < batch.count; i = batch.next++)
+		{
+			try
+			{
+				(*batch.job)(i);
+			}
+			catch (...)
+			{
+				// An exception leaving a worker thread would terminate the application
+				std::lock_guard<std::mutex> lock(batch.exceptionMutex);
+				if (!batch.exception)
+					batch.exception = std::current_exception();
+			}
+			batch.finished++;
+		}
+	}
+
+	class WorkerPool
+	{
+	public:
+		WorkerPool(uint32_t threadCount)
+		{
+			m_threads.reserve(threadCount);
+			for (uint32_t i = 0; i < threadCount; i++)
+				m_threads.emplace_back([this]() { work(); });
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+
+			for (auto& thread : m_threads)
+				thread.join();
+		}
+
+		// A job may call parallelFor again, the calling thread always works through its own batch so nested batches can't starve.
+		void run(Batch& batch)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_batches.push_back(&batch);
+			}
+			m_wake.notify_all();
+
+			runJobs(batch);
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			// Every job is taken, no other worker joins it anymore
+			m_batches.erase(std::find(m_batches.begin(), m_batches.end(), &batch));
+			m_done.wait(lock, [&]() { return batch.finished == batch.count && batch.helpers == 0; });
+		}
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		std::vector<Batch*> m_batches;
+		bool m_stop = false;
+
+		Batch* findBatch() const
+		{
+			for (auto batch : m_batches)
+			{
+				if (batch->next < batch->count && batch->helpers < batch->maxHelpers)
+					return batch;
+			}
+			return nullptr;
+		}
+
+		void work()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true)
+			{
+				Batch* batch = nullptr;
+				m_wake.wait(lock, [&]() { return m_stop || (batch = findBatch()) != nullptr; });
+				if (m_stop)
+					return;
+
+				batch->helpers += 1;
+				lock.unlock();
+				runJobs(*batch);
+				lock.lock();
+
+				// The calling thread may release the batch as soon as the last helper left it
+				batch->helpers -= 1;
+				m_done.notify_all();
+			}
+		}
+	};
+
+	WorkerPool& getPool()
+	{
+		static WorkerPool pool(JobSystem::getWorkerCount() - 1u);
+		return pool;
+	}
+}
+
+uint32_t JobSystem::getWorkerCount() { return std::max(std::thread::hardware_concurrency(), 1u); }
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& job, uint32_t maxWorkers)
+{
+	const auto workerCount = static_cast<size_t>(std::min(maxWorkers == 0 ? getWorkerCount() : maxWorkers, getWorkerCount()));
+	const auto threadCount = std::min(workerCount, count);
+
+	if (threadCount <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	Batch batch;
+	batch.job = &job;
+	batch.count = count;
+	batch.maxHelpers = threadCount - 1;
+
+	getPool().run(batch);
+
+	if (batch.exception)
+		std::rethrow_exception(batch.exception);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "pch.h"
+
+// The workers are started once, on the first parallelFor, and are shared by every caller until the application exits.
+class JobSystem
+{
+public:
+	static uint32_t getWorkerCount();
+
+	// Runs job(i) for every i in [0, count) across up to maxWorkers threads (0 = one per hardware thread), the calling thread included.
+	// Blocks until all are done. An exception thrown by a job is rethrown on the calling thread once the others finished, the first one wins.
+	static void parallelFor(size_t count, const std::function<void(size_t)>& job, uint32_t maxWorkers = 0);
+};
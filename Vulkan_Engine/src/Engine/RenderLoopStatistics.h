@@ -1,5 +1,6 @@
 #pragma once
 #include "pch.h"
+#include "EngineCore/VertexBinding.h"
 
 struct DirectionalLightParams
 {
@@ -13,15 +14,63 @@ struct DirectionalLightParams
 	const glm::vec4 getBiasAmbient() { return glm::vec4(depthBias, normalBias, ambient, 0.0f); }
 };
 
+// Picked once at startup, before the pipelines and the scene are created. The mapped scene cache is keyed on them,
+// a cache written with other settings is imported again.
+struct GeometrySettings
+{
+	// The layout of the vertices in the GPU buffers
+	MeshDescriptor::EVertexFormat vertexFormat;
+	// Meshes with up to 65536 vertices get 16 bit indices on the GPU and in the scene cache
+	bool use16BitIndices;
+
+	GeometrySettings(MeshDescriptor::EVertexFormat vertexFormat = MeshDescriptor::EVertexFormat::Compact, bool use16BitIndices = true)
+		: vertexFormat(vertexFormat), use16BitIndices(use16BitIndices) { }
+};
+
 struct FrameSettings
 {
+	constexpr static uint32_t c_maxRecordingThreads = 8u;
+
 	bool enableShadowPass;
+	// Keeps the static shadow casters in a depth cache, only the dynamic ones are drawn every frame
+	bool enableShadowCache;
 	bool enableForwardPass;
 
 	bool enableDebugShadowMap;
+	bool enableIndirectDraw;
+	bool enableHierarchicalCulling;
+	// Two phase occlusion culling of the forward pass against a depth pyramid, needs indirect draws and a depth attachment
+	bool enableOcclusionCulling;
+	// Frustum culls the forward pass in a compute shader that writes the indirect draws, replaces the CPU and occlusion culling.
+	// Needs indirect draws with multiple draws per call and VK_KHR_draw_indirect_count
+	bool enableGpuCulling;
+
+	// Draws the simplified LODs of the renderers that cover less than lodScreenSize of the screen height, halving it per level.
+	// A renderer only goes back to a finer LOD once it is lodHysteresis larger than the threshold it crossed
+	bool enableLods;
+	float lodScreenSize;
+	float lodHysteresis;
+
+	// The draws of a pass are split in this many chunks, each recorded on its own thread into a secondary command buffer.
+	// A single chunk records straight into the primary command buffer.
+	int recordingThreadCount;
+
+	// Frames the CPU records ahead of the GPU, between 1 and MAX_FRAMES_IN_FLIGHT. More of them trade latency for throughput.
+	int framesInFlight;
+
+	// A FramePacing, when the main loop starts the next frame. The capped ones aim for targetFps
+	int framePacing;
+	int targetFps;
+	// A VkPresentModeKHR, changing it recreates the swapchain. FIFO is used when the surface doesn't support it
+	int presentMode;
 
-	FrameSettings(bool forwardPass = true, bool shadowPass = true, bool debugShadowMap = false)
-		: enableShadowPass(shadowPass), enableForwardPass(forwardPass), enableDebugShadowMap(debugShadowMap) { }
+	FrameSettings(bool forwardPass = true, bool shadowPass = true, bool debugShadowMap = false, bool indirectDraw = true, bool hierarchicalCulling = true, bool shadowCache = true,
+		int recordingThreads = 4, bool occlusionCulling = true, bool gpuCulling = false, bool lods = true, int framesInFlight = 3,
+		int framePacing = 1, int targetFps = 120, int presentMode = VK_PRESENT_MODE_MAILBOX_KHR)
+		: enableShadowPass(shadowPass), enableShadowCache(shadowCache), enableForwardPass(forwardPass), enableDebugShadowMap(debugShadowMap), enableIndirectDraw(indirectDraw),
+		enableHierarchicalCulling(hierarchicalCulling), enableOcclusionCulling(occlusionCulling), enableGpuCulling(gpuCulling),
+		enableLods(lods), lodScreenSize(0.25f), lodHysteresis(0.1f), recordingThreadCount(recordingThreads), framesInFlight(framesInFlight),
+		framePacing(framePacing), targetFps(targetFps), presentMode(presentMode) { }
 };
 
 struct FrameStats
@@ -30,6 +79,61 @@ struct FrameStats
 	size_t descriptorSetCount;
 	size_t drawCallCount;
 
+	// Meshes drawn through vkCmdDrawIndexedIndirect and through vkCmdDrawIndexed respectively
+	size_t indirectDrawCount;
+	size_t directDrawCount;
+
+	// Renderers that passed the camera frustum culling
+	size_t visibleCount;
+	// Renderers that entered or left the camera frustum since the previous frame, CPU culling only
+	size_t visibilityChangeCount;
+
+	// Shadow pass only, the totals above include it
+	size_t shadowDrawCallCount;
+	size_t shadowCasterCount;
+	size_t shadowCulledCount;
+
+	// Since startup, a miss redraws the static shadow casters
+	size_t shadowCacheHits;
+	size_t shadowCacheMisses;
+
+	// Frustum visible renderers rejected by the depth pyramid, and the ones that only turned visible in the second phase.
+	// Read back from the GPU, they lag behind by the frames in flight.
+	size_t occludedCount;
+	size_t lateVisibleCount;
+	// Renderers that passed the compute shader frustum culling, read back from the GPU with the same latency
+	size_t gpuVisibleCount;
+	// Resident transforms of the compute shader culling rewritten this frame, the ones that moved since the frame slot was last used
+	size_t transformUploadCount;
+	// Renderers drawn with one of their simplified LODs
+	size_t lodReducedCount;
+	// Bytes of the uniform ring written this frame, alignment included
+	size_t uniformByteCount;
+	// Submitted frames the GPU had not completed yet when this one started recording
+	size_t pendingFrameCount;
+
 	size_t frameNumber;
 	int64_t renderLoop_ms;
+
+	// Frame pacing, the interval between the starts of the last two frames and its standard deviation over the recent ones
+	int64_t frameInterval_us;
+	int64_t frameJitter_us;
+	// Frames that started late because the previous one overran its period, since startup
+	size_t missedDeadlineCount;
+	// Between the first and the last command of the latest completed frame on the GPU, 0 without timestamp support
+	int64_t gpuFrame_us;
+
+	// Time spent recording by each chunk, summed over the passes
+	std::array<int64_t, FrameSettings::c_maxRecordingThreads> recordThread_us;
+	uint32_t recordThreadCount;
+
+	// Merges the state and draw counters of a chunk recorded on another thread.
+	void addCommandCounts(const FrameStats& other)
+	{
+		pipelineCount += other.pipelineCount;
+		descriptorSetCount += other.descriptorSetCount;
+		drawCallCount += other.drawCallCount;
+		indirectDrawCount += other.indirectDrawCount;
+		directDrawCount += other.directDrawCount;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,389 @@
+#include "pch.h"
+#include "AsyncTextureUploader.h"
+#include "Texture.h"
+#include "VkTypes/VkTexture.h"
+#include "VkTypes/InitializersUtility.h"
+#include "Presentation/Device.h"
+#include "Engine/JobSystem.h"
+#include "Profiling/ProfileMarker.h"
+#include "vk_types.h"
+
+static uint32_t getDecodedByteSize(const UNQ<Texture>& texture)
+{
+	auto byteSize = 0u;
+	if (texture)
+	{
+		for (const auto& mip : texture->getMipChain())
+			byteSize += mip.getByteSize();
+	}
+	return byteSize;
+}
+
+static VkImageMemoryBarrier createOwnershipBarrier(VkImage image, uint32_t mipCount, uint32_t srcFamily, uint32_t dstFamily, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipCount;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	return barrier;
+}
+
+AsyncTextureUploader::AsyncTextureUploader(const Presentation::Device* device)
+	: m_device(device), m_transferPool(VK_NULL_HANDLE), m_graphicsPool(VK_NULL_HANDLE), m_stagingPool(device), m_decodedCount(0)
+{
+	const auto& families = device->getQueueFamilyIndices();
+	m_isInitialized =
+		vkinit::Commands::createCommandPool(m_transferPool, device->getDevice(), families.transferFamily.value()) &&
+		vkinit::Commands::createCommandPool(m_graphicsPool, device->getDevice(), families.graphicsFamily.value());
+}
+
+AsyncTextureUploader::~AsyncTextureUploader()
+{
+	if (m_decodeThread.joinable())
+		m_decodeThread.join();
+}
+
+uint32_t AsyncTextureUploader::request(const TextureSource& source)
+{
+	assert(!m_decodeThread.joinable() && "Textures can only be requested before the decoding has started.");
+
+	m_requests.push_back(source);
+	return as_uint32(m_requests.size() - 1);
+}
+
+void AsyncTextureUploader::startDecoding()
+{
+	m_decodeThread = std::thread([this]()
+		{
+			ProfileMarker _("AsyncTextureUploader::Decode");
+			JobSystem::parallelFor(m_requests.size(), [this](size_t i)
+				{
+					const auto& source = m_requests[i];
+					auto texture = MAKEUNQ<Texture>();
+					if (!Texture::tryLoadSupportedFormat(*texture, source.path.value) || !texture->hasPixelData())
+					{
+						printf("The texture '%s' could not be loaded, it will keep using the fallback.\n", source.path.c_str());
+						texture.reset();
+					}
+					else if (texture->format != source.format)
+					{
+						printf("The meta data was expecting format %i, but the texture '%s' had the format %i.\n", source.format, source.path.c_str(), texture->format);
+					}
+
+					{
+						std::lock_guard<std::mutex> lock(m_decodedLock);
+						m_decoded.push_back(DecodedTexture{ as_uint32(i), std::move(texture) });
+					}
+					m_decodedCount++;
+				});
+		});
+}
+
+bool AsyncTextureUploader::isIdle() const
+{
+	std::lock_guard<std::mutex> lock(m_decodedLock);
+	return m_decodedCount == m_requests.size() && m_decoded.empty() && m_inFlight.empty();
+}
+
+void AsyncTextureUploader::update(const ResidentCallback& onResident)
+{
+	const auto device = m_device->getDevice();
+
+	// Hand over everything the GPU has finished with, in submission order so the staging ring is released in order
+	size_t retired = 0;
+	for (; retired < m_inFlight.size(); retired++)
+	{
+		auto& batch = m_inFlight[retired];
+		if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS)
+			break;
+
+		retireBatch(batch, onResident);
+		m_stagingPool.releaseExternalRegions(batch.stagingMarker);
+		destroyBatch(batch);
+	}
+	m_inFlight.erase(m_inFlight.begin(), m_inFlight.begin() + retired);
+
+	// Take what the workers decoded so far, at least one texture and up to the batch budget
+	std::vector<DecodedTexture> decoded;
+	{
+		std::lock_guard<std::mutex> lock(m_decodedLock);
+
+		size_t count = 0, byteSize = 0;
+		while (count < m_decoded.size() && (count == 0 || byteSize + getDecodedByteSize(m_decoded[count].texture) <= c_maxBatchByteSize))
+		{
+			byteSize += getDecodedByteSize(m_decoded[count].texture);
+			count++;
+		}
+
+		decoded.reserve(count);
+		std::move(m_decoded.begin(), m_decoded.begin() + count, std::back_inserter(decoded));
+		m_decoded.erase(m_decoded.begin(), m_decoded.begin() + count);
+	}
+
+	if (!decoded.empty())
+		recordBatch(decoded);
+}
+
+bool AsyncTextureUploader::recordBatch(std::vector<DecodedTexture>& decoded)
+{
+	ProfileMarker _("AsyncTextureUploader::Record_Batch");
+
+	const auto device = m_device->getDevice();
+	const auto& families = m_device->getQueueFamilyIndices();
+	const auto dedicatedTransfer = families.hasDedicatedTransfer();
+	const auto transferFamily = families.transferFamily.value(),
+		graphicsFamily = families.graphicsFamily.value();
+
+	Batch batch{};
+	if (!vkinit::Commands::createSingleCommandBuffer(batch.graphicsCmd, m_graphicsPool, device) ||
+		!vkinit::Synchronization::createFence(batch.fence, device, false) ||
+		(dedicatedTransfer && (!vkinit::Commands::createSingleCommandBuffer(batch.transferCmd, m_transferPool, device) ||
+			!vkinit::Synchronization::createSemaphore(batch.transferFinished, device))))
+	{
+		printf("Could not create the command objects for a texture upload batch.\n");
+		destroyBatch(batch);
+		return false;
+	}
+
+	auto vmaci = VkMemoryAllocator::getInstance()->createAllocationDescriptor(VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Without a dedicated transfer family the copies go straight into the graphics command buffer
+	const auto copyCmd = dedicatedTransfer ? batch.transferCmd : batch.graphicsCmd;
+	{
+		CommandObjectsWrapper::CommandBufferScope copyScope(copyCmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		for (size_t i = 0; i < decoded.size(); i++)
+		{
+			auto& entry = decoded[i];
+			if (!entry.texture)
+				continue;
+
+			const auto& texture = *entry.texture;
+			auto mipCount = as_uint32(texture.textureMipChain.size());
+			const auto generateTheMips = mipCount == 1u && m_requests[entry.requestID].generateTheMips;
+			if (generateTheMips)
+			{
+				mipCount = as_uint32(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+			}
+
+			std::vector<MipDesc> dimensions;
+			dimensions.reserve(texture.textureMipChain.size());
+			auto totalBufferSize = 0u;
+			for (auto& mip : texture.textureMipChain)
+			{
+				totalBufferSize += mip.getByteSize();
+				dimensions.emplace_back(mip.getDimensions());
+			}
+
+			UploadedTexture uploaded{};
+			uploaded.requestID = entry.requestID;
+			uploaded.format = texture.format;
+			uploaded.width = texture.width;
+			uploaded.height = texture.height;
+			uploaded.mipCount = mipCount;
+			uploaded.generateMips = generateTheMips;
+			// The staging ring is still busy with the previous batches, try the rest again next frame
+			StagingBufferPool::StgBuffer stagingBuffer;
+			if (!m_stagingPool.claimAStagingBuffer(stagingBuffer, totalBufferSize))
+			{
+				std::lock_guard<std::mutex> lock(m_decodedLock);
+				m_decoded.insert(m_decoded.begin(), std::make_move_iterator(decoded.begin() + i), std::make_move_iterator(decoded.end()));
+				break;
+			}
+
+			size_t offset = 0;
+			for (auto& mip : texture.textureMipChain)
+			{
+				mip.copyToMappedBuffer(stagingBuffer.mapped, offset);
+				offset += mip.getByteSize();
+			}
+
+			auto imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			if (generateTheMips)
+			{
+				imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
+
+			if (!vkinit::Texture::createImage(uploaded.image, uploaded.memoryRange, vmaci, texture.format, imageUsage, texture.width, texture.height, mipCount))
+			{
+				printf("Could not create image for texture.\n");
+				continue;
+			}
+
+			Texture::transitionImageLayout(copyCmd, uploaded.image, texture.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
+			Texture::copyBufferToImage(copyCmd, stagingBuffer.buffer, uploaded.image, dimensions, stagingBuffer.offset);
+
+			// Blits need a graphics queue, so the mip generation waits for the ownership transfer
+			const auto finalLayout = generateTheMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			if (dedicatedTransfer)
+			{
+				auto release = createOwnershipBarrier(uploaded.image, mipCount, transferFamily, graphicsFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout);
+				release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				release.dstAccessMask = 0;
+
+				vkCmdPipelineBarrier(copyCmd,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &release);
+			}
+			else if (generateTheMips)
+			{
+				VkTexture2D::recordMipChainGeneration(copyCmd, uploaded.image, texture.width, texture.height, mipCount);
+			}
+			else
+			{
+				Texture::transitionImageLayout(copyCmd, uploaded.image, texture.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipCount);
+			}
+
+			batch.textures.push_back(uploaded);
+		}
+	}
+
+	if (dedicatedTransfer)
+	{
+		CommandObjectsWrapper::CommandBufferScope graphicsScope(batch.graphicsCmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		for (const auto& uploaded : batch.textures)
+		{
+			auto acquire = createOwnershipBarrier(uploaded.image, uploaded.mipCount, transferFamily, graphicsFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				uploaded.generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			acquire.srcAccessMask = 0;
+			acquire.dstAccessMask = uploaded.generateMips ? (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) : VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(batch.graphicsCmd,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, uploaded.generateMips ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr,
+				0, nullptr,
+				1, &acquire);
+
+			if (uploaded.generateMips)
+			{
+				VkTexture2D::recordMipChainGeneration(batch.graphicsCmd, uploaded.image, uploaded.width, uploaded.height, uploaded.mipCount);
+			}
+		}
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+
+	auto result = VK_SUCCESS;
+	const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	if (dedicatedTransfer)
+	{
+		submitInfo.pCommandBuffers = &batch.transferCmd;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch.transferFinished;
+		result = vkQueueSubmit(m_device->getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &batch.transferFinished;
+		submitInfo.pWaitDstStageMask = &waitStage;
+	}
+
+	submitInfo.pCommandBuffers = &batch.graphicsCmd;
+	if (result == VK_SUCCESS)
+	{
+		result = vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, batch.fence);
+	}
+
+	batch.stagingMarker = m_stagingPool.closeExternalRegions();
+	if (result != VK_SUCCESS)
+	{
+		printf("Failed to submit a texture upload batch of %zu textures.\n", batch.textures.size());
+		vkQueueWaitIdle(m_device->getTransferQueue());
+		vkQueueWaitIdle(m_device->getGraphicsQueue());
+		m_stagingPool.releaseExternalRegions(batch.stagingMarker);
+		destroyBatch(batch);
+		return false;
+	}
+
+	m_inFlight.push_back(std::move(batch));
+	return true;
+}
+
+bool AsyncTextureUploader::retireBatch(Batch& batch, const ResidentCallback& onResident)
+{
+	const auto device = m_device->getDevice();
+
+	auto isSuccess = true;
+	for (auto& uploaded : batch.textures)
+	{
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+		if (!vkinit::Texture::createTextureImageView(imageView, device, uploaded.image, uploaded.format, uploaded.mipCount) ||
+			!vkinit::Texture::createTextureSampler(sampler, device, uploaded.mipCount, true, VK_SAMPLER_ADDRESS_MODE_REPEAT, Texture::c_anisotropySamples))
+		{
+			printf("Could not create imageview or sampler for texture.\n");
+			vkDestroyImageView(device, imageView, nullptr);
+			vmaDestroyImage(VkMemoryAllocator::getInstance()->m_allocator, uploaded.image, uploaded.memoryRange);
+			isSuccess = false;
+			continue;
+		}
+
+		auto texture = MAKEUNQ<VkTexture2D>(uploaded.image, uploaded.memoryRange, imageView, sampler, uploaded.mipCount);
+		onResident(uploaded.requestID, texture);
+
+		// The callback did not take ownership
+		if (texture)
+		{
+			texture->release(device);
+		}
+	}
+	batch.textures.clear();
+
+	return isSuccess;
+}
+
+void AsyncTextureUploader::destroyBatch(Batch& batch)
+{
+	const auto device = m_device->getDevice();
+
+	// Anything left here never reached the callback
+	for (auto& uploaded : batch.textures)
+	{
+		vmaDestroyImage(VkMemoryAllocator::getInstance()->m_allocator, uploaded.image, uploaded.memoryRange);
+	}
+	batch.textures.clear();
+
+	if (batch.transferCmd != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(device, m_transferPool, 1, &batch.transferCmd);
+	if (batch.graphicsCmd != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(device, m_graphicsPool, 1, &batch.graphicsCmd);
+
+	vkDestroySemaphore(device, batch.transferFinished, nullptr);
+	vkDestroyFence(device, batch.fence, nullptr);
+	batch = Batch{};
+}
+
+void AsyncTextureUploader::release()
+{
+	if (m_decodeThread.joinable())
+		m_decodeThread.join();
+
+	const auto device = m_device->getDevice();
+	for (auto& batch : m_inFlight)
+	{
+		vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		m_stagingPool.releaseExternalRegions(batch.stagingMarker);
+		destroyBatch(batch);
+	}
+	m_inFlight.clear();
+	m_decoded.clear();
+
+	m_stagingPool.releaseAllResources();
+
+	vkDestroyCommandPool(device, m_transferPool, nullptr);
+	vkDestroyCommandPool(device, m_graphicsPool, nullptr);
+	m_transferPool = VK_NULL_HANDLE;
+	m_graphicsPool = VK_NULL_HANDLE;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "pch.h"
+#include "Common.h"
+#include "Interfaces/IRequireInitialization.h"
+#include "StagingBufferPool.h"
+#include "Material.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace Presentation
+{
+	class Device;
+}
+struct Texture;
+struct VkTexture2D;
+
+// Decodes textures on worker threads and uploads them in batches on the transfer queue, without blocking the frame.
+class AsyncTextureUploader : IRequireInitialization
+{
+public:
+	typedef std::function<void(uint32_t requestID, UNQ<VkTexture2D>& texture)> ResidentCallback;
+
+	AsyncTextureUploader(const Presentation::Device* device);
+	~AsyncTextureUploader();
+
+	bool IRequireInitialization::isInitialized() const override { return m_isInitialized; }
+
+	// Returns the request ID that is later handed to the resident callback.
+	uint32_t request(const TextureSource& source);
+	void startDecoding();
+
+	// Main thread, once per frame: records the decoded textures into one batch and hands over the finished ones.
+	void update(const ResidentCallback& onResident);
+	bool isIdle() const;
+
+	void release();
+
+	constexpr static uint32_t c_maxBatchByteSize = 64u * 1024u * 1024u;
+
+private:
+	struct DecodedTexture
+	{
+		uint32_t requestID;
+		UNQ<Texture> texture;
+	};
+
+	struct UploadedTexture
+	{
+		uint32_t requestID;
+		VkImage image;
+		VmaAllocation memoryRange;
+		VkFormat format;
+		uint32_t width, height;
+		uint32_t mipCount;
+		bool generateMips;
+	};
+
+	struct Batch
+	{
+		VkCommandBuffer transferCmd;
+		VkCommandBuffer graphicsCmd;
+		VkSemaphore transferFinished;
+		VkFence fence;
+		uint64_t stagingMarker;
+		std::vector<UploadedTexture> textures;
+	};
+
+	bool m_isInitialized = false;
+	const Presentation::Device* m_device;
+
+	VkCommandPool m_transferPool;
+	VkCommandPool m_graphicsPool;
+	StagingBufferPool m_stagingPool;
+
+	std::vector<TextureSource> m_requests;
+	std::thread m_decodeThread;
+	std::atomic<size_t> m_decodedCount;
+
+	mutable std::mutex m_decodedLock;
+	std::vector<DecodedTexture> m_decoded;
+	std::vector<Batch> m_inFlight;
+
+	bool recordBatch(std::vector<DecodedTexture>& decoded);
+	bool retireBatch(Batch& batch, const ResidentCallback& onResident);
+	void destroyBatch(Batch& batch);
+};
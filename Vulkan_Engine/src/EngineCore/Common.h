@@ -10,3 +10,5 @@
 #define as_uint32(x) static_cast<uint32_t>(x)
 
 constexpr static uint32_t SWAPCHAIN_IMAGE_COUNT = 3u;
+// The per frame resources are sized for it, how many frames are actually in flight is a runtime setting between 1 and this.
+constexpr static uint32_t MAX_FRAMES_IN_FLIGHT = 4u;
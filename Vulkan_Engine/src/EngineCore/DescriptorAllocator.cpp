@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, std::string&& name, const std::vector<PoolSizeRatio>& ratios, uint32_t initialSetsPerPool)
+	: m_device(device), m_name(std::move(name)), m_ratios(ratios), m_setsPerPool(std::clamp(initialSetsPerPool, 1u, c_maxSetsPerPool)),
+	m_currentPool(VK_NULL_HANDLE), m_usedPools(), m_freePools(), m_poolCapacities(),
+	m_setCount(0), m_peakSetCount(0), m_overflowCount(0), m_resetCount(0) { }
+
+bool DescriptorAllocator::allocate(VkDescriptorSet& descriptorSet, VkDescriptorSetLayout layout)
+{
+	return allocate(&descriptorSet, &layout, 1u);
+}
+
+bool DescriptorAllocator::allocate(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDescriptorSetLayout layout)
+{
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(layout);
+
+	return allocate(descriptorSets.data(), layouts.data(), MAX_FRAMES_IN_FLIGHT);
+}
+
+bool DescriptorAllocator::allocate(VkDescriptorSet* descriptorSets, const VkDescriptorSetLayout* layouts, uint32_t count)
+{
+	if (m_currentPool == VK_NULL_HANDLE && !acquirePool())
+		return false;
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_currentPool;
+	allocInfo.descriptorSetCount = count;
+	allocInfo.pSetLayouts = layouts;
+
+	auto result = vkAllocateDescriptorSets(m_device, &allocInfo, descriptorSets);
+
+	// Moves on through the pools freed by the last reset, at the latest a freshly created pool has to fit the sets
+	bool isFreshPool = false;
+	while (!isFreshPool && (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL))
+	{
+		// The pool stays in use until the next reset, the sets it already handed out are still valid
+		m_overflowCount += 1;
+		isFreshPool = m_freePools.empty();
+		if (!acquirePool())
+			return false;
+
+		allocInfo.descriptorPool = m_currentPool;
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, descriptorSets);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		printf("The '%s' descriptor allocator could not allocate %u descriptor sets, even from a new pool.\n", m_name.c_str(), count);
+		return false;
+	}
+
+	m_setCount += count;
+	m_peakSetCount = std::max(m_peakSetCount, m_setCount);
+	return true;
+}
+
+void DescriptorAllocator::reset()
+{
+	for (auto pool : m_usedPools)
+	{
+		vkResetDescriptorPool(m_device, pool, 0);
+		m_freePools.push_back(pool);
+	}
+	m_usedPools.clear();
+
+	m_currentPool = VK_NULL_HANDLE;
+	m_setCount = 0;
+	m_resetCount += 1;
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::getStats() const
+{
+	Stats stats{};
+	stats.name = m_name;
+	stats.poolCount = as_uint32(m_usedPools.size() + m_freePools.size());
+	stats.setCount = m_setCount;
+	stats.peakSetCount = m_peakSetCount;
+	for (const auto& pool : m_poolCapacities)
+		stats.setCapacity += pool.second;
+	stats.overflowCount = m_overflowCount;
+	stats.resetCount = m_resetCount;
+
+	return stats;
+}
+
+void DescriptorAllocator::release()
+{
+	for (auto pool : m_usedPools)
+		vkDestroyDescriptorPool(m_device, pool, nullptr);
+	for (auto pool : m_freePools)
+		vkDestroyDescriptorPool(m_device, pool, nullptr);
+
+	m_usedPools.clear();
+	m_freePools.clear();
+	m_poolCapacities.clear();
+	m_currentPool = VK_NULL_HANDLE;
+	m_setCount = 0;
+}
+
+bool DescriptorAllocator::acquirePool()
+{
+	// Pools freed by the last reset come first, the allocator only grows when all of them are in use
+	if (!m_freePools.empty())
+	{
+		m_currentPool = m_freePools.back();
+		m_freePools.pop_back();
+	}
+	else
+	{
+		m_currentPool = createPool(m_setsPerPool);
+		m_setsPerPool = std::min(m_setsPerPool * 2u, c_maxSetsPerPool);
+	}
+
+	if (m_currentPool == VK_NULL_HANDLE)
+		return false;
+
+	m_usedPools.push_back(m_currentPool);
+	return true;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(m_ratios.size());
+	for (const auto& ratio : m_ratios)
+		poolSizes.push_back({ ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * setCount), 1u) });
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = as_uint32(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		printf("The '%s' descriptor allocator was not able to create a pool of %u sets!\n", m_name.c_str(), setCount);
+		return VK_NULL_HANDLE;
+	}
+
+	m_poolCapacities[pool] = setCount;
+	return pool;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "pch.h"
+#include "Common.h"
+
+// Hands out descriptor sets from a chain of pools. A pool is sized by setsPerPool times the ratio of each descriptor type,
+// once it runs out the allocation is retried from the next one, which is created twice as large as the last. Resetting
+// keeps the pools around for the next round of allocations, so a steady state allocates no pools at all.
+class DescriptorAllocator
+{
+public:
+	struct PoolSizeRatio
+	{
+		VkDescriptorType type;
+		float ratio;
+	};
+
+	struct Stats
+	{
+		std::string name;
+		uint32_t poolCount;
+		// Sets handed out since the last reset, and the most there ever were at once
+		uint32_t setCount;
+		uint32_t peakSetCount;
+		uint32_t setCapacity;
+		// Allocations that didn't fit the current pool and moved on to the next one
+		uint32_t overflowCount;
+		uint32_t resetCount;
+	};
+
+	constexpr static uint32_t c_maxSetsPerPool = 4096u;
+
+	DescriptorAllocator(VkDevice device, std::string&& name, const std::vector<PoolSizeRatio>& ratios, uint32_t initialSetsPerPool);
+
+	bool allocate(VkDescriptorSet& descriptorSet, VkDescriptorSetLayout layout);
+	bool allocate(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDescriptorSetLayout layout);
+
+	// Every set handed out so far becomes invalid, none of them may still be in use by the device.
+	void reset();
+
+	Stats getStats() const;
+
+	void release();
+
+private:
+	VkDevice m_device;
+	std::string m_name;
+	std::vector<PoolSizeRatio> m_ratios;
+	uint32_t m_setsPerPool;
+
+	VkDescriptorPool m_currentPool;
+	std::vector<VkDescriptorPool> m_usedPools;
+	std::vector<VkDescriptorPool> m_freePools;
+	std::unordered_map<VkDescriptorPool, uint32_t> m_poolCapacities;
+
+	uint32_t m_setCount;
+	uint32_t m_peakSetCount;
+	uint32_t m_overflowCount;
+	uint32_t m_resetCount;
+
+	bool allocate(VkDescriptorSet* descriptorSets, const VkDescriptorSetLayout* layouts, uint32_t count);
+	bool acquirePool();
+	VkDescriptorPool createPool(uint32_t setCount);
+};
@@ -1,27 +1,53 @@
 #include "pch.h"
 #include "DescriptorPoolManager.h"
 
-DescriptorPoolManager::DescriptorPoolManager(VkDevice device) : m_device(device), m_poolCollection() { m_instance = this; }
+namespace
+{
+	// Per descriptor set, every pass of the engine binds at most a couple of buffers and textures per set
+	const std::vector<DescriptorAllocator::PoolSizeRatio> c_defaultRatios =
+	{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f }
+	};
+
+	constexpr uint32_t c_persistentSetsPerPool = 64u;
+}
+
+DescriptorPoolManager::DescriptorPoolManager(VkDevice device) : m_device(device), m_persistent(), m_dedicated()
+{
+	m_instance = this;
+
+	m_persistent = MAKEUNQ<DescriptorAllocator>(device, "Persistent", c_defaultRatios, c_persistentSetsPerPool);
+}
 
 DescriptorPoolManager* DescriptorPoolManager::getInstance() { return m_instance; }
 
-VkDescriptorPool DescriptorPoolManager::createNewPool(uint32_t size)
+DescriptorAllocator& DescriptorPoolManager::getPersistent() { return *m_persistent; }
+
+DescriptorAllocator& DescriptorPoolManager::createAllocator(std::string&& name, const std::vector<DescriptorAllocator::PoolSizeRatio>& ratios, uint32_t setsPerPool)
 {
-	VkDescriptorPool pool{};
-	if (!vkinit::Descriptor::createDescriptorPool(pool, m_device, size))
-	{
-		printf("Was not able to allocate a new descriptor pool!\n");
-		return VK_NULL_HANDLE;
-	}
+	m_dedicated.push_back(MAKEUNQ<DescriptorAllocator>(m_device, std::move(name), ratios, setsPerPool));
+	return *m_dedicated.back();
+}
 
-	m_poolCollection.push_back(pool);
-	return m_poolCollection.back();
+std::vector<DescriptorAllocator::Stats> DescriptorPoolManager::getStats() const
+{
+	std::vector<DescriptorAllocator::Stats> stats;
+	stats.reserve(1 + m_dedicated.size());
+
+	stats.push_back(m_persistent->getStats());
+	for (const auto& allocator : m_dedicated)
+		stats.push_back(allocator->getStats());
+
+	return stats;
 }
 
 void DescriptorPoolManager::release()
 {
-	for (auto& pool : m_poolCollection)
-	{
-		vkDestroyDescriptorPool(m_device, pool, nullptr);
-	}
+	m_persistent->release();
+	for (auto& allocator : m_dedicated)
+		allocator->release();
+	m_dedicated.clear();
 }
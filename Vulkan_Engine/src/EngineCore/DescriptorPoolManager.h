@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "VkTypes/InitializersUtility.h"
 #include "Interfaces/IRequireInitialization.h"
+#include "DescriptorAllocator.h"
 
 class DescriptorPoolManager : IRequireInitialization
 {
@@ -10,12 +11,20 @@ public:
 	static DescriptorPoolManager* getInstance();
 
 	virtual bool isInitialized() const override { return true; }
-	VkDescriptorPool createNewPool(uint32_t size);
+
+	// Sets that live as long as their owner, the materials and the global state of the passes.
+	DescriptorAllocator& getPersistent();
+	// For sets the default ratios don't fit, such as large texture arrays. Owned by the manager.
+	DescriptorAllocator& createAllocator(std::string&& name, const std::vector<DescriptorAllocator::PoolSizeRatio>& ratios, uint32_t setsPerPool);
+
+	std::vector<DescriptorAllocator::Stats> getStats() const;
 
 	void release();
 
 private:
 	inline static DescriptorPoolManager* m_instance = nullptr;
 	VkDevice m_device;
-	std::vector<VkDescriptorPool> m_poolCollection;
+
+	UNQ<DescriptorAllocator> m_persistent;
+	std::vector<UNQ<DescriptorAllocator>> m_dedicated;
 };
@@ -4,7 +4,9 @@
 #include "Camera.h"
 #include "Engine/Window.h"
 #include "Presentation/Device.h"
+#include "VkTypes/VkPipelineCacheStore.h"
 #include "Engine/RenderLoopStatistics.h"
+#include "DescriptorPoolManager.h"
 
 ImGuiHandle::ImGuiHandle(VkInstance instance, VkPhysicalDevice activeGPU, const Presentation::Device* presentationDevice, VkRenderPass renderPass, uint32_t imageCount, Window* window)
 	: m_window(window)
@@ -54,6 +56,7 @@ ImGuiHandle::ImGuiHandle(VkInstance instance, VkPhysicalDevice activeGPU, const
 	init_info.MinImageCount = 2;
 	init_info.ImageCount = imageCount;
 	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	init_info.PipelineCache = VkPipelineCacheStore::getHandle();
 
 	ImGui_ImplVulkan_Init(&init_info, renderPass);
 
@@ -77,9 +80,34 @@ void ImGuiHandle::draw(const FrameStats& stats, Camera* cam, DirectionalLightPar
 	{
 		std::string statsText =
 			"Draw Calls: " + std::to_string(stats.drawCallCount) +
-			"\nRenderLoop: " + std::to_string(stats.renderLoop_ms) + " ms"
+			"\nIndirect / Direct draws: " + std::to_string(stats.indirectDrawCount) + " / " + std::to_string(stats.directDrawCount) +
+			"\nVisible renderers: " + std::to_string(stats.visibleCount) + " (" + std::to_string(stats.visibilityChangeCount) + " changed)" +
+			"\nShadow draw calls: " + std::to_string(stats.shadowDrawCallCount) +
+			"\nShadow casters / culled: " + std::to_string(stats.shadowCasterCount) + " / " + std::to_string(stats.shadowCulledCount) +
+			"\nShadow cache hits / misses: " + std::to_string(stats.shadowCacheHits) + " / " + std::to_string(stats.shadowCacheMisses) +
+			"\nOccluded / late visible: " + std::to_string(stats.occludedCount) + " / " + std::to_string(stats.lateVisibleCount) +
+			"\nGPU culling visible: " + std::to_string(stats.gpuVisibleCount) +
+			"\nTransform uploads: " + std::to_string(stats.transformUploadCount) +
+			"\nReduced LODs: " + std::to_string(stats.lodReducedCount) +
+			"\nUniform bytes: " + std::to_string(stats.uniformByteCount) +
+			"\nPending frames: " + std::to_string(stats.pendingFrameCount) +
+			"\nRenderLoop: " + std::to_string(stats.renderLoop_ms) + " ms" +
+			"\nGPU frame: " + std::to_string(stats.gpuFrame_us) + " us" +
+			"\nFrame interval / jitter: " + std::to_string(stats.frameInterval_us) + " / " + std::to_string(stats.frameJitter_us) + " us" +
+			"\nMissed deadlines: " + std::to_string(stats.missedDeadlineCount)
 			+ "\n\nPipeline count: " + std::to_string(stats.pipelineCount) +
 			+"\nDescriptor set count: " + std::to_string(stats.descriptorSetCount);
+
+		statsText += "\nRecording threads (us):";
+		for (uint32_t i = 0; i < stats.recordThreadCount; i++)
+			statsText += " " + std::to_string(stats.recordThread_us[i]);
+
+		// Startup regressions show up here, a warm cache should create the same pipelines much faster than a cold one
+		if (const auto pipelineCache = VkPipelineCacheStore::getInstance())
+		{
+			statsText += "\nPipeline cache (" + std::string(pipelineCache->isWarm() ? "warm" : "cold") + "): " +
+				std::to_string(pipelineCache->getPipelineCount()) + " pipelines in " + std::to_string(pipelineCache->getCreationTime_us()) + " us";
+		}
 		ImGui::Text(statsText.c_str());
 	}
 
@@ -87,8 +115,22 @@ void ImGuiHandle::draw(const FrameStats& stats, Camera* cam, DirectionalLightPar
 	if (frameSettingsCollapsed)
 	{
 		ImGui::Checkbox("Shadows", &settings->enableShadowPass);
+		ImGui::Checkbox("Shadow cache", &settings->enableShadowCache);
 		// ImGui::Checkbox("Forward", &settings->enableForwardPass);
 		ImGui::Checkbox("Debug", &settings->enableDebugShadowMap);
+		ImGui::Checkbox("Indirect draw", &settings->enableIndirectDraw);
+		ImGui::Checkbox("BVH culling", &settings->enableHierarchicalCulling);
+		ImGui::Checkbox("Occlusion culling", &settings->enableOcclusionCulling);
+		ImGui::Checkbox("GPU culling", &settings->enableGpuCulling);
+		ImGui::Checkbox("LODs", &settings->enableLods);
+		ImGui::SliderFloat("LOD screen size", &settings->lodScreenSize, 0.01f, 1.0f);
+		ImGui::SliderFloat("LOD hysteresis", &settings->lodHysteresis, 0.0f, 0.5f);
+		ImGui::SliderInt("Recording threads", &settings->recordingThreadCount, 1, static_cast<int>(FrameSettings::c_maxRecordingThreads));
+		ImGui::SliderInt("Frames in flight", &settings->framesInFlight, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT));
+		ImGui::Combo("Frame pacing", &settings->framePacing, "Uncapped\0Fixed rate\0Just in time\0");
+		ImGui::SliderInt("Target FPS", &settings->targetFps, 15, 360);
+		// In the order of the VkPresentModeKHR values
+		ImGui::Combo("Present mode", &settings->presentMode, "Immediate\0Mailbox\0FIFO\0FIFO relaxed\0");
 	}
 
 	bool cameraParamsCollapsed = ImGui::CollapsingHeader("Camera params");
@@ -114,6 +156,16 @@ void ImGuiHandle::draw(const FrameStats& stats, Camera* cam, DirectionalLightPar
 		ImGui::DragFloat("Normal Bias", &light->normalBias, 0.025f, -1.f, 1.f);
 		ImGui::DragFloat("Ambient light", &light->ambient, 0.02f, 0.0f, 0.5f);
 	}
+
+	bool descriptorPoolsCollapsed = ImGui::CollapsingHeader("Descriptor pools");
+	if (descriptorPoolsCollapsed)
+	{
+		for (const auto& pool : DescriptorPoolManager::getInstance()->getStats())
+		{
+			ImGui::Text("%s: %u / %u sets (peak %u), %u pools, %u overflows, %u resets",
+				pool.name.c_str(), pool.setCount, pool.setCapacity, pool.peakSetCount, pool.poolCount, pool.overflowCount, pool.resetCount);
+		}
+	}
 	ImGui::End();
 	
 	ImGui::Render();
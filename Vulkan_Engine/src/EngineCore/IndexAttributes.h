@@ -8,6 +8,8 @@ public:
 	IndexAttributes(VkBuffer indexBuffer, VmaAllocation indexBufferMemory, uint32_t iCount, VkIndexType indexType, VkDeviceSize offset = 0);
 
 	uint32_t getIndexCount() const { return iCount; }
+	VkBuffer getBuffer() const { return buffer; }
+	VkIndexType getIndexType() const { return indexType; }
 	void bind(VkCommandBuffer commandBuffer) const;
 
 	void destroy(VmaAllocator allocator);
@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "IndirectDrawBuffers.h"
+#include "VkTypes/InitializersUtility.h"
+#include "VkTypes/VkMemoryAllocator.h"
+#include "DescriptorAllocator.h"
+
+IndirectDrawBuffers::IndirectDrawBuffers(VkDevice device, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t initialDrawCapacity)
+	: m_isInitialized(false), m_device(device), m_frames(), m_currentFrame(0), m_drawCount(0), m_residentCount(0)
+{
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets{};
+	if (!allocator.allocate(descriptorSets, layout))
+		return;
+
+	m_isInitialized = true;
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].descriptorSet = descriptorSets[i];
+		m_isInitialized = m_isInitialized && allocateFrame(m_frames[i], initialDrawCapacity);
+	}
+}
+
+bool IndirectDrawBuffers::isInitialized() const { return m_isInitialized; }
+
+bool IndirectDrawBuffers::startFrame(uint32_t frameIndex, uint32_t drawCapacity, uint32_t residentCount, uint32_t residentVersion)
+{
+	assert(residentCount <= drawCapacity);
+
+	m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+	m_drawCount = 0;
+	m_residentCount = 0;
+
+	// The previous submission using this frame's buffers has already completed, they can be replaced.
+	auto& frame = m_frames[m_currentFrame];
+	if (drawCapacity > frame.capacity)
+	{
+		auto capacity = std::max(frame.capacity, 1u);
+		while (capacity < drawCapacity)
+			capacity *= 2u;
+
+		releaseFrame(frame);
+		if (!allocateFrame(frame, capacity))
+		{
+			printf("Could not grow the indirect draw buffers to %u draws.\n", capacity);
+			return false;
+		}
+	}
+
+	// New buffers or a different set of resident draws, none of the written transforms can be kept
+	if (frame.residentVersion != residentVersion || frame.residentVersions.size() != residentCount)
+	{
+		frame.residentVersions.assign(residentCount, c_staleTransformVersion);
+		frame.residentVersion = residentVersion;
+	}
+
+	m_residentCount = residentCount;
+	m_drawCount = residentCount;
+	return true;
+}
+
+uint32_t IndirectDrawBuffers::push(const glm::mat4& model, uint32_t materialIndex, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset)
+{
+	const auto drawIndex = reserve(1u);
+	write(drawIndex, model, materialIndex, indexCount, firstIndex, vertexOffset);
+
+	return drawIndex;
+}
+
+uint32_t IndirectDrawBuffers::reserve(uint32_t drawCount)
+{
+	assert(m_drawCount + drawCount <= m_frames[m_currentFrame].capacity);
+
+	const auto firstDraw = m_drawCount;
+	m_drawCount += drawCount;
+	return firstDraw;
+}
+
+void IndirectDrawBuffers::write(uint32_t drawIndex, const glm::mat4& model, uint32_t materialIndex, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset)
+{
+	auto& frame = m_frames[m_currentFrame];
+	assert(drawIndex < m_drawCount);
+
+	frame.mappedTransforms[drawIndex] = model;
+	frame.mappedMaterials[drawIndex] = materialIndex;
+
+	auto& command = frame.mappedCommands[drawIndex];
+	command.indexCount = indexCount;
+	command.instanceCount = 1u;
+	command.firstIndex = firstIndex;
+	command.vertexOffset = vertexOffset;
+	command.firstInstance = drawIndex;
+}
+
+bool IndirectDrawBuffers::isResidentCurrent(uint32_t drawIndex, uint32_t transformVersion) const
+{
+	assert(drawIndex < m_residentCount);
+	return m_frames[m_currentFrame].residentVersions[drawIndex] == transformVersion;
+}
+
+void IndirectDrawBuffers::writeResident(uint32_t drawIndex, uint32_t transformVersion, const glm::mat4& model, uint32_t materialIndex)
+{
+	auto& frame = m_frames[m_currentFrame];
+	assert(drawIndex < m_residentCount);
+
+	frame.mappedTransforms[drawIndex] = model;
+	frame.mappedMaterials[drawIndex] = materialIndex;
+	frame.residentVersions[drawIndex] = transformVersion;
+}
+
+uint32_t IndirectDrawBuffers::getDrawCount() const { return m_drawCount; }
+
+void IndirectDrawBuffers::flush()
+{
+	if (m_drawCount == 0)
+		return;
+
+	const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+	const auto& frame = m_frames[m_currentFrame];
+	vmaFlushAllocation(allocator, frame.transformsMemory, 0, m_drawCount * sizeof(glm::mat4));
+	vmaFlushAllocation(allocator, frame.materialsMemory, 0, m_drawCount * sizeof(uint32_t));
+	vmaFlushAllocation(allocator, frame.commandsMemory, 0, getCommandOffset(m_drawCount));
+}
+
+VkBuffer IndirectDrawBuffers::getCommandBuffer() const { return m_frames[m_currentFrame].commands; }
+
+VkBuffer IndirectDrawBuffers::getTransformBuffer() const { return m_frames[m_currentFrame].transforms; }
+
+const VkDescriptorSet* IndirectDrawBuffers::getDescriptorSet() const { return &m_frames[m_currentFrame].descriptorSet; }
+
+void IndirectDrawBuffers::release()
+{
+	for (auto& frame : m_frames)
+	{
+		releaseFrame(frame);
+	}
+}
+
+bool IndirectDrawBuffers::allocateFrame(FrameBuffers& frame, uint32_t capacity)
+{
+	const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+
+	// CPU_TO_GPU memory is written once per frame and read once by the GPU, it stays mapped for the whole lifetime.
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationInfo transformsInfo{};
+	bufferInfo.size = capacity * sizeof(glm::mat4);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &frame.transforms, &frame.transformsMemory, &transformsInfo) != VK_SUCCESS)
+		return false;
+
+	VmaAllocationInfo materialsInfo{};
+	bufferInfo.size = capacity * sizeof(uint32_t);
+	if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &frame.materials, &frame.materialsMemory, &materialsInfo) != VK_SUCCESS)
+	{
+		vmaDestroyBuffer(allocator, frame.transforms, frame.transformsMemory);
+		frame.transforms = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VmaAllocationInfo commandsInfo{};
+	bufferInfo.size = capacity * sizeof(VkDrawIndexedIndirectCommand);
+	// The culling compute shaders write the instance counts or the whole commands
+	bufferInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &frame.commands, &frame.commandsMemory, &commandsInfo) != VK_SUCCESS)
+	{
+		vmaDestroyBuffer(allocator, frame.transforms, frame.transformsMemory);
+		vmaDestroyBuffer(allocator, frame.materials, frame.materialsMemory);
+		frame.transforms = VK_NULL_HANDLE;
+		frame.materials = VK_NULL_HANDLE;
+		return false;
+	}
+
+	frame.mappedTransforms = static_cast<glm::mat4*>(transformsInfo.pMappedData);
+	frame.mappedMaterials = static_cast<uint32_t*>(materialsInfo.pMappedData);
+	frame.mappedCommands = static_cast<VkDrawIndexedIndirectCommand*>(commandsInfo.pMappedData);
+	frame.capacity = capacity;
+
+	// Binding 0 holds the transforms, binding 1 the material indices
+	std::array<VkDescriptorBufferInfo, 2> descriptorBufferInfos{};
+	descriptorBufferInfos[0].buffer = frame.transforms;
+	descriptorBufferInfos[0].offset = 0;
+	descriptorBufferInfos[0].range = VK_WHOLE_SIZE;
+	descriptorBufferInfos[1].buffer = frame.materials;
+	descriptorBufferInfos[1].offset = 0;
+	descriptorBufferInfos[1].range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+	for (uint32_t i = 0; i < descriptorWrites.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = frame.descriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &descriptorBufferInfos[i];
+	}
+	vkUpdateDescriptorSets(m_device, as_uint32(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	return true;
+}
+
+void IndirectDrawBuffers::releaseFrame(FrameBuffers& frame)
+{
+	const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+
+	if (frame.transforms != VK_NULL_HANDLE)
+		vmaDestroyBuffer(allocator, frame.transforms, frame.transformsMemory);
+	if (frame.materials != VK_NULL_HANDLE)
+		vmaDestroyBuffer(allocator, frame.materials, frame.materialsMemory);
+	if (frame.commands != VK_NULL_HANDLE)
+		vmaDestroyBuffer(allocator, frame.commands, frame.commandsMemory);
+
+	frame.transforms = VK_NULL_HANDLE;
+	frame.materials = VK_NULL_HANDLE;
+	frame.commands = VK_NULL_HANDLE;
+	frame.mappedTransforms = nullptr;
+	frame.mappedMaterials = nullptr;
+	frame.mappedCommands = nullptr;
+	frame.capacity = 0;
+	frame.residentVersions.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "pch.h"
+#include "Common.h"
+#include "Interfaces/IRequireInitialization.h"
+
+class DescriptorAllocator;
+
+// Per frame model matrices and material indices (storage buffers) and indexed draw commands, all written through persistently mapped memory.
+// The command of a draw sets firstInstance to the draw index, the vertex shader reads its transform and material at gl_InstanceIndex.
+// The first draws of a frame can be kept resident, their transforms and materials survive until the frame slot is used again
+// and only the ones whose transform version changed since are written.
+class IndirectDrawBuffers : IRequireInitialization
+{
+public:
+	constexpr static uint32_t c_initialDrawCapacity = 1024u;
+
+	IndirectDrawBuffers(VkDevice device, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t initialDrawCapacity = c_initialDrawCapacity);
+	bool isInitialized() const override;
+
+	// Restarts the draw list of this frame, the buffers grow when they can't hold the requested draw count.
+	// The first residentCount draws are resident, they are all rewritten when the residentVersion differs from the last one of this frame slot.
+	bool startFrame(uint32_t frameIndex, uint32_t drawCapacity, uint32_t residentCount = 0, uint32_t residentVersion = 0);
+
+	// Returns the draw index, which is also the offset of its command and its transform.
+	uint32_t push(const glm::mat4& model, uint32_t materialIndex, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+	// Hands out a contiguous range of draw indices and returns the first one. The range is filled through write,
+	// which is safe to call from several threads as long as each writes its own indices.
+	uint32_t reserve(uint32_t drawCount);
+	void write(uint32_t drawIndex, const glm::mat4& model, uint32_t materialIndex, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+	// Resident draws only have their transform and material written, their commands are written on the GPU.
+	// Whether the resident draw still holds the transform of this version in the current frame slot.
+	bool isResidentCurrent(uint32_t drawIndex, uint32_t transformVersion) const;
+	void writeResident(uint32_t drawIndex, uint32_t transformVersion, const glm::mat4& model, uint32_t materialIndex);
+	uint32_t getResidentCount() const { return m_residentCount; }
+	uint32_t getDrawCount() const;
+
+	// Makes the writes of this frame visible to the device, a no-op on host coherent memory.
+	void flush();
+
+	VkBuffer getCommandBuffer() const;
+	VkBuffer getTransformBuffer() const;
+	const VkDescriptorSet* getDescriptorSet() const;
+	static VkDeviceSize getCommandOffset(uint32_t drawIndex) { return drawIndex * static_cast<VkDeviceSize>(sizeof(VkDrawIndexedIndirectCommand)); }
+
+	void release();
+
+private:
+	struct FrameBuffers
+	{
+		VkBuffer transforms;
+		VmaAllocation transformsMemory;
+		glm::mat4* mappedTransforms;
+
+		VkBuffer materials;
+		VmaAllocation materialsMemory;
+		uint32_t* mappedMaterials;
+
+		VkBuffer commands;
+		VmaAllocation commandsMemory;
+		VkDrawIndexedIndirectCommand* mappedCommands;
+
+		VkDescriptorSet descriptorSet;
+		uint32_t capacity;
+
+		// The transform version each resident draw was written with
+		std::vector<uint32_t> residentVersions;
+		uint32_t residentVersion;
+	};
+
+	constexpr static uint32_t c_staleTransformVersion = std::numeric_limits<uint32_t>::max();
+
+	bool m_isInitialized;
+	VkDevice m_device;
+
+	std::array<FrameBuffers, MAX_FRAMES_IN_FLIGHT> m_frames;
+	uint32_t m_currentFrame;
+	uint32_t m_drawCount;
+	uint32_t m_residentCount;
+
+	bool allocateFrame(FrameBuffers& frame, uint32_t capacity);
+	void releaseFrame(FrameBuffers& frame);
+};
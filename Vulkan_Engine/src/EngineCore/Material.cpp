@@ -8,11 +8,24 @@
 #include "VkTypes/VkTexture.h"
 #include "VkTypes/VkShader.h"
 
-VkMaterial::VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets)
+VkMaterial::VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets)
 	: shader(&shader), texture(&texture), variant(pipeline, pipelineLayout, descriptorSetLayout, descriptorSets)
 {
 }
 
+VkMaterial::VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, uint32_t textureIndex)
+	: shader(&shader), texture(&texture), variant(pipeline, pipelineLayout, textureIndex)
+{
+}
+
+void VkMaterial::rebindTexture(const VkTexture2D& newTexture, const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets)
+{
+	texture = &newTexture;
+	variant.setDescriptorSets(descriptorSets);
+}
+
+void VkMaterial::rebindTexture(const VkTexture2D& newTexture) { texture = &newTexture; }
+
 void VkMaterial::release(VkDevice device)
 {
 	shader = nullptr;
@@ -21,23 +34,32 @@ void VkMaterial::release(VkDevice device)
 	variant.release(device);
 }
 
-// WRITE
-void Material::serialize(boost::archive::binary_oarchive& ar, const unsigned int version)
+TextureSource Material::getSerializedTextureSource() const
 {
-	ar& m_shaderIdentifier;
+	TextureSource source = m_textureParameters;
 
-	const std::string compressedAlternative = Directories::getWorkingDirectory().combine(m_textureParameters.getTextureName(false) + ".dds");
+	const std::string compressedAlternative = Directories::getWorkingDirectory().combine(source.getTextureName(false) + ".dds");
 	if (std::filesystem::exists(compressedAlternative))
 	{
-		m_textureParameters.path.value = compressedAlternative;
-		m_textureParameters.format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
-		m_textureParameters.generateTheMips = false;
+		source.path.value = compressedAlternative;
+		source.format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		source.generateTheMips = false;
 	}
 
 	// Always serializing relative path
-	m_textureParameters.path.removeDirectory(Directories::getWorkingDirectory());
-	// printf("path: %s\n", Directories::getWorkingDirectory().combine(m_textureParameters.path.value).value.c_str());
-	assert(std::filesystem::exists(Directories::getWorkingDirectory().combine(m_textureParameters.path.value).value));
+	source.path.removeDirectory(Directories::getWorkingDirectory());
+	// printf("path: %s\n", Directories::getWorkingDirectory().combine(source.path.value).value.c_str());
+	assert(std::filesystem::exists(Directories::getWorkingDirectory().combine(source.path.value).value));
+
+	return source;
+}
+
+// WRITE
+void Material::serialize(boost::archive::binary_oarchive& ar, const unsigned int version)
+{
+	ar& m_shaderIdentifier;
+
+	m_textureParameters = getSerializedTextureSource();
 
 	ar& m_textureParameters.path.value;
 	ar& m_textureParameters.format;
@@ -82,6 +82,7 @@ public:
 	const TextureSource& getTextureSource() const { return m_textureParameters; }
 	uint32_t getShaderIdentifier() const { return m_shaderIdentifier; }
 	size_t getHash() const { return m_hash; }
+	TextureSource getSerializedTextureSource() const;
 	
 	void serialize(boost::archive::binary_oarchive& ar, const unsigned int version); // WRITE
 	void serialize(boost::archive::binary_iarchive& ar, const unsigned int version); // READ
@@ -105,9 +106,13 @@ private:
 
 struct VkMaterial
 {
-	VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets);
+	VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets);
+	VkMaterial(const VkShader& shader, const VkTexture2D& texture, const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, uint32_t textureIndex);
 
 	const VkMaterialVariant& getMaterialVariant() const { return variant; }
+	void rebindTexture(const VkTexture2D& newTexture, const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets);
+	// The texture table slot of the material has to be pointed at the new texture as well.
+	void rebindTexture(const VkTexture2D& newTexture);
 	void release(VkDevice device);
 
 	const VkShader* shader;
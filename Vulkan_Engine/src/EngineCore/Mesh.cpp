@@ -4,10 +4,15 @@
 #include "VkTypes/VkMesh.h"
 #include "Mesh.h"
 #include "VertexAttributes.h"
-#include "Presentation/Device.h"
 #include "StagingBufferPool.h"
+#include "Math/MeshSimplifier.h"
 
-MeshDescriptor Mesh::defaultMeshDescriptor = MeshDescriptor();
+MeshDescriptor Mesh::defaultMeshDescriptor = MeshDescriptor(MeshDescriptor::EVertexFormat::Compact);
+static bool use_16bit_indices = true;
+
+void Mesh::setVertexFormat(MeshDescriptor::EVertexFormat vertexFormat) { defaultMeshDescriptor = MeshDescriptor(vertexFormat); }
+void Mesh::setUse16BitIndices(bool use16BitIndices) { use_16bit_indices = use16BitIndices; }
+bool Mesh::getUse16BitIndices() { return use_16bit_indices; }
 
 Mesh::Mesh(const Mesh& mesh) : m_positions(mesh.m_positions), m_uvs(mesh.m_uvs), m_normals(mesh.m_normals), m_colors(mesh.m_colors), m_submeshes(mesh.m_submeshes) { updateMetaData(); }
 
@@ -31,7 +36,7 @@ Mesh::Mesh(std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs, std::
 	updateMetaData();
 }
 
-Mesh::Mesh() : vectors(), metaData() {}
+Mesh::Mesh() : metaData() {}
 
 Mesh::Mesh(size_t vertN, size_t indexN)
 {
@@ -111,185 +116,308 @@ bool MeshDescriptor::operator ==(const MeshDescriptor& other) const
 {
 	for (int i = 0; i < descriptorCount; i++)
 	{
-		if (elementByteSizes[i] != other.elementByteSizes[i] ||
+		if (elementByteSizes[i] != other.elementByteSizes[i] || formats[i] != other.formats[i] ||
 			std::min(lengths[i], 1_z) != std::min(other.lengths[i], 1_z))
 			return false;
 	}
-	return true;
+	return format == other.format;
 }
 
 bool MeshDescriptor::operator !=(const MeshDescriptor& other) const { return !(*this == other); }
 
+size_t MeshDescriptor::getVertexStride() const
+{
+	size_t vertexStride = 0;
+	for (int i = 0; i < descriptorCount; i++)
+		vertexStride += std::clamp(lengths[i], 0_z, 1_z) * elementByteSizes[i];
+
+	return vertexStride;
+}
+
+VkIndexType MeshDescriptor::getIndexType(size_t vertexCount)
+{
+	// Primitive restart is disabled, so the last 16 bit index addresses a vertex as well
+	constexpr size_t maxVertexCount16 = static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1;
+	if (use_16bit_indices && vertexCount <= maxVertexCount16)
+		return VkIndexType::VK_INDEX_TYPE_UINT16;
+
+	static_assert(sizeof(MeshDescriptor::TVertexIndices) == sizeof(uint32_t), "The CPU indices are expected to be 32 bit.");
+	return VkIndexType::VK_INDEX_TYPE_UINT32;
+}
+
+size_t MeshDescriptor::getIndexByteSize(VkIndexType indexType)
+{
+	assert((indexType == VK_INDEX_TYPE_UINT16 || indexType == VK_INDEX_TYPE_UINT32) && "The index type is not supported.");
+	return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 template<typename T>
-inline void Mesh::mapAndCopyBuffer(VmaAllocator vmaAllocator, VmaAllocation memRange, const T* source, size_t elementCount, size_t totalByteSize, const char* message)
+static bool stageBuffer(StagingBufferPool& stagingPool, StagingBufferPool::StgBuffer& stagingBuffer, const T* source, size_t elementCount, size_t totalByteSize, const char* message)
 {
-	void* data;
-	vmaMapMemory(vmaAllocator, memRange, &data);
-	memcpy(data, source, totalByteSize);
-	vmaUnmapMemory(vmaAllocator, memRange);
+	if (!stagingPool.stage(stagingBuffer, source, as_uint32(totalByteSize)))
+		return false;
 
 #ifdef VERBOSE_INFO_MESSAGE
 	printf(message, elementCount, totalByteSize, totalByteSize / static_cast<float>(elementCount));
 #endif
+	return true;
 }
 
-bool Mesh::allocateVertexAttributes(VkMesh& graphicsMesh, const VmaAllocator& vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool)
+size_t Mesh::getVertexStride() const { return metaData.getVertexStride(); }
+VkIndexType Mesh::getIndexType() const { return MeshDescriptor::getIndexType(m_positions.size()); }
+
+size_t Mesh::getIndexCount() const
 {
-	size_t vertCount = m_positions.size();
+	size_t indexCount = 0;
+	for (auto& submesh : m_submeshes)
+	{
+		indexCount += submesh.getIndexCount();
+		for (auto& lod : submesh.m_lods)
+			indexCount += lod.size();
+	}
 
-	constexpr size_t descriptorCount = MeshDescriptor::descriptorCount;
-	auto& byteSizes = metaData.elementByteSizes;
-	auto& vectorSizes = metaData.lengths;
+	return indexCount;
+}
 
-	size_t strides[descriptorCount];
-	for (int i = 0; i < descriptorCount; i++)
-		strides[i] = std::clamp(metaData.lengths[i], 0_z, 1_z) * byteSizes[i];
+void Mesh::generateLods(uint32_t lodCount, float lodReduction, float maxRelativeError)
+{
+	// A level that removes less than this share of the previous one is not worth switching to
+	constexpr float minLodSaving = 0.1f;
+
+	for (auto& submesh : m_submeshes)
+	{
+		submesh.m_lods.clear();
+		if (lodCount < 2)
+			continue;
+
+		submesh.m_lods.reserve(lodCount - 1);
+		const float maxError = glm::length(submesh.m_bounds.extents) * 2.0f * maxRelativeError;
 
-	size_t vertexStride = sumValues(strides, descriptorCount);
-	size_t floatCount = vertexStride / sizeof(float);
+		const auto* source = &submesh.m_indices;
+		for (uint32_t lod = 1; lod < lodCount; lod++)
+		{
+			const auto targetIndexCount = static_cast<size_t>(source->size() * lodReduction) / 3 * 3;
+
+			std::vector<MeshDescriptor::TVertexIndices> indices;
+			MeshSimplifier::simplify(indices, *source, m_positions, targetIndexCount, maxError);
+
+			// Stalls on meshes made of seams and borders, the following levels would only repeat it
+			if (indices.empty() || indices.size() > source->size() * (1.0f - minLodSaving))
+				break;
+
+			submesh.m_lods.push_back(std::move(indices));
+			source = &submesh.m_lods.back();
+		}
+	}
+}
+
+bool Mesh::uploadVertexAttributes(VkBuffer vertexBuffer, uint32_t firstVertex, const VertexQuantization::PositionRange& positionRange, StagingBufferPool& stagingPool)
+{
+	size_t vertCount = m_positions.size();
+
+	size_t vertexStride = metaData.getVertexStride();
 	size_t totalSizeBytes = vertexStride * vertCount;
-	// Align and optimize the mesh data
-	auto interleavedCount = floatCount * vertCount;
-	std::vector<float> interleavedVertexData(interleavedCount);
+	// Interleave the attributes in the layout of the descriptor
+	std::vector<uint8_t> interleavedVertexData(totalSizeBytes);
 
 	size_t offset = 0;
-	for (int i = 0; i < descriptorCount; i++)
+	const auto interleave = [&](size_t attribute, auto&& encode)
 	{
-		if (vectorSizes[i] == 0)
-			continue;
+		if (metaData.lengths[attribute] == 0)
+			return;
 
-		copyInterleavedNoCheck(interleavedVertexData, vectors[i], byteSizes[i], floatCount, offset);
-		offset += strides[i] / sizeof(float);
+		assert(sizeof(encode(0)) == metaData.elementByteSizes[attribute] && "The encoded vertex attribute does not match the descriptor.");
+		for (size_t v = 0; v < vertCount; v++)
+		{
+			const auto value = encode(v);
+			memcpy(interleavedVertexData.data() + v * vertexStride + offset, &value, sizeof(value));
+		}
+		offset += metaData.elementByteSizes[attribute];
+	};
+
+	if (metaData.format == MeshDescriptor::EVertexFormat::Compact)
+	{
+		interleave(0, [&](size_t v) { return VertexQuantization::encodePosition(m_positions[v], positionRange); });
+		interleave(1, [&](size_t v) { return VertexQuantization::encodeUV(m_uvs[v]); });
+		interleave(2, [&](size_t v) { return VertexQuantization::encodeNormal(positionRange.toQuantizedNormal(m_normals[v])); });
+		interleave(3, [&](size_t v) { return VertexQuantization::encodeColor(m_colors[v]); });
+	}
+	else
+	{
+		interleave(0, [&](size_t v) { return m_positions[v]; });
+		interleave(1, [&](size_t v) { return m_uvs[v]; });
+		interleave(2, [&](size_t v) { return m_normals[v]; });
+		interleave(3, [&](size_t v) { return m_colors[v]; });
 	}
 
 	// Copy to staging buffer
 	StagingBufferPool::StgBuffer stagingBuffer;
-	stagingPool.claimAStagingBuffer(stagingBuffer, as_uint32(totalSizeBytes));
-	mapAndCopyBuffer(vmaAllocator, stagingBuffer.allocation, interleavedVertexData.data(), vertCount, totalSizeBytes,
-		"Copied vertex buffer of size: %zu elements and %zu bytes (%f bytes per vertex).\n");
-
-	// Allocate permanent buffer
-	VkBuffer vBuffer;
-	VmaAllocation vMemRange;
-	if (!vkinit::MemoryBuffer::allocateBufferAndMemory(vBuffer, vMemRange, vmaAllocator, as_uint32(totalSizeBytes), VMA_MEMORY_USAGE_GPU_ONLY, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+	if (!stageBuffer(stagingPool, stagingBuffer, interleavedVertexData.data(), vertCount, totalSizeBytes,
+		"Copied vertex buffer of size: %zu elements and %zu bytes (%f bytes per vertex).\n"))
 	{
-		printf("Could not allocate vertex memory buffer.\n");
+		printf("Could not claim staging memory for the vertex buffer.\n");
 		return false;
 	}
 
-	// Copy from staging buffer to permanent buffer
-	presentationDevice->submitImmediatelyAndWaitCompletion([=](VkCommandBuffer cmd) {
-		VkBufferCopy copyRegion{};
-		copyRegion.size = as_uint32(totalSizeBytes);
-
-		vkCmdCopyBuffer(cmd, stagingBuffer.buffer, vBuffer, 1, &copyRegion);
-	});
-	// Release staging buffer back to the pool
-	stagingPool.freeBuffer(stagingBuffer);
-
-	std::vector<VkBuffer> vBuffers{ vBuffer };
-	std::vector<VkDeviceSize> vOffsets{ 0 };
-	std::vector<VmaAllocation> vMemRanges{ vMemRange };
-	graphicsMesh.vAttributes = MAKEUNQ<VertexAttributes>(vBuffers, vMemRanges, vOffsets);
-	graphicsMesh.vCount = as_uint32(vertCount);
+	// Copy from staging buffer to the scene buffer, goes out with the rest of the staging batch
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = stagingBuffer.offset;
+	copyRegion.dstOffset = static_cast<VkDeviceSize>(firstVertex) * vertexStride;
+	copyRegion.size = totalSizeBytes;
+	vkCmdCopyBuffer(stagingPool.getBatchCommandBuffer(), stagingBuffer.buffer, vertexBuffer, 1, &copyRegion);
 
 	return true;
 }
 
-bool Mesh::allocateIndexAttributes(VkMesh& graphicsMesh, const SubMesh& submesh, VmaAllocator vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool)
+void Mesh::optimizeForGpu(MeshOptimizer::CacheStats& before, MeshOptimizer::CacheStats& after)
 {
-	size_t totalSize = vectorsizeof(submesh.m_indices);
-	auto indexCount = submesh.getIndexCount();
-
-	// Copy to staging buffer
-	StagingBufferPool::StgBuffer stagingBuffer;
-	stagingPool.claimAStagingBuffer(stagingBuffer, as_uint32(totalSize));
-
-	// Fill the index buffer
-	mapAndCopyBuffer(vmaAllocator, stagingBuffer.allocation, submesh.m_indices.data(), indexCount / 3, totalSize,
-		"Copied index buffer of size: %zu triangles and %zu bytes (%f bytes per triangle).\n");
+	// Costs at most this much of the cache efficiency to sort the clusters for overdraw
+	constexpr float overdrawThreshold = 1.05f;
 
-	// Allocate permanent buffer
-	VkBuffer iBuffer;
-	VmaAllocation iMemRange;
-	if (!vkinit::MemoryBuffer::allocateBufferAndMemory(iBuffer, iMemRange, vmaAllocator, as_uint32(totalSize), VMA_MEMORY_USAGE_CPU_TO_GPU, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+	const auto vertexCount = m_positions.size();
+	std::vector<const std::vector<MeshDescriptor::TVertexIndices>*> indexLists;
+	std::vector<MeshDescriptor::TVertexIndices> cacheOrder;
+	for (auto& submesh : m_submeshes)
 	{
-		printf("Could not allocate index memory buffer.\n");
-		return false;
-	}
+		const auto optimize = [&](std::vector<MeshDescriptor::TVertexIndices>& indices)
+		{
+			before.add(MeshOptimizer::analyzeVertexCache(indices, vertexCount));
 
-	// Copy from staging buffer to permanent buffer
-	presentationDevice->submitImmediatelyAndWaitCompletion([=](VkCommandBuffer cmd) {
-		VkBufferCopy copyRegion{};
-		copyRegion.size = as_uint32(totalSize);
+			MeshOptimizer::optimizeVertexCache(cacheOrder, indices, vertexCount);
+			MeshOptimizer::optimizeOverdraw(indices, cacheOrder, m_positions, submesh.m_bounds.center, overdrawThreshold);
+			indexLists.push_back(&indices);
+		};
 
-		vkCmdCopyBuffer(cmd, stagingBuffer.buffer, iBuffer, 1, &copyRegion);
-	});
-	// Release staging buffer back to the pool
-	stagingPool.freeBuffer(stagingBuffer);
+		optimize(submesh.m_indices);
+		for (auto& lod : submesh.m_lods)
+			optimize(lod);
+	}
 
-	VkIndexType indexPrecision = VkIndexType::VK_INDEX_TYPE_MAX_ENUM;
-	if (sizeof(MeshDescriptor::TVertexIndices) == sizeof(uint16_t))
-		indexPrecision = VkIndexType::VK_INDEX_TYPE_UINT16;
-	if(sizeof(MeshDescriptor::TVertexIndices) == sizeof(uint32_t)) 
-		indexPrecision = VkIndexType::VK_INDEX_TYPE_UINT32;
-	assert(indexPrecision != VkIndexType::VK_INDEX_TYPE_MAX_ENUM);
+	std::vector<uint32_t> remap;
+	const auto referencedCount = MeshOptimizer::buildVertexFetchRemap(remap, indexLists, vertexCount);
+	for (auto& submesh : m_submeshes)
+	{
+		for (auto& index : submesh.m_indices)
+			index = remap[index];
+		for (auto& lod : submesh.m_lods)
+		{
+			for (auto& index : lod)
+				index = remap[index];
+		}
+	}
 
-	graphicsMesh.iAttributes.emplace_back(
-		iBuffer, iMemRange, as_uint32(indexCount), indexPrecision
-	);
+	// The optional attributes are either empty or one per vertex
+	MeshOptimizer::remapVertices(m_positions, remap, referencedCount);
+	if (m_uvs.size() == vertexCount)
+		MeshOptimizer::remapVertices(m_uvs, remap, referencedCount);
+	if (m_normals.size() == vertexCount)
+		MeshOptimizer::remapVertices(m_normals, remap, referencedCount);
+	if (m_colors.size() == vertexCount)
+		MeshOptimizer::remapVertices(m_colors, remap, referencedCount);
+	updateMetaData();
 
-	return true;
+	for (const auto& submesh : m_submeshes)
+	{
+		after.add(MeshOptimizer::analyzeVertexCache(submesh.m_indices, referencedCount));
+		for (const auto& lod : submesh.m_lods)
+			after.add(MeshOptimizer::analyzeVertexCache(lod, referencedCount));
+	}
 }
 
-void Mesh::copyInterleavedNoCheck(std::vector<float>& interleavedVertexData, const void* src, size_t elementByteSize, size_t iterStride, size_t offset)
+bool Mesh::uploadIndexAttributes(const std::vector<MeshDescriptor::TVertexIndices>& indices, VkIndexType indexType, VkBuffer indexBuffer, uint32_t firstIndex, StagingBufferPool& stagingPool)
 {
-	int i = 0;
-	auto it = interleavedVertexData.begin();
-	auto end = interleavedVertexData.end();
-	std::advance(it, offset);
+	const auto indexByteSize = MeshDescriptor::getIndexByteSize(indexType);
+	size_t totalSize = indexByteSize * indices.size();
+	auto indexCount = indices.size();
 
-	while (it != end)
+	// Fill the index buffer, narrowed to the width of the scene buffer
+	StagingBufferPool::StgBuffer stagingBuffer;
+	bool isStaged = false;
+	if (indexType == VK_INDEX_TYPE_UINT16)
 	{
-		memcpy(&(*it), (char*)src + i * elementByteSize, elementByteSize);
-		if (std::distance(it, end) < static_cast<ptrdiff_t>(iterStride))
-			break;
+		std::vector<uint16_t> narrowIndices(indices.begin(), indices.end());
+		isStaged = stageBuffer(stagingPool, stagingBuffer, narrowIndices.data(), indexCount / 3, totalSize,
+			"Copied 16 bit index buffer of size: %zu triangles and %zu bytes (%f bytes per triangle).\n");
+	}
+	else
+	{
+		isStaged = stageBuffer(stagingPool, stagingBuffer, indices.data(), indexCount / 3, totalSize,
+			"Copied index buffer of size: %zu triangles and %zu bytes (%f bytes per triangle).\n");
+	}
 
-		std::advance(it, iterStride);
-		++i;
+	if (!isStaged)
+	{
+		printf("Could not claim staging memory for the index buffer.\n");
+		return false;
 	}
+
+	// Copy from staging buffer to the scene buffer, goes out with the rest of the staging batch
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = stagingBuffer.offset;
+	copyRegion.dstOffset = static_cast<VkDeviceSize>(firstIndex) * indexByteSize;
+	copyRegion.size = totalSize;
+	vkCmdCopyBuffer(stagingPool.getBatchCommandBuffer(), stagingBuffer.buffer, indexBuffer, 1, &copyRegion);
+
+	return true;
 }
 
-bool Mesh::allocateGraphicsMesh(VkMesh& graphicsMesh, VmaAllocator vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool)
+bool Mesh::uploadGraphicsMesh(VkMesh& graphicsMesh, const VkMeshBuffers& buffers, uint32_t firstVertex, uint32_t firstIndex, StagingBufferPool& stagingPool)
 {
-	if (!allocateVertexAttributes(graphicsMesh, vmaAllocator, presentationDevice, stagingPool))
+	// The compact positions are relative to the bounds of the mesh, every draw of it scales them back
+	const auto positionRange = metaData.format == MeshDescriptor::EVertexFormat::Compact ?
+		VertexQuantization::PositionRange::fromPositions(m_positions) : VertexQuantization::PositionRange();
+	if (!uploadVertexAttributes(buffers.getVertexBuffer(), firstVertex, positionRange, stagingPool))
 		return false;
 
-	for (auto& submesh : m_submeshes)
+	graphicsMesh.positionRange = positionRange;
+	graphicsMesh.vertexTransform = positionRange.getDequantizationMatrix();
+
+	const auto indexType = buffers.getIndexType();
+	if (MeshDescriptor::getIndexByteSize(indexType) < MeshDescriptor::getIndexByteSize(getIndexType()))
+	{
+		printf("The %zu vertices of the mesh can not be addressed by the indices of the scene buffer.\n", m_positions.size());
+		return false;
+	}
+
+	graphicsMesh.submeshes.clear();
+	graphicsMesh.submeshes.reserve(m_submeshes.size());
+	graphicsMesh.lods.clear();
+	graphicsMesh.lods.resize(m_submeshes.size());
+	for (size_t i = 0; i < m_submeshes.size(); i++)
 	{
-		if (!allocateIndexAttributes(graphicsMesh, submesh, vmaAllocator, presentationDevice, stagingPool))
+		const auto& submesh = m_submeshes[i];
+		if (!uploadIndexAttributes(submesh.m_indices, indexType, buffers.getIndexBuffer(), firstIndex, stagingPool))
 			return false;
+
+		// The indices stay local to the mesh, the draw offsets them by the first vertex
+		graphicsMesh.submeshes.push_back({ firstIndex, as_uint32(submesh.getIndexCount()), static_cast<int32_t>(firstVertex) });
+		firstIndex += as_uint32(submesh.getIndexCount());
+
+		// The LODs index the same vertices, they only add index ranges
+		for (const auto& lod : submesh.m_lods)
+		{
+			if (!uploadIndexAttributes(lod, indexType, buffers.getIndexBuffer(), firstIndex, stagingPool))
+				return false;
+
+			graphicsMesh.lods[i].push_back({ firstIndex, as_uint32(lod.size()), static_cast<int32_t>(firstVertex) });
+			firstIndex += as_uint32(lod.size());
+		}
 	}
 
+	graphicsMesh.buffers = &buffers;
+	graphicsMesh.vCount = as_uint32(m_positions.size());
 	return true;
 }
 
 void Mesh::updateMetaData()
 {
-	vectors[0] = m_positions.data();
-	vectors[1] = m_uvs.data();
-	vectors[2] = m_normals.data();
-	vectors[3] = m_colors.data();
+	// The attributes are uploaded in the vertex format of the default descriptor
+	metaData = defaultMeshDescriptor;
 
 	metaData.lengths[0] = m_positions.size();
 	metaData.lengths[1] = m_uvs.size();
 	metaData.lengths[2] = m_normals.size();
 	metaData.lengths[3] = m_colors.size();
-
-	metaData.elementByteSizes[0] = vectorElementsizeof(m_positions);
-	metaData.elementByteSizes[1] = vectorElementsizeof(m_uvs);
-	metaData.elementByteSizes[2] = vectorElementsizeof(m_normals);
-	metaData.elementByteSizes[3] = vectorElementsizeof(m_colors);
 }
 
 bool Mesh::operator==(const Mesh& other) const
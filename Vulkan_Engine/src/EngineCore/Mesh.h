@@ -2,8 +2,11 @@
 #include "pch.h"
 #include "VertexBinding.h"
 #include "Math/BoundsAABB.h"
+#include "Math/MeshOptimizer.h"
+#include "VertexQuantization.h"
 
 struct VkMesh;
+struct VkMeshBuffers;
 class StagingBufferPool;
 
 namespace Presentation {
@@ -24,6 +27,8 @@ struct SubMesh
 
 	std::vector<MeshDescriptor::TVertexIndices> m_indices;
 	BoundsAABB m_bounds;
+	// Coarser versions of m_indices over the same vertices, m_lods[0] is LOD 1
+	std::vector<std::vector<MeshDescriptor::TVertexIndices>> m_lods;
 
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version);
@@ -44,15 +49,26 @@ public:
 	void clear();
 	bool isValid();
 
-	template<typename T>
-	void mapAndCopyBuffer(VmaAllocator vmaAllocator, VmaAllocation memRange, const T* source, size_t elementCount, size_t totalByteSize, const char* message);
-
 	static bool validateOptionalBufferSize(size_t vectorSize, size_t vertexCount, char const* name);
-	static void copyInterleavedNoCheck(std::vector<float>& interleavedVertexData, const void* src, size_t elementByteSize, size_t iterStride, size_t offset);
 
-	bool allocateGraphicsMesh(VkMesh& graphicsMesh, VmaAllocator vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool);
-	bool allocateIndexAttributes(VkMesh& graphicsMesh, const SubMesh& submesh, VmaAllocator vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool);
-	bool allocateVertexAttributes(VkMesh& graphicsMesh, const VmaAllocator& vmaAllocator, const Presentation::Device* presentationDevice, StagingBufferPool& stagingPool);
+	// Copies the mesh into the shared scene buffers, starting at the given vertex and index.
+	bool uploadGraphicsMesh(VkMesh& graphicsMesh, const VkMeshBuffers& buffers, uint32_t firstVertex, uint32_t firstIndex, StagingBufferPool& stagingPool);
+	bool uploadIndexAttributes(const std::vector<MeshDescriptor::TVertexIndices>& indices, VkIndexType indexType, VkBuffer indexBuffer, uint32_t firstIndex, StagingBufferPool& stagingPool);
+	bool uploadVertexAttributes(VkBuffer vertexBuffer, uint32_t firstVertex, const VertexQuantization::PositionRange& positionRange, StagingBufferPool& stagingPool);
+
+	size_t getVertexStride() const;
+	size_t getVertexCount() const { return m_positions.size(); }
+	// The narrowest index type that addresses every vertex, the scene buffers and the cache store the indices in it.
+	VkIndexType getIndexType() const;
+	// Every index uploaded for the mesh, the LODs included.
+	size_t getIndexCount() const;
+
+	// Replaces the LODs of every submesh with up to lodCount - 1 simplified levels, each aiming for lodReduction of the
+	// indices of the previous one. The error of a level is capped at maxRelativeError of the diagonal of the submesh bounds.
+	void generateLods(uint32_t lodCount, float lodReduction, float maxRelativeError);
+	// Reorders the triangles of every submesh and LOD for the vertex cache and then for overdraw, and the vertices in the
+	// order the indices first fetch them, dropping the unreferenced ones. Adds the cache stats of every index list before and after.
+	void optimizeForGpu(MeshOptimizer::CacheStats& before, MeshOptimizer::CacheStats& after);
 
 	void makeFace(glm::vec3 pivot, glm::vec3 up, glm::vec3 right, MeshDescriptor::TVertexIndices firstIndex);
 	static Mesh getPrimitiveCube();
@@ -62,7 +78,18 @@ public:
 	const MeshDescriptor& getMeshDescriptor() const;
 	const BoundsAABB* getBounds(uint32_t submeshIndex) const;
 
+	const std::vector<MeshDescriptor::TVertexPosition>& getPositions() const { return m_positions; }
+	const std::vector<MeshDescriptor::TVertexUV>& getUVs() const { return m_uvs; }
+	const std::vector<MeshDescriptor::TVertexNormal>& getNormals() const { return m_normals; }
+	const std::vector<MeshDescriptor::TVertexColor>& getColors() const { return m_colors; }
+	const std::vector<SubMesh>& getSubmeshes() const { return m_submeshes; }
+
 	static MeshDescriptor defaultMeshDescriptor;
+	// Has to be picked before the pipelines and the meshes are created, it is Compact unless the settings ask otherwise.
+	static void setVertexFormat(MeshDescriptor::EVertexFormat vertexFormat);
+	// Same as the vertex format, without them every mesh gets 32 bit indices whatever its vertex count.
+	static void setUse16BitIndices(bool use16BitIndices);
+	static bool getUse16BitIndices();
 
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version);
@@ -82,7 +109,6 @@ private:
 	std::vector<SubMesh> m_submeshes;
 
 	MeshDescriptor metaData;
-	void* vectors[MeshDescriptor::descriptorCount];
 
 	void updateMetaData();
 };
\ No newline at end of file
@@ -5,32 +5,32 @@
 
 #include "Camera.h"
 #include "DescriptorPoolManager.h"
+#include "DescriptorAllocator.h"
+#include "VkTypes/InitializersUtility.h"
 #include "VkTypes/VkGraphicsPipeline.h"
-#include "UboAllocatorDelegate.h"
+#include "VkTypes/PushConstantTypes.h"
 
-PipelineDescriptor::PipelineDescriptor(VkDevice device) : m_currentFrameNumber(0)
+PipelineDescriptor::PipelineDescriptor(VkDevice device, uint32_t textureCapacity, VkDeviceSize uniformAlignment)
+	: m_constantsDescriptorSet(VK_NULL_HANDLE), m_viewDescriptorSet(VK_NULL_HANDLE), m_currentFrameNumber(0), m_textureCapacity(std::max(textureCapacity, 1u))
 {
 	m_isInitialized = tryCreateDescriptorSetLayouts(device) &&
 		tryCreatePipelineLayout(m_forwardPipelineLayout, device) &&
-		tryCreatePipelineLayout(m_depthOnlyPipelineLayout, device, 2u) &&
-		tryCreateUBOs(device);
+		tryCreatePipelineLayout(m_depthOnlyPipelineLayout, device) &&
+		tryCreateUBOs(device, uniformAlignment);
 }
 
 bool PipelineDescriptor::isInitialized() const { return m_isInitialized; }
 
 VkDescriptorSetLayout PipelineDescriptor::getDescriptorSetLayout(BindingSlots slot) { return m_appendedDescSetLayouts[static_cast<int>(slot)]; }
 
-BufferHandle PipelineDescriptor::fillGlobalConstantsUBO(const glm::mat4& worldToLight, const glm::vec4& bias_ambient)
+bool PipelineDescriptor::fillGlobalConstantsUBO(UniformHandle& handle, const glm::mat4& worldToLight, const glm::vec4& bias_ambient)
 {
 	auto constantsData = ConstantsUBO{};
 	constantsData.world_to_light = worldToLight;
 	constantsData.light_to_world = glm::inverse(worldToLight);
 	constantsData.bias_ambient = bias_ambient;
 
-	const auto handle = m_globalConstantsUBO->getHandle(m_currentFrameNumber);
-	handle.CopyData(&constantsData, sizeof(ConstantsUBO));
-
-	return handle;
+	return m_uniformRing->push(handle, m_constantsDescriptorSet, constantsData);
 }
 
 bool PipelineDescriptor::tryCreateDescriptorSetLayouts(VkDevice device)
@@ -40,12 +40,12 @@ bool PipelineDescriptor::tryCreateDescriptorSetLayouts(VkDevice device)
 	return vkinit::Descriptor::createDescriptorSetLayout(
 
 		m_appendedDescSetLayouts[BindingSlots::Constants], device, 
-		vkinit::BoundBuffer(bindingStages[BindingSlots::Constants])
+		vkinit::BoundDynamicBuffer(bindingStages[BindingSlots::Constants])
 
 	) && vkinit::Descriptor::createDescriptorSetLayout(
 
 		m_appendedDescSetLayouts[BindingSlots::View], device, 
-		vkinit::BoundBuffer(bindingStages[BindingSlots::View])
+		vkinit::BoundDynamicBuffer(bindingStages[BindingSlots::View])
 
 	) && vkinit::Descriptor::createDescriptorSetLayout(
 
@@ -55,7 +55,16 @@ bool PipelineDescriptor::tryCreateDescriptorSetLayouts(VkDevice device)
 	) && vkinit::Descriptor::createDescriptorSetLayout(
 
 		m_appendedDescSetLayouts[BindingSlots::MaterialTextures], device, 
-		vkinit::BoundTexture(bindingStages[BindingSlots::MaterialTextures])
+		vkinit::BoundTextureArray(bindingStages[BindingSlots::MaterialTextures], m_textureCapacity)
+
+	) && vkinit::Descriptor::createDescriptorSetLayout(
+
+		// The model matrices and the material indices of the draws
+		m_appendedDescSetLayouts[BindingSlots::Transforms], device, 
+		{ 
+			vkinit::BoundStorageBuffer(bindingStages[BindingSlots::Transforms]),
+			vkinit::BoundStorageBuffer(bindingStages[BindingSlots::Transforms])
+		}
 
 	);
 }
@@ -68,51 +77,61 @@ bool PipelineDescriptor::tryCreatePipelineLayout(VkPipelineLayout& pipelineLayou
 	pipelineLayoutInfo.setLayoutCount = std::min(getSetLayoutsCount(), maxCount);
 	pipelineLayoutInfo.pSetLayouts = getAllSetLayouts();
 
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(TransformPushConstant);
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-
 	return vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) == VK_SUCCESS;
 }
 
-bool PipelineDescriptor::allocateConstantsUBO(VkDevice device, VkDescriptorPool pool)
+bool PipelineDescriptor::allocateUniformRing(VkDevice device, VkDeviceSize uniformAlignment, DescriptorAllocator& allocator)
 {
-	const auto constantsUBOLayout = getDescriptorSetLayout(PipelineDescriptor::BindingSlots::Constants);
-	m_globalConstantsUBO = MAKEUNQ<BuffersUBO>(constantsUBOLayout, as_uint32(sizeof(ConstantsUBO)));
-	return m_globalConstantsUBO->allocate(device, pool, constantsUBOLayout);
+	// One set per block type for every view and frame, only the dynamic offset differs
+	return tryInitialize(m_uniformRing, device, uniformAlignment) &&
+		m_uniformRing->createDescriptorSet(m_constantsDescriptorSet, allocator, getDescriptorSetLayout(BindingSlots::Constants), as_uint32(sizeof(ConstantsUBO))) &&
+		m_uniformRing->createDescriptorSet(m_viewDescriptorSet, allocator, getDescriptorSetLayout(BindingSlots::View), as_uint32(sizeof(ViewUBO)));
 }
 
-bool PipelineDescriptor::allocateViewUBO(VkDevice device, VkDescriptorPool pool)
+bool PipelineDescriptor::allocateIndirectDrawBuffers(VkDevice device, DescriptorAllocator& allocator)
 {
-	const auto viewUBOLayout = getDescriptorSetLayout(PipelineDescriptor::BindingSlots::View);
-	m_globalViewUBOCollection = BufferUBOPool(UBOAllocatorDelegate(device, pool, viewUBOLayout));
-	return true;
+	const auto transformsLayout = getDescriptorSetLayout(PipelineDescriptor::BindingSlots::Transforms);
+
+	m_indirectDraws = MAKEUNQ<IndirectDrawBuffers>(device, allocator, transformsLayout);
+	return m_indirectDraws->isInitialized();
 }
 
-bool PipelineDescriptor::tryCreateUBOs(VkDevice device)
+bool PipelineDescriptor::allocateTextureTable(VkDevice device)
 {
-	auto pool = DescriptorPoolManager::getInstance()->createNewPool(SWAPCHAIN_IMAGE_COUNT * 10);
+	// A set of the table alone takes the whole capacity in descriptors, it would skew the ratios of a shared allocator
+	auto& allocator = DescriptorPoolManager::getInstance()->createAllocator("Texture table",
+		{ { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<float>(m_textureCapacity) } }, MAX_FRAMES_IN_FLIGHT);
+	const auto texturesLayout = getDescriptorSetLayout(PipelineDescriptor::BindingSlots::MaterialTextures);
 
-	return allocateConstantsUBO(device, pool) &&
-		allocateViewUBO(device, pool);
+	m_textureTable = MAKEUNQ<TextureTable>(device, allocator, texturesLayout, m_textureCapacity);
+	return m_textureTable->isInitialized();
 }
 
-BufferHandle PipelineDescriptor::fillCameraUBO(const Camera& cam)
+bool PipelineDescriptor::tryCreateUBOs(VkDevice device, VkDeviceSize uniformAlignment)
+{
+	auto& allocator = DescriptorPoolManager::getInstance()->getPersistent();
+
+	return allocateUniformRing(device, uniformAlignment, allocator) &&
+		allocateIndirectDrawBuffers(device, allocator) &&
+		allocateTextureTable(device);
+}
+
+bool PipelineDescriptor::fillCameraUBO(UniformHandle& handle, const Camera& cam)
 {
 	auto viewData = ViewUBO{};
 	viewData.view_matrix = cam.getViewMatrix();
 	viewData.persp_matrix = cam.getPerspectiveMatrix();
 	viewData.view_persp_matrix = cam.getViewProjectionMatrix();
 	
-	const auto handle = m_globalViewUBOCollection.claim()->getHandle(m_currentFrameNumber);
-	handle.CopyData(&viewData, sizeof(ViewUBO));
-
-	return handle;
+	return m_uniformRing->push(handle, m_viewDescriptorSet, viewData);
 }
 
+const UniformRing& PipelineDescriptor::getUniformRing() const { return *m_uniformRing; }
+
+IndirectDrawBuffers& PipelineDescriptor::getIndirectDrawBuffers() { return *m_indirectDraws; }
+
+TextureTable& PipelineDescriptor::getTextureTable() { return *m_textureTable; }
+
 const VkPipelineLayout PipelineDescriptor::getForwardPipelineLayout() { return m_forwardPipelineLayout; }
 
 const VkPipelineLayout PipelineDescriptor::getDepthOnlyPipelineLayout() { return m_depthOnlyPipelineLayout; }
@@ -136,8 +155,9 @@ uint32_t PipelineDescriptor::getSetLayoutsCount() const { return as_uint32(m_app
 
 void PipelineDescriptor::release(VkDevice device)
 {
-	m_globalConstantsUBO->release();
-	m_globalViewUBOCollection.releaseAllResources();
+	m_uniformRing->release();
+	m_indirectDraws->release();
+	m_textureTable->release();
 
 	for (auto& graphicsPipeline : globalPipelineList)
 	{
@@ -157,8 +177,9 @@ void PipelineDescriptor::release(VkDevice device)
 	globalPipelineList.clear();
 }
 
-void PipelineDescriptor::StartFrame(uint32_t frameNumber)
+void PipelineDescriptor::StartFrame(uint32_t frameIndex)
 {
-	m_globalViewUBOCollection.freeAllClaimed();
-	m_currentFrameNumber = frameNumber % SWAPCHAIN_IMAGE_COUNT;
+	m_currentFrameNumber = frameIndex % MAX_FRAMES_IN_FLIGHT;
+	m_uniformRing->startFrame(frameIndex);
+	m_textureTable->startFrame(frameIndex);
 }
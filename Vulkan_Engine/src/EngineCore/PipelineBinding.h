@@ -1,33 +1,43 @@
 #pragma once
 #include "pch.h"
 #include "Interfaces/IRequireInitialization.h"
-#include "BuffersUBO.h"
-#include "BuffersUBOPool.h"
+#include "UniformRing.h"
+#include "IndirectDrawBuffers.h"
+#include "TextureTable.h"
 
 namespace vkinit { struct ShaderBinding; }
 struct VkShader;
 struct VkGraphicsPipeline;
 class Camera;
+class DescriptorAllocator;
 
 struct PipelineDescriptor : IRequireInitialization
 {
-	static constexpr int DESCRIPTOR_SET_COUNT = 4;
-	enum BindingSlots { Constants = 0, View = 1, Shadowmap = 2, MaterialTextures = 3, MAX = 4 };
+	static constexpr int DESCRIPTOR_SET_COUNT = 5;
+	enum BindingSlots { Constants = 0, View = 1, Shadowmap = 2, MaterialTextures = 3, Transforms = 4, MAX = 5 };
 	static constexpr std::array<VkShaderStageFlags, DESCRIPTOR_SET_COUNT> bindingStages = 
 	{
 		VK_SHADER_STAGE_VERTEX_BIT,
 		VK_SHADER_STAGE_VERTEX_BIT,
 		VK_SHADER_STAGE_FRAGMENT_BIT,
-		VK_SHADER_STAGE_FRAGMENT_BIT
+		VK_SHADER_STAGE_FRAGMENT_BIT,
+		VK_SHADER_STAGE_VERTEX_BIT
 	};
 
-	PipelineDescriptor(VkDevice device);
+	// The material textures are a single array of textureCapacity combined image samplers, see TextureTable.
+	// The uniform blocks are bound at dynamic offsets aligned to uniformAlignment, see UniformRing.
+	PipelineDescriptor(VkDevice device, uint32_t textureCapacity, VkDeviceSize uniformAlignment);
 	bool isInitialized() const override;
 
 	VkDescriptorSetLayout getDescriptorSetLayout(BindingSlots slot);
 
-	BufferHandle fillGlobalConstantsUBO(const glm::mat4& worldToLight, const glm::vec4& bias_ambient);
-	BufferHandle fillCameraUBO(const Camera& cam);
+	// Fail when the uniform ring of the frame is out of space, nothing may be bound with the handle then.
+	bool fillGlobalConstantsUBO(UniformHandle& handle, const glm::mat4& worldToLight, const glm::vec4& bias_ambient);
+	bool fillCameraUBO(UniformHandle& handle, const Camera& cam);
+
+	const UniformRing& getUniformRing() const;
+	IndirectDrawBuffers& getIndirectDrawBuffers();
+	TextureTable& getTextureTable();
 
 	const VkPipelineLayout getForwardPipelineLayout();
 	const VkPipelineLayout getDepthOnlyPipelineLayout();
@@ -38,26 +48,31 @@ struct PipelineDescriptor : IRequireInitialization
 
 	void release(VkDevice device);
 
-	void StartFrame(uint32_t frameNumber);
+	void StartFrame(uint32_t frameIndex);
 
 private:
 	VkPipelineLayout m_forwardPipelineLayout,
 		m_depthOnlyPipelineLayout;
-	UNQ<BuffersUBO> m_globalConstantsUBO;
-	BufferUBOPool m_globalViewUBOCollection;
+	UNQ<UniformRing> m_uniformRing;
+	VkDescriptorSet m_constantsDescriptorSet;
+	VkDescriptorSet m_viewDescriptorSet;
+	UNQ<IndirectDrawBuffers> m_indirectDraws;
+	UNQ<TextureTable> m_textureTable;
 
 	std::array<VkDescriptorSetLayout, DESCRIPTOR_SET_COUNT> m_appendedDescSetLayouts;
 	std::unordered_map<const VkShader*, VkGraphicsPipeline> globalPipelineList;
 
 	bool m_isInitialized;
 	uint32_t m_currentFrameNumber;
+	uint32_t m_textureCapacity;
 
 	bool tryCreateDescriptorSetLayouts(VkDevice device);
 	bool tryCreatePipelineLayout(VkPipelineLayout& pipelineLayout, const VkDevice device, uint32_t maxCount = std::numeric_limits<uint32_t>::max());
-	bool tryCreateUBOs(VkDevice device);
+	bool tryCreateUBOs(VkDevice device, VkDeviceSize uniformAlignment);
 
-	bool allocateConstantsUBO(VkDevice device, VkDescriptorPool pool);
-	bool allocateViewUBO(VkDevice device, VkDescriptorPool pool);
+	bool allocateUniformRing(VkDevice device, VkDeviceSize uniformAlignment, DescriptorAllocator& allocator);
+	bool allocateIndirectDrawBuffers(VkDevice device, DescriptorAllocator& allocator);
+	bool allocateTextureTable(VkDevice device);
 	
 	const VkDescriptorSetLayout* getAllSetLayouts() const;
 	uint32_t getSetLayoutsCount() const;
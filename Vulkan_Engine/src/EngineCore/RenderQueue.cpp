@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "RenderQueue.h"
+
+#include <numeric>
+
+#include "Math/BoundsAABB.h"
+#include "EngineCore/Transform.h"
+#include "VkTypes/VkMesh.h"
+#include "VkTypes/VkMaterialVariant.h"
+
+namespace
+{
+	// Ranks are handed out in the order of first appearance, so the sort doesn't depend on the handle or pointer values.
+	template<typename T>
+	uint64_t rankOf(std::unordered_map<T, uint64_t>& ranks, T value)
+	{
+		return ranks.emplace(value, static_cast<uint64_t>(ranks.size())).first->second;
+	}
+
+	// Shared by every queue, so a cache keyed on the version can't mistake a new scene for the old one
+	uint32_t s_lastStaticStateVersion = 0;
+	uint32_t s_lastBuildVersion = 0;
+}
+
+void RenderQueue::build(const std::vector<VkMeshRenderer>& renderers)
+{
+	clear();
+
+	std::unordered_map<VkPipeline, uint64_t> pipelineRanks;
+	std::unordered_map<const VkMaterialVariant*, uint64_t> variantRanks;
+	std::unordered_map<const VkMeshBuffers*, uint64_t> buffersRanks;
+	std::unordered_map<const VkMesh*, uint64_t> meshRanks;
+
+	// pipeline : 12 bits | mesh buffers : 8 bits | variant : 20 bits | mesh : 24 bits
+	// The variants of a pipeline only differ in their texture index, so the draws of a mesh buffer batch across them
+	std::vector<std::pair<uint64_t, uint32_t>> keys;
+	keys.reserve(renderers.size());
+	for (uint32_t i = 0; i < renderers.size(); i++)
+	{
+		const auto& renderer = renderers[i];
+		const auto key =
+			(rankOf(pipelineRanks, renderer.variant->getPipeline()) << 52) |
+			(rankOf(buffersRanks, renderer.mesh->buffers) << 44) |
+			(rankOf(variantRanks, renderer.variant) << 24) |
+			rankOf(meshRanks, renderer.mesh);
+		keys.emplace_back(key, i);
+	}
+	assert(pipelineRanks.size() <= (1u << 12) && variantRanks.size() <= (1u << 20) && buffersRanks.size() <= (1u << 8) && meshRanks.size() <= (1u << 24)
+		&& "The render queue sort key is out of bits.");
+
+	// Ties keep the scene order
+	std::sort(keys.begin(), keys.end());
+
+	m_renderers.reserve(keys.size());
+	for (const auto& key : keys)
+	{
+		const auto& renderer = renderers[key.second];
+		const auto index = static_cast<uint32_t>(m_renderers.size());
+		if (m_batches.empty() || m_batches.back().variant != renderer.variant)
+		{
+			m_batches.push_back({ renderer.variant, index, index });
+		}
+
+		m_renderers.push_back(renderer);
+		m_batches.back().end = index + 1;
+	}
+
+	m_meshOrder.resize(m_renderers.size());
+	std::iota(m_meshOrder.begin(), m_meshOrder.end(), 0u);
+	std::stable_sort(m_meshOrder.begin(), m_meshOrder.end(), [this](uint32_t a, uint32_t b)
+		{
+			return std::less<const VkMeshBuffers*>()(m_renderers[a].mesh->buffers, m_renderers[b].mesh->buffers);
+		}
+	);
+
+	m_worldBounds.resize(m_renderers.size());
+	m_boundsVersions.assign(m_renderers.size(), c_invalidVersion);
+	m_isStaticStateDirty = true;
+	m_visibility.assign((m_renderers.size() + 63u) / 64u, 0u);
+	m_previousVisibility.assign(m_visibility.size(), 0u);
+	m_shadowVisibility.assign(m_visibility.size(), 0u);
+	m_casterVisibility.assign(m_visibility.size(), 0u);
+	m_staticMask.assign(m_visibility.size(), 0u);
+	m_staticShadowVisibility.assign(m_visibility.size(), 0u);
+	m_lods.assign(m_renderers.size(), 0u);
+	m_buildVersion = ++s_lastBuildVersion;
+}
+
+void RenderQueue::clear()
+{
+	m_renderers.clear();
+	m_batches.clear();
+	m_meshOrder.clear();
+	m_worldBounds.clear();
+	m_boundsVersions.clear();
+	m_dynamicIndices.clear();
+	m_isStaticStateDirty = true;
+	m_boundsUpdates = 0;
+	m_hierarchy.clear();
+	m_visibility.clear();
+	m_previousVisibility.clear();
+	m_visibleCount = 0;
+	m_visibilityChanges = 0;
+	m_shadowVisibility.clear();
+	m_casterVisibility.clear();
+	m_staticMask.clear();
+	m_staticShadowVisibility.clear();
+	m_dynamicShadowCasterCount = 0;
+	m_shadowCasterCount = 0;
+	m_lods.clear();
+}
+
+bool RenderQueue::tryUpdateWorldBounds(uint32_t index)
+{
+	const auto& renderer = m_renderers[index];
+	const auto version = renderer.transform->getVersion();
+	if (m_boundsVersions[index] == version)
+		return false;
+
+	if (renderer.bounds != nullptr)
+		m_worldBounds.setTransformed(index, *renderer.bounds, renderer.transform->getLocalToWorld());
+	else
+		m_worldBounds.setEmpty(index);
+
+	m_boundsVersions[index] = version;
+	return true;
+}
+
+void RenderQueue::updateWorldBounds()
+{
+	m_boundsUpdates = 0;
+
+	// Visits everything once, static transforms may have moved before they were marked
+	if (m_isStaticStateDirty)
+	{
+		m_dynamicIndices.clear();
+		std::fill(m_staticMask.begin(), m_staticMask.end(), 0u);
+		for (uint32_t i = 0; i < m_renderers.size(); i++)
+		{
+			m_boundsUpdates += tryUpdateWorldBounds(i);
+
+			if (m_renderers[i].transform->isStatic())
+				m_staticMask[i / 64u] |= 1ull << (i % 64u);
+			else
+				m_dynamicIndices.push_back(i);
+		}
+
+		m_isStaticStateDirty = false;
+		m_staticStateVersion = ++s_lastStaticStateVersion;
+		m_hierarchy.build(m_worldBounds);
+		return;
+	}
+
+	for (auto index : m_dynamicIndices)
+	{
+		m_boundsUpdates += tryUpdateWorldBounds(index);
+	}
+
+	if (m_boundsUpdates != 0)
+		m_hierarchy.refit(m_worldBounds);
+}
+
+uint32_t RenderQueue::cull(const Frustum& frustum, bool useHierarchy, std::vector<uint64_t>& visibility) const
+{
+	if (useHierarchy)
+		return m_hierarchy.query(frustum, visibility.data());
+
+	return FrustumCulling::cull(frustum, m_worldBounds, visibility.data());
+}
+
+uint32_t RenderQueue::updateVisibility(const Frustum& frustum, bool useHierarchy)
+{
+	std::swap(m_visibility, m_previousVisibility);
+	m_visibleCount = cull(frustum, useHierarchy, m_visibility);
+
+	// Renderers that entered or left the frustum since the previous frame
+	m_visibilityChanges = 0;
+	for (size_t word = 0; word < m_visibility.size(); word++)
+	{
+		m_visibilityChanges += bitCount(m_visibility[word] ^ m_previousVisibility[word]);
+	}
+
+	return m_visibleCount;
+}
+
+uint32_t RenderQueue::updateShadowVisibility(const Frustum& lightFrustum, const Frustum& casterFrustum, bool useHierarchy)
+{
+	cull(lightFrustum, useHierarchy, m_shadowVisibility);
+	cull(casterFrustum, useHierarchy, m_casterVisibility);
+
+	m_shadowCasterCount = 0;
+	m_dynamicShadowCasterCount = 0;
+	for (size_t word = 0; word < m_shadowVisibility.size(); word++)
+	{
+		m_shadowVisibility[word] &= m_casterVisibility[word];
+		m_shadowCasterCount += bitCount(m_shadowVisibility[word]);
+		m_dynamicShadowCasterCount += bitCount(m_shadowVisibility[word] & ~m_staticMask[word]);
+	}
+
+	return m_shadowCasterCount;
+}
+
+uint32_t RenderQueue::updateLods(const glm::vec3& cameraPosition, float projScale, float lodScreenSize, float hysteresis)
+{
+	const auto threshold = [lodScreenSize](uint32_t lod) { return lodScreenSize * std::ldexp(1.0f, 1 - static_cast<int>(lod)); };
+
+	uint32_t reducedCount = 0;
+	for (size_t i = 0; i < m_renderers.size(); i++)
+	{
+		const auto& renderer = m_renderers[i];
+		const auto lodCount = std::min(renderer.submeshIndex < renderer.mesh->submeshes.size() ? renderer.mesh->getLodCount(renderer.submeshIndex) : 1u, 256u);
+		if (lodCount < 2)
+		{
+			m_lods[i] = 0u;
+			continue;
+		}
+
+		const auto center = glm::vec3(m_worldBounds.centerX[i], m_worldBounds.centerY[i], m_worldBounds.centerZ[i]);
+		const auto radius = glm::length(glm::vec3(m_worldBounds.extentsX[i], m_worldBounds.extentsY[i], m_worldBounds.extentsZ[i]));
+		const auto distance = glm::length(center - cameraPosition);
+
+		// From inside of the bounds, or without any, it covers the whole screen
+		const auto screenSize = distance > radius ? radius * projScale / distance : std::numeric_limits<float>::max();
+
+		uint32_t lod = std::min<uint32_t>(m_lods[i], lodCount - 1);
+		while (lod + 1 < lodCount && screenSize < threshold(lod + 1) * (1.0f - hysteresis))
+			lod++;
+		while (lod > 0 && screenSize > threshold(lod) * (1.0f + hysteresis))
+			lod--;
+
+		m_lods[i] = static_cast<uint8_t>(lod);
+		reducedCount += lod > 0 ? 1u : 0u;
+	}
+
+	return reducedCount;
+}
+
+void RenderQueue::resetLods() { std::fill(m_lods.begin(), m_lods.end(), 0u); }
+
+uint32_t RenderQueue::updateStaticShadowVisibility(const Frustum& lightFrustum, bool useHierarchy)
+{
+	cull(lightFrustum, useHierarchy, m_staticShadowVisibility);
+
+	uint32_t staticCasterCount = 0;
+	for (size_t word = 0; word < m_staticShadowVisibility.size(); word++)
+	{
+		m_staticShadowVisibility[word] &= m_staticMask[word];
+		staticCasterCount += bitCount(m_staticShadowVisibility[word]);
+	}
+
+	return staticCasterCount;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "pch.h"
+#include "VkTypes/VkMeshRenderer.h"
+#include "Engine/Bitmask.h"
+#include "Math/FrustumCulling.h"
+#include "Math/BVH.h"
+
+struct Frustum;
+struct VkMaterialVariant;
+struct VkMeshBuffers;
+
+// Renderers sorted once by (pipeline, mesh buffers, material variant, mesh), the order stays valid for the lifetime of the scene.
+// Each frame only rewrites the visibility bitset, drawing walks the set bits of one variant batch at a time.
+class RenderQueue
+{
+public:
+	struct Batch
+	{
+		const VkMaterialVariant* variant;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	enum class EShadowCasters { All, Static, Dynamic };
+
+	void build(const std::vector<VkMeshRenderer>& renderers);
+	void clear();
+
+	// Refreshes the world bounds of the moved renderers and keeps the hierarchy in sync, call once per frame before any visibility query.
+	void updateWorldBounds();
+
+	// Returns the number of visible renderers, the flat SIMD kernel is used instead of the hierarchy when it's disabled.
+	uint32_t updateVisibility(const Frustum& frustum, bool useHierarchy = true);
+	// Keeps the renderers inside of the light frustum that can also shadow the camera (Frustum::getShadowCasterFrustum),
+	// they are walked with forEachShadowCaster. Returns the number of shadow casters.
+	uint32_t updateShadowVisibility(const Frustum& lightFrustum, const Frustum& casterFrustum, bool useHierarchy = true);
+	// Every static renderer inside of the light frustum, wherever the camera is, for caching the static shadow casters.
+	uint32_t updateStaticShadowVisibility(const Frustum& lightFrustum, bool useHierarchy = true);
+
+	// Picks the LOD of every renderer from the share of the screen height its world bounds cover, projScale being [1][1] of the
+	// projection. Level n is used below lodScreenSize / 2^(n - 1), a renderer only returns to a finer level once it covers
+	// hysteresis more than the threshold, so it doesn't flicker while sitting on one. Returns the renderers past LOD 0.
+	uint32_t updateLods(const glm::vec3& cameraPosition, float projScale, float lodScreenSize, float hysteresis);
+	void resetLods();
+	// The renderer has to come from getRenderers.
+	uint32_t getLod(const VkMeshRenderer& renderer) const { return m_lods.empty() ? 0u : m_lods[&renderer - m_renderers.data()]; }
+
+	// The static transforms are left out of the per frame bounds update, call after changing which ones are static.
+	void invalidateStaticState() { m_isStaticStateDirty = true; }
+	// Changes whenever the set of static renderers may have changed, unique across queues.
+	uint32_t getStaticStateVersion() const { return m_staticStateVersion; }
+	// Changes with every build, for caches of the sorted renderers, unique across queues.
+	uint32_t getBuildVersion() const { return m_buildVersion; }
+
+	const std::vector<VkMeshRenderer>& getRenderers() const { return m_renderers; }
+	const std::vector<Batch>& getBatches() const { return m_batches; }
+	// The order that rebinds the mesh buffers the least, for passes that ignore the materials.
+	const std::vector<uint32_t>& getMeshOrder() const { return m_meshOrder; }
+
+	uint32_t getVisibleCount() const { return m_visibleCount; }
+	uint32_t getVisibilityChanges() const { return m_visibilityChanges; }
+	uint32_t getBoundsUpdates() const { return m_boundsUpdates; }
+	uint32_t getShadowCasterCount() const { return m_shadowCasterCount; }
+	uint32_t getDynamicShadowCasterCount() const { return m_dynamicShadowCasterCount; }
+	const BVH& getHierarchy() const { return m_hierarchy; }
+	// Indexed like getRenderers, refreshed by updateWorldBounds.
+	const BoundsSoA& getWorldBounds() const { return m_worldBounds; }
+
+	template<typename Func>
+	void forEachVisible(const Batch& batch, Func&& func) const
+	{
+		for (auto word = batch.begin / 64u; word * 64u < batch.end; word++)
+		{
+			auto bits = m_visibility[word];
+			while (bits != 0)
+			{
+				const auto index = word * 64u + lowestBitIndex(bits);
+				bits &= bits - 1u;
+
+				if (index < batch.begin)
+					continue;
+				if (index >= batch.end)
+					return;
+
+				func(m_renderers[index]);
+			}
+		}
+	}
+
+	// Walks the visible shadow casters in the mesh order, the static ones come from updateStaticShadowVisibility.
+	template<typename Func>
+	void forEachShadowCaster(Func&& func, EShadowCasters casters = EShadowCasters::All) const
+	{
+		for (auto index : m_meshOrder)
+		{
+			const auto word = index / 64u;
+			const auto bit = 1ull << (index % 64u);
+
+			bool isVisible = false;
+			switch (casters)
+			{
+			case EShadowCasters::Static: isVisible = (m_staticShadowVisibility[word] & bit) != 0; break;
+			case EShadowCasters::Dynamic: isVisible = (m_shadowVisibility[word] & ~m_staticMask[word] & bit) != 0; break;
+			default: isVisible = (m_shadowVisibility[word] & bit) != 0; break;
+			}
+
+			if (isVisible)
+				func(m_renderers[index]);
+		}
+	}
+
+private:
+	constexpr static uint32_t c_invalidVersion = std::numeric_limits<uint32_t>::max();
+
+	bool tryUpdateWorldBounds(uint32_t index);
+	uint32_t cull(const Frustum& frustum, bool useHierarchy, std::vector<uint64_t>& visibility) const;
+
+	std::vector<VkMeshRenderer> m_renderers;
+	std::vector<Batch> m_batches;
+	std::vector<uint32_t> m_meshOrder;
+	uint32_t m_buildVersion = 0;
+
+	// World space bounds cache, an entry is only recomputed when the version of its transform moves on
+	BoundsSoA m_worldBounds;
+	std::vector<uint32_t> m_boundsVersions;
+	std::vector<uint32_t> m_dynamicIndices;
+	bool m_isStaticStateDirty = true;
+	uint32_t m_boundsUpdates = 0;
+	std::vector<uint64_t> m_staticMask;
+	uint32_t m_staticStateVersion = 0;
+
+	// Rebuilt when the static state changes, refitted when only the dynamic bounds moved
+	BVH m_hierarchy;
+
+	std::vector<uint64_t> m_visibility;
+	std::vector<uint64_t> m_previousVisibility;
+	uint32_t m_visibleCount = 0;
+	uint32_t m_visibilityChanges = 0;
+
+	std::vector<uint64_t> m_shadowVisibility;
+	std::vector<uint64_t> m_casterVisibility;
+	uint32_t m_shadowCasterCount = 0;
+	uint32_t m_dynamicShadowCasterCount = 0;
+	std::vector<uint64_t> m_staticShadowVisibility;
+
+	// Indexed like m_renderers, kept across frames for the hysteresis
+	std::vector<uint8_t> m_lods;
+};
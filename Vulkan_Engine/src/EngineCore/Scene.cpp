@@ -3,12 +3,20 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "VkTypes/VkMesh.h"
+#include "VertexAttributes.h"
 #include "VkTypes/VkTexture.h"
 #include "VkTypes/VkShader.h"
+#include "VkTypes/InitializersUtility.h"
 
 #include "Presentation/Device.h"
 #include "Presentation/PresentationTarget.h"
+#include "EngineCore/PipelineBinding.h"
+#include "EngineCore/DescriptorPoolManager.h"
+#include "EngineCore/DescriptorAllocator.h"
 #include "EngineCore/StagingBufferPool.h"
+#include "EngineCore/SceneCache.h"
+#include "EngineCore/AsyncTextureUploader.h"
+#include "EngineCore/Texture.h"
 
 #include "FileManager/FileIO.h"
 #include "FileManager/Directories.h"
@@ -19,13 +27,31 @@
 #include "Loaders/Model/Loader_OBJ.h"
 #include "Loaders/Model/Loader_ASSIMP.h"
 
+#include "Engine/JobSystem.h"
+
+#include <boost/serialization/version.hpp>
+
+// Version 1 added the LODs
+BOOST_CLASS_VERSION(SubMesh, 1)
+
 Scene::Scene(const Presentation::Device* device, Presentation::PresentationTarget* target)
 	: m_presentationDevice(device), m_presentationTarget(target) { }
 
 Scene::~Scene() = default;
 
 constexpr bool force_serialize_from_origin = false;
-bool Scene::load(VkDescriptorPool descPool)
+constexpr bool use_mapped_scene_cache = true;
+
+// The settings the meshes are imported and laid out with
+static SceneCache::Key getSceneCacheKey()
+{
+	SceneCache::Key key{};
+	key.vertexFormat = static_cast<uint32_t>(Mesh::defaultMeshDescriptor.format);
+	key.use16BitIndices = Mesh::getUse16BitIndices() ? 1u : 0u;
+	return key;
+}
+
+bool Scene::load()
 {
 	//const auto modelOptions = Directories::getModels_DebrovicSponza();
 	//const auto modelOptions = Directories::getModels_IntelSponza();
@@ -33,7 +59,10 @@ bool Scene::load(VkDescriptorPool descPool)
 
 	Path fullPath;
 	/*****************************				IMPORT					****************************************/
-	if (!Directories::tryGetBinaryIfExists(fullPath, modelOptions.front().filePath) || force_serialize_from_origin)
+	// A mapped cache of an older version or written with other geometry settings is imported again
+	const auto hasBinary = Directories::tryGetBinaryIfExists(fullPath, modelOptions.front().filePath, use_mapped_scene_cache) &&
+		(!use_mapped_scene_cache || SceneCache::isCurrent(fullPath, getSceneCacheKey()));
+	if (!hasBinary || force_serialize_from_origin)
 	{
 		ProfileMarker _("Scene::import & serialize");
 		Scene scene(nullptr, nullptr);
@@ -49,6 +78,15 @@ bool Scene::load(VkDescriptorPool descPool)
 			}
 		}
 
+		if (use_mapped_scene_cache)
+		{
+			if (!scene.writeMappedCache(fullPath))
+			{
+				printf("Could not write the scene cache '%s'.\n", fullPath.c_str());
+				return false;
+			}
+		}
+		else
 		{
 			auto stream = std::fstream(fullPath, std::ios::out | std::ios::binary);
 			boost::archive::binary_oarchive archive(stream);
@@ -70,7 +108,7 @@ bool Scene::load(VkDescriptorPool descPool)
 	printf("Initialized the scene with (renderers = %zi), (transforms = %zi), (meshes = %zi), (textures = %zi), (materials = %zi).\n", m_renderers.size(), m_transforms.size(), m_meshes.size(), m_textures.size(), m_materials.size());
 
 	/*****************************				GRAPHICS					****************************************/
-	createGraphicsRepresentation(descPool);
+	createGraphicsRepresentation();
 
 	return true;
 }
@@ -81,6 +119,7 @@ const std::vector<Material>& Scene::getMaterials() const { return m_materials; }
 const std::vector<Renderer>& Scene::getRendererIDs() const { return m_rendererIDs; }
 const std::vector<VkMesh>& Scene::getGraphicsMeshes() const { return m_graphicsMeshes; }
 const std::vector<VkMeshRenderer>& Scene::getRenderers() const { return m_renderers; }
+RenderQueue& Scene::getRenderQueue() { return m_renderQueue; }
 
 void Scene::release(VkDevice device, VmaAllocator allocator)
 {
@@ -90,19 +129,38 @@ void Scene::release(VkDevice device, VmaAllocator allocator)
 	}
 	m_meshes.clear();
 
-	for (auto& gmesh : m_graphicsMeshes)
+	m_graphicsMeshes.clear();
+	for (auto& buffers : m_meshBuffers)
 	{
-		gmesh.release(allocator);
+		buffers->release(allocator);
+	}
+	m_meshBuffers.clear();
+
+	if (m_textureUploader)
+	{
+		m_textureUploader->release();
+		m_textureUploader.reset();
 	}
-	m_graphicsMeshes.clear();
 
+	// The table would otherwise write the released textures into the sets of the next frames
+	m_presentationTarget->m_globalPipelineState->getTextureTable().release();
 	for (auto& tex : m_textures)
 	{
+		// Textures that never finished streaming are still pointing at the fallback
+		if (!tex)
+			continue;
+
 		tex->release(device);
 		tex.release();
 	}
 	m_textures.clear();
 
+	if (m_fallbackTexture)
+	{
+		m_fallbackTexture->release(device);
+		m_fallbackTexture.reset();
+	}
+
 	for (auto& mat : m_graphicsMaterials)
 	{
 		mat->release(device);
@@ -111,6 +169,7 @@ void Scene::release(VkDevice device, VmaAllocator allocator)
 	m_graphicsMaterials.clear();
 
 	m_renderers.clear();
+	m_renderQueue.clear();
 	m_materials.clear();
 	m_rendererIDs.clear();
 }
@@ -132,6 +191,9 @@ void SubMesh::serialize(Archive& ar, const unsigned int version)
 	ar& m_indices;
 	ar& m_bounds.center;
 	ar& m_bounds.extents;
+
+	if (version > 0)
+		ar& m_lods;
 }
 
 template<class Archive>
@@ -158,6 +220,13 @@ bool Scene::tryInitializeFromFile(const Loader::ModelLoaderOptions& modelOptions
 {
 	const auto& path = modelOptions.filePath;
 
+	/* ================ READ MAPPED SCENE CACHE =============== */
+	if (Directories::isMappedSceneCache(path) && path.fileExists())
+	{
+		ProfileMarker _("Loader::MappedCache");
+		return tryInitializeFromMappedCache(path);
+	}
+
 	/* ================ READ SERIALIZED BINARY =============== */
 	if (Directories::isBinary(path) && path.fileExists())
 	{
@@ -172,40 +241,303 @@ bool Scene::tryInitializeFromFile(const Loader::ModelLoaderOptions& modelOptions
 		return true;
 	}
 
+	const auto firstImportedMesh = m_meshes.size();
+	bool isImported = false;
+
 	/* ================ READ FROM GLTF =============== */
 	if (FileIO::fileExists(path, ".gltf"))
 	{
 		ProfileMarker _("Loader::ASSIMP");
-		return Loader::load_AssimpImplementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
+		isImported = Loader::load_AssimpImplementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
 	}
 
 	/* ================ READ FROM OBJ =============== */
-	if (FileIO::fileExists(path, ".obj"))
+	else if (FileIO::fileExists(path, ".obj"))
 	{
 		ProfileMarker _("Loader::Custom_OBJ");
-		return Loader::loadOBJ_Implementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
+		isImported = Loader::loadOBJ_Implementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
 	}
 
 	// Fallback
-	if (FileIO::fileExists(path))
+	else if (FileIO::fileExists(path))
 	{
 		ProfileMarker _("Loader::ASSIMP");
-		return Loader::load_AssimpImplementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
+		isImported = Loader::load_AssimpImplementation(m_meshes, m_materials, m_rendererIDs, m_transforms, modelOptions);
+	}
+
+	if (isImported)
+	{
+		processImportedMeshes(firstImportedMesh, modelOptions);
+	}
+
+	return isImported;
+}
+
+void Scene::processImportedMeshes(size_t firstMesh, const Loader::ModelLoaderOptions& modelOptions)
+{
+	ProfileMarker _("Scene::processImportedMeshes");
+
+	const auto meshCount = m_meshes.size() - firstMesh;
+	std::vector<MeshOptimizer::CacheStats> statsBefore(meshCount);
+	std::vector<MeshOptimizer::CacheStats> statsAfter(meshCount);
+
+	// Every mesh is processed on its own, the result doesn't depend on the thread count.
+	// The LODs go first, so they get optimized along with the full submeshes.
+	JobSystem::parallelFor(meshCount, [&](size_t i)
+	{
+		auto& mesh = m_meshes[firstMesh + i];
+		mesh.generateLods(modelOptions.lodCount, modelOptions.lodReduction, modelOptions.lodMaxError);
+
+		if (modelOptions.optimizeMeshes)
+			mesh.optimizeForGpu(statsBefore[i], statsAfter[i]);
+	}, modelOptions.importThreadCount);
+
+	if (!modelOptions.optimizeMeshes)
+		return;
+
+	MeshOptimizer::CacheStats before{}, after{};
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		before.add(statsBefore[i]);
+		after.add(statsAfter[i]);
+	}
+	printf("Optimized %zi meshes for the vertex cache, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f.\n", meshCount,
+		before.getACMR(), after.getACMR(), before.getATVR(), after.getATVR());
+}
+
+bool Scene::tryInitializeFromMappedCache(const Path& path)
+{
+	using namespace SceneCache;
+
+	Reader reader;
+	if (!reader.open(path, getSceneCacheKey()))
+		return false;
+
+	const auto meshes = reader.getSection<MeshRecord>(ESection::Meshes);
+	const auto submeshes = reader.getSection<SubMeshRecord>(ESection::SubMeshes);
+	const auto positions = reader.getSection<MeshDescriptor::TVertexPosition>(ESection::Positions);
+	const auto uvs = reader.getSection<MeshDescriptor::TVertexUV>(ESection::UVs);
+	const auto normals = reader.getSection<MeshDescriptor::TVertexNormal>(ESection::Normals);
+	const auto colors = reader.getSection<MeshDescriptor::TVertexColor>(ESection::Colors);
+	const auto indices = reader.getSection<MeshDescriptor::TVertexIndices>(ESection::Indices);
+	const auto compactIndices = reader.getSection<uint16_t>(ESection::CompactIndices);
+	const auto lods = reader.getSection<LodRecord>(ESection::Lods);
+	const auto transforms = reader.getSection<glm::mat4>(ESection::Transforms);
+	const auto renderers = reader.getSection<RendererRecord>(ESection::Renderers);
+	const auto materialIDs = reader.getSection<uint64_t>(ESection::MaterialIDs);
+	const auto materials = reader.getSection<MaterialRecord>(ESection::Materials);
+	const auto strings = reader.getSection<char>(ESection::Strings);
+
+	// The vertex and index streams are copied in bulk straight out of the mapping
+	m_meshes.reserve(m_meshes.size() + meshes.size());
+	for (const auto& record : meshes)
+	{
+		const auto p = positions.subspan(record.positionFirst, record.positionCount);
+		const auto uv = uvs.subspan(record.uvFirst, record.uvCount);
+		const auto n = normals.subspan(record.normalFirst, record.normalCount);
+		const auto c = colors.subspan(record.colorFirst, record.colorCount);
+		const auto sm = submeshes.subspan(record.submeshFirst, record.submeshCount);
+		if (p.size() != record.positionCount || uv.size() != record.uvCount || n.size() != record.normalCount ||
+			c.size() != record.colorCount || sm.size() != record.submeshCount)
+		{
+			printf("The scene cache '%s' references vertex data outside of its sections.\n", path.c_str());
+			return false;
+		}
+
+		const auto indexType = static_cast<VkIndexType>(record.indexType);
+		if ((indexType != VK_INDEX_TYPE_UINT16 && indexType != VK_INDEX_TYPE_UINT32) ||
+			MeshDescriptor::getIndexByteSize(indexType) < MeshDescriptor::getIndexByteSize(MeshDescriptor::getIndexType(p.size())))
+		{
+			printf("The scene cache '%s' has a mesh with an unsupported index type %u.\n", path.c_str(), record.indexType);
+			return false;
+		}
+
+		// The 16 bit indices are widened back, the CPU side always works on 32 bit ones
+		const auto readIndices = [&](std::vector<MeshDescriptor::TVertexIndices>& destination, uint64_t first, uint64_t count)
+		{
+			if (indexType == VK_INDEX_TYPE_UINT16)
+			{
+				const auto span = compactIndices.subspan(first, count);
+				destination.assign(span.begin(), span.end());
+				return span.size() == count;
+			}
+
+			const auto span = indices.subspan(first, count);
+			destination.assign(span.begin(), span.end());
+			return span.size() == count;
+		};
+
+		std::vector<MeshDescriptor::TVertexPosition> meshPositions(p.begin(), p.end());
+		std::vector<MeshDescriptor::TVertexUV> meshUVs(uv.begin(), uv.end());
+		std::vector<MeshDescriptor::TVertexNormal> meshNormals(n.begin(), n.end());
+		std::vector<MeshDescriptor::TVertexColor> meshColors(c.begin(), c.end());
+
+		std::vector<SubMesh> meshSubmeshes(sm.size());
+		for (size_t i = 0; i < sm.size(); i++)
+		{
+			const auto lod = lods.subspan(sm[i].lodFirst, sm[i].lodCount);
+			if (!readIndices(meshSubmeshes[i].m_indices, sm[i].indexFirst, sm[i].indexCount) || lod.size() != sm[i].lodCount)
+			{
+				printf("The scene cache '%s' references index data outside of its sections.\n", path.c_str());
+				return false;
+			}
+
+			meshSubmeshes[i].m_bounds.center = sm[i].center;
+			meshSubmeshes[i].m_bounds.extents = sm[i].extents;
+
+			meshSubmeshes[i].m_lods.resize(lod.size());
+			for (size_t l = 0; l < lod.size(); l++)
+			{
+				if (!readIndices(meshSubmeshes[i].m_lods[l], lod[l].indexFirst, lod[l].indexCount))
+				{
+					printf("The scene cache '%s' references index data outside of its sections.\n", path.c_str());
+					return false;
+				}
+			}
+		}
+
+		m_meshes.emplace_back(meshPositions, meshUVs, meshNormals, meshColors, meshSubmeshes);
+	}
+
+	m_materials.reserve(m_materials.size() + materials.size());
+	for (const auto& record : materials)
+	{
+		const auto relativePath = strings.subspan(record.pathFirst, record.pathLength);
+
+		// Deserializing always relative path to the working directory
+		auto source = TextureSource(Directories::getWorkingDirectory().combine(std::string(relativePath.begin(), relativePath.end())).value,
+			static_cast<VkFormat>(record.format), record.generateTheMips != 0);
+		m_materials.emplace_back(record.shaderIdentifier, std::move(source));
+	}
+
+	m_rendererIDs.reserve(m_rendererIDs.size() + renderers.size());
+	for (const auto& record : renderers)
+	{
+		const auto ids = materialIDs.subspan(record.materialFirst, record.materialCount);
+		m_rendererIDs.emplace_back(static_cast<size_t>(record.meshID), static_cast<size_t>(record.transformID), std::vector<size_t>(ids.begin(), ids.end()));
+	}
+
+	m_transforms.reserve(m_transforms.size() + transforms.size());
+	for (const auto& localToWorld : transforms)
+	{
+		m_transforms.emplace_back(localToWorld);
 	}
 
-	return false;
+	return true;
 }
 
-void Scene::createGraphicsRepresentation(VkDescriptorPool descPool)
+bool Scene::writeMappedCache(const Path& path) const
+{
+	using namespace SceneCache;
+	ProfileMarker _("Scene::Write_MappedCache");
+
+	Writer writer;
+	for (const auto& mesh : m_meshes)
+	{
+		MeshRecord record{};
+		record.positionCount = mesh.getPositions().size();
+		record.positionFirst = writer.append(ESection::Positions, mesh.getPositions());
+		record.uvCount = mesh.getUVs().size();
+		record.uvFirst = writer.append(ESection::UVs, mesh.getUVs());
+		record.normalCount = mesh.getNormals().size();
+		record.normalFirst = writer.append(ESection::Normals, mesh.getNormals());
+		record.colorCount = mesh.getColors().size();
+		record.colorFirst = writer.append(ESection::Colors, mesh.getColors());
+
+		// Narrowed the same way as for the scene buffers, so the cache takes half the index space for most meshes
+		record.indexType = static_cast<uint32_t>(mesh.getIndexType());
+		const auto appendIndices = [&](const std::vector<MeshDescriptor::TVertexIndices>& indices)
+		{
+			if (mesh.getIndexType() == VK_INDEX_TYPE_UINT16)
+				return writer.append(ESection::CompactIndices, std::vector<uint16_t>(indices.begin(), indices.end()));
+
+			return writer.append(ESection::Indices, indices);
+		};
+
+		const auto& submeshes = mesh.getSubmeshes();
+		std::vector<SubMeshRecord> submeshRecords(submeshes.size());
+		for (size_t i = 0; i < submeshes.size(); i++)
+		{
+			submeshRecords[i].indexCount = submeshes[i].m_indices.size();
+			submeshRecords[i].indexFirst = appendIndices(submeshes[i].m_indices);
+			submeshRecords[i].center = submeshes[i].m_bounds.center;
+			submeshRecords[i].extents = submeshes[i].m_bounds.extents;
+
+			std::vector<LodRecord> lodRecords(submeshes[i].m_lods.size());
+			for (size_t l = 0; l < lodRecords.size(); l++)
+			{
+				lodRecords[l].indexCount = submeshes[i].m_lods[l].size();
+				lodRecords[l].indexFirst = appendIndices(submeshes[i].m_lods[l]);
+			}
+			submeshRecords[i].lodCount = lodRecords.size();
+			submeshRecords[i].lodFirst = writer.append(ESection::Lods, lodRecords);
+		}
+		record.submeshCount = submeshRecords.size();
+		record.submeshFirst = writer.append(ESection::SubMeshes, submeshRecords);
+
+		writer.append(ESection::Meshes, &record, 1);
+	}
+
+	for (const auto& material : m_materials)
+	{
+		const auto source = material.getSerializedTextureSource();
+
+		MaterialRecord record{};
+		record.shaderIdentifier = material.getShaderIdentifier();
+		record.format = static_cast<uint32_t>(source.format);
+		record.generateTheMips = source.generateTheMips ? 1u : 0u;
+		record.pathLength = as_uint32(source.path.value.size());
+		record.pathFirst = writer.append(ESection::Strings, source.path.value.data(), source.path.value.size());
+
+		writer.append(ESection::Materials, &record, 1);
+	}
+
+	for (const auto& renderer : m_rendererIDs)
+	{
+		RendererRecord record{};
+		record.meshID = renderer.meshID;
+		record.transformID = renderer.transformID;
+		record.materialCount = renderer.materialIDs.size();
+		record.materialFirst = writer.append(ESection::MaterialIDs, std::vector<uint64_t>(renderer.materialIDs.begin(), renderer.materialIDs.end()));
+
+		writer.append(ESection::Renderers, &record, 1);
+	}
+
+	for (const auto& transform : m_transforms)
+	{
+		writer.append(ESection::Transforms, &transform.getLocalToWorld(), 1);
+	}
+
+	return writer.write(path, getSceneCacheKey());
+}
+
+void Scene::createGraphicsRepresentation()
 {
 	std::unordered_map<TextureSource, uint32_t> loadedTextures;
-	StagingBufferPool stagingBufPool{};
+	StagingBufferPool stagingBufPool(m_presentationDevice);
 	{
 		ProfileMarker _("Scene::Create_Graphics_Materials");
-		/* ================= CREATE TEXTURES ================*/
+		/* ================= CREATE FALLBACK TEXTURE ================*/
+		if (!createFallbackTexture(stagingBufPool))
+		{
+			throw std::runtime_error("Could not create the fallback texture for the scene.");
+		}
+
+		auto& textureTable = m_presentationTarget->m_globalPipelineState->getTextureTable();
+		textureTable.reset(*m_fallbackTexture);
+
+		m_textureUploader = MAKEUNQ<AsyncTextureUploader>(m_presentationDevice);
+		if (!m_textureUploader->isInitialized())
+		{
+			throw std::runtime_error("Could not initialize the texture uploader.");
+		}
+
+		/* ================= REQUEST TEXTURES ================*/
 		/* ================= CREATE GRAPHICS MATERIALS ================*/
-		m_graphicsMaterials.reserve(m_textures.size());
+		// Every material starts with the fallback texture in its slot of the table and gets its own one once it is resident
+		// Without the table every material binds the texture through sets of its own instead
 		auto device = m_presentationDevice->getDevice();
+		const auto useTextureTable = m_presentationTarget->usesTextureTable();
 		for (auto& rendererIDs : m_rendererIDs)
 		{
 			for (auto& matIndex : rendererIDs.materialIDs)
@@ -217,24 +549,27 @@ void Scene::createGraphicsRepresentation(VkDescriptorPool descPool)
 					auto size = m_textures.size();
 					m_textures.resize(size + 1);
 					m_graphicsMaterials.resize(size + 1);
-					if (VkTexture2D::tryCreateTexture(m_textures.back(), texSrc, m_presentationDevice, stagingBufPool))
-					{
-						loadedTextures[texSrc] = as_uint32(size);
+					loadedTextures[texSrc] = as_uint32(size);
 
-						auto* shader = VkShader::findShader(mat.getShaderIdentifier());
-						m_presentationTarget->createGraphicsMaterial(m_graphicsMaterials.back(), device, descPool, shader, m_textures.back().get());
+					auto* shader = VkShader::findShader(mat.getShaderIdentifier());
+					if (useTextureTable)
+					{
+						const auto textureIndex = textureTable.add(*m_fallbackTexture);
+						m_presentationTarget->createGraphicsMaterial(m_graphicsMaterials.back(), device, shader, m_fallbackTexture.get(), textureIndex);
 					}
 					else
 					{
-						rendererIDs.materialIDs = { 0 };
-
-						m_textures.resize(size);
-						m_graphicsMaterials.resize(size);
-						printf("The texture at '%s' could not be loaded.\n", texSrc.path.c_str());
+						m_presentationTarget->createBoundGraphicsMaterial(m_graphicsMaterials.back(), device,
+							DescriptorPoolManager::getInstance()->getPersistent(), shader, m_fallbackTexture.get());
 					}
+
+					const auto requestID = m_textureUploader->request(texSrc);
+					assert(requestID == size && "The texture requests have to line up with the graphics materials.");
 				}
 			}
 		}
+
+		m_textureUploader->startDecoding();
 	}
 
 	{
@@ -244,22 +579,98 @@ void Scene::createGraphicsRepresentation(VkDescriptorPool descPool)
 		auto vmaAllocator = VkMemoryAllocator::getInstance()->m_allocator;
 		const auto count = m_meshes.size();
 
-		m_graphicsMeshes.reserve(count);
-		m_renderers.reserve(count);
-		for (auto& ids : m_rendererIDs)
+		// Place every mesh that can share the default pipeline into the scene buffers, a new pair is started once one would outgrow the limit.
+		// The meshes are packed separately by index width, most of them fit 16 bit indices and their buffers take half the index memory.
+		struct MeshPlacement { size_t buffersIndex; uint32_t firstVertex, firstIndex; };
+		struct BuffersSize { VkIndexType indexType; VkDeviceSize vertexCount, indexCount; };
+
+		std::vector<bool> isPacked(count, false);
+		std::vector<MeshPlacement> placements(count);
+		std::vector<BuffersSize> buffersSizes;
+		std::unordered_map<VkIndexType, size_t> openBuffers;
+		const auto vertexStride = static_cast<VkDeviceSize>(defaultMeshDescriptor.getVertexStride());
+		for (size_t i = 0; i < count; i++)
 		{
-			auto& mesh = m_meshes[ids.meshID];
-
-			auto newGraphicsMesh = VkMesh();
-			if (!mesh.allocateGraphicsMesh(newGraphicsMesh, vmaAllocator, m_presentationDevice, stagingBufPool) || !mesh.isValid())
+			auto& mesh = m_meshes[i];
+			if (!mesh.isValid())
 				continue;
 
-			if (defaultMeshDescriptor != mesh.getMeshDescriptor())
+			if (defaultMeshDescriptor != mesh.getMeshDescriptor() || mesh.getVertexStride() != vertexStride)
 			{
 				printf("Mesh metadata does not match - can not bind to the same pipeline.\n");
 				continue;
 			}
-			m_graphicsMeshes.emplace_back(std::move(newGraphicsMesh));
+
+			const auto vertexCount = static_cast<VkDeviceSize>(mesh.getVertexCount());
+			const auto indexCount = static_cast<VkDeviceSize>(mesh.getIndexCount());
+			const auto indexType = mesh.getIndexType();
+			const auto indexStride = static_cast<VkDeviceSize>(MeshDescriptor::getIndexByteSize(indexType));
+
+			auto open = openBuffers.find(indexType);
+			if (open == openBuffers.end() ||
+				(buffersSizes[open->second].vertexCount + vertexCount) * vertexStride > c_maxMeshBuffersByteSize ||
+				(buffersSizes[open->second].indexCount + indexCount) * indexStride > c_maxMeshBuffersByteSize)
+			{
+				open = openBuffers.insert_or_assign(indexType, buffersSizes.size()).first;
+				buffersSizes.push_back({ indexType, 0, 0 });
+			}
+
+			auto& size = buffersSizes[open->second];
+			placements[i] = { open->second, static_cast<uint32_t>(size.vertexCount), static_cast<uint32_t>(size.indexCount) };
+			size.vertexCount += vertexCount;
+			size.indexCount += indexCount;
+			isPacked[i] = true;
+		}
+
+		m_meshBuffers.reserve(buffersSizes.size());
+		VkDeviceSize indexBytes = 0, wideIndexBytes = 0;
+		size_t narrowBuffersCount = 0;
+		for (auto& size : buffersSizes)
+		{
+			const auto indexStride = static_cast<VkDeviceSize>(MeshDescriptor::getIndexByteSize(size.indexType));
+			const auto vertexByteSize = std::max(size.vertexCount * vertexStride, vertexStride);
+			const auto indexByteSize = std::max(size.indexCount * indexStride, indexStride);
+
+			indexBytes += size.indexCount * indexStride;
+			wideIndexBytes += size.indexCount * sizeof(MeshDescriptor::TVertexIndices);
+			narrowBuffersCount += size.indexType == VK_INDEX_TYPE_UINT16 ? 1 : 0;
+
+			VkBuffer vBuffer, iBuffer;
+			VmaAllocation vMemRange, iMemRange;
+			if (!vkinit::MemoryBuffer::allocateBufferAndMemory(vBuffer, vMemRange, vmaAllocator, as_uint32(vertexByteSize), VMA_MEMORY_USAGE_GPU_ONLY, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT) ||
+				!vkinit::MemoryBuffer::allocateBufferAndMemory(iBuffer, iMemRange, vmaAllocator, as_uint32(indexByteSize), VMA_MEMORY_USAGE_GPU_ONLY, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+			{
+				throw std::runtime_error("Could not allocate the scene vertex and index buffers.");
+			}
+
+			std::vector<VkBuffer> vBuffers{ vBuffer };
+			std::vector<VkDeviceSize> vOffsets{ 0 };
+			std::vector<VmaAllocation> vMemRanges{ vMemRange };
+			m_meshBuffers.emplace_back(MAKEUNQ<VkMeshBuffers>(
+				MAKEUNQ<VertexAttributes>(vBuffers, vMemRanges, vOffsets),
+				IndexAttributes(iBuffer, iMemRange, as_uint32(size.indexCount), size.indexType)));
+		}
+		printf("Packed %zu meshes into %zu vertex/index buffer pairs (%zu with 16 bit indices), %.2f MB of indices instead of %.2f MB.\n",
+			static_cast<size_t>(std::count(isPacked.begin(), isPacked.end(), true)), m_meshBuffers.size(), narrowBuffersCount,
+			indexBytes / (1024.0 * 1024.0), wideIndexBytes / (1024.0 * 1024.0));
+
+		m_graphicsMeshes.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& placement = placements[i];
+			if (isPacked[i] && !m_meshes[i].uploadGraphicsMesh(m_graphicsMeshes[i], *m_meshBuffers[placement.buffersIndex], placement.firstVertex, placement.firstIndex, stagingBufPool))
+			{
+				printf("Could not upload the mesh %zu into the scene buffers.\n", i);
+			}
+		}
+
+		m_renderers.reserve(count);
+		for (auto& ids : m_rendererIDs)
+		{
+			auto& mesh = m_meshes[ids.meshID];
+			auto& graphicsMesh = m_graphicsMeshes[ids.meshID];
+			if (!graphicsMesh.isValid())
+				continue;
 
 			uint32_t submeshIndex = 0;
 			for (auto materialIDs : ids.materialIDs)
@@ -272,13 +683,98 @@ void Scene::createGraphicsRepresentation(VkDescriptorPool descPool)
 				}
 
 				m_renderers.emplace_back(
-					&m_graphicsMeshes.back(), submeshIndex, &m_materials[materialIDs],
+					&graphicsMesh, submeshIndex, &m_materials[materialIDs],
 					&m_graphicsMaterials[loadedTextures[texPath]]->getMaterialVariant(),
 					mesh.getBounds(submeshIndex), &m_transforms[ids.transformID]
 				);
 				++submeshIndex;
 			}
 		}
+
+		// The variants and the meshes don't move after this point, streamed textures only swap the variant's descriptor sets
+		m_renderQueue.build(m_renderers);
+
+		// Nothing moves the imported transforms after loading
+		setAllTransformsStatic(true);
 	}
 	stagingBufPool.releaseAllResources();
 }
+
+bool Scene::createFallbackTexture(StagingBufferPool& stagingBufPool)
+{
+	constexpr uint32_t size = 4u, channels = 4u;
+	std::array<unsigned char, size * size * channels> pixels;
+	pixels.fill(255u);
+
+	std::vector<LoadedTexture> mipChain;
+	mipChain.emplace_back(pixels.data(), as_uint32(pixels.size()), size, size);
+
+	Texture texture(std::move(mipChain), VK_FORMAT_R8G8B8A8_SRGB, size, size, channels);
+	return VkTexture2D::tryCreateTexture(m_fallbackTexture, texture, m_presentationDevice, stagingBufPool, false);
+}
+
+void Scene::updateStreaming()
+{
+	if (!m_textureUploader || m_textureUploader->isIdle())
+		return;
+
+	auto& textureTable = m_presentationTarget->m_globalPipelineState->getTextureTable();
+	m_textureUploader->update([&](uint32_t index, UNQ<VkTexture2D>& texture)
+		{
+			auto& material = m_graphicsMaterials[index];
+			if (!material)
+				return;
+
+			m_textures[index] = std::move(texture);
+			const auto& variant = material->getMaterialVariant();
+			if (variant.hasDescriptorSets())
+			{
+				// The current sets may still be read by frames in flight, the texture gets freshly allocated ones
+				std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+				if (!DescriptorPoolManager::getInstance()->getPersistent().allocate(descriptorSets, variant.getDescriptorSetLayout()))
+				{
+					printf("Could not allocate the descriptor sets of a streamed texture, the material keeps the fallback texture.\n");
+					return;
+				}
+
+				vkinit::Descriptor::updateDescriptorSets(descriptorSets, m_presentationDevice->getDevice(), *m_textures[index]);
+				material->rebindTexture(*m_textures[index], descriptorSets);
+				return;
+			}
+
+			// The slot is rewritten in each frame's set once that frame starts again
+			textureTable.set(variant.getTextureIndex(), *m_textures[index]);
+			material->rebindTexture(*m_textures[index]);
+		});
+}
+
+void Scene::setTransform(size_t transformID, const glm::mat4& localToWorld)
+{
+	auto& transform = m_transforms[transformID];
+	if (transform.isStatic())
+	{
+		transform.setStatic(false);
+		m_renderQueue.invalidateStaticState();
+	}
+
+	transform.setLocalToWorld(localToWorld);
+}
+
+void Scene::setTransformStatic(size_t transformID, bool isStatic)
+{
+	auto& transform = m_transforms[transformID];
+	if (transform.isStatic() == isStatic)
+		return;
+
+	transform.setStatic(isStatic);
+	m_renderQueue.invalidateStaticState();
+}
+
+void Scene::setAllTransformsStatic(bool isStatic)
+{
+	for (auto& transform : m_transforms)
+	{
+		transform.setStatic(isStatic);
+	}
+	m_renderQueue.invalidateStaticState();
+}
@@ -4,15 +4,20 @@
 #include "Renderer.h"
 #include "Transform.h"
 #include "VkTypes/VkMeshRenderer.h"
+#include "RenderQueue.h"
 
 struct Mesh;
 struct VkMesh;
+struct VkMeshBuffers;
 
 class Material;
 struct TextureSource;
 struct VkTexture2D;
 struct VkMaterial;
 struct VkMeshRenderer;
+struct Path;
+class AsyncTextureUploader;
+class StagingBufferPool;
 
 namespace Loader { struct ModelLoaderOptions; }
 
@@ -34,16 +39,30 @@ public:
 	const std::vector<Renderer>& getRendererIDs() const;
 	const std::vector<VkMesh>& getGraphicsMeshes() const;
 	const std::vector<VkMeshRenderer>& getRenderers() const;
+	RenderQueue& getRenderQueue();
 
-	bool load(VkDescriptorPool descPool);
+	bool load();
 	void release(VkDevice device, VmaAllocator allocator);
 
 	bool tryInitializeFromFile(const Loader::ModelLoaderOptions& modelOptions);
-	void createGraphicsRepresentation(VkDescriptorPool descPool);
+	bool tryInitializeFromMappedCache(const Path& path);
+	bool writeMappedCache(const Path& path) const;
+	void createGraphicsRepresentation();
+
+	// Swaps the fallback texture out of the materials whose texture finished streaming in.
+	void updateStreaming();
+
+	// Moving a transform goes through here, so the render queue refreshes its world bounds.
+	void setTransform(size_t transformID, const glm::mat4& localToWorld);
+	// Static transforms are skipped by the per frame bounds update, the loaded ones start as static.
+	void setTransformStatic(size_t transformID, bool isStatic);
+	void setAllTransformsStatic(bool isStatic);
 
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version);
 
+	constexpr static VkDeviceSize c_maxMeshBuffersByteSize = 256u * 1024u * 1024u;
+
 private:
 	const Presentation::Device* m_presentationDevice;
 	Presentation::PresentationTarget* m_presentationTarget;
@@ -56,8 +75,18 @@ private:
 
 	// Graphics data
 	std::vector<VkMeshRenderer> m_renderers;
+	RenderQueue m_renderQueue;
 	std::vector<UNQ<VkTexture2D>> m_textures;
 	std::vector<UNQ<VkMaterial>> m_graphicsMaterials;
 	std::vector<VkMesh> m_graphicsMeshes;
+	std::vector<UNQ<VkMeshBuffers>> m_meshBuffers;
+
+	// Texture streaming, the materials sample their slot of the texture table
+	UNQ<VkTexture2D> m_fallbackTexture;
+	UNQ<AsyncTextureUploader> m_textureUploader;
+
+	bool createFallbackTexture(StagingBufferPool& stagingBufPool);
+	// Simplifies and optimizes the meshes an import appended from firstMesh on, the caches store the result so loading them costs nothing.
+	void processImportedMeshes(size_t firstMesh, const Loader::ModelLoaderOptions& modelOptions);
 };
  
\ No newline at end of file
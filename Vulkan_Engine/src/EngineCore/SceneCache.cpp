@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "SceneCache.h"
+#include "FileManager/Path.h"
+
+namespace SceneCache
+{
+	static uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+	bool isCurrent(const Path& path, const Key& key)
+	{
+		auto stream = std::ifstream(path.value, std::ios::in | std::ios::binary);
+		if (!stream.is_open())
+			return false;
+
+		Header header{};
+		stream.read(reinterpret_cast<char*>(&header), sizeof(Header));
+		return stream.good() && header.magic == magic && header.version == version && header.key == key;
+	}
+
+	bool Reader::open(const Path& path, const Key& key)
+	{
+		if (!m_file.open(path))
+			return false;
+
+		const auto fileSize = static_cast<uint64_t>(m_file.size());
+		constexpr auto sectionCount = static_cast<uint32_t>(ESection::Count);
+		constexpr auto tableSize = sizeof(Header) + sizeof(SectionEntry) * sectionCount;
+		if (fileSize < tableSize)
+		{
+			printf("The scene cache '%s' is truncated.\n", path.c_str());
+			return false;
+		}
+
+		Header header;
+		memcpy(&header, m_file.data(), sizeof(Header));
+		if (header.magic != magic || header.version != version || header.alignment != blobAlignment ||
+			header.sectionCount != sectionCount || header.fileSize != fileSize)
+		{
+			printf("The scene cache '%s' has an unsupported header (version %u, expected %u).\n", path.c_str(), header.version, version);
+			return false;
+		}
+
+		if (header.key != key)
+		{
+			printf("The scene cache '%s' was written with the vertex format %u and 16 bit indices %u, expected %u and %u.\n", path.c_str(),
+				header.key.vertexFormat, header.key.use16BitIndices, key.vertexFormat, key.use16BitIndices);
+			return false;
+		}
+
+		memcpy(m_sections.data(), m_file.data() + sizeof(Header), sizeof(SectionEntry) * sectionCount);
+		for (uint32_t i = 0; i < sectionCount; i++)
+		{
+			// Compared without multiplying or adding, a corrupted entry could otherwise wrap around and pass
+			const auto& entry = m_sections[i];
+			if (entry.type != i || entry.offset % blobAlignment != 0 || entry.offset > fileSize ||
+				(entry.elementSize != 0 && entry.count > (fileSize - entry.offset) / entry.elementSize))
+			{
+				printf("The scene cache '%s' has a corrupted section table at entry %u.\n", path.c_str(), i);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	Writer::Writer() : m_sections(), m_blobs()
+	{
+		for (uint32_t i = 0; i < static_cast<uint32_t>(ESection::Count); i++)
+			m_sections[i].type = i;
+	}
+
+	bool Writer::write(const Path& path, const Key& key)
+	{
+		constexpr auto sectionCount = static_cast<uint32_t>(ESection::Count);
+
+		// Lay out the blobs after the section table, each one starting at an aligned offset
+		uint64_t offset = alignUp(sizeof(Header) + sizeof(SectionEntry) * sectionCount, blobAlignment);
+		for (uint32_t i = 0; i < sectionCount; i++)
+		{
+			m_sections[i].offset = offset;
+			offset = alignUp(offset + m_blobs[i].size(), blobAlignment);
+		}
+
+		Header header{};
+		header.magic = magic;
+		header.version = version;
+		header.sectionCount = sectionCount;
+		header.alignment = static_cast<uint32_t>(blobAlignment);
+		header.key = key;
+		header.fileSize = offset;
+
+		auto stream = std::ofstream(path.value, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!stream.is_open())
+		{
+			printf("Could not open the scene cache '%s' for writing.\n", path.c_str());
+			return false;
+		}
+
+		const char padding[blobAlignment]{};
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		stream.write(reinterpret_cast<const char*>(m_sections.data()), sizeof(SectionEntry) * sectionCount);
+
+		uint64_t written = sizeof(Header) + sizeof(SectionEntry) * sectionCount;
+		for (uint32_t i = 0; i < sectionCount; i++)
+		{
+			stream.write(padding, m_sections[i].offset - written);
+			stream.write(m_blobs[i].data(), m_blobs[i].size());
+			written = m_sections[i].offset + m_blobs[i].size();
+		}
+		stream.write(padding, header.fileSize - written);
+
+		return stream.good();
+	}
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "pch.h"
+#include "FileManager/MappedFile.h"
+
+struct Path;
+
+// Versioned scene container: header, section table and raw blobs aligned for direct access from a file mapping.
+namespace SceneCache
+{
+	constexpr uint32_t magic = 0x43534B56; // "VKSC"
+	constexpr uint32_t version = 6;
+	constexpr uint64_t blobAlignment = 16;
+
+	enum class ESection : uint32_t
+	{
+		Meshes,
+		SubMeshes,
+		Positions,
+		UVs,
+		Normals,
+		Colors,
+		Indices,
+		Transforms,
+		Renderers,
+		MaterialIDs,
+		Materials,
+		Strings,
+		Lods,
+		// The indices of the meshes with 16 bit indices, MeshRecord::indexType picks the section
+		CompactIndices,
+
+		Count
+	};
+
+	// The settings the scene was imported with, a cache with a different key is imported again
+	struct Key
+	{
+		// A MeshDescriptor::EVertexFormat
+		uint32_t vertexFormat;
+		// Whether the meshes that fit got 16 bit indices
+		uint32_t use16BitIndices;
+
+		bool operator==(const Key& other) const { return vertexFormat == other.vertexFormat && use16BitIndices == other.use16BitIndices; }
+		bool operator!=(const Key& other) const { return !(*this == other); }
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sectionCount;
+		uint32_t alignment;
+		Key key;
+		uint64_t fileSize;
+	};
+
+	// Only reads the header, false for a missing file, an older version or a different key.
+	bool isCurrent(const Path& path, const Key& key);
+
+	struct SectionEntry
+	{
+		uint32_t type;
+		uint32_t elementSize;
+		uint64_t offset;
+		uint64_t count;
+	};
+
+	struct MeshRecord
+	{
+		uint64_t positionFirst, positionCount;
+		uint64_t uvFirst, uvCount;
+		uint64_t normalFirst, normalCount;
+		uint64_t colorFirst, colorCount;
+		uint64_t submeshFirst, submeshCount;
+		// VkIndexType of the submeshes and LODs of the mesh, their index ranges point into CompactIndices for 16 bit ones
+		uint32_t indexType;
+		uint32_t padding;
+	};
+
+	struct SubMeshRecord
+	{
+		uint64_t indexFirst, indexCount;
+		uint64_t lodFirst, lodCount;
+		glm::vec3 center;
+		glm::vec3 extents;
+	};
+
+	// The indices of a LOD live in the Indices section next to the ones of the full submesh
+	struct LodRecord
+	{
+		uint64_t indexFirst, indexCount;
+	};
+
+	struct RendererRecord
+	{
+		uint64_t meshID;
+		uint64_t transformID;
+		uint64_t materialFirst, materialCount;
+	};
+
+	struct MaterialRecord
+	{
+		uint32_t shaderIdentifier;
+		uint32_t format;
+		uint32_t generateTheMips;
+		uint32_t pathLength;
+		uint64_t pathFirst;
+	};
+
+	template<typename T>
+	struct Span
+	{
+		const T* ptr;
+		size_t count;
+
+		Span() : ptr(nullptr), count(0) { }
+		Span(const T* ptr, size_t count) : ptr(ptr), count(count) { }
+
+		const T* begin() const { return ptr; }
+		const T* end() const { return ptr + count; }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		const T& operator[](size_t i) const { return ptr[i]; }
+
+		Span<T> subspan(uint64_t first, uint64_t length) const
+		{
+			return first <= count && length <= count - first ? Span<T>(ptr + first, static_cast<size_t>(length)) : Span<T>();
+		}
+	};
+
+	// Hands out spans that point straight into the mapped file, valid while the reader is alive.
+	class Reader
+	{
+	public:
+		bool open(const Path& path, const Key& key);
+
+		template<typename T>
+		Span<T> getSection(ESection section) const
+		{
+			const auto& entry = m_sections[static_cast<size_t>(section)];
+			if (entry.elementSize != sizeof(T))
+				return Span<T>();
+
+			return Span<T>(reinterpret_cast<const T*>(m_file.data() + entry.offset), static_cast<size_t>(entry.count));
+		}
+
+	private:
+		MappedFile m_file;
+		std::array<SectionEntry, static_cast<size_t>(ESection::Count)> m_sections;
+	};
+
+	// Collects the blobs in memory and writes them out in a single pass.
+	class Writer
+	{
+	public:
+		Writer();
+
+		template<typename T>
+		uint64_t append(ESection section, const T* src, size_t count)
+		{
+			auto& blob = m_blobs[static_cast<size_t>(section)];
+			auto& entry = m_sections[static_cast<size_t>(section)];
+
+			const auto first = entry.count;
+			const auto byteSize = sizeof(T) * count;
+			const auto offset = blob.size();
+
+			entry.elementSize = sizeof(T);
+			entry.count += count;
+
+			blob.resize(offset + byteSize);
+			if (byteSize > 0)
+				memcpy(blob.data() + offset, src, byteSize);
+
+			return first;
+		}
+
+		template<typename T>
+		uint64_t append(ESection section, const std::vector<T>& src) { return append(section, src.data(), src.size()); }
+
+		bool write(const Path& path, const Key& key);
+
+	private:
+		std::array<SectionEntry, static_cast<size_t>(ESection::Count)> m_sections;
+		std::array<std::vector<char>, static_cast<size_t>(ESection::Count)> m_blobs;
+	};
+}
@@ -12,11 +12,11 @@ bool ShaderSource::getVertexSource(std::vector<char>& sourcecode) const { return
 
 bool ShaderSource::getFragmentSource(std::vector<char>& sourcecode) const { return FileIO::readFile(sourcecode, fragmentPath); }
 
-ShaderSource ShaderSource::getDefaultShader()
+ShaderSource ShaderSource::getDefaultShader(bool useTextureTable)
 {
 	return ShaderSource(
 		Directories::getShaderLibraryPath().combine("simple.vert.spv"),
-		Directories::getShaderLibraryPath().combine("simple.frag.spv")
+		Directories::getShaderLibraryPath().combine(useTextureTable ? "simple.frag.spv" : "simple_bound.frag.spv")
 	);
 }
 
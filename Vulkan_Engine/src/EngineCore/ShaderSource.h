@@ -13,7 +13,8 @@ struct ShaderSource
 	bool getVertexSource(std::vector<char>&) const;
 	bool getFragmentSource(std::vector<char>&) const;
 
-	static ShaderSource getDefaultShader();
+	// Without the texture table the fragment shader samples the single texture bound by the material
+	static ShaderSource getDefaultShader(bool useTextureTable = true);
 	static ShaderSource getDepthOnlyShader();
 	static ShaderSource getDebugQuadShader();
 };
\ No newline at end of file
@@ -1,178 +1,370 @@
 #include "pch.h"
 #include "StagingBufferPool.h"
+#include "Presentation/Device.h"
 
 #define VERBOSITY_ERROR
 //#define VERBOSITY_INFO
 
-bool StagingBufferPool::claimAStagingBuffer(StgBuffer& buffer, uint32_t byteSize)
+static uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+StagingBufferPool::StagingBufferPool(const Presentation::Device* device, VkDeviceSize ringByteSize)
+	: m_device(device), m_ringByteSize(alignUp(ringByteSize, c_defaultAlignment)),
+	m_ringBuffer(VK_NULL_HANDLE), m_ringAllocation(VK_NULL_HANDLE), m_ringMapped(nullptr),
+	m_head(0), m_tail(0), m_lap(0),
+	m_commandPool(VK_NULL_HANDLE), m_recordingCommandBuffer(VK_NULL_HANDLE),
+	m_nextMarker(0), m_inFlight(), m_pendingDedicated() { }
+
+bool StagingBufferPool::claimAStagingBuffer(StgBuffer& buffer, uint32_t byteSize, VkDeviceSize alignment)
 {
-	int theNextBestThing = -1;
-	for (int i = 0, n = static_cast<int>(freePool.size()); i < n; i++)
-	{
-		auto& buf = freePool[i];
+	if (byteSize > m_ringByteSize)
+		return claimDedicated(buffer, byteSize);
 
-		// Check for exact match
-		if (byteSize == buf.totalByteSize)
-		{
-			buffer = buf;
-			m_stats.reusedMatchingBuffer += 1;
-#ifdef VERBOSITY_INFO
-			printf("Found a buffer (%i) matching the requested size (%i).\n", buf.totalByteSize, byteSize);
-#endif
+	if (m_ringBuffer == VK_NULL_HANDLE && !createRing())
+		return false;
 
-			claimedFromFreePool_impl(i);
-			return true;
-		}
+	retireCompleted();
 
-		// The buffer we are looking at is bigger, so it would work, but lets check if we already have a better option that is closer to desired size.
-		if (byteSize < buf.totalByteSize &&
-			(theNextBestThing < 0 || freePool[theNextBestThing].totalByteSize > buf.totalByteSize))
-		{
-			theNextBestThing = i;
-		}
+	// Never split a region across the end of the ring
+	auto position = alignUp(m_head, alignment);
+	const auto offset = position % m_ringByteSize;
+	if (offset + byteSize > m_ringByteSize)
+	{
+		position += m_ringByteSize - offset;
 	}
 
-	if (theNextBestThing >= 0)
+	// Nothing is in use, the skipped bytes don't need to wait for anything
+	if (m_head == m_tail)
 	{
-		buffer = freePool[theNextBestThing];
-		m_stats.reusedBiggerBuffer += 1;
-#ifdef VERBOSITY_INFO
-		printf("Found a buffer (%i) clooose to the requested size (%i).\n", freePool[theNextBestThing].totalByteSize, byteSize);
-#endif
+		m_tail = position;
+	}
 
-		claimedFromFreePool_impl(theNextBestThing);
-		return true;
+	while (position + byteSize - m_tail > m_ringByteSize)
+	{
+		if (!makeRoom())
+		{
+#ifdef VERBOSITY_ERROR
+			printf("The staging ring has no room for %u bytes and nothing it could wait on.\n", byteSize);
+#endif
+			return false;
+		}
 	}
 
-	// Doesn't exist - create
-	if (createNewBuffer(buffer, byteSize))
+	if (position / m_ringByteSize != m_lap)
 	{
-		claim(buffer);
-		return true;
+		m_lap = position / m_ringByteSize;
+		m_stats.ringWraps += 1;
 	}
-	return false;
+
+	m_head = position + byteSize;
+	m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_head - m_tail);
+	m_stats.claimCount += 1;
+	m_stats.bytesStaged += byteSize;
+
+	buffer.buffer = m_ringBuffer;
+	buffer.offset = position % m_ringByteSize;
+	buffer.mapped = m_ringMapped + buffer.offset;
+	buffer.totalByteSize = byteSize;
+
+#ifdef VERBOSITY_INFO
+	printf("Claimed %u bytes of the staging ring at offset %llu.\n", byteSize, buffer.offset);
+#endif
+	return true;
 }
 
-void StagingBufferPool::freeBuffer(const StgBuffer& buffer)
+bool StagingBufferPool::stage(StgBuffer& buffer, const void* source, uint32_t byteSize, VkDeviceSize alignment)
 {
-	returnToFreePool_impl(buffer);
+	if (!claimAStagingBuffer(buffer, byteSize, alignment))
+		return false;
+
+	memcpy(buffer.mapped, source, byteSize);
+	return true;
 }
 
-void StagingBufferPool::releaseAllResources()
+VkCommandBuffer StagingBufferPool::getBatchCommandBuffer()
 {
-	for (auto& buffer : freePool)
+	if (m_recordingCommandBuffer != VK_NULL_HANDLE)
+		return m_recordingCommandBuffer;
+
+	const auto device = m_device->getDevice();
+	if (m_commandPool == VK_NULL_HANDLE &&
+		!vkinit::Commands::createCommandPool(m_commandPool, device, m_device->getQueueFamilyIndices().graphicsFamily.value(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT))
 	{
-		indirection_destroyBuffer(buffer, false);
+		throw std::runtime_error("Could not create the command pool for the staging batches.");
 	}
-	freePool.clear();
 
-	for (auto& buffer : claimedPool)
+	if (!vkinit::Commands::createSingleCommandBuffer(m_recordingCommandBuffer, m_commandPool, device))
 	{
-#ifdef VERBOSITY_ERROR
-		printf("[FORCE RELEASE] Warning, the buffer (%p) of size %i is still claimed, but release all resources was called on the pool.\n", buffer.buffer, buffer.totalByteSize);
-#endif
-		indirection_destroyBuffer(buffer, false);
+		throw std::runtime_error("Could not allocate the command buffer for a staging batch.");
 	}
-	claimedPool.clear();
 
-	m_stats.print();
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_recordingCommandBuffer, &beginInfo);
+
+	return m_recordingCommandBuffer;
 }
 
-bool StagingBufferPool::createNewBuffer(StgBuffer& buffer, uint32_t size)
+bool StagingBufferPool::submitBatch(bool waitForCompletion)
 {
-	// Before creating a new bigger buffer, free all the smaller ones in the free pool.
-	for (auto& freeBuf : freePool)
+	if (m_recordingCommandBuffer == VK_NULL_HANDLE)
+		return true;
+
+	const auto device = m_device->getDevice();
+	auto commandBuffer = m_recordingCommandBuffer;
+	m_recordingCommandBuffer = VK_NULL_HANDLE;
+	vkEndCommandBuffer(commandBuffer);
+
+	VkFence fence;
+	if (!vkinit::Synchronization::createFence(fence, device, false))
 	{
-		assert(freeBuf.totalByteSize < size && "Trying to create a new staging buffer while a bigger one was already present in the free pool!");
+		printf("Could not create the fence for a staging batch.\n");
+		vkFreeCommandBuffers(device, m_commandPool, 1, &commandBuffer);
+		return false;
+	}
 
-#ifdef VERBOSITY_INFO
-		printf("TEMP\t\t\t\tDestroyed a free buffer (%i), because it was smaller than %i.\n", freeBuf.totalByteSize, size);
-#endif
-		indirection_destroyBuffer(freeBuf);
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		printf("Failed to submit a staging batch.\n");
+		vkDestroyFence(device, fence, nullptr);
+		vkFreeCommandBuffers(device, m_commandPool, 1, &commandBuffer);
+		return false;
 	}
-	freePool.clear();
 
-#ifdef VERBOSITY_INFO
-	printf("Trying to allocate a new staging buffer of size %i.\n", size);
-#endif
-	return indirection_allocateBuffer(buffer, size);
+	closeBatch(commandBuffer, fence);
+	m_stats.batchCount += 1;
+
+	if (waitForCompletion)
+	{
+		vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+		retireCompleted();
+	}
+	return true;
 }
 
-void StagingBufferPool::claimedFromFreePool_impl(size_t index)
+void StagingBufferPool::flush()
 {
-	if (index >= 0 && index < freePool.size())
-	{
-		claim(freePool[index]);
+	submitBatch();
 
-		freePool[index] = freePool.back();
-		freePool.pop_back();
+	const auto device = m_device->getDevice();
+	for (auto& batch : m_inFlight)
+	{
+		if (batch.fence != VK_NULL_HANDLE)
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
 	}
-	else
+	retireCompleted();
+}
+
+uint64_t StagingBufferPool::closeExternalRegions()
+{
+	closeBatch(VK_NULL_HANDLE, VK_NULL_HANDLE);
+	return m_inFlight.back().marker;
+}
+
+void StagingBufferPool::releaseExternalRegions(uint64_t marker)
+{
+	for (auto& batch : m_inFlight)
 	{
-#ifdef VERBOSITY_ERROR
-		printf("The index %zu was out of bounds of the free pool [0, %zu).\n", index, freePool.size());
-#endif
+		if (batch.marker <= marker && batch.fence == VK_NULL_HANDLE && batch.marker != c_retiredMarker)
+			retire(batch);
 	}
+	retireCompleted();
 }
 
-void StagingBufferPool::returnToFreePool_impl(const StgBuffer& buffer)
+void StagingBufferPool::releaseAllResources()
 {
-	bool freed = false;
-	for (size_t i = 0; i < claimedPool.size(); i++)
+	flush();
+
+	for (auto& batch : m_inFlight)
 	{
-		if (claimedPool[i].totalByteSize == buffer.totalByteSize &&
-			claimedPool[i].allocation == buffer.allocation)
-		{
-			claimedPool[i] = claimedPool.back();
-			claimedPool.pop_back();
+		if (batch.marker == c_retiredMarker)
+			continue;
 
-			freed = true;
-		}
+#ifdef VERBOSITY_ERROR
+		printf("[FORCE RELEASE] Warning, the staging regions up to %llu were never released, but release all resources was called on the pool.\n", batch.ringEnd);
+#endif
+		retire(batch);
+	}
+	m_inFlight.clear();
+
+#ifndef NO_GRAPHICS_MODE
+	auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+	for (auto& dedicated : m_pendingDedicated)
+	{
+		vmaDestroyBuffer(allocator, dedicated.buffer, dedicated.allocation);
 	}
 
-	if (freed)
+	if (m_ringBuffer != VK_NULL_HANDLE)
 	{
-		free(buffer);
+		vmaDestroyBuffer(allocator, m_ringBuffer, m_ringAllocation);
 	}
-	else
+
+	if (m_commandPool != VK_NULL_HANDLE)
 	{
-#ifdef VERBOSITY_ERROR
-		printf("The provided buffer is not managed by this staging buffer pool, it was not found in the list of claimed objects.\n");
-#endif
+		vkDestroyCommandPool(m_device->getDevice(), m_commandPool, nullptr);
 	}
-}
+#endif
+	m_pendingDedicated.clear();
+	m_ringBuffer = VK_NULL_HANDLE;
+	m_ringAllocation = VK_NULL_HANDLE;
+	m_ringMapped = nullptr;
+	m_commandPool = VK_NULL_HANDLE;
+	m_head = m_tail = m_lap = 0;
 
-void StagingBufferPool::claim(const StgBuffer& buffer)
-{
-	claimedPool.push_back(buffer);
-	m_stats.claimCount += 1;
+	m_stats.print(m_ringByteSize);
 }
 
-void StagingBufferPool::free(const StgBuffer& buffer)
+bool StagingBufferPool::createRing()
 {
-	freePool.push_back(buffer);
-	m_stats.freeCount += 1;
+	auto isSuccess = false;
+
+#ifndef NO_GRAPHICS_MODE
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_ringByteSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// CPU_ONLY is guaranteed to be host coherent, the writes don't need to be flushed
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo mappedInfo{};
+	auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+	isSuccess = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &m_ringBuffer, &m_ringAllocation, &mappedInfo) == VK_SUCCESS;
+	m_ringMapped = isSuccess ? static_cast<char*>(mappedInfo.pMappedData) : nullptr;
+#endif
+
+	if (!isSuccess)
+	{
+		printf("Could not allocate the staging ring of %llu bytes.\n", m_ringByteSize);
+	}
+	return isSuccess;
 }
 
-void StagingBufferPool::indirection_destroyBuffer(StgBuffer& buffer, bool increaseCounter)
+bool StagingBufferPool::claimDedicated(StgBuffer& buffer, uint32_t byteSize)
 {
+	auto isSuccess = false;
+	DedicatedBuffer dedicated{};
+
 #ifndef NO_GRAPHICS_MODE
-	m_stats.destroyedBuffer += increaseCounter;
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = byteSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo mappedInfo{};
 	auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
-	vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+	isSuccess = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &dedicated.buffer, &dedicated.allocation, &mappedInfo) == VK_SUCCESS;
+	buffer.mapped = mappedInfo.pMappedData;
 #endif
+
+	if (!isSuccess)
+	{
+		printf("Could not allocate a dedicated staging buffer of %u bytes.\n", byteSize);
+		return false;
+	}
+
+#ifdef VERBOSITY_INFO
+	printf("The claim of %u bytes does not fit the staging ring (%llu bytes), allocated a dedicated buffer.\n", byteSize, m_ringByteSize);
+#endif
+	m_pendingDedicated.push_back(dedicated);
+	m_stats.dedicatedCount += 1;
+	m_stats.claimCount += 1;
+	m_stats.bytesStaged += byteSize;
+
+	buffer.buffer = dedicated.buffer;
+	buffer.offset = 0;
+	buffer.totalByteSize = byteSize;
+	return true;
 }
 
-bool StagingBufferPool::indirection_allocateBuffer(StgBuffer& buffer, uint32_t size)
+bool StagingBufferPool::makeRoom()
 {
-	auto isSuccess = false;
+	// The region we need is still owned by the batch being recorded
+	if (m_inFlight.empty())
+		return m_recordingCommandBuffer != VK_NULL_HANDLE && submitBatch();
+
+	auto& oldest = m_inFlight.front();
+	m_stats.stalls += 1;
+
+	// The caller that submitted these regions has to release them
+	if (oldest.fence == VK_NULL_HANDLE)
+		return false;
+
+	vkWaitForFences(m_device->getDevice(), 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+	retireCompleted();
+	return true;
+}
+
+void StagingBufferPool::retireCompleted()
+{
+	const auto device = m_device->getDevice();
+
+	// The tail only moves past batches whose predecessors are all retired
+	size_t count = 0;
+	for (; count < m_inFlight.size(); count++)
+	{
+		auto& batch = m_inFlight[count];
+		if (batch.fence != VK_NULL_HANDLE)
+		{
+			if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS)
+				break;
+
+			retire(batch);
+		}
+		// External regions are retired by releaseExternalRegions
+		else if (batch.marker != c_retiredMarker)
+		{
+			break;
+		}
+
+		m_tail = std::max(m_tail, batch.ringEnd);
+	}
+	m_inFlight.erase(m_inFlight.begin(), m_inFlight.begin() + count);
+}
 
+void StagingBufferPool::retire(InFlightBatch& batch)
+{
 #ifndef NO_GRAPHICS_MODE
+	const auto device = m_device->getDevice();
 	auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
-	isSuccess = vkinit::MemoryBuffer::allocateBufferAndMemory(buffer.buffer, buffer.allocation, allocator, size, VMA_MEMORY_USAGE_CPU_TO_GPU, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	for (auto& dedicated : batch.dedicatedBuffers)
+	{
+		vmaDestroyBuffer(allocator, dedicated.buffer, dedicated.allocation);
+	}
+
+	if (batch.commandBuffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(device, m_commandPool, 1, &batch.commandBuffer);
+	if (batch.fence != VK_NULL_HANDLE)
+		vkDestroyFence(device, batch.fence, nullptr);
 #endif
 
-	buffer.totalByteSize = size;
-	m_stats.createdBuffer += isSuccess;
-	return isSuccess;
-}
\ No newline at end of file
+	batch.dedicatedBuffers.clear();
+	batch.commandBuffer = VK_NULL_HANDLE;
+	batch.fence = VK_NULL_HANDLE;
+	batch.marker = c_retiredMarker;
+}
+
+void StagingBufferPool::closeBatch(VkCommandBuffer commandBuffer, VkFence fence)
+{
+	InFlightBatch batch{};
+	batch.marker = m_nextMarker++;
+	batch.ringEnd = m_head;
+	batch.commandBuffer = commandBuffer;
+	batch.fence = fence;
+	batch.dedicatedBuffers = std::move(m_pendingDedicated);
+	m_pendingDedicated.clear();
+
+	m_inFlight.push_back(std::move(batch));
+}
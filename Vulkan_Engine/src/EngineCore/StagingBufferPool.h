@@ -2,13 +2,21 @@
 #include "VkTypes/InitializersUtility.h"
 #include "VkTypes/VkMemoryAllocator.h"
 
+namespace Presentation
+{
+	class Device;
+}
+
+// Persistently mapped staging ring, claims are sub-allocated linearly and their copies recorded into one shared batch.
+// A region is reused only after the fence of the batch that read from it is signaled.
 class StagingBufferPool
 {
 public:
 	struct StgBuffer
 	{
 		VkBuffer buffer;
-		VmaAllocation allocation;
+		VkDeviceSize offset;
+		void* mapped;
 
 		uint32_t totalByteSize;
 	};
@@ -16,46 +24,99 @@ public:
 	// Storing stats on the buffer performance.
 	struct Stats
 	{
-		int freeCount;
 		int claimCount;
+		int dedicatedCount;
+		int batchCount;
 
-		int reusedMatchingBuffer;
-		int reusedBiggerBuffer;
+		int ringWraps;
+		int stalls;
 
-		int destroyedBuffer;
-		int createdBuffer;
+		uint64_t bytesStaged;
+		uint64_t peakBytesInUse;
 
-		Stats() : freeCount(0), claimCount(0),
-			reusedMatchingBuffer(0), reusedBiggerBuffer(0),
-			createdBuffer(0), destroyedBuffer(0) { }
+		Stats() : claimCount(0), dedicatedCount(0), batchCount(0),
+			ringWraps(0), stalls(0),
+			bytesStaged(0), peakBytesInUse(0) { }
 
-		void print()
+		void print(VkDeviceSize ringByteSize) const
 		{
-			printf("Staging buffer stats: (Created new %i, reallocated to grow %i), (Reuse matching size %i, bigger size %i), (Claims %i, frees %i).\n",
-				createdBuffer - destroyedBuffer, destroyedBuffer, reusedMatchingBuffer, reusedBiggerBuffer, claimCount, freeCount);
+			constexpr double toMB = 1.0 / (1024.0 * 1024.0);
+			printf("Staging buffer stats: %.2f MB staged by %i claims in %i batches (%i too big for the ring), peak %.2f / %.2f MB in use, wrapped %i times, stalled %i times.\n",
+				bytesStaged * toMB, claimCount, batchCount, dedicatedCount, peakBytesInUse * toMB, ringByteSize * toMB, ringWraps, stalls);
 		}
 	};
 
-	bool claimAStagingBuffer(StgBuffer& buffer, uint32_t byteSize);
-	void freeBuffer(const StgBuffer& buffer);
+	constexpr static VkDeviceSize c_defaultRingByteSize = 128u * 1024u * 1024u;
+	constexpr static VkDeviceSize c_defaultAlignment = 16u;
+
+	StagingBufferPool(const Presentation::Device* device, VkDeviceSize ringByteSize = c_defaultRingByteSize);
+
+	// Waits on the oldest batch when the ring is full, requests bigger than the ring get a buffer of their own.
+	bool claimAStagingBuffer(StgBuffer& buffer, uint32_t byteSize, VkDeviceSize alignment = c_defaultAlignment);
+	bool stage(StgBuffer& buffer, const void* source, uint32_t byteSize, VkDeviceSize alignment = c_defaultAlignment);
+
+	// The copies reading from the claimed regions are recorded here, the batch goes out in a single submission.
+	VkCommandBuffer getBatchCommandBuffer();
+	bool submitBatch(bool waitForCompletion = false);
+	void flush();
+
+	// For callers submitting the copies on their own queue: closes the regions claimed so far,
+	// the returned marker is released once the caller's fence is signaled.
+	uint64_t closeExternalRegions();
+	void releaseExternalRegions(uint64_t marker);
+
 	void releaseAllResources();
 
 	const Stats& getStatistics() const { return m_stats; }
+	VkDeviceSize getRingByteSize() const { return m_ringByteSize; }
 
 private:
-	bool indirection_allocateBuffer(StgBuffer& buffer, uint32_t size);
-	void indirection_destroyBuffer(StgBuffer& buffer, bool increaseCounter = true);
+	constexpr static uint64_t c_retiredMarker = std::numeric_limits<uint64_t>::max();
+
+	struct DedicatedBuffer
+	{
+		VkBuffer buffer;
+		VmaAllocation allocation;
+	};
+
+	struct InFlightBatch
+	{
+		uint64_t marker;
+		uint64_t ringEnd;
+
+		// Both are null for the regions submitted by an external caller
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+
+		std::vector<DedicatedBuffer> dedicatedBuffers;
+	};
+
+	bool createRing();
+	bool claimDedicated(StgBuffer& buffer, uint32_t byteSize);
+	bool makeRoom();
+
+	void retireCompleted();
+	void retire(InFlightBatch& batch);
+	void closeBatch(VkCommandBuffer commandBuffer, VkFence fence);
+
+	const Presentation::Device* m_device;
+	VkDeviceSize m_ringByteSize;
+
+	VkBuffer m_ringBuffer;
+	VmaAllocation m_ringAllocation;
+	char* m_ringMapped;
 
-	bool createNewBuffer(StgBuffer& buffer, uint32_t size);
-	void claimedFromFreePool_impl(size_t index);
-	void returnToFreePool_impl(const StgBuffer& buffer);
+	// Monotonic byte positions, the offset into the ring is position % ring size
+	uint64_t m_head;
+	uint64_t m_tail;
+	uint64_t m_lap;
 
-	void claim(const StgBuffer& buffer);
-	void free(const StgBuffer& buffer);
+	VkCommandPool m_commandPool;
+	VkCommandBuffer m_recordingCommandBuffer;
 
-	// The actual buffers
-	std::vector<StgBuffer> claimedPool;
-	std::vector<StgBuffer> freePool;
+	uint64_t m_nextMarker;
+	std::vector<InFlightBatch> m_inFlight;
+	std::vector<DedicatedBuffer> m_pendingDedicated;
 
 	Stats m_stats{};
 };
@@ -1,9 +1,9 @@
 #include "pch.h"
 #include "Mesh.h"
 
-SubMesh::SubMesh() : m_indices(), m_bounds() { }
-SubMesh::SubMesh(size_t size) : m_indices(), m_bounds() { m_indices.reserve(size); }
-SubMesh::SubMesh(std::vector<MeshDescriptor::TVertexIndices>& indices) : m_indices(std::move(indices)), m_bounds() { }
+SubMesh::SubMesh() : m_indices(), m_bounds(), m_lods() { }
+SubMesh::SubMesh(size_t size) : m_indices(), m_bounds(), m_lods() { m_indices.reserve(size); }
+SubMesh::SubMesh(std::vector<MeshDescriptor::TVertexIndices>& indices) : m_indices(std::move(indices)), m_bounds(), m_lods() { }
 size_t SubMesh::getIndexCount() const { return m_indices.size(); }
 
 bool SubMesh::operator ==(const SubMesh& other) const
@@ -17,7 +17,7 @@ bool SubMesh::operator ==(const SubMesh& other) const
 			return false;
 	}
 
-	return true;
+	return m_lods == other.m_lods;
 }
 
 bool SubMesh::operator !=(const SubMesh& other) const { return !(*this == other); }
\ No newline at end of file
@@ -106,32 +106,37 @@ void Texture::copyBufferToImage(const Presentation::Device* presentationDevice,
 {
 	presentationDevice->submitImmediatelyAndWaitCompletion([=](VkCommandBuffer cmd)
 		{
-			const auto count = dimensions.size();
-			auto offsets = 0u;
+			Texture::copyBufferToImage(cmd, buffer, image, dimensions);
+		});
+}
 
-			std::vector<VkBufferImageCopy> regions(count);
-			for(size_t i = 0; i < count; i++)
-			{
-				regions[i]  = VkBufferImageCopy{};
-				auto& region = regions[i];
+void Texture::copyBufferToImage(const VkCommandBuffer cmd, VkBuffer buffer, VkImage image, const std::vector<MipDesc>& dimensions, VkDeviceSize bufferOffset)
+{
+	const auto count = dimensions.size();
+	auto offsets = bufferOffset;
 
-				region.bufferOffset = offsets;
-				region.bufferRowLength = 0;
-				region.bufferImageHeight = 0;
+	std::vector<VkBufferImageCopy> regions(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		regions[i]  = VkBufferImageCopy{};
+		auto& region = regions[i];
 
-				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				region.imageSubresource.mipLevel = as_uint32(i);
-				region.imageSubresource.baseArrayLayer = 0;
-				region.imageSubresource.layerCount = 1;
+		region.bufferOffset = offsets;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
 
-				region.imageOffset = { 0, 0, 0 };
-				region.imageExtent = { dimensions[i].width, dimensions[i].height, 1 };
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = as_uint32(i);
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
 
-				offsets += dimensions[i].imageByteSize;
-			}
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { dimensions[i].width, dimensions[i].height, 1 };
 
-			vkCmdCopyBufferToImage(cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, as_uint32(regions.size()), regions.data());
-		});
+		offsets += dimensions[i].imageByteSize;
+	}
+
+	vkCmdCopyBufferToImage(cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, as_uint32(regions.size()), regions.data());
 }
 
 struct _PipelineBarrierArg
@@ -100,6 +100,7 @@ struct Texture
 	static bool tryLoadSupportedFormat(Texture& texture, const std::string& path);
 
 	static void copyBufferToImage(const Presentation::Device* presentationDevice, VkBuffer buffer, VkImage image, const std::vector<MipDesc>& dimensions);
+	static void copyBufferToImage(const VkCommandBuffer cmd, VkBuffer buffer, VkImage image, const std::vector<MipDesc>& dimensions, VkDeviceSize bufferOffset = 0);
 	static void transitionImageLayout(const Presentation::Device* presentationDevice, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipCount);
 	static void transitionImageLayout(const VkCommandBuffer cmd, const VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipCount = 1u, VkImageAspectFlagBits subResImageAspect = VK_IMAGE_ASPECT_COLOR_BIT);
 
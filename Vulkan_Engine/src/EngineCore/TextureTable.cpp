@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "TextureTable.h"
+#include "VkTypes/InitializersUtility.h"
+#include "VkTypes/VkTexture.h"
+#include "DescriptorAllocator.h"
+
+TextureTable::TextureTable(VkDevice device, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t capacity)
+	: m_isInitialized(false), m_device(device), m_capacity(std::max(capacity, 1u)), m_currentFrame(0),
+	m_fallback(nullptr), m_slots(), m_descriptorSets(), m_pendingSlots(), m_pendingReset()
+{
+	m_isInitialized = allocator.allocate(m_descriptorSets, layout);
+}
+
+bool TextureTable::isInitialized() const { return m_isInitialized; }
+
+void TextureTable::reset(const VkTexture2D& fallback)
+{
+	m_fallback = &fallback;
+	m_slots.assign(1, &fallback);
+
+	m_pendingReset.fill(true);
+	for (auto& pending : m_pendingSlots)
+		pending.clear();
+}
+
+uint32_t TextureTable::add(const VkTexture2D& texture)
+{
+	assert(m_fallback != nullptr && "The texture table has to be reset before textures are added.");
+	if (m_slots.size() >= m_capacity)
+	{
+		printf("The texture table is full at %u textures, the material keeps the fallback texture.\n", m_capacity);
+		return c_fallbackSlot;
+	}
+
+	const auto slot = as_uint32(m_slots.size());
+	m_slots.push_back(&texture);
+	for (auto& pending : m_pendingSlots)
+		pending.push_back(slot);
+
+	return slot;
+}
+
+void TextureTable::set(uint32_t slot, const VkTexture2D& texture)
+{
+	if (slot == c_fallbackSlot || slot >= m_slots.size())
+		return;
+
+	m_slots[slot] = &texture;
+	for (auto& pending : m_pendingSlots)
+		pending.push_back(slot);
+}
+
+uint32_t TextureTable::startFrame(uint32_t frameIndex)
+{
+	m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+	if (m_fallback == nullptr)
+		return 0u;
+
+	// The previous submission using this frame's set has already completed, it can be written.
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkWriteDescriptorSet> writes;
+
+	const auto describe = [](const VkTexture2D& texture)
+	{
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = texture.imageView;
+		imageInfo.sampler = texture.sampler;
+		return imageInfo;
+	};
+
+	auto& pending = m_pendingSlots[m_currentFrame];
+	if (m_pendingReset[m_currentFrame])
+	{
+		// Every slot has to hold a valid descriptor, the pipelines statically use the whole array
+		imageInfos.assign(m_capacity, describe(*m_fallback));
+		for (size_t slot = 0; slot < m_slots.size(); slot++)
+			imageInfos[slot] = describe(*m_slots[slot]);
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptorSets[m_currentFrame];
+		write.dstBinding = 0;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = m_capacity;
+		write.pImageInfo = imageInfos.data();
+		writes.push_back(write);
+
+		m_pendingReset[m_currentFrame] = false;
+	}
+	else
+	{
+		std::sort(pending.begin(), pending.end());
+		pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+		// Reserved up front, the writes point into it
+		imageInfos.reserve(pending.size());
+		for (auto slot : pending)
+		{
+			imageInfos.push_back(describe(*m_slots[slot]));
+
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = m_descriptorSets[m_currentFrame];
+			write.dstBinding = 0;
+			write.dstArrayElement = slot;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.descriptorCount = 1;
+			write.pImageInfo = &imageInfos.back();
+			writes.push_back(write);
+		}
+	}
+	pending.clear();
+
+	if (!writes.empty())
+		vkUpdateDescriptorSets(m_device, as_uint32(writes.size()), writes.data(), 0, nullptr);
+
+	return as_uint32(imageInfos.size());
+}
+
+const VkDescriptorSet* TextureTable::getDescriptorSet() const { return &m_descriptorSets[m_currentFrame]; }
+
+void TextureTable::release()
+{
+	// The sets go away with the pools of their allocator
+	m_fallback = nullptr;
+	m_slots.clear();
+	for (auto& pending : m_pendingSlots)
+		pending.clear();
+}
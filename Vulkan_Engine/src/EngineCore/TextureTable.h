@@ -0,0 +1,49 @@
+#pragma once
+#include "pch.h"
+#include "Common.h"
+#include "Interfaces/IRequireInitialization.h"
+
+struct VkTexture2D;
+class DescriptorAllocator;
+
+// Every scene texture in a single array of combined image samplers, bound once per pass at BindingSlots::MaterialTextures.
+// A draw picks its texture through the material index written next to its transform. Each frame in flight has its own set,
+// a changed slot is only written into a set once the frame using it starts again, so no set is updated while the GPU reads it.
+class TextureTable : IRequireInitialization
+{
+public:
+	constexpr static uint32_t c_maxCapacity = 4096u;
+	// Always holds the fallback texture, materials beyond the capacity keep using it.
+	constexpr static uint32_t c_fallbackSlot = 0u;
+
+	TextureTable(VkDevice device, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t capacity);
+	bool isInitialized() const override;
+
+	uint32_t getCapacity() const { return m_capacity; }
+	uint32_t getCount() const { return as_uint32(m_slots.size()); }
+
+	// Points every slot of every frame at the fallback, nothing may be drawn with the table before it was reset once.
+	void reset(const VkTexture2D& fallback);
+	// Returns the slot of the texture, c_fallbackSlot once the table is full.
+	uint32_t add(const VkTexture2D& texture);
+	void set(uint32_t slot, const VkTexture2D& texture);
+
+	// Writes the slots that changed since this frame's set was last used. Returns the number of descriptors written.
+	uint32_t startFrame(uint32_t frameIndex);
+	const VkDescriptorSet* getDescriptorSet() const;
+
+	void release();
+
+private:
+	bool m_isInitialized;
+	VkDevice m_device;
+	uint32_t m_capacity;
+	uint32_t m_currentFrame;
+
+	const VkTexture2D* m_fallback;
+	std::vector<const VkTexture2D*> m_slots;
+
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_descriptorSets;
+	std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> m_pendingSlots;
+	std::array<bool, MAX_FRAMES_IN_FLIGHT> m_pendingReset;
+};
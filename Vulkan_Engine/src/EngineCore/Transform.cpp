@@ -1,11 +1,19 @@
 #include "pch.h"
 #include "Transform.h"
 
-Transform::Transform() : localToWorld(1.0f) { }
+Transform::Transform() : m_localToWorld(1.0f), m_version(0), m_isStatic(false) { }
 
-Transform::Transform(const glm::mat4& mat) : localToWorld(mat) { }
+Transform::Transform(const glm::mat4& mat) : m_localToWorld(mat), m_version(0), m_isStatic(false) { }
 
-Transform::Transform(glm::mat4&& mat) : localToWorld(std::move(mat)) { }
+Transform::Transform(glm::mat4&& mat) : m_localToWorld(std::move(mat)), m_version(0), m_isStatic(false) { }
 
-bool Transform::operator==(const Transform& other) const { return localToWorld == other.localToWorld; }
+void Transform::setLocalToWorld(const glm::mat4& mat)
+{
+	assert(!m_isStatic && "A static transform was moved, its cached world bounds will be stale.");
+
+	m_localToWorld = mat;
+	m_version++;
+}
+
+bool Transform::operator==(const Transform& other) const { return m_localToWorld == other.m_localToWorld; }
 bool Transform::operator!=(const Transform& other) const { return !(*this == other); }
\ No newline at end of file
@@ -3,18 +3,31 @@
 
 struct Transform
 {
-	glm::mat4 localToWorld;
-
 	Transform();
 	Transform(const glm::mat4& mat);
 	Transform(glm::mat4&& mat);
 
+	const glm::mat4& getLocalToWorld() const { return m_localToWorld; }
+	// Every change bumps the version, so the cached world space data knows when it has to be recomputed.
+	void setLocalToWorld(const glm::mat4& mat);
+	uint32_t getVersion() const { return m_version; }
+
+	// Static transforms are promised not to change, their cached data is never checked again.
+	bool isStatic() const { return m_isStatic; }
+	void setStatic(bool isStatic) { m_isStatic = isStatic; }
+
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version)
 	{
-		ar& localToWorld;
+		ar& m_localToWorld;
 	}
 
 	bool operator==(const Transform& other) const;
 	bool operator!=(const Transform& other) const;
-};
+
+private:
+	glm::mat4 m_localToWorld;
+
+	uint32_t m_version;
+	bool m_isStatic;
+};
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "UniformRing.h"
+#include "DescriptorAllocator.h"
+#include "VkTypes/InitializersUtility.h"
+#include "VkTypes/VkMemoryAllocator.h"
+
+UniformRing::UniformRing(VkDevice device, VkDeviceSize minOffsetAlignment, uint32_t frameByteSize)
+	: m_isInitialized(false), m_device(device), m_alignment(std::max(static_cast<uint32_t>(minOffsetAlignment), 1u)), m_frameByteSize(0),
+	m_buffer(VK_NULL_HANDLE), m_allocation(VK_NULL_HANDLE), m_mapped(nullptr),
+	m_currentFrame(0), m_usedBytes(0), m_overflowReported(false)
+{
+	// The regions start aligned as well, the alignment is a power of two
+	m_frameByteSize = alignUp(std::max(frameByteSize, m_alignment));
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = static_cast<VkDeviceSize>(m_frameByteSize) * MAX_FRAMES_IN_FLIGHT;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// CPU_TO_GPU memory is written once per frame and read once by the GPU, it stays mapped for the whole lifetime.
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo mappedInfo{};
+	const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+	if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &m_buffer, &m_allocation, &mappedInfo) != VK_SUCCESS)
+	{
+		printf("Could not allocate the uniform ring of %u bytes per frame.\n", m_frameByteSize);
+		return;
+	}
+
+	m_mapped = static_cast<char*>(mappedInfo.pMappedData);
+	m_isInitialized = true;
+}
+
+bool UniformRing::isInitialized() const { return m_isInitialized; }
+
+bool UniformRing::createDescriptorSet(VkDescriptorSet& descriptorSet, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t byteSize)
+{
+	if (!allocator.allocate(descriptorSet, layout))
+		return false;
+
+	vkinit::Descriptor::updateDescriptorSet(descriptorSet, m_device, m_buffer, byteSize, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+	return true;
+}
+
+void UniformRing::startFrame(uint32_t frameIndex)
+{
+	m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+	m_usedBytes = 0;
+	m_overflowReported = false;
+}
+
+bool UniformRing::push(UniformHandle& handle, VkDescriptorSet descriptorSet, const void* data, uint32_t byteSize)
+{
+	const auto alignedSize = alignUp(byteSize);
+	if (descriptorSet == VK_NULL_HANDLE || m_usedBytes + alignedSize > m_frameByteSize)
+	{
+		if (!m_overflowReported)
+		{
+			printf("The uniform ring is out of its %u bytes for this frame, or the block has no descriptor set.\n", m_frameByteSize);
+			m_overflowReported = true;
+		}
+		return false;
+	}
+
+	const auto offset = m_currentFrame * m_frameByteSize + m_usedBytes;
+	m_usedBytes += alignedSize;
+	memcpy(m_mapped + offset, data, byteSize);
+
+	// Does nothing on host coherent memory
+	vmaFlushAllocation(VkMemoryAllocator::getInstance()->m_allocator, m_allocation, offset, byteSize);
+
+	handle = { descriptorSet, offset };
+	return true;
+}
+
+void UniformRing::release()
+{
+	if (m_buffer != VK_NULL_HANDLE)
+		vmaDestroyBuffer(VkMemoryAllocator::getInstance()->m_allocator, m_buffer, m_allocation);
+
+	m_buffer = VK_NULL_HANDLE;
+	m_allocation = VK_NULL_HANDLE;
+	m_mapped = nullptr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "pch.h"
+#include "Common.h"
+#include "Interfaces/IRequireInitialization.h"
+
+class DescriptorAllocator;
+
+// A uniform block written for the current frame, bound with its set and the dynamic offset into the ring.
+struct UniformHandle
+{
+	VkDescriptorSet descriptorSet;
+	uint32_t dynamicOffset;
+};
+
+// A single persistently mapped uniform buffer with a region for each frame in flight. The uniform blocks of a frame are bump
+// allocated from its region at the device's offset alignment and bound through dynamic offsets, so every view and pass shares
+// one buffer and one descriptor set per layout, and adding more of them allocates nothing.
+class UniformRing : IRequireInitialization
+{
+public:
+	constexpr static uint32_t c_defaultFrameByteSize = 64u * 1024u;
+
+	UniformRing(VkDevice device, VkDeviceSize minOffsetAlignment, uint32_t frameByteSize = c_defaultFrameByteSize);
+	bool isInitialized() const override;
+
+	// The set covers byteSize bytes of the ring at whatever dynamic offset it is bound with, its layout needs a single UNIFORM_BUFFER_DYNAMIC binding.
+	bool createDescriptorSet(VkDescriptorSet& descriptorSet, DescriptorAllocator& allocator, VkDescriptorSetLayout layout, uint32_t byteSize);
+
+	// The previous submission using this frame's region has completed, it is written from the start again.
+	void startFrame(uint32_t frameIndex);
+	// Copies the block into the current frame's region. Fails once the region is full, which is reported once per frame.
+	bool push(UniformHandle& handle, VkDescriptorSet descriptorSet, const void* data, uint32_t byteSize);
+
+	template<typename T>
+	bool push(UniformHandle& handle, VkDescriptorSet descriptorSet, const T& data) { return push(handle, descriptorSet, &data, as_uint32(sizeof(T))); }
+
+	uint32_t getUsedBytes() const { return m_usedBytes; }
+	uint32_t getFrameByteSize() const { return m_frameByteSize; }
+
+	void release();
+
+private:
+	bool m_isInitialized;
+	VkDevice m_device;
+	uint32_t m_alignment;
+	uint32_t m_frameByteSize;
+
+	VkBuffer m_buffer;
+	VmaAllocation m_allocation;
+	char* m_mapped;
+
+	uint32_t m_currentFrame;
+	uint32_t m_usedBytes;
+	bool m_overflowReported;
+
+	uint32_t alignUp(uint32_t byteSize) const { return (byteSize + m_alignment - 1u) & ~(m_alignment - 1u); }
+};
@@ -13,7 +13,7 @@ VertexAttributes::VertexAttributes(std::vector<VkBuffer>& vertexBuffers, std::ve
 	}
 }
 
-void VertexAttributes::bind(VkCommandBuffer commandBuffer)
+void VertexAttributes::bind(VkCommandBuffer commandBuffer) const
 {
 	vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers.data(), offsets.data());
 }
@@ -7,7 +7,8 @@ public:
 	VertexAttributes() = delete;
 	VertexAttributes(std::vector<VkBuffer>& vertexBuffers, std::vector<VmaAllocation> vertexMemoryRanges, std::vector<VkDeviceSize>& vertexOffsets, uint32_t bindingOffset = 0, uint32_t bindingCount = 0);
 
-	void bind(VkCommandBuffer commandBuffer);
+	VkBuffer getBuffer(size_t index) const { return buffers[index]; }
+	void bind(VkCommandBuffer commandBuffer) const;
 
 	void destroy(VmaAllocator allocator);
 
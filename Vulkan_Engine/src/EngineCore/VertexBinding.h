@@ -18,18 +18,48 @@ struct MeshDescriptor
 		Colors = 0
 	};
 
+	// The layout of the vertices in the GPU buffers, the meshes always keep the attributes above on the CPU.
+	// Compact stores the positions as 16 bit unorm relative to the mesh bounds, the normals octahedral encoded in 2x16 bit snorm,
+	// the uvs as half floats and the colors as 8 bit unorm, 16 bytes per vertex instead of 32 (see VertexQuantization).
+	enum class EVertexFormat : uint32_t
+	{
+		Float32,
+		Compact
+	};
+
 	static constexpr size_t descriptorCount = 4;
 
-	MeshDescriptor() : lengths(), elementByteSizes()
+	MeshDescriptor(EVertexFormat vertexFormat = EVertexFormat::Float32) : lengths(), elementByteSizes(), formats(), format(vertexFormat)
 	{
 		lengths[0] = EAttributePresent::Positions; lengths[1] = EAttributePresent::UVs; lengths[2] = EAttributePresent::Normals; lengths[3] = EAttributePresent::Colors;
 
-		elementByteSizes[0] = sizeof(TVertexPosition); elementByteSizes[1] = sizeof(TVertexUV);
-		elementByteSizes[2] = sizeof(TVertexNormal); elementByteSizes[3] = sizeof(TVertexColor);
+		if (format == EVertexFormat::Compact)
+		{
+			elementByteSizes[0] = sizeof(uint64_t); elementByteSizes[1] = sizeof(uint32_t);
+			elementByteSizes[2] = sizeof(uint32_t); elementByteSizes[3] = sizeof(uint32_t);
+
+			formats[0] = VK_FORMAT_R16G16B16A16_UNORM; formats[1] = VK_FORMAT_R16G16_SFLOAT;
+			formats[2] = VK_FORMAT_R16G16_SNORM; formats[3] = VK_FORMAT_R8G8B8A8_UNORM;
+		}
+		else
+		{
+			elementByteSizes[0] = sizeof(TVertexPosition); elementByteSizes[1] = sizeof(TVertexUV);
+			elementByteSizes[2] = sizeof(TVertexNormal); elementByteSizes[3] = sizeof(TVertexColor);
+
+			formats[0] = VK_FORMAT_R32G32B32_SFLOAT; formats[1] = VK_FORMAT_R32G32_SFLOAT;
+			formats[2] = VK_FORMAT_R32G32B32_SFLOAT; formats[3] = VK_FORMAT_R32G32B32_SFLOAT;
+		}
 	}
 
 	size_t lengths[descriptorCount];
 	size_t elementByteSizes[descriptorCount];
+	VkFormat formats[descriptorCount];
+	EVertexFormat format;
+
+	size_t getVertexStride() const;
+	// The indices stay 32 bit on the CPU, meshes whose vertices all fit in 16 bits are narrowed on upload and in the scene cache.
+	static VkIndexType getIndexType(size_t vertexCount);
+	static size_t getIndexByteSize(VkIndexType indexType);
 
 	bool operator ==(const MeshDescriptor& other) const;
 	bool operator !=(const MeshDescriptor& other) const;
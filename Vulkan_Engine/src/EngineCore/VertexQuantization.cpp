@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "VertexQuantization.h"
+
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+	glm::vec2 signNotZero(const glm::vec2& v) { return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f); }
+}
+
+VertexQuantization::PositionRange VertexQuantization::PositionRange::fromPositions(const std::vector<glm::vec3>& positions)
+{
+	if (positions.empty())
+		return PositionRange();
+
+	glm::vec3 min = positions.front(), max = positions.front();
+	for (const auto& position : positions)
+	{
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+
+	const auto size = max - min;
+	const auto minScale = std::max(std::max(size.x, std::max(size.y, size.z)) * 1e-4f, 1e-6f);
+	return PositionRange(min, glm::max(size, glm::vec3(minScale)));
+}
+
+glm::mat4 VertexQuantization::PositionRange::getDequantizationMatrix() const
+{
+	return glm::scale(glm::translate(glm::mat4(1.0f), offset), scale);
+}
+
+BoundsAABB VertexQuantization::PositionRange::toQuantizedSpace(const BoundsAABB& bounds) const
+{
+	const auto center = (bounds.center - offset) / scale;
+	const auto extents = bounds.extents / scale;
+	return BoundsAABB(center, extents.x, extents.y, extents.z);
+}
+
+glm::vec3 VertexQuantization::PositionRange::toQuantizedNormal(const glm::vec3& normal) const
+{
+	const auto quantized = normal * scale;
+	const auto length = glm::length(quantized);
+	return length > 0.0f ? quantized / length : normal;
+}
+
+uint64_t VertexQuantization::encodePosition(const glm::vec3& position, const PositionRange& range)
+{
+	return glm::packUnorm4x16(glm::vec4((position - range.offset) / range.scale, 0.0f));
+}
+
+glm::vec3 VertexQuantization::decodePosition(uint64_t packed, const PositionRange& range)
+{
+	return range.offset + glm::vec3(glm::unpackUnorm4x16(packed)) * range.scale;
+}
+
+uint32_t VertexQuantization::encodeNormal(const glm::vec3& normal)
+{
+	const auto sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (sum <= 0.0f)
+		return glm::packSnorm2x16(glm::vec2(0.0f));
+
+	// Onto the octahedron, the lower half is folded over the diagonals onto the outer triangles of the square
+	auto p = glm::vec2(normal.x, normal.y) / sum;
+	if (normal.z < 0.0f)
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+
+	return glm::packSnorm2x16(p);
+}
+
+glm::vec3 VertexQuantization::decodeNormal(uint32_t packed)
+{
+	// Same as octDecode of simple.vert
+	const auto p = glm::unpackSnorm2x16(packed);
+	auto n = glm::vec3(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+	if (n.z < 0.0f)
+	{
+		const auto folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+		n.x = folded.x;
+		n.y = folded.y;
+	}
+
+	const auto length = glm::length(n);
+	return length > 0.0f ? n / length : n;
+}
+
+uint32_t VertexQuantization::encodeUV(const glm::vec2& uv) { return glm::packHalf2x16(uv); }
+glm::vec2 VertexQuantization::decodeUV(uint32_t packed) { return glm::unpackHalf2x16(packed); }
+
+uint32_t VertexQuantization::encodeColor(const glm::vec3& color) { return glm::packUnorm4x8(glm::vec4(color, 1.0f)); }
@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include "Math/BoundsAABB.h"
+
+// Encoding of the compact vertex format (MeshDescriptor::EVertexFormat::Compact), the shaders decode it for free in the vertex fetch.
+namespace VertexQuantization
+{
+	// Maps the positions of a mesh onto [0, 1] of its bounds. The inverse is folded into the transform of every draw,
+	// so the vertex shaders keep reading a plain position and normal.
+	struct PositionRange
+	{
+		glm::vec3 offset;
+		glm::vec3 scale;
+
+		PositionRange() : offset(0.0f), scale(1.0f) { }
+		PositionRange(const glm::vec3& offset, const glm::vec3& scale) : offset(offset), scale(scale) { }
+
+		// Flat meshes keep a small scale on their flat axes, so the transform of the draw stays invertible.
+		static PositionRange fromPositions(const std::vector<glm::vec3>& positions);
+
+		// Quantized to local space, the model matrix of a draw is multiplied by it.
+		glm::mat4 getDequantizationMatrix() const;
+		BoundsAABB toQuantizedSpace(const BoundsAABB& bounds) const;
+		// Normals go through the inverse transpose of the dequantization, the shaders renormalize them.
+		glm::vec3 toQuantizedNormal(const glm::vec3& normal) const;
+	};
+
+	// 16 bit unorm per component relative to the range, the 4th component only pads the attribute to 8 bytes.
+	uint64_t encodePosition(const glm::vec3& position, const PositionRange& range);
+	glm::vec3 decodePosition(uint64_t packed, const PositionRange& range);
+
+	// Octahedral projection in 2x16 bit snorm.
+	uint32_t encodeNormal(const glm::vec3& normal);
+	glm::vec3 decodeNormal(uint32_t packed);
+
+	uint32_t encodeUV(const glm::vec2& uv);
+	glm::vec2 decodeUV(uint32_t packed);
+
+	uint32_t encodeColor(const glm::vec3& color);
+}
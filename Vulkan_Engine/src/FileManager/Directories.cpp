@@ -15,6 +15,8 @@ Path Directories::getWorkingDirectory() { return getAbsolutePath(workingSceneDir
 
 Path Directories::getShaderLibraryPath() { return getAbsolutePath(libraryShaderPath_relative); }
 
+Path Directories::getPipelineCachePath() { return getAbsolutePath(libraryPipelineCache_relative); }
+
 std::vector<Loader::ModelLoaderOptions> Directories::getModels_IntelSponza()
 {
 	return 
@@ -38,17 +40,19 @@ std::vector<Loader::ModelLoaderOptions> Directories::getModels_CrytekSponza()
 	};
 }
 
-bool Directories::isBinary(const Path& scenePath) { return scenePath.matchesExtension(sceneFileExtension); }
+bool Directories::isBinary(const Path& scenePath) { return scenePath.matchesExtension(sceneFileExtension) || isMappedSceneCache(scenePath); }
+
+bool Directories::isMappedSceneCache(const Path& scenePath) { return scenePath.matchesExtension(mappedSceneFileExtension); }
 
-Path Directories::getBinaryTargetPath(const Path& modelPath)
+Path Directories::getBinaryTargetPath(const Path& modelPath, bool mappedSceneCache)
 {
-	auto fileName = modelPath.getFileName(false) + sceneFileExtension;
+	auto fileName = modelPath.getFileName(false) + (mappedSceneCache ? mappedSceneFileExtension : sceneFileExtension);
 	return getAbsolutePath(workingSceneDir_relative).combine(fileName);
 }
 
-bool Directories::tryGetBinaryIfExists(Path& binaryPath, const Path& modelPath)
+bool Directories::tryGetBinaryIfExists(Path& binaryPath, const Path& modelPath, bool mappedSceneCache)
 {
-	binaryPath = getBinaryTargetPath(modelPath);
+	binaryPath = getBinaryTargetPath(modelPath, mappedSceneCache);
 	return binaryPath.fileExists();
 }
 
@@ -22,17 +22,21 @@ public:
 	static std::vector<Loader::ModelLoaderOptions> getModels_CrytekSponza();
 
 	static Path getShaderLibraryPath();
+	static Path getPipelineCachePath();
 
 	static bool isBinary(const Path& scenePath);
-	static Path getBinaryTargetPath(const Path& modelPath);
-	static bool tryGetBinaryIfExists(Path& binaryPath, const Path& modelPath);
+	static bool isMappedSceneCache(const Path& scenePath);
+	static Path getBinaryTargetPath(const Path& modelPath, bool mappedSceneCache = false);
+	static bool tryGetBinaryIfExists(Path& binaryPath, const Path& modelPath, bool mappedSceneCache = false);
 
 	static Path syscall_GetApplicationPath();
 
 private:
 	inline static std::string sceneFileExtension = ".binary";
+	inline static std::string mappedSceneFileExtension = ".vkscene";
 	inline static std::string library_relative = "Resources/Library/";
 	inline static std::string libraryShaderPath_relative = "Resources/Library/outputSPV/";
+	inline static std::string libraryPipelineCache_relative = "Resources/Library/pipeline.cache";
 
 	inline static std::string CUBE_GLTF = "Resources/Other/gltf/Cube_khr.gltf";
 
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "MappedFile.h"
+#include "Path.h"
+
+MappedFile::MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_view(nullptr), m_size(0) { }
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const Path& path)
+{
+	close();
+
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		printf("Could not open the file '%s' for mapping.\n", path.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		printf("The file '%s' is empty and can not be mapped.\n", path.c_str());
+		close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		printf("Could not create the file mapping for '%s'.\n", path.c_str());
+		close();
+		return false;
+	}
+
+	m_view = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_view == nullptr)
+	{
+		printf("Could not map the view of '%s'.\n", path.c_str());
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_view != nullptr)
+	{
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+	}
+
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+	m_size = 0;
+}
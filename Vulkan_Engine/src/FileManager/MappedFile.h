@@ -0,0 +1,28 @@
+#pragma once
+#include "pch.h"
+
+struct Path;
+
+// Read-only view of a whole file mapped into the address space.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const Path& path);
+	void close();
+
+	bool isOpen() const { return m_view != nullptr; }
+	const char* data() const { return static_cast<const char*>(m_view); }
+	size_t size() const { return m_size; }
+
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const void* m_view;
+	size_t m_size;
+};
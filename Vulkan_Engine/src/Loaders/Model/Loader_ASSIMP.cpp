@@ -13,6 +13,7 @@
 
 #include "Profiling/ProfileMarker.h"
 #include "FileManager/FileIO.h"
+#include "Engine/JobSystem.h"
 
 #include <assimp/Importer.hpp>      // C++ importer interface
 #include <assimp/scene.h>           // Output data structure
@@ -114,25 +115,38 @@ bool Loader::load_AssimpImplementation(std::vector<Mesh>& meshes, std::vector<Ma
 	std::unordered_map<int, std::vector<size_t>> textureToMeshMap;
 
 	ProfileMarker _("	Loader::CreateMesh");
-	std::vector<MeshDescriptor::TVertexIndices> indices;
-	std::vector<MeshDescriptor::TVertexPosition> vertices;
-	std::vector<MeshDescriptor::TVertexNormal> normals;
-	std::vector<MeshDescriptor::TVertexUV> uvs;
-	std::vector<MeshDescriptor::TVertexColor> colors;
-	for (unsigned int mi = 0; mi < scene->mNumMeshes; mi++)
+	auto meshCount = static_cast<size_t>(scene->mNumMeshes);
+#ifdef IMPORT_LIMITER_ENABLED
+	if (import_mesh_limitter > 0)
+	{
+		const auto limit = static_cast<size_t>(import_mesh_limitter);
+		meshCount = existingElementsCount > limit ? 0 : std::min(meshCount, limit - existingElementsCount + 1);
+	}
+#endif
+
+	// Everything an aiMesh contributes to the scene, produced independently on a worker.
+	struct MeshImport
+	{
+		std::vector<MeshDescriptor::TVertexIndices> indices;
+		std::vector<MeshDescriptor::TVertexPosition> vertices;
+		std::vector<MeshDescriptor::TVertexNormal> normals;
+		std::vector<MeshDescriptor::TVertexUV> uvs;
+		BoundsAABB bounds;
+	};
+	std::vector<MeshImport> meshImports(meshCount);
+
+	JobSystem::parallelFor(meshCount, [&](size_t mi)
 	{
 		const auto* mesh = scene->mMeshes[mi];
 		auto vertN = mesh->mNumVertices;
 
-#ifdef IMPORT_LIMITER_ENABLED
-		if (import_mesh_limitter > 0 && meshes.size() > import_mesh_limitter)
-			break;
-#endif
-
+		auto& result = meshImports[mi];
+		auto& vertices = result.vertices;
+		auto& normals = result.normals;
+		auto& uvs = result.uvs;
 		vertices.resize(vertN);
 		normals.resize(vertN);
 		uvs.resize(vertN);
-		//colors.resize(vertN);
 
 		const auto* mVerts = mesh->mVertices;
 		const auto* mTexcoords = mesh->mTextureCoords[0];
@@ -175,6 +189,7 @@ bool Loader::load_AssimpImplementation(std::vector<Mesh>& meshes, std::vector<Ma
 		}
 #endif
 
+		result.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
 		for (unsigned int fi = 0; fi < mesh->mNumFaces; fi++)
 		{
 			auto& face = mesh->mFaces[fi];
@@ -184,27 +199,34 @@ bool Loader::load_AssimpImplementation(std::vector<Mesh>& meshes, std::vector<Ma
 			{
 				Utility::assertIndex(face.mIndices[ii], vertN, mesh->mName.C_Str());
 
-				indices.push_back(static_cast<MeshDescriptor::TVertexIndices>(face.mIndices[ii]));
+				result.indices.push_back(static_cast<MeshDescriptor::TVertexIndices>(face.mIndices[ii]));
 			}
 		}
-		auto matIndex = mesh->mMaterialIndex;
-
-		std::vector<SubMesh> submeshes(1);
-		submeshes[0] = SubMesh(indices);
 
 		auto boundsMin = mesh->mAABB.mMin * modelScaler,
 			boundsMax = mesh->mAABB.mMax * modelScaler;
-		submeshes[0].m_bounds = BoundsAABB(
+		result.bounds = BoundsAABB(
 			glm::vec3(boundsMin.x, boundsMin.y, boundsMin.z),
 			glm::vec3(boundsMax.x, boundsMax.y, boundsMax.z)
 		);
+	}, options.importThreadCount);
+
+	// Merge in mesh order, so the output does not depend on the number of workers.
+	std::vector<MeshDescriptor::TVertexColor> colors;
+	for (size_t mi = 0; mi < meshCount; mi++)
+	{
+		auto& result = meshImports[mi];
+
+		std::vector<SubMesh> submeshes(1);
+		submeshes[0] = SubMesh(result.indices);
+		submeshes[0].m_bounds = result.bounds;
 
-		meshes.push_back(Mesh(vertices, uvs, normals, colors, submeshes));
+		meshes.push_back(Mesh(result.vertices, result.uvs, result.normals, colors, submeshes));
 
 		// By default set the material ID to 0, when its loaded and processed successfuly will be replaced by actual ID.
 		auto meshFinalIndex = meshes.size() - 1;
-		rendererIDs.emplace_back(meshFinalIndex, meshToTransform[mi]);
-		textureToMeshMap[matIndex].push_back(meshFinalIndex);
+		rendererIDs.emplace_back(meshFinalIndex, meshToTransform[static_cast<int>(mi)]);
+		textureToMeshMap[scene->mMeshes[mi]->mMaterialIndex].push_back(meshFinalIndex);
 	}
 
 	auto dir = fullPath.getFileDirectory();
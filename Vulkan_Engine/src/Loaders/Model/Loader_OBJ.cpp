@@ -12,6 +12,7 @@
 #include "VkTypes/VkShader.h"
 
 #include "Profiling/ProfileMarker.h"
+#include "Engine/JobSystem.h"
 
 bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Material>& materials, std::vector<Renderer>& rendererIDs, std::vector<Transform>& transforms, 
 	const Loader::ModelLoaderOptions& options)
@@ -56,7 +57,6 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 	}
 
 	ProfileMarker _("	Scene::loadObjImplementation - Create meshes");
-	typedef int MeshID;
 
 	struct SubMeshDesc
 	{
@@ -64,19 +64,22 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 		size_t mappedIndex;
 	};
 
-	std::unordered_map<MeshID, std::vector<MaterialID>> meshToMaterialMapping;
-	std::unordered_map<MaterialID, SubMeshDesc> uniqueMaterialIDs;
-	std::unordered_map<size_t, MeshDescriptor::TVertexIndices> indexMapping;
+	// Everything a shape contributes to the scene, produced independently on a worker.
+	struct ShapeImport
+	{
+		std::vector<MeshDescriptor::TVertexPosition> vertices;
+		std::vector<MeshDescriptor::TVertexNormal> normals;
+		std::vector<MeshDescriptor::TVertexUV> uvs;
+		std::vector<SubMesh> submeshes;
+		std::vector<MaterialID> materialIDs;
+		bool isValid = false;
+	};
+	std::vector<ShapeImport> shapeImports(objShapes.size());
 
-	std::vector<SubMesh> submeshes;
-	std::vector<size_t> materialIDs;
 	// MESHES
-	meshes.reserve(meshes.size() + objShapes.size());
-	rendererIDs.reserve(meshes.size() + objShapes.size());
-	for (MeshID i = 0; i < objShapes.size(); i++)
+	JobSystem::parallelFor(objShapes.size(), [&](size_t i)
 	{
-		indexMapping.clear();
-
+		auto& result = shapeImports[i];
 		auto& name = objShapes[i].name;
 		auto& mesh = objShapes[i].mesh;
 		auto& shapeIndices = mesh.indices;
@@ -86,40 +89,36 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 		if (mesh.material_ids.size() * 3 < shapeIndices.size())
 		{
 			printf("The material ID array size (3 * %zi) does not match the shapeIndices array size (%zi).\n", mesh.material_ids.size(), shapeIndices.size());
-			return false;
+			return;
 		}
 
-		uniqueMaterialIDs.clear();
-		size_t materialCount = 0;
+		// Submeshes are ordered by the first appearance of their material, independent of hashing.
+		std::unordered_map<MaterialID, SubMeshDesc> uniqueMaterialIDs;
+		auto& materialIDs = result.materialIDs;
 		for (auto& id : mesh.material_ids)
 		{
-			if (uniqueMaterialIDs.count(id) > 0)
+			MaterialID materialID = id;
+			if (uniqueMaterialIDs.count(materialID) > 0)
 			{
-				uniqueMaterialIDs[id].indexCount += 1;
+				uniqueMaterialIDs[materialID].indexCount += 1;
 				continue;
 			}
 
 			SubMeshDesc desc;
 			desc.indexCount = 1;
-			desc.mappedIndex = materialCount;
+			desc.mappedIndex = materialIDs.size();
 
-			uniqueMaterialIDs[id] = desc;
-			materialCount += 1;
+			uniqueMaterialIDs[materialID] = desc;
+			materialIDs.push_back(materialID);
 		}
-		submeshes.clear();
-		submeshes.reserve(materialCount);
-		materialIDs.clear();
-		materialIDs.reserve(materialCount);
+		const auto materialCount = materialIDs.size();
 
-		for (auto& kvPair : uniqueMaterialIDs)
+		auto& submeshes = result.submeshes;
+		submeshes.reserve(materialCount);
+		for (auto materialID : materialIDs)
 		{
-			auto materialID = kvPair.first;
-			auto submeshDesc = kvPair.second;
-
-			materialIDs.push_back(materialID);
-			submeshes.emplace_back(submeshDesc.indexCount * 3);
+			submeshes.emplace_back(uniqueMaterialIDs[materialID].indexCount * 3);
 		}
-		meshToMaterialMapping[i] = materialIDs;
 
 		// Axis-Aligned Bounding Box
 		std::vector<glm::vec3> boundsMinMax(materialCount * 2);
@@ -168,9 +167,9 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 			submeshes[k].m_bounds = BoundsAABB(boundsMinMax[k * 2], boundsMinMax[k * 2 + 1]);
 		}
 
-		std::vector<MeshDescriptor::TVertexPosition> vertices(mappedIndex);
-		std::vector<MeshDescriptor::TVertexNormal> normals(mappedIndex);
-		std::vector<MeshDescriptor::TVertexUV> uvs(mappedIndex);
+		result.vertices.resize(mappedIndex);
+		result.normals.resize(mappedIndex);
+		result.uvs.resize(mappedIndex);
 
 		if (objAttribs.normals.size() > objAttribs.vertices.size() ||
 			objAttribs.texcoords.size() > objAttribs.vertices.size())
@@ -186,14 +185,26 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 			auto ni = kv.first.normal_index;
 			auto uvi = kv.first.texcoord_index;
 
-			vertices[kv.second] = Utility::reinterpretAt<float, MeshDescriptor::TVertexPosition>(objAttribs.vertices, vi) * modelScaler;
+			result.vertices[kv.second] = Utility::reinterpretAt<float, MeshDescriptor::TVertexPosition>(objAttribs.vertices, vi) * modelScaler;
 
-			normals[kv.second] = Utility::reinterpretAt_orFallback<float, MeshDescriptor::TVertexNormal>(objAttribs.normals, ni);
-			uvs[kv.second] = Utility::reinterpretAt_orFallback<float, MeshDescriptor::TVertexUV>(objAttribs.texcoords, uvi);
+			result.normals[kv.second] = Utility::reinterpretAt_orFallback<float, MeshDescriptor::TVertexNormal>(objAttribs.normals, ni);
+			result.uvs[kv.second] = Utility::reinterpretAt_orFallback<float, MeshDescriptor::TVertexUV>(objAttribs.texcoords, uvi);
 		}
 
+		result.isValid = true;
+	}, options.importThreadCount);
+
+	// Merge in shape order, so the output does not depend on the number of workers.
+	const auto firstMeshID = meshes.size();
+	meshes.reserve(meshes.size() + objShapes.size());
+	rendererIDs.reserve(rendererIDs.size() + objShapes.size());
+	for (auto& shape : shapeImports)
+	{
+		if (!shape.isValid)
+			return false;
+
 		std::vector<MeshDescriptor::TVertexColor> colors;
-		meshes.push_back(Mesh(vertices, uvs, normals, colors, submeshes));
+		meshes.push_back(Mesh(shape.vertices, shape.uvs, shape.normals, colors, shape.submeshes));
 	}
 
 	// MATERIALS
@@ -201,9 +212,9 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 	std::unordered_map<MaterialID, GlobalBufferMaterialID> uniqueMaterials;
 	std::vector<size_t> globalBufMaterialIDs;
 	materials.reserve(materials.size() + objMats.size());
-	for (const auto& kv : meshToMaterialMapping)
+	for (size_t i = 0; i < shapeImports.size(); i++)
 	{
-		const auto& meshMaterials = kv.second;
+		const auto& meshMaterials = shapeImports[i].materialIDs;
 		globalBufMaterialIDs.clear();
 		globalBufMaterialIDs.reserve(meshMaterials.size());
 		for (const auto& materialID : meshMaterials)
@@ -234,7 +245,7 @@ bool Loader::loadOBJ_Implementation(std::vector<Mesh>& meshes, std::vector<Mater
 			}
 		}
 
-		rendererIDs.emplace_back(kv.first, 0, globalBufMaterialIDs);
+		rendererIDs.emplace_back(firstMeshID + i, 0, globalBufMaterialIDs);
 	}
 
 	if (transforms.size() == 0)
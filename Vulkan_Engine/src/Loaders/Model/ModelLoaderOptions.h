@@ -7,8 +7,19 @@ namespace Loader
 	{
 		Path filePath;
 		float sizeModifier;
+		// 0 imports on every hardware thread, 1 keeps the import single threaded.
+		uint32_t importThreadCount;
 
-		ModelLoaderOptions(Path&& path, float scale) : filePath(std::move(path)), sizeModifier(scale) { }
-		ModelLoaderOptions(std::string&& path, float scale) : filePath(std::move(path)), sizeModifier(scale) { }
+		// Levels per submesh including the full one, 1 skips the simplification.
+		uint32_t lodCount = 4;
+		// Share of the indices of the previous level each LOD aims for.
+		float lodReduction = 0.5f;
+		// Largest distance a LOD may move the surface, relative to the diagonal of the submesh bounds.
+		float lodMaxError = 0.02f;
+		// Reorders the indices and vertices of the imported meshes for the vertex cache, overdraw and vertex fetch.
+		bool optimizeMeshes = true;
+
+		ModelLoaderOptions(Path&& path, float scale, uint32_t threadCount = 0) : filePath(std::move(path)), sizeModifier(scale), importThreadCount(threadCount) { }
+		ModelLoaderOptions(std::string&& path, float scale, uint32_t threadCount = 0) : filePath(std::move(path)), sizeModifier(scale), importThreadCount(threadCount) { }
 	};
 }
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "FrustumCulling.h"
+#include "Engine/Bitmask.h"
+
+namespace
+{
+	float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+	{
+		const auto size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	struct Bin
+	{
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+		uint32_t count = 0;
+
+		void grow(const glm::vec3& itemMin, const glm::vec3& itemMax)
+		{
+			min = glm::min(min, itemMin);
+			max = glm::max(max, itemMax);
+		}
+	};
+}
+
+void BVH::build(const BoundsSoA& bounds)
+{
+	clear();
+
+	std::vector<BuildItem> buildItems(bounds.size());
+	m_items.reserve(bounds.size());
+	for (uint32_t i = 0; i < bounds.size(); i++)
+	{
+		const auto center = glm::vec3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		const auto extents = glm::vec3(bounds.extentsX[i], bounds.extentsY[i], bounds.extentsZ[i]);
+		if (glm::any(glm::isnan(center)))
+			continue;
+
+		buildItems[i] = { center - extents, center + extents, center };
+		m_items.push_back(i);
+	}
+
+	m_boundsCount = bounds.size();
+	if (m_items.empty())
+		return;
+
+	// A binary tree never has more than 2n - 1 nodes
+	m_nodes.reserve(m_items.size() * 2);
+	m_nodes.push_back({ glm::vec3(), 0u, glm::vec3(), static_cast<uint32_t>(m_items.size()) });
+	subdivide(0u, buildItems, 1u);
+
+	m_itemBounds.resize(m_items.size());
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		const auto item = m_items[i];
+		m_itemBounds[i] = { glm::vec3(bounds.centerX[item], bounds.centerY[item], bounds.centerZ[item]),
+			glm::vec3(bounds.extentsX[item], bounds.extentsY[item], bounds.extentsZ[item]) };
+	}
+}
+
+void BVH::updateNodeBounds(Node& node, const std::vector<BuildItem>& buildItems) const
+{
+	node.min = glm::vec3(std::numeric_limits<float>::max());
+	node.max = glm::vec3(-std::numeric_limits<float>::max());
+	for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+	{
+		const auto& item = buildItems[m_items[i]];
+		node.min = glm::min(node.min, item.min);
+		node.max = glm::max(node.max, item.max);
+	}
+}
+
+void BVH::subdivide(uint32_t nodeIndex, const std::vector<BuildItem>& buildItems, uint32_t depth)
+{
+	m_depth = std::max(m_depth, depth);
+	updateNodeBounds(m_nodes[nodeIndex], buildItems);
+
+	const auto first = m_nodes[nodeIndex].leftOrFirst;
+	const auto count = m_nodes[nodeIndex].count;
+	if (count <= c_maxLeafSize || depth >= c_maxDepth)
+		return;
+
+	auto centroidMin = glm::vec3(std::numeric_limits<float>::max());
+	auto centroidMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		centroidMin = glm::min(centroidMin, buildItems[m_items[i]].centroid);
+		centroidMax = glm::max(centroidMax, buildItems[m_items[i]].centroid);
+	}
+
+	// Binned SAH, the split with the lowest (area * count) sum of both halves wins
+	auto bestCost = std::numeric_limits<float>::max();
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const auto axisExtent = centroidMax[axis] - centroidMin[axis];
+		if (axisExtent <= 0.0f)
+			continue;
+
+		std::array<Bin, c_binCount> bins{};
+		const auto scale = c_binCount / axisExtent;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			const auto& item = buildItems[m_items[i]];
+			const auto binIndex = std::min(c_binCount - 1, static_cast<uint32_t>((item.centroid[axis] - centroidMin[axis]) * scale));
+			bins[binIndex].count++;
+			bins[binIndex].grow(item.min, item.max);
+		}
+
+		// Sweep from both sides, so every split plane is evaluated in one pass
+		std::array<float, c_binCount - 1> leftArea{}, rightArea{};
+		std::array<uint32_t, c_binCount - 1> leftCount{}, rightCount{};
+		Bin left, right;
+		uint32_t leftSum = 0, rightSum = 0;
+		for (uint32_t i = 0; i < c_binCount - 1; i++)
+		{
+			leftSum += bins[i].count;
+			leftCount[i] = leftSum;
+			if (bins[i].count != 0) left.grow(bins[i].min, bins[i].max);
+			leftArea[i] = leftSum != 0 ? surfaceArea(left.min, left.max) : 0.0f;
+
+			const auto r = c_binCount - 1 - i;
+			rightSum += bins[r].count;
+			rightCount[r - 1] = rightSum;
+			if (bins[r].count != 0) right.grow(bins[r].min, bins[r].max);
+			rightArea[r - 1] = rightSum != 0 ? surfaceArea(right.min, right.max) : 0.0f;
+		}
+
+		for (uint32_t i = 0; i < c_binCount - 1; i++)
+		{
+			const auto cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (leftCount[i] != 0 && rightCount[i] != 0 && cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	const auto& node = m_nodes[nodeIndex];
+	const auto leafCost = static_cast<float>(count) * surfaceArea(node.min, node.max);
+	// Every centroid sits on the same point, the items can't be told apart
+	if (bestAxis < 0)
+		return;
+
+	// Splitting doesn't pay off, unless the leaf would be too big to test cheaply
+	if (bestCost >= leafCost && count <= c_maxLeafSize * 4)
+		return;
+
+	const auto scale = c_binCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	const auto middle = std::partition(m_items.begin() + first, m_items.begin() + first + count, [&](uint32_t item)
+		{
+			const auto binIndex = std::min(c_binCount - 1, static_cast<uint32_t>((buildItems[item].centroid[bestAxis] - centroidMin[bestAxis]) * scale));
+			return binIndex <= bestSplit;
+		}
+	);
+	const auto leftItemCount = static_cast<uint32_t>(std::distance(m_items.begin() + first, middle));
+
+	const auto leftIndex = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back({ glm::vec3(), first, glm::vec3(), leftItemCount });
+	m_nodes.push_back({ glm::vec3(), first + leftItemCount, glm::vec3(), count - leftItemCount });
+
+	m_nodes[nodeIndex].leftOrFirst = leftIndex;
+	m_nodes[nodeIndex].count = 0;
+
+	subdivide(leftIndex, buildItems, depth + 1);
+	subdivide(leftIndex + 1, buildItems, depth + 1);
+}
+
+void BVH::refit(const BoundsSoA& bounds)
+{
+	// Children always come after their parent, so walking backwards visits them first
+	for (auto nodeIndex = m_nodes.size(); nodeIndex-- > 0;)
+	{
+		auto& node = m_nodes[nodeIndex];
+		if (node.isLeaf())
+		{
+			node.min = glm::vec3(std::numeric_limits<float>::max());
+			node.max = glm::vec3(-std::numeric_limits<float>::max());
+			for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+			{
+				const auto item = m_items[i];
+				auto& itemBounds = m_itemBounds[i];
+				itemBounds.center = glm::vec3(bounds.centerX[item], bounds.centerY[item], bounds.centerZ[item]);
+				itemBounds.extents = glm::vec3(bounds.extentsX[item], bounds.extentsY[item], bounds.extentsZ[item]);
+
+				node.min = glm::min(node.min, itemBounds.center - itemBounds.extents);
+				node.max = glm::max(node.max, itemBounds.center + itemBounds.extents);
+			}
+			continue;
+		}
+
+		const auto& left = m_nodes[node.leftOrFirst];
+		const auto& right = m_nodes[node.leftOrFirst + 1];
+		node.min = glm::min(left.min, right.min);
+		node.max = glm::max(left.max, right.max);
+	}
+}
+
+void BVH::clear()
+{
+	m_nodes.clear();
+	m_items.clear();
+	m_itemBounds.clear();
+	m_boundsCount = 0;
+	m_depth = 0;
+}
+
+uint32_t BVH::query(const Frustum& frustum, uint64_t* visibility) const
+{
+	std::fill(visibility, visibility + (m_boundsCount + 63) / 64, 0u);
+	if (m_nodes.empty())
+		return 0;
+
+	constexpr uint32_t c_allPlanes = (1u << Frustum::EPlanes::Count) - 1u;
+	const auto planes = FrustumCulling::PreparedPlanes(frustum);
+
+	// Each entry carries the planes its subtree still straddles
+	struct StackEntry { uint32_t node, planeMask; };
+	std::array<StackEntry, c_maxDepth + 2> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0u, c_allPlanes };
+
+	uint32_t visibleCount = 0;
+	while (stackSize != 0)
+	{
+		const auto entry = stack[--stackSize];
+		const auto& node = m_nodes[entry.node];
+
+		auto planeMask = entry.planeMask;
+		if (planeMask != 0)
+		{
+			const auto center = (node.min + node.max) * 0.5f;
+			const auto extents = (node.max - node.min) * 0.5f;
+
+			bool isOutside = false;
+			for (uint32_t k = 0; k < Frustum::EPlanes::Count && !isOutside; k++)
+			{
+				if ((planeMask & (1u << k)) == 0)
+					continue;
+
+				const float r = extents.x * planes.ax[k] + extents.y * planes.ay[k] + extents.z * planes.az[k];
+				const float distance = planes.nx[k] * center.x + planes.ny[k] * center.y + planes.nz[k] * center.z + planes.d[k];
+				isOutside = distance < -r;
+				if (distance >= r)
+					planeMask &= ~(1u << k);
+			}
+
+			if (isOutside)
+				continue;
+		}
+
+		if (!node.isLeaf())
+		{
+			stack[stackSize++] = { node.leftOrFirst + 1, planeMask };
+			stack[stackSize++] = { node.leftOrFirst, planeMask };
+			continue;
+		}
+
+		// Only the planes the leaf straddles are left to test
+		for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+		{
+			const auto& center = m_itemBounds[i].center;
+			const auto& extents = m_itemBounds[i].extents;
+
+			bool isVisible = true;
+			for (auto bits = planeMask; bits != 0 && isVisible; bits &= bits - 1u)
+			{
+				const auto k = lowestBitIndex(bits);
+				const float r = extents.x * planes.ax[k] + extents.y * planes.ay[k] + extents.z * planes.az[k];
+				const float distance = planes.nx[k] * center.x + planes.ny[k] * center.y + planes.nz[k] * center.z + planes.d[k];
+				isVisible = -r <= distance;
+			}
+
+			const auto item = m_items[i];
+			visibility[item / 64] |= static_cast<uint64_t>(isVisible) << (item % 64);
+			visibleCount += isVisible;
+		}
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "pch.h"
+
+struct Frustum;
+struct BoundsSoA;
+
+// Bounding volume hierarchy over world space boxes, built with binned SAH and flattened depth first into one node array.
+// The children of an interior node are stored next to each other and always after their parent.
+class BVH
+{
+public:
+	struct Node
+	{
+		glm::vec3 min;
+		// The left child of an interior node (the right one follows it), or the first item of a leaf
+		uint32_t leftOrFirst;
+		glm::vec3 max;
+		// Zero for interior nodes
+		uint32_t count;
+
+		bool isLeaf() const { return count != 0; }
+	};
+
+	constexpr static uint32_t c_maxLeafSize = 4u;
+	constexpr static uint32_t c_binCount = 12u;
+	constexpr static uint32_t c_maxDepth = 48u;
+
+	// Boxes without bounds (BoundsSoA::setEmpty) are left out, they can never be visible.
+	void build(const BoundsSoA& bounds);
+	// Keeps the topology and only recomputes the node boxes, for when the boxes moved but not by much.
+	void refit(const BoundsSoA& bounds);
+	void clear();
+
+	// Subtrees outside of a plane are rejected whole, subtrees inside of every plane are accepted without further tests.
+	// Sets one bit per visible box in (count + 63) / 64 words of the bounds it was built from and returns the visible count.
+	uint32_t query(const Frustum& frustum, uint64_t* visibility) const;
+
+	bool isEmpty() const { return m_nodes.empty(); }
+	size_t getNodeCount() const { return m_nodes.size(); }
+	uint32_t getDepth() const { return m_depth; }
+
+private:
+	struct BuildItem
+	{
+		glm::vec3 min, max, centroid;
+	};
+
+	// Copy of the item boxes in leaf order, so the leaves are tested without chasing the indices
+	struct ItemBounds
+	{
+		glm::vec3 center, extents;
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_items;
+	std::vector<ItemBounds> m_itemBounds;
+	size_t m_boundsCount = 0;
+	uint32_t m_depth = 0;
+
+	void subdivide(uint32_t nodeIndex, const std::vector<BuildItem>& buildItems, uint32_t depth);
+	void updateNodeBounds(Node& node, const std::vector<BuildItem>& buildItems) const;
+};
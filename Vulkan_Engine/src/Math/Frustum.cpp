@@ -7,10 +7,10 @@ inline static glm::vec4 getRow(const glm::mat4& matrix, int rowIndex);
 inline static glm::vec4 addRows(const glm::mat4& matrix, int rowIndex1, int rowIndex2);
 inline static glm::vec4 subtractRows(const glm::mat4& matrix, int rowIndex1, int rowIndex2);
 
-Frustum::Frustum(const Camera& cam)
-{
-	const auto& viewProjMat = cam.getViewProjectionMatrix();
+Frustum::Frustum(const Camera& cam) : Frustum(cam.getViewProjectionMatrix()) { }
 
+Frustum::Frustum(const glm::mat4& viewProjMat)
+{
 	// Gribb-Hartmann method of frustum plane extraction from VP matrix - http://www.cs.otago.ac.nz/postgrads/alexis/planeExtraction.pdf
 	m_planes[EPlanes::Left]		= addRows(viewProjMat,		3, 0);
 	m_planes[EPlanes::Right]	= subtractRows(viewProjMat,	3, 0);
@@ -37,6 +37,25 @@ bool Frustum::isOnFrustum(const BoundsAABB& bounds) const
 		bounds.isOnOrForwardPlane(m_planes[EPlanes::Near]);
 }
 
+void Frustum::ignorePlane(EPlanes plane)
+{
+	// Zero normal and distance, every point lies on the plane
+	m_planes[plane] = Plane();
+}
+
+Frustum Frustum::getShadowCasterFrustum(const glm::vec3& lightDirection) const
+{
+	auto casterFrustum = *this;
+	for (size_t i = 0; i < m_planes.size(); i++)
+	{
+		// Moving along the light direction brings the bounds closer to the inside of the plane
+		if (glm::dot(m_planes[i].getNormal(), lightDirection) > 0.0f)
+			casterFrustum.ignorePlane(static_cast<EPlanes>(i));
+	}
+
+	return casterFrustum;
+}
+
 inline static glm::vec4 getRow(const glm::mat4& matrix, int rowIndex)
 {
 	glm::vec4 result;
@@ -8,11 +8,11 @@ struct BoundsAABB;
 struct Frustum
 {
 	Frustum(const Camera& cam);
+	Frustum(const glm::mat4& viewProjection);
 
 	// Check if the world space bounds are inside the camera frustum.
 	bool isOnFrustum(const BoundsAABB& bounds) const;
 
-private:
 	enum EPlanes
 	{
 		Left = 0,
@@ -25,5 +25,14 @@ private:
 		Count = 6
 	};
 
+	const std::array<Plane, EPlanes::Count>& getPlanes() const { return m_planes; }
+
+	// Every bounds pass the test against an ignored plane.
+	void ignorePlane(EPlanes plane);
+
+	// Keeps the planes that bounds swept along the light direction can't cross, anything outside of them can't shadow the frustum.
+	Frustum getShadowCasterFrustum(const glm::vec3& lightDirection) const;
+
+private:
 	std::array<Plane, EPlanes::Count> m_planes;
 };
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "FrustumCulling.h"
+#include "Frustum.h"
+#include "BoundsAABB.h"
+#include "Engine/Bitmask.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FRUSTUM_CULLING_X64
+#include <immintrin.h>
+#endif
+
+#if defined(FRUSTUM_CULLING_X64) && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+void BoundsSoA::resize(size_t count)
+{
+	for (auto* component : { &centerX, &centerY, &centerZ, &extentsX, &extentsY, &extentsZ })
+		component->resize(count);
+}
+
+void BoundsSoA::clear() { resize(0); }
+
+void BoundsSoA::set(size_t index, const BoundsAABB& bounds)
+{
+	centerX[index] = bounds.center.x;
+	centerY[index] = bounds.center.y;
+	centerZ[index] = bounds.center.z;
+	extentsX[index] = bounds.extents.x;
+	extentsY[index] = bounds.extents.y;
+	extentsZ[index] = bounds.extents.z;
+}
+
+void BoundsSoA::setTransformed(size_t index, const BoundsAABB& bounds, const glm::mat4& matrix)
+{
+	set(index, bounds.getTransformed(matrix));
+}
+
+void BoundsSoA::setEmpty(size_t index)
+{
+	// Every comparison against NaN fails, so the box is rejected by the first plane
+	const auto nan = std::numeric_limits<float>::quiet_NaN();
+	set(index, BoundsAABB(glm::vec3(nan), 0.0f, 0.0f, 0.0f));
+}
+
+namespace FrustumCulling
+{
+	PreparedPlanes::PreparedPlanes(const Frustum& frustum)
+	{
+		const auto& planes = frustum.getPlanes();
+		for (size_t i = 0; i < planes.size(); i++)
+		{
+			const auto& normal = planes[i].getNormal();
+			nx[i] = normal.x; ny[i] = normal.y; nz[i] = normal.z;
+			ax[i] = std::abs(normal.x); ay[i] = std::abs(normal.y); az[i] = std::abs(normal.z);
+			d[i] = planes[i].getDistance();
+		}
+	}
+
+	namespace
+	{
+		uint32_t cullScalar(const PreparedPlanes& p, const BoundsSoA& b, uint64_t* visibility, size_t begin, size_t end)
+		{
+			uint32_t visibleCount = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				const auto isVisible = p.isOnFrustum(b.centerX[i], b.centerY[i], b.centerZ[i], b.extentsX[i], b.extentsY[i], b.extentsZ[i]);
+				visibility[i / 64] |= static_cast<uint64_t>(isVisible) << (i % 64);
+				visibleCount += isVisible;
+			}
+			return visibleCount;
+		}
+
+#ifdef FRUSTUM_CULLING_X64
+		uint32_t cullSSE(const PreparedPlanes& p, const BoundsSoA& b, uint64_t* visibility, size_t count)
+		{
+			const auto signMask = _mm_set1_ps(-0.0f);
+
+			uint32_t visibleCount = 0;
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const auto cx = _mm_loadu_ps(&b.centerX[i]), cy = _mm_loadu_ps(&b.centerY[i]), cz = _mm_loadu_ps(&b.centerZ[i]);
+				const auto ex = _mm_loadu_ps(&b.extentsX[i]), ey = _mm_loadu_ps(&b.extentsY[i]), ez = _mm_loadu_ps(&b.extentsZ[i]);
+
+				auto mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (size_t k = 0; k < Frustum::EPlanes::Count; k++)
+				{
+					const auto r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(p.ax[k])), _mm_mul_ps(ey, _mm_set1_ps(p.ay[k]))), _mm_mul_ps(ez, _mm_set1_ps(p.az[k])));
+					const auto distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.nx[k]), cx), _mm_mul_ps(_mm_set1_ps(p.ny[k]), cy)),
+						_mm_mul_ps(_mm_set1_ps(p.nz[k]), cz)), _mm_set1_ps(p.d[k]));
+
+					mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_xor_ps(r, signMask), distance));
+				}
+
+				const auto bits = static_cast<uint64_t>(_mm_movemask_ps(mask));
+				visibility[i / 64] |= bits << (i % 64);
+				visibleCount += bitCount(bits);
+			}
+
+			return visibleCount + cullScalar(p, b, visibility, i, count);
+		}
+
+		TARGET_AVX2 uint32_t cullAVX2(const PreparedPlanes& p, const BoundsSoA& b, uint64_t* visibility, size_t count)
+		{
+			const auto signMask = _mm256_set1_ps(-0.0f);
+
+			uint32_t visibleCount = 0;
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const auto cx = _mm256_loadu_ps(&b.centerX[i]), cy = _mm256_loadu_ps(&b.centerY[i]), cz = _mm256_loadu_ps(&b.centerZ[i]);
+				const auto ex = _mm256_loadu_ps(&b.extentsX[i]), ey = _mm256_loadu_ps(&b.extentsY[i]), ez = _mm256_loadu_ps(&b.extentsZ[i]);
+
+				auto mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (size_t k = 0; k < Frustum::EPlanes::Count; k++)
+				{
+					const auto r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(p.ax[k])), _mm256_mul_ps(ey, _mm256_set1_ps(p.ay[k]))), _mm256_mul_ps(ez, _mm256_set1_ps(p.az[k])));
+					const auto distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.nx[k]), cx), _mm256_mul_ps(_mm256_set1_ps(p.ny[k]), cy)),
+						_mm256_mul_ps(_mm256_set1_ps(p.nz[k]), cz)), _mm256_set1_ps(p.d[k]));
+
+					mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_xor_ps(r, signMask), distance, _CMP_LE_OQ));
+				}
+
+				// 8 aligned lanes never straddle two words
+				const auto bits = static_cast<uint64_t>(_mm256_movemask_ps(mask));
+				visibility[i / 64] |= bits << (i % 64);
+				visibleCount += bitCount(bits);
+			}
+
+			return visibleCount + cullScalar(p, b, visibility, i, count);
+		}
+
+		bool isAVX2Supported()
+		{
+#ifdef _MSC_VER
+			std::array<int, 4> info{};
+			__cpuid(info.data(), 0);
+			if (info[0] < 7)
+				return false;
+
+			// AVX and OSXSAVE, then the OS has to save the YMM registers on context switches
+			__cpuid(info.data(), 1);
+			const auto hasAVX = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0;
+			if (!hasAVX || (_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info.data(), 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+	}
+
+	EPath getBestPath()
+	{
+#ifdef FRUSTUM_CULLING_X64
+		static const auto path = isAVX2Supported() ? EPath::AVX2 : EPath::SSE;
+		return path;
+#else
+		return EPath::Scalar;
+#endif
+	}
+
+	const char* getPathName(EPath path)
+	{
+		switch (path)
+		{
+		case EPath::SSE: return "SSE";
+		case EPath::AVX2: return "AVX2";
+		default: return "Scalar";
+		}
+	}
+
+	uint32_t cull(const Frustum& frustum, const BoundsSoA& bounds, uint64_t* visibility, EPath path)
+	{
+		const auto count = bounds.size();
+		std::fill(visibility, visibility + (count + 63) / 64, 0u);
+
+		const auto planes = PreparedPlanes(frustum);
+#ifdef FRUSTUM_CULLING_X64
+		if (path == EPath::AVX2 && getBestPath() == EPath::AVX2)
+			return cullAVX2(planes, bounds, visibility, count);
+		if (path != EPath::Scalar)
+			return cullSSE(planes, bounds, visibility, count);
+#endif
+		return cullScalar(planes, bounds, visibility, 0, count);
+	}
+
+	void cullToIndices(const Frustum& frustum, const BoundsSoA& bounds, std::vector<uint32_t>& visibleIndices, EPath path)
+	{
+		std::vector<uint64_t> visibility((bounds.size() + 63) / 64);
+		visibleIndices.resize(cull(frustum, bounds, visibility.data(), path));
+
+		size_t visibleIndex = 0;
+		for (uint32_t word = 0; word < visibility.size(); word++)
+		{
+			for (auto bits = visibility[word]; bits != 0; bits &= bits - 1u)
+				visibleIndices[visibleIndex++] = word * 64u + lowestBitIndex(bits);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+#include "Frustum.h"
+
+struct BoundsAABB;
+
+// World space bounds stored as structure of arrays, so one SIMD load brings in the same component of 4 or 8 boxes.
+struct BoundsSoA
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentsX, extentsY, extentsZ;
+
+	size_t size() const { return centerX.size(); }
+	void resize(size_t count);
+	void clear();
+
+	void set(size_t index, const BoundsAABB& bounds);
+	// Writes the bounds transformed by the matrix, same as BoundsAABB::getTransformed.
+	void setTransformed(size_t index, const BoundsAABB& bounds, const glm::mat4& matrix);
+	// Boxes without bounds are never visible.
+	void setEmpty(size_t index);
+};
+
+namespace FrustumCulling
+{
+	enum class EPath { Scalar, SSE, AVX2 };
+
+	// Plane components broadcast per lane, |n| is precomputed for the projected radius of the box.
+	struct PreparedPlanes
+	{
+		std::array<float, Frustum::EPlanes::Count> nx, ny, nz;
+		std::array<float, Frustum::EPlanes::Count> ax, ay, az;
+		std::array<float, Frustum::EPlanes::Count> d;
+
+		PreparedPlanes(const Frustum& frustum);
+
+		// Same operation order as BoundsAABB::isOnOrForwardPlane, so every path gives bit identical results.
+		bool isOnFrustum(float cx, float cy, float cz, float ex, float ey, float ez) const
+		{
+			bool isVisible = true;
+			for (size_t k = 0; k < Frustum::EPlanes::Count; k++)
+			{
+				const float r = ex * ax[k] + ey * ay[k] + ez * az[k];
+				const float distance = nx[k] * cx + ny[k] * cy + nz[k] * cz + d[k];
+				isVisible = isVisible && -r <= distance;
+			}
+			return isVisible;
+		}
+	};
+
+	// Picked once from cpuid, the kernels give the same result on every path.
+	EPath getBestPath();
+	const char* getPathName(EPath path);
+
+	// Writes one bit per box into (count + 63) / 64 words, the bits past the last box are cleared.
+	// Returns the number of visible boxes.
+	uint32_t cull(const Frustum& frustum, const BoundsSoA& bounds, uint64_t* visibility, EPath path = getBestPath());
+
+	// Returns the indices of the visible boxes in ascending order.
+	void cullToIndices(const Frustum& frustum, const BoundsSoA& bounds, std::vector<uint32_t>& visibleIndices, EPath path = getBestPath());
+}
@@ -0,0 +1,322 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+namespace
+{
+	// Scoring constants from Forsyth's paper, the cache only has to be roughly the size of the real one
+	constexpr uint32_t c_scoredCacheSize = 32u;
+	constexpr float c_cacheDecayPower = 1.5f;
+	constexpr float c_lastTriangleScore = 0.75f;
+	constexpr float c_valenceBoostScale = 2.0f;
+	constexpr float c_valenceBoostPower = 0.5f;
+
+	float getVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the triangle just emitted score the same, whichever order they went in
+			if (cachePosition < 3)
+			{
+				score = c_lastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (c_scoredCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, c_cacheDecayPower);
+			}
+		}
+
+		// Vertices with few triangles left get a boost, so single triangles don't get stranded until the very end
+		score += c_valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -c_valenceBoostPower);
+		return score;
+	}
+
+	// Each miss stamps the vertex with the running miss count, a vertex is cached while fewer than cacheSize misses followed it.
+	struct FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		FifoCache(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0u), time(cacheSize + 1u), size(cacheSize) { }
+
+		uint32_t process(const uint32_t* triangle)
+		{
+			uint32_t misses = 0;
+			for (size_t k = 0; k < 3; k++)
+			{
+				const auto v = triangle[k];
+				if (time - timestamps[v] > size)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		void reset() { time += size + 1u; }
+	};
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	CacheStats stats{};
+	stats.triangleCount = indices.size() / 3;
+
+	std::vector<uint8_t> isReferenced(vertexCount, 0);
+	for (auto index : indices)
+	{
+		stats.vertexCount += isReferenced[index] ? 0u : 1u;
+		isReferenced[index] = 1;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		stats.transformedCount += cache.process(&indices[i]);
+	}
+
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	destination.clear();
+	destination.reserve(triangleCount * 3);
+	if (triangleCount == 0)
+		return;
+
+	// The not yet emitted triangles of every vertex, the first remaining[v] entries of its range
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			const auto v = indices[t * 3 + k];
+			adjacency[offsets[v] + remaining[v]++] = t;
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = getVertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<uint8_t> isEmitted(triangleCount, 0);
+	int64_t bestTriangle = -1;
+	float bestScore = -std::numeric_limits<float>::max();
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > bestScore)
+		{
+			bestScore = triangleScores[t];
+			bestTriangle = t;
+		}
+	}
+
+	// Three extra slots for the vertices pushed out by the last triangle, their scores have to drop too
+	std::array<uint32_t, c_scoredCacheSize + 3> cache;
+	std::array<uint32_t, c_scoredCacheSize + 3> nextCache;
+	size_t cacheCount = 0;
+	size_t cursor = 0;
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// Nothing in the cache has triangles left, carry on in the input order
+		if (bestTriangle < 0)
+		{
+			while (isEmitted[cursor])
+				cursor++;
+			bestTriangle = static_cast<int64_t>(cursor);
+		}
+
+		const auto t = static_cast<uint32_t>(bestTriangle);
+		const auto* triangle = &indices[t * 3];
+		isEmitted[t] = 1;
+		destination.insert(destination.end(), triangle, triangle + 3);
+
+		size_t nextCount = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			const auto v = triangle[k];
+			auto* begin = &adjacency[offsets[v]];
+			auto* end = begin + remaining[v];
+			auto* found = std::find(begin, end, t);
+			if (found != end)
+			{
+				std::swap(*found, *(end - 1));
+				remaining[v]--;
+			}
+
+			if (std::find(nextCache.begin(), nextCache.begin() + nextCount, v) == nextCache.begin() + nextCount)
+				nextCache[nextCount++] = v;
+		}
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			const auto v = cache[i];
+			if (std::find(nextCache.begin(), nextCache.begin() + nextCount, v) == nextCache.begin() + nextCount)
+				nextCache[nextCount++] = v;
+		}
+
+		for (size_t i = 0; i < nextCount; i++)
+		{
+			cachePositions[nextCache[i]] = i < c_scoredCacheSize ? static_cast<int32_t>(i) : -1;
+		}
+
+		for (size_t i = 0; i < nextCount; i++)
+		{
+			const auto v = nextCache[i];
+			const auto score = getVertexScore(cachePositions[v], remaining[v]);
+			const auto delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			for (auto a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+			{
+				triangleScores[adjacency[a]] += delta;
+			}
+		}
+
+		cacheCount = std::min(nextCount, static_cast<size_t>(c_scoredCacheSize));
+		std::copy(nextCache.begin(), nextCache.begin() + cacheCount, cache.begin());
+
+		// Only the triangles around the cached vertices changed their score, the best one is among them
+		bestTriangle = -1;
+		bestScore = -std::numeric_limits<float>::max();
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			const auto v = cache[i];
+			for (auto a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+			{
+				const auto candidate = adjacency[a];
+				if (triangleScores[candidate] > bestScore)
+				{
+					bestScore = triangleScores[candidate];
+					bestTriangle = candidate;
+				}
+			}
+		}
+	}
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+	const glm::vec3& center, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	destination = indices;
+	if (triangleCount < 2)
+		return;
+
+	const auto vertexCount = positions.size();
+	const auto acmr = analyzeVertexCache(indices, vertexCount).getACMR();
+
+	// Hard boundaries: the cache optimizer moved on to a part of the mesh it hadn't touched yet
+	std::vector<uint32_t> hardBoundaries;
+	{
+		FifoCache cache(vertexCount, c_analyzedCacheSize);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			if (cache.process(&indices[t * 3]) == 3 || t == 0)
+				hardBoundaries.push_back(t);
+		}
+	}
+	hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+	// Soft boundaries: the cache restarts cold at the beginning of every cluster, it ends once it paid that back
+	std::vector<uint32_t> clusterStarts;
+	{
+		FifoCache cache(vertexCount, c_analyzedCacheSize);
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+		{
+			auto start = hardBoundaries[h];
+			uint32_t misses = 0;
+			cache.reset();
+			clusterStarts.push_back(start);
+
+			for (auto t = start; t < hardBoundaries[h + 1]; t++)
+			{
+				misses += cache.process(&indices[t * 3]);
+				const auto clusterAcmr = misses / static_cast<float>(t - start + 1);
+				if (t + 1 < hardBoundaries[h + 1] && clusterAcmr <= acmr * threshold)
+				{
+					start = t + 1;
+					misses = 0;
+					cache.reset();
+					clusterStarts.push_back(start);
+				}
+			}
+		}
+	}
+	clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+	// How much a cluster faces away from the center of the submesh, weighted by the area of its triangles
+	const auto clusterCount = clusterStarts.size() - 1;
+	std::vector<std::pair<float, uint32_t>> sortKeys(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (auto t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			const auto& p0 = positions[indices[t * 3]];
+			const auto& p1 = positions[indices[t * 3 + 1]];
+			const auto& p2 = positions[indices[t * 3 + 2]];
+
+			const auto triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			const auto triangleArea = glm::length(triangleNormal);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		const auto normalLength = glm::length(normal);
+		const auto facing = area > 0.0f && normalLength > 0.0f ? glm::dot(centroid / area - center, normal / normalLength) : 0.0f;
+		sortKeys[c] = { -facing, c };
+	}
+	std::sort(sortKeys.begin(), sortKeys.end());
+
+	destination.clear();
+	for (const auto& key : sortKeys)
+	{
+		const auto c = key.second;
+		destination.insert(destination.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+}
+
+size_t MeshOptimizer::buildVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<const std::vector<uint32_t>*>& indexLists, size_t vertexCount)
+{
+	remap.assign(vertexCount, c_unusedVertex);
+
+	uint32_t nextVertex = 0;
+	for (const auto* indices : indexLists)
+	{
+		for (auto index : *indices)
+		{
+			if (remap[index] == c_unusedVertex)
+				remap[index] = nextVertex++;
+		}
+	}
+
+	return nextVertex;
+}
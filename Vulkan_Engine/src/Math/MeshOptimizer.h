@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+
+// Index and vertex reordering for the GPU, run on import so the cached meshes come out ready to draw.
+// Every function is deterministic for the same input.
+namespace MeshOptimizer
+{
+	// Post transform cache behaviour of an index list on a FIFO cache of the given size.
+	struct CacheStats
+	{
+		size_t triangleCount = 0;
+		// Vertices referenced by the indices
+		size_t vertexCount = 0;
+		// Cache misses, each one runs the vertex shader
+		size_t transformedCount = 0;
+
+		// Average cache miss ratio, transformed vertices per triangle (0.5 at best on a regular grid, 3 at worst)
+		float getACMR() const { return triangleCount == 0 ? 0.0f : transformedCount / static_cast<float>(triangleCount); }
+		// Average transform to vertex ratio, 1 means every vertex runs the vertex shader once
+		float getATVR() const { return vertexCount == 0 ? 0.0f : transformedCount / static_cast<float>(vertexCount); }
+
+		void add(const CacheStats& other)
+		{
+			triangleCount += other.triangleCount;
+			vertexCount += other.vertexCount;
+			transformedCount += other.transformedCount;
+		}
+	};
+
+	constexpr uint32_t c_analyzedCacheSize = 16u;
+
+	CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = c_analyzedCacheSize);
+
+	// Tom Forsyth's linear speed vertex cache optimisation, greedily emits the triangle whose vertices score the highest
+	// on a simulated LRU cache. The scores favour vertices that are recent and have few triangles left.
+	void optimizeVertexCache(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Splits the cache optimized order in clusters wherever the cache would be mostly cold anyway, then sorts the clusters
+	// so the ones facing away from the center come first, they are the likeliest to occlude the rest. A cluster ends as
+	// soon as its own miss ratio drops under threshold times the one of the whole list, which bounds the ACMR it costs.
+	void optimizeOverdraw(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+		const glm::vec3& center, float threshold);
+
+	// Fills remap with the new position of every vertex, in the order the index lists first reference them.
+	// Vertices no index references get c_unusedVertex. Returns the number of referenced vertices.
+	constexpr uint32_t c_unusedVertex = std::numeric_limits<uint32_t>::max();
+	size_t buildVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<const std::vector<uint32_t>*>& indexLists, size_t vertexCount);
+
+	template<typename T>
+	void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap, size_t referencedCount)
+	{
+		std::vector<T> remapped(referencedCount);
+		for (size_t v = 0; v < vertices.size() && v < remap.size(); v++)
+		{
+			if (remap[v] != c_unusedVertex)
+				remapped[remap[v]] = vertices[v];
+		}
+		vertices = std::move(remapped);
+	}
+}
@@ -0,0 +1,312 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+
+namespace
+{
+	// Sum of the squared distances to a set of planes, each weighted by the area of the triangle it came from.
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		// (n.p + d)^2 = p^T (n n^T) p + 2 d n.p + d^2
+		static Quadric fromPlane(const glm::dvec3& n, double d, double w)
+		{
+			return { n.x * n.x * w, n.x * n.y * w, n.x * n.z * w, n.y * n.y * w, n.y * n.z * w, n.z * n.z * w,
+				n.x * d * w, n.y * d * w, n.z * d * w, d * d * w, w };
+		}
+
+		void add(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// Mean squared distance of the point to the planes
+		double evaluate(const glm::vec3& point) const
+		{
+			const double x = point.x, y = point.y, z = point.z;
+			const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+			return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+
+		bool operator<(const Collapse& other) const
+		{
+			if (cost != other.cost)
+				return cost < other.cost;
+			return from != other.from ? from < other.from : to < other.to;
+		}
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& position) const
+		{
+			// -0 and 0 compare equal, they have to hash the same
+			uint32_t bits[3];
+			const glm::vec3 p(position.x == 0.0f ? 0.0f : position.x, position.y == 0.0f ? 0.0f : position.y, position.z == 0.0f ? 0.0f : position.z);
+			memcpy(bits, &p, sizeof(bits));
+
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	uint64_t getEdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	void removeDegenerateTriangles(std::vector<uint32_t>& indices)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (a == b || b == c || c == a)
+				continue;
+
+			indices[count++] = a;
+			indices[count++] = b;
+			indices[count++] = c;
+		}
+		indices.resize(count);
+	}
+}
+
+float MeshSimplifier::simplify(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+	size_t targetIndexCount, float maxError)
+{
+	destination = indices;
+
+	const size_t vertexCount = positions.size();
+	for (auto index : destination)
+	{
+		if (index >= vertexCount)
+		{
+			printf("Can not simplify a mesh with index %u outside of its %zi vertices.\n", index, vertexCount);
+			return 0.0f;
+		}
+	}
+
+	removeDegenerateTriangles(destination);
+	if (destination.size() <= targetIndexCount)
+		return 0.0f;
+
+	// Vertices at the same position are welded, the quadrics and the borders are tracked per welded vertex
+	std::vector<uint32_t> welded(vertexCount);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+		firstAtPosition.reserve(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			welded[v] = firstAtPosition.emplace(positions[v], v).first->second;
+		}
+	}
+
+	// A position referenced through several vertices is a seam of the uvs or normals, moving it would tear the surface apart
+	std::vector<uint8_t> isLocked(vertexCount, 0);
+	{
+		std::vector<uint8_t> isReferenced(vertexCount, 0);
+		std::vector<uint32_t> referenceCount(vertexCount, 0);
+		for (auto index : destination)
+		{
+			if (!isReferenced[index])
+				referenceCount[welded[index]]++;
+			isReferenced[index] = 1;
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			if (referenceCount[v] > 1)
+				isLocked[v] = 1;
+		}
+	}
+
+	// So is an edge used by a single triangle, the silhouette of an open mesh has to stay where it is
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(destination.size());
+		for (size_t i = 0; i < destination.size(); i += 3)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				const auto a = welded[destination[i + k]];
+				const auto b = welded[destination[i + (k + 1) % 3]];
+				edgeUses[getEdgeKey(a, b)]++;
+			}
+		}
+
+		for (const auto& [key, uses] : edgeUses)
+		{
+			if (uses != 1)
+				continue;
+
+			isLocked[static_cast<uint32_t>(key >> 32)] = 1;
+			isLocked[static_cast<uint32_t>(key)] = 1;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < destination.size(); i += 3)
+	{
+		const glm::dvec3 p0 = positions[destination[i]];
+		const glm::dvec3 p1 = positions[destination[i + 1]];
+		const glm::dvec3 p2 = positions[destination[i + 2]];
+
+		const auto normal = glm::cross(p1 - p0, p2 - p0);
+		const auto length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+
+		const auto n = normal / length;
+		const auto q = Quadric::fromPlane(n, -glm::dot(n, p0), length * 0.5);
+		for (size_t k = 0; k < 3; k++)
+		{
+			quadrics[welded[destination[i + k]]].add(q);
+		}
+	}
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double reachedCost = 0.0;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> triangleOffsets;
+	std::vector<uint32_t> adjacentTriangles;
+	std::vector<uint32_t> cursor;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> isTouched;
+
+	// Every pass collapses a set of edges whose neighbourhoods don't overlap, so the flip tests of a pass can't invalidate each other
+	while (destination.size() > targetIndexCount)
+	{
+		const auto triangleCount = static_cast<uint32_t>(destination.size() / 3);
+
+		triangleOffsets.assign(vertexCount + 1, 0);
+		for (auto index : destination)
+		{
+			triangleOffsets[index + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+
+		cursor.assign(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		adjacentTriangles.resize(destination.size());
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				adjacentTriangles[cursor[destination[t * 3 + k]]++] = t;
+			}
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < destination.size(); i += 3)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				const auto a = destination[i + k];
+				const auto b = destination[i + (k + 1) % 3];
+
+				for (const auto& [from, to] : { std::make_pair(a, b), std::make_pair(b, a) })
+				{
+					if (isLocked[welded[from]])
+						continue;
+
+					auto q = quadrics[welded[from]];
+					q.add(quadrics[welded[to]]);
+					collapses.push_back({ from, to, q.evaluate(positions[to]) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		isTouched.assign(vertexCount, 0);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			remap[v] = v;
+		}
+
+		const size_t trianglesToRemove = (destination.size() - targetIndexCount + 2) / 3;
+		size_t removedTriangles = 0;
+		size_t collapseCount = 0;
+		for (const auto& collapse : collapses)
+		{
+			if (collapse.cost > maxCost)
+				break;
+
+			const auto from = collapse.from;
+			const auto to = collapse.to;
+			if (isTouched[from] || isTouched[to])
+				continue;
+
+			bool isFlipping = false;
+			size_t collapsedTriangles = 0;
+			for (auto i = triangleOffsets[from]; i < triangleOffsets[from + 1] && !isFlipping; i++)
+			{
+				const auto* triangle = &destination[adjacentTriangles[i] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				{
+					collapsedTriangles++;
+					continue;
+				}
+
+				// Moving 'from' onto 'to' must keep the triangle facing the same way, turning it edge on counts as a flip
+				const glm::vec3 before[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+				glm::vec3 after[3];
+				for (size_t k = 0; k < 3; k++)
+				{
+					after[k] = triangle[k] == from ? positions[to] : before[k];
+				}
+
+				const auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				isFlipping = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+
+			if (isFlipping)
+				continue;
+
+			remap[from] = to;
+			for (auto i = triangleOffsets[from]; i < triangleOffsets[from + 1]; i++)
+			{
+				const auto* triangle = &destination[adjacentTriangles[i] * 3];
+				isTouched[triangle[0]] = isTouched[triangle[1]] = isTouched[triangle[2]] = 1;
+			}
+			quadrics[welded[to]].add(quadrics[welded[from]]);
+
+			reachedCost = std::max(reachedCost, collapse.cost);
+			removedTriangles += collapsedTriangles;
+			collapseCount++;
+
+			if (removedTriangles >= trianglesToRemove)
+				break;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		for (auto& index : destination)
+		{
+			index = remap[index];
+		}
+		removeDegenerateTriangles(destination);
+	}
+
+	return static_cast<float>(std::sqrt(reachedCost));
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "pch.h"
+
+// Quadric error metric simplification by edge collapse. A vertex is only ever collapsed onto one of its neighbours,
+// so the simplified indices address the same vertex buffer as the source and a LOD costs nothing but its index range.
+namespace MeshSimplifier
+{
+	// Collapses the cheapest edges until at most targetIndexCount indices are left, or until every remaining collapse would
+	// move the surface further than maxError. Open borders and attribute seams (vertices sharing a position) stay in place,
+	// collapses that would flip a triangle are skipped. The result is deterministic for the same input.
+	// Returns the largest error of the performed collapses, a distance in the units of the positions.
+	float simplify(std::vector<uint32_t>& destination, const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+		size_t targetIndexCount, float maxError);
+}
@@ -61,10 +61,38 @@ namespace Presentation
 
 	bool Device::createLogicalDevice(VkPhysicalDevice physicalDevice)
 	{
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.depthClamp = supportedFeatures.depthClamp;
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+		m_supportsIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+		m_supportsMultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+		m_maxDrawIndirectCount = m_supportsMultiDrawIndirect ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1u;
+		m_supportsDepthClamp = supportedFeatures.depthClamp == VK_TRUE;
+		m_supportsSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+		m_maxBoundTextures = std::min({ properties.limits.maxPerStageDescriptorSampledImages, properties.limits.maxPerStageDescriptorSamplers,
+			properties.limits.maxDescriptorSetSampledImages, properties.limits.maxDescriptorSetSamplers });
+		m_minUniformBufferOffsetAlignment = properties.limits.minUniformBufferOffsetAlignment;
 
 		vkinit::Queue::findQueueFamilies(m_queueIndices, physicalDevice, m_surface);
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		const auto graphicsFamily = m_queueIndices.graphicsFamily.value();
+		m_timestampValidBits = graphicsFamily < queueFamilyCount ? queueFamilies[graphicsFamily].timestampValidBits : 0u;
+		m_timestampPeriod = properties.limits.timestampPeriod;
 		float queuePriority = 1.0;
 		auto queueCreateInfos = vkinit::Queue::getQueueCreateInfo(m_queueIndices, &queuePriority);
 
@@ -74,9 +102,40 @@ namespace Presentation
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-		auto& requiredExtensions = vkinit::Instance::requiredExtensions;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
-		createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+		// Optional extensions are enabled only when the hardware has them
+		auto enabledExtensions = vkinit::Instance::requiredExtensions;
+		const bool hasDrawIndirectCount = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[](const VkExtensionProperties& extension) { return strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0; });
+		if (hasDrawIndirectCount)
+			enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+		// The extension alone isn't enough, the feature has to be enabled as well
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		const bool hasTimelineExtension = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[](const VkExtensionProperties& extension) { return strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0; });
+		if (hasTimelineExtension)
+		{
+			VkPhysicalDeviceFeatures2 supportedFeatures2{};
+			supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures2.pNext = &timelineFeatures;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+		}
+		const bool hasTimelineSemaphore = hasTimelineExtension && timelineFeatures.timelineSemaphore == VK_TRUE;
+		if (hasTimelineSemaphore)
+		{
+			enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			timelineFeatures.pNext = nullptr;
+			createInfo.pNext = &timelineFeatures;
+		}
+
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		createInfo.pEnabledFeatures = &deviceFeatures;
 
@@ -90,6 +149,15 @@ namespace Presentation
 		{
 			vkGetDeviceQueue(m_vkdevice, m_queueIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
 			vkGetDeviceQueue(m_vkdevice, m_queueIndices.presentFamily.value(), 0, &m_presentQueue);
+			vkGetDeviceQueue(m_vkdevice, m_queueIndices.transferFamily.value(), 0, &m_transferQueue);
+
+			if (hasDrawIndirectCount)
+				m_cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(m_vkdevice, "vkCmdDrawIndexedIndirectCountKHR"));
+			if (hasTimelineSemaphore)
+			{
+				m_waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(m_vkdevice, "vkWaitSemaphoresKHR"));
+				m_getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(m_vkdevice, "vkGetSemaphoreCounterValueKHR"));
+			}
 		}
 
 		return isSuccess;
@@ -19,8 +19,34 @@ namespace Presentation
 		VkSurfaceKHR getSurface() const { return m_surface; }
 		VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
 		VkQueue getPresentQueue() const { return m_presentQueue; }
+		VkQueue getTransferQueue() const { return m_transferQueue; }
+		const QueueFamilyIndices& getQueueFamilyIndices() const { return m_queueIndices; }
 		VkCommandPool getCommandPool() const { return m_commandPool; }
 
+		// Indirect draws can only address the per draw data through firstInstance when the feature is enabled
+		bool supportsIndirectFirstInstance() const { return m_supportsIndirectFirstInstance; }
+		bool supportsMultiDrawIndirect() const { return m_supportsMultiDrawIndirect; }
+		uint32_t getMaxDrawIndirectCount() const { return m_maxDrawIndirectCount; }
+		// Lets the shadow pass flatten casters in front of the light's near plane onto it instead of clipping them
+		bool supportsDepthClamp() const { return m_supportsDepthClamp; }
+		// The fragment shader can pick a texture of the table by the material index of the draw
+		bool supportsSampledImageArrayDynamicIndexing() const { return m_supportsSampledImageArrayDynamicIndexing; }
+		// How many combined image samplers the fragment stage can have bound at once
+		uint32_t getMaxBoundTextures() const { return m_maxBoundTextures; }
+		// Dynamic uniform buffer offsets have to be a multiple of it
+		VkDeviceSize getMinUniformBufferOffsetAlignment() const { return m_minUniformBufferOffsetAlignment; }
+		// VK_KHR_draw_indirect_count, lets the GPU write how many indirect draws to execute
+		bool supportsDrawIndirectCount() const { return m_cmdDrawIndexedIndirectCount != nullptr; }
+		PFN_vkCmdDrawIndexedIndirectCountKHR getDrawIndexedIndirectCount() const { return m_cmdDrawIndexedIndirectCount; }
+		// VK_KHR_timeline_semaphore, the frames are tracked by a single counter instead of a fence per frame
+		bool supportsTimelineSemaphore() const { return m_waitSemaphores != nullptr && m_getSemaphoreCounterValue != nullptr; }
+		PFN_vkWaitSemaphoresKHR getWaitSemaphores() const { return m_waitSemaphores; }
+		PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue() const { return m_getSemaphoreCounterValue; }
+		// The graphics queue can write timestamps, a tick lasts getTimestampPeriod nanoseconds and only the low getTimestampValidBits bits count
+		bool supportsTimestamps() const { return m_timestampValidBits != 0u && m_timestampPeriod > 0.0f; }
+		float getTimestampPeriod() const { return m_timestampPeriod; }
+		uint32_t getTimestampValidBits() const { return m_timestampValidBits; }
+
 		bool submitImmediatelyAndWaitCompletion(const std::function<void(VkCommandBuffer cmd)>&& commandForExecution) const;
 
 		void release();
@@ -34,9 +60,23 @@ namespace Presentation
 
 		VkQueue m_graphicsQueue;
 		VkQueue m_presentQueue;
+		VkQueue m_transferQueue;
 
 		VkCommandPool m_commandPool;
 
+		bool m_supportsIndirectFirstInstance = false;
+		bool m_supportsMultiDrawIndirect = false;
+		uint32_t m_maxDrawIndirectCount = 1u;
+		bool m_supportsDepthClamp = false;
+		bool m_supportsSampledImageArrayDynamicIndexing = false;
+		uint32_t m_maxBoundTextures = 16u;
+		VkDeviceSize m_minUniformBufferOffsetAlignment = 256u;
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+		PFN_vkWaitSemaphoresKHR m_waitSemaphores = nullptr;
+		PFN_vkGetSemaphoreCounterValueKHR m_getSemaphoreCounterValue = nullptr;
+		float m_timestampPeriod = 0.0f;
+		uint32_t m_timestampValidBits = 0u;
+
 		const Window* m_window;
 		const VulkanValidationLayers* m_validationLayers;
 
@@ -1,10 +1,11 @@
 #include "pch.h"
 #include "Frame.h"
 #include "VkTypes/InitializersUtility.h"
+#include "vk_types.h"
 
 namespace Presentation
 {
-	bool Frame::initialize(VkDevice device, VkCommandPool pool)
+	bool Frame::initialize(VkDevice device, VkCommandPool pool, bool measureGpuTime)
 	{
 		bool fullyInitialized = true;
 		fullyInitialized &= vkinit::Synchronization::createSemaphore(m_imageAvailableSemaphore, device);
@@ -13,27 +14,85 @@ namespace Presentation
 		fullyInitialized &= vkinit::Synchronization::createFence(m_inFlightFence, device);
 
 		fullyInitialized &= vkinit::Commands::createSingleCommandBuffer(m_buffer, pool, device);
+
+		if (measureGpuTime)
+			fullyInitialized &= createGpuTimestamps(device, pool);
 		return fullyInitialized;
 	}
 
-	void Frame::submitToQueue(VkQueue graphicsQueue)
+	bool Frame::createGpuTimestamps(VkDevice device, VkCommandPool pool)
+	{
+		if (!vkinit::Commands::createTimestampQueryPool(m_timestampPool, device, 2u) ||
+			!vkinit::Commands::createSingleCommandBuffer(m_timestampBegin, pool, device) ||
+			!vkinit::Commands::createSingleCommandBuffer(m_timestampEnd, pool, device))
+			return false;
+
+		// Recorded once, the slot's previous submission has completed whenever they are submitted again
+		{
+			CommandObjectsWrapper::CommandBufferScope scope(m_timestampBegin);
+			vkCmdResetQueryPool(m_timestampBegin, m_timestampPool, 0u, 2u);
+			// At the stage the submission waits for the swapchain image, so the time the image isn't available yet is left out
+			vkCmdWriteTimestamp(m_timestampBegin, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, m_timestampPool, 0u);
+		}
+		{
+			CommandObjectsWrapper::CommandBufferScope scope(m_timestampEnd);
+			vkCmdWriteTimestamp(m_timestampEnd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, 1u);
+		}
+
+		return true;
+	}
+
+	bool Frame::readGpuTime(VkDevice device, float timestampPeriod, uint32_t timestampValidBits, int64_t& gpuTime_us) const
+	{
+		if (m_timestampPool == VK_NULL_HANDLE || !m_isTimestampWritten)
+			return false;
+
+		std::array<uint64_t, 2> ticks{};
+		if (vkGetQueryPoolResults(device, m_timestampPool, 0u, 2u, sizeof(ticks), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+			return false;
+
+		// The counter wraps around at its valid bits
+		const auto mask = timestampValidBits >= 64u ? ~0ull : (1ull << timestampValidBits) - 1ull;
+		const auto elapsedTicks = (ticks[1] - ticks[0]) & mask;
+		gpuTime_us = static_cast<int64_t>(static_cast<double>(elapsedTicks) * timestampPeriod / 1000.0);
+		return true;
+	}
+
+	void Frame::submitToQueue(VkQueue graphicsQueue, VkSemaphore timeline, uint64_t timelineValue)
 	{
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &m_renderFinishedSemaphore;
+		// The value of the binary render finished semaphore is ignored
+		const std::array<VkSemaphore, 2> signalSemaphores = { m_renderFinishedSemaphore, timeline };
+		const std::array<uint64_t, 2> signalValues = { 0u, timelineValue };
+		const std::array<uint64_t, 1> waitValues = { 0u };
+
+		VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.waitSemaphoreValueCount = as_uint32(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = as_uint32(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		const auto hasTimeline = timeline != VK_NULL_HANDLE;
+		submitInfo.pNext = hasTimeline ? &timelineInfo : nullptr;
+		submitInfo.signalSemaphoreCount = hasTimeline ? 2 : 1;
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
 
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 		submitInfo.waitSemaphoreCount = 1;
 		submitInfo.pWaitSemaphores = &m_imageAvailableSemaphore;
 		submitInfo.pWaitDstStageMask = waitStages;
 
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_buffer;
+		const std::array<VkCommandBuffer, 3> commandBuffers = { m_timestampBegin, m_buffer, m_timestampEnd };
+		const auto hasTimestamps = m_timestampPool != VK_NULL_HANDLE;
+		submitInfo.commandBufferCount = hasTimestamps ? 3 : 1;
+		submitInfo.pCommandBuffers = hasTimestamps ? commandBuffers.data() : &m_buffer;
 
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, m_inFlightFence) != VK_SUCCESS)
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, hasTimeline ? VK_NULL_HANDLE : m_inFlightFence) != VK_SUCCESS)
 			throw std::runtime_error("Failed to submit draw command buffer!");
+		m_isTimestampWritten = hasTimestamps;
 	}
 
 	void Frame::present(uint32_t imageIndex, VkSwapchainKHR swapChain, VkQueue presentQueue)
@@ -68,5 +127,16 @@ namespace Presentation
 		vkDestroySemaphore(device, m_imageAvailableSemaphore, nullptr);
 		vkDestroySemaphore(device, m_renderFinishedSemaphore, nullptr);
 		vkDestroyFence(device, m_inFlightFence, nullptr);
+		// The slots are rebuilt when the frames in flight change, the pool outlives them
+		vkFreeCommandBuffers(device, m_pool, 1, &m_buffer);
+
+		if (m_timestampPool != VK_NULL_HANDLE)
+		{
+			const std::array<VkCommandBuffer, 2> timestampBuffers = { m_timestampBegin, m_timestampEnd };
+			vkFreeCommandBuffers(device, m_pool, as_uint32(timestampBuffers.size()), timestampBuffers.data());
+			vkDestroyQueryPool(device, m_timestampPool, nullptr);
+		}
+		m_timestampPool = VK_NULL_HANDLE;
+		m_isTimestampWritten = false;
 	}
 }
\ No newline at end of file
@@ -7,9 +7,9 @@ namespace Presentation
 	class Frame : IRequireInitialization
 	{
 	public:
-		Frame(VkDevice device, VkCommandPool pool)
+		Frame(VkDevice device, VkCommandPool pool, bool measureGpuTime = false) : m_pool(pool)
 		{
-			m_isInitialized = initialize(device, pool);
+			m_isInitialized = initialize(device, pool, measureGpuTime);
 		}
 
 		bool IRequireInitialization::isInitialized() const override { return m_isInitialized; }
@@ -19,10 +19,15 @@ namespace Presentation
 		VkSemaphore getRenderFinishedSemaphore() const { return m_renderFinishedSemaphore; }
 		VkFence getInFlightFence() const { return m_inFlightFence; }
 
-		void submitToQueue(VkQueue graphicsQueue);
+		// Signals the timeline semaphore with the value of the frame, or the fence of the slot when there is no timeline.
+		void submitToQueue(VkQueue graphicsQueue, VkSemaphore timeline, uint64_t timelineValue);
 
 		void present(uint32_t imageIndex, VkSwapchainKHR swapChain, VkQueue presentQueue);
 
+		// The GPU time between the start and the end of the slot's last submission, it has to have completed.
+		// False when the slot doesn't measure it or wasn't submitted yet.
+		bool readGpuTime(VkDevice device, float timestampPeriod, uint32_t timestampValidBits, int64_t& gpuTime_us) const;
+
 		void waitOnAcquireFence(VkDevice device);
 		void resetAcquireFence(VkDevice device);
 
@@ -31,12 +36,20 @@ namespace Presentation
 	private:
 		bool m_isInitialized = false;
 
+		VkCommandPool m_pool;
 		VkCommandBuffer m_buffer;
 
 		VkSemaphore m_imageAvailableSemaphore;
 		VkSemaphore m_renderFinishedSemaphore;
 		VkFence m_inFlightFence;
 
-		bool initialize(VkDevice device, VkCommandPool pool);
+		// Two timestamps written by command buffers submitted before and after the frame's own
+		VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+		VkCommandBuffer m_timestampBegin = VK_NULL_HANDLE;
+		VkCommandBuffer m_timestampEnd = VK_NULL_HANDLE;
+		bool m_isTimestampWritten = false;
+
+		bool initialize(VkDevice device, VkCommandPool pool, bool measureGpuTime);
+		bool createGpuTimestamps(VkDevice device, VkCommandPool pool);
 	};
 }
\ No newline at end of file
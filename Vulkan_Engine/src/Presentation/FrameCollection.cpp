@@ -4,29 +4,48 @@
 
 namespace Presentation
 {
-	FrameCollection::FrameCollection(VkDevice device, VkCommandPool pool, uint32_t frameCount) :
-		m_device(device)
+	FrameCollection::FrameCollection(const Device& device, uint32_t framesInFlight) :
+		m_device(device.getDevice()), m_pool(device.getCommandPool()),
+		m_measureGpuTime(device.supportsTimestamps()), m_timestampPeriod(device.getTimestampPeriod()), m_timestampValidBits(device.getTimestampValidBits())
 	{
-		m_fullyInitialized = true;
-
-		m_frameCollection.reserve(frameCount);
-		for (uint32_t i = 0; i < frameCount; i++)
-		{
-			m_frameCollection.emplace_back(device, pool);
-			m_fullyInitialized &= m_frameCollection[i].isInitialized();
-		}
+		m_fullyInitialized = tryInitialize(m_timeline, device) &&
+			createFrames(framesInFlight);
 	}
 
-	Frame FrameCollection::getNextFrame()
+	bool FrameCollection::setFramesInFlight(uint32_t framesInFlight)
 	{
-		m_currentFrameIndex = (m_currentFrameIndex + 1u) % as_uint32(m_frameCollection.size());
-		return m_frameCollection[m_currentFrameIndex];
+		framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+		if (framesInFlight == getFramesInFlight())
+			return true;
+
+		// The slots of the old count may still be executing
+		vkDeviceWaitIdle(m_device);
+		m_timeline->markCompleted(m_timeline->getSubmittedValue());
+		m_timeline->collect();
+
+		releaseFrames();
+		return m_fullyInitialized = createFrames(framesInFlight);
 	}
 
-	Frame FrameCollection::getNextFrameAndWaitOnFence()
+	Frame& FrameCollection::getNextFrameAndWait()
 	{
-		auto frame = getNextFrame();
-		frame.waitOnAcquireFence(m_device);
+		m_currentFrameIndex = (m_currentFrameIndex + 1u) % getFramesInFlight();
+		auto& frame = m_frameCollection[m_currentFrameIndex];
+
+		const auto slotValue = m_submittedValues[m_currentFrameIndex];
+		if (m_timeline->getSemaphore() != VK_NULL_HANDLE)
+			m_timeline->wait(slotValue);
+		else
+		{
+			frame.waitOnAcquireFence(m_device);
+			m_timeline->markCompleted(slotValue);
+		}
+
+		int64_t gpuTime_us = 0;
+		if (frame.readGpuTime(m_device, m_timestampPeriod, m_timestampValidBits, gpuTime_us))
+			m_lastGpuTime_us = gpuTime_us;
+
+		m_timeline->collect();
 		return frame;
 	}
 
@@ -35,7 +54,44 @@ namespace Presentation
 		return vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_frameCollection[m_currentFrameIndex].getImageAvailableSemaphore(), VK_NULL_HANDLE, &imageIndex);
 	}
 
+	void FrameCollection::submit(VkQueue graphicsQueue)
+	{
+		auto& frame = m_frameCollection[m_currentFrameIndex];
+		const auto timeline = m_timeline->getSemaphore();
+		if (timeline == VK_NULL_HANDLE)
+			frame.resetAcquireFence(m_device);
+
+		const auto value = m_timeline->submit();
+		frame.submitToQueue(graphicsQueue, timeline, value);
+		m_submittedValues[m_currentFrameIndex] = value;
+	}
+
 	void FrameCollection::releaseFrameResources()
+	{
+		releaseFrames();
+		m_timeline->release(m_device);
+		m_fullyInitialized = false;
+	}
+
+	bool FrameCollection::createFrames(uint32_t framesInFlight)
+	{
+		framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+
+		auto fullyInitialized = true;
+		m_frameCollection.reserve(framesInFlight);
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			m_frameCollection.emplace_back(m_device, m_pool, m_measureGpuTime);
+			fullyInitialized &= m_frameCollection[i].isInitialized();
+		}
+
+		// Nothing was submitted from the new slots yet, value 0 has always completed
+		m_submittedValues.assign(framesInFlight, 0u);
+		m_currentFrameIndex = 0;
+		return fullyInitialized;
+	}
+
+	void FrameCollection::releaseFrames()
 	{
 		for (auto& frame : m_frameCollection)
 		{
@@ -43,7 +99,7 @@ namespace Presentation
 		}
 
 		m_frameCollection.clear();
+		m_submittedValues.clear();
 		m_currentFrameIndex = 0;
-		m_fullyInitialized = false;
 	}
-}
\ No newline at end of file
+}
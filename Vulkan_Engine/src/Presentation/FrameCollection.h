@@ -2,22 +2,34 @@
 #include "pch.h"
 #include "Presentation/Device.h"
 #include "Presentation/Frame.h"
+#include "Presentation/FrameTimeline.h"
 
 namespace Presentation
 {
+	// The frame slots recorded while earlier ones are still executing, between 1 and MAX_FRAMES_IN_FLIGHT independent of the swapchain images.
+	// A slot is recorded again once the timeline value of its last submission completed.
 	class FrameCollection : IRequireInitialization
 	{
 	public:
-		FrameCollection(VkDevice device, VkCommandPool pool, uint32_t frameCount = SWAPCHAIN_IMAGE_COUNT);
+		FrameCollection(const Device& device, uint32_t framesInFlight);
 
 		bool IRequireInitialization::isInitialized() const override { return m_fullyInitialized; }
 
-		uint32_t getImageCount() { return as_uint32(m_frameCollection.size()); }
+		uint32_t getFramesInFlight() const { return as_uint32(m_frameCollection.size()); }
+		// Waits for the device to be idle, every slot starts out free.
+		bool setFramesInFlight(uint32_t framesInFlight);
 
-		Frame getNextFrame();
-		Frame getNextFrameAndWaitOnFence();
+		// The slot of the frame being recorded, the per frame resources are indexed by it
+		uint32_t getFrameIndex() const { return m_currentFrameIndex; }
+		FrameTimeline& getTimeline() { return *m_timeline; }
+
+		// Moves on to the next slot and waits until its previous submission completed, then releases what the completed frames retired.
+		Frame& getNextFrameAndWait();
+		// The GPU time of the slot's previous submission, read once it completed. 0 without timestamp support.
+		int64_t getLastGpuTime_us() const { return m_lastGpuTime_us; }
 
 		VkResult acquireImageFromSwapchain(uint32_t& imageIndex, VkSwapchainKHR m_swapchain);
+		void submit(VkQueue graphicsQueue);
 
 		void releaseFrameResources();
 
@@ -25,7 +37,20 @@ namespace Presentation
 		bool m_fullyInitialized = false;
 
 		VkDevice m_device;
+		VkCommandPool m_pool;
+		UNQ<FrameTimeline> m_timeline;
+
+		bool m_measureGpuTime;
+		float m_timestampPeriod;
+		uint32_t m_timestampValidBits;
+		int64_t m_lastGpuTime_us = 0;
+
 		std::vector<Frame> m_frameCollection;
+		// The timeline value each slot was last submitted with
+		std::vector<uint64_t> m_submittedValues;
 		uint32_t m_currentFrameIndex = 0;
+
+		bool createFrames(uint32_t framesInFlight);
+		void releaseFrames();
 	};
-}
\ No newline at end of file
+}
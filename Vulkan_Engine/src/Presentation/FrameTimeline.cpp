@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "FrameTimeline.h"
+#include "Device.h"
+#include "VkTypes/InitializersUtility.h"
+
+namespace Presentation
+{
+	FrameTimeline::FrameTimeline(const Device& device)
+		: m_isInitialized(false), m_device(device.getDevice()), m_semaphore(VK_NULL_HANDLE),
+		m_waitSemaphores(device.getWaitSemaphores()), m_getSemaphoreCounterValue(device.getSemaphoreCounterValue()),
+		m_submittedValue(0u), m_completedValue(0u), m_deferred()
+	{
+		m_instance = this;
+
+		if (device.supportsTimelineSemaphore())
+			m_isInitialized = vkinit::Synchronization::createTimelineSemaphore(m_semaphore, m_device, 0u);
+		else
+		{
+			printf("VK_KHR_timeline_semaphore is not available, the frames are tracked by their fences.\n");
+			m_isInitialized = true;
+		}
+	}
+
+	FrameTimeline* FrameTimeline::getInstance() { return m_instance; }
+
+	uint64_t FrameTimeline::getCompletedValue()
+	{
+		if (m_semaphore != VK_NULL_HANDLE)
+		{
+			uint64_t value = 0u;
+			if (m_getSemaphoreCounterValue(m_device, m_semaphore, &value) == VK_SUCCESS)
+				m_completedValue = std::max(m_completedValue, value);
+		}
+
+		return m_completedValue;
+	}
+
+	uint64_t FrameTimeline::submit() { return ++m_submittedValue; }
+
+	void FrameTimeline::wait(uint64_t value)
+	{
+		if (m_semaphore == VK_NULL_HANDLE || value <= m_completedValue)
+			return;
+
+		VkSemaphoreWaitInfoKHR waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_semaphore;
+		waitInfo.pValues = &value;
+
+		if (m_waitSemaphores(m_device, &waitInfo, UINT64_MAX) == VK_SUCCESS)
+			m_completedValue = value;
+	}
+
+	void FrameTimeline::markCompleted(uint64_t value) { m_completedValue = std::max(m_completedValue, value); }
+
+	void FrameTimeline::defer(std::function<void()>&& release)
+	{
+		m_deferred.emplace_back(getRecordingValue(), std::move(release));
+	}
+
+	uint32_t FrameTimeline::collect()
+	{
+		if (m_deferred.empty())
+			return 0u;
+
+		// Deferred in the order of the frames, the completed ones are all at the front
+		const auto completed = getCompletedValue();
+		auto end = m_deferred.begin();
+		while (end != m_deferred.end() && end->first <= completed)
+		{
+			end->second();
+			++end;
+		}
+
+		const auto count = as_uint32(end - m_deferred.begin());
+		m_deferred.erase(m_deferred.begin(), end);
+		return count;
+	}
+
+	void FrameTimeline::release(VkDevice device)
+	{
+		for (auto& deferred : m_deferred)
+			deferred.second();
+		m_deferred.clear();
+
+		if (m_semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(device, m_semaphore, nullptr);
+		m_semaphore = VK_NULL_HANDLE;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "pch.h"
+#include "Interfaces/IRequireInitialization.h"
+
+namespace Presentation
+{
+	class Device;
+
+	// Numbers the submitted frames, the GPU signals the value of a frame once it has completed. A frame slot is reused once the value
+	// of its last submission completed, and resources still read by frames in flight are released once the frame they were retired in completed.
+	// Without VK_KHR_timeline_semaphore the fence of each frame slot stands in for the semaphore, the completed value then advances on the waits.
+	class FrameTimeline : IRequireInitialization
+	{
+	public:
+		FrameTimeline(const Device& device);
+		static FrameTimeline* getInstance();
+
+		bool isInitialized() const override { return m_isInitialized; }
+
+		// VK_NULL_HANDLE when the frames are tracked by their fences
+		VkSemaphore getSemaphore() const { return m_semaphore; }
+
+		// The value the frame being recorded signals once it completes
+		uint64_t getRecordingValue() const { return m_submittedValue + 1u; }
+		uint64_t getSubmittedValue() const { return m_submittedValue; }
+		uint64_t getCompletedValue();
+
+		// Called once the frame being recorded is submitted, returns its value
+		uint64_t submit();
+		// Blocks until the value completed, a semaphore timeline only.
+		void wait(uint64_t value);
+		// A fence of a frame with this value was waited on.
+		void markCompleted(uint64_t value);
+
+		// Runs the release once the GPU is done with the frame being recorded, and with every frame before it.
+		void defer(std::function<void()>&& release);
+		// Runs the releases of the completed frames. Returns how many ran.
+		uint32_t collect();
+
+		// The device has to be idle, every deferred release is run.
+		void release(VkDevice device);
+
+	private:
+		inline static FrameTimeline* m_instance = nullptr;
+		bool m_isInitialized;
+
+		VkDevice m_device;
+		VkSemaphore m_semaphore;
+		PFN_vkWaitSemaphoresKHR m_waitSemaphores;
+		PFN_vkGetSemaphoreCounterValueKHR m_getSemaphoreCounterValue;
+
+		uint64_t m_submittedValue;
+		uint64_t m_completedValue;
+
+		std::vector<std::pair<uint64_t, std::function<void()>>> m_deferred;
+	};
+}
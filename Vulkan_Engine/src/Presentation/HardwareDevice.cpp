@@ -10,6 +10,13 @@ namespace Presentation
 		m_isInitialized = pickPhysicalDevice(instance, surface);
 	}
 	
+	VkPhysicalDeviceProperties HardwareDevice::getProperties() const
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_chosenGPU, &properties);
+		return properties;
+	}
+
 	VkSurfaceFormatKHR HardwareDevice::chooseSwapSurfaceFormat() const
 	{
 		for (const auto& availableFormat : m_formats)
@@ -23,11 +30,11 @@ namespace Presentation
 		return m_formats[0];
 	}
 
-	VkPresentModeKHR HardwareDevice::chooseSwapPresentMode() const
+	VkPresentModeKHR HardwareDevice::chooseSwapPresentMode(VkPresentModeKHR requestedMode) const
 	{
 		for (const auto& availablePresentMode : m_presentModes)
 		{
-			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+			if (availablePresentMode == requestedMode)
 			{
 				return availablePresentMode;
 			}
@@ -12,9 +12,11 @@ namespace Presentation
 		bool IRequireInitialization::isInitialized() const override { return m_isInitialized; }
 
 		VkPhysicalDevice getActiveGPU() const { return m_chosenGPU; }
+		VkPhysicalDeviceProperties getProperties() const;
 
 		VkSurfaceFormatKHR chooseSwapSurfaceFormat() const;
-		VkPresentModeKHR chooseSwapPresentMode() const;
+		// FIFO is always available, it is used when the surface doesn't support the requested mode
+		VkPresentModeKHR chooseSwapPresentMode(VkPresentModeKHR requestedMode) const;
 
 	private:
 		bool m_isInitialized = false;
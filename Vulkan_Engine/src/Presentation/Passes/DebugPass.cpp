@@ -28,11 +28,12 @@ namespace Presentation
 			return;
 		}
 
-		const auto pool = DescriptorPoolManager::getInstance()->createNewPool(3u);
 		VkDescriptorSetLayout descriptorSetLayout = target.m_globalPipelineState->getDescriptorSetLayout(PipelineDescriptor::BindingSlots::Shadowmap);
 
 		m_isInitialized = vkinit::Texture::createTextureSampler(m_shadowmapSampler, device, 1u, true, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER) &&
-			vkinit::Descriptor::createDescriptorSets(m_shadowmapDescriptorSet, device, pool, descriptorSetLayout, displayTexture.imageView, m_shadowmapSampler);
+			DescriptorPoolManager::getInstance()->getPersistent().allocate(m_shadowmapDescriptorSet, descriptorSetLayout);
+		if (m_isInitialized)
+			vkinit::Descriptor::updateDescriptorSets(m_shadowmapDescriptorSet, device, displayTexture.imageView, m_shadowmapSampler);
 
 		if (!m_isInitialized)
 		{
@@ -46,7 +47,7 @@ namespace Presentation
 	const VkPipelineLayout DebugPass::getPipelineLayout() const { return m_debugQuad.m_pipelineLayout; }
 	const VkPipeline DebugPass::getPipeline() const { return m_debugQuad.m_pipeline; }
 
-	const VkDescriptorSet* DebugPass::getDescriptorSet(uint32_t frameNumber) { return &m_shadowmapDescriptorSet[frameNumber % SWAPCHAIN_IMAGE_COUNT]; }
+	const VkDescriptorSet* DebugPass::getDescriptorSet(uint32_t frameIndex) { return &m_shadowmapDescriptorSet[frameIndex % MAX_FRAMES_IN_FLIGHT]; }
 	
 	void DebugPass::release(VkDevice device)
 	{
@@ -23,7 +23,7 @@ namespace Presentation
 
 		const VkPipelineLayout getPipelineLayout() const;
 		const VkPipeline getPipeline() const;
-		const VkDescriptorSet* getDescriptorSet(uint32_t frameNumber);
+		const VkDescriptorSet* getDescriptorSet(uint32_t frameIndex);
 
 		void release(VkDevice device) override;
 
@@ -32,6 +32,6 @@ namespace Presentation
 		VkGraphicsPipeline m_debugQuad;
 
 		VkSampler m_shadowmapSampler;
-		std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT> m_shadowmapDescriptorSet;
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_shadowmapDescriptorSet;
 	};
 }
\ No newline at end of file
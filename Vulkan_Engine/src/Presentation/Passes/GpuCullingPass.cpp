@@ -0,0 +1,318 @@
+#include "pch.h"
+#include "GpuCullingPass.h"
+#include "VkTypes/InitializersUtility.h"
+#include "VkTypes/PipelineConstructor.h"
+#include "VkTypes/VkShader.h"
+#include "VkTypes/VkMemoryAllocator.h"
+#include "VkTypes/VkMesh.h"
+#include "VkTypes/VkMeshRenderer.h"
+#include "EngineCore/RenderQueue.h"
+#include "Math/BoundsAABB.h"
+#include "Math/Frustum.h"
+
+namespace Presentation
+{
+	namespace
+	{
+		// Matches CullBlock of gpucull.comp
+		struct CullConstants
+		{
+			std::array<glm::vec4, Frustum::EPlanes::Count> planes;
+			uint32_t objectCount;
+			uint32_t firstDraw;
+		};
+
+		uint32_t growCapacity(uint32_t capacity, uint32_t required)
+		{
+			capacity = std::max(capacity, 64u);
+			while (capacity < required)
+				capacity *= 2u;
+			return capacity;
+		}
+	}
+
+	GpuCulling::GpuCulling(VkDevice device, bool isEnabled)
+		: Pass(isEnabled), m_isInitialized(false), m_device(device),
+		m_cullShader(VK_NULL_HANDLE), m_cullSetLayout(VK_NULL_HANDLE), m_cullPipelineLayout(VK_NULL_HANDLE), m_cullPipeline(VK_NULL_HANDLE),
+		m_descriptorPool(VK_NULL_HANDLE), m_objects(), m_records(), m_groups(), m_buildVersion(0), m_maxGroupSize(0),
+		m_frames(), m_currentFrame(0), m_visibleCount(0)
+	{
+		m_isInitialized = createPipeline(device);
+
+		if (m_isInitialized)
+		{
+			const auto poolSize = VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5u * MAX_FRAMES_IN_FLIGHT };
+
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.poolSizeCount = 1;
+			poolInfo.pPoolSizes = &poolSize;
+			poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+			m_isInitialized = vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) == VK_SUCCESS;
+		}
+
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> cullSets{};
+		m_isInitialized = m_isInitialized && vkinit::Descriptor::createDescriptorSets(cullSets, device, m_descriptorPool, m_cullSetLayout);
+		for (size_t i = 0; i < m_frames.size() && m_isInitialized; i++)
+		{
+			m_frames[i].cullSet = cullSets[i];
+			m_isInitialized = allocateStats(m_frames[i]);
+		}
+
+		if (!m_isInitialized)
+		{
+			printf("Was not able to initialize the GPU culling pass.\n");
+			setActive(false);
+		}
+	}
+
+	GpuCulling::~GpuCulling() = default;
+
+	bool GpuCulling::isInitialized() const { return m_isInitialized; }
+
+	bool GpuCulling::createPipeline(VkDevice device)
+	{
+		if (!VkShader::loadShaderModule(m_cullShader, device, "gpucull.comp.spv"))
+			return false;
+
+		const std::array<VkDescriptorSetLayoutBinding, 5> cullBindings = {
+			vkinit::Compute::getBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+		};
+
+		if (!vkinit::Compute::createPipelineLayout(m_cullSetLayout, m_cullPipelineLayout, device, cullBindings.data(), as_uint32(cullBindings.size()), sizeof(CullConstants)))
+		{
+			printf("Could not create the GPU culling pipeline layout.\n");
+			return false;
+		}
+
+		if (!PipelineConstruction::createComputePipeline(m_cullPipeline, m_cullPipelineLayout, device, m_cullShader))
+		{
+			printf("Could not create the GPU culling compute pipeline.\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool GpuCulling::startFrame(uint32_t frameIndex, const RenderQueue& renderQueue, uint32_t maxGroupSize)
+	{
+		m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+		auto& frame = m_frames[m_currentFrame];
+
+		// GPU_TO_CPU memory doesn't have to be coherent
+		vmaInvalidateAllocation(allocator, frame.statsMemory, 0, sizeof(Stats));
+		m_visibleCount = frame.mappedStats->visibleCount;
+		*frame.mappedStats = Stats{};
+		vmaFlushAllocation(allocator, frame.statsMemory, 0, sizeof(Stats));
+
+		if (m_buildVersion != renderQueue.getBuildVersion() || m_maxGroupSize != maxGroupSize)
+			buildObjects(renderQueue, maxGroupSize);
+
+		if (!ensureCapacity(frame))
+			return false;
+
+		// The records only depend on the queue, every frame keeps its own copy as the previous one may still be read
+		if (frame.objectsVersion != m_buildVersion && !m_records.empty())
+		{
+			std::copy(m_records.begin(), m_records.end(), frame.mappedObjects);
+			vmaFlushAllocation(allocator, frame.objectsMemory, 0, m_records.size() * sizeof(ObjectRecord));
+		}
+		frame.objectsVersion = m_buildVersion;
+
+		return true;
+	}
+
+	void GpuCulling::buildObjects(const RenderQueue& renderQueue, uint32_t maxGroupSize)
+	{
+		m_objects.clear();
+		m_records.clear();
+		m_groups.clear();
+
+		// The queue is sorted by pipeline and mesh buffers, the objects of a group are already next to each other.
+		// Materials with sets of their own split the groups further, a group binds a single set.
+		for (const auto& renderer : renderQueue.getRenderers())
+		{
+			// Renderers without bounds are never visible, the ones without a submesh have nothing to draw
+			if (renderer.bounds == nullptr || renderer.submeshIndex >= renderer.mesh->submeshes.size())
+				continue;
+
+			const auto objectIndex = as_uint32(m_objects.size());
+			if (m_groups.empty() || renderer.variant->compare(m_groups.back().variant) != VariantStateChange::None || m_groups.back().buffers != renderer.mesh->buffers ||
+				m_groups.back().objectCount == maxGroupSize)
+			{
+				m_groups.push_back({ renderer.variant, renderer.mesh->buffers, objectIndex, 0u });
+			}
+			auto& group = m_groups.back();
+			group.objectCount += 1;
+
+			// The transforms the shader reads include the dequantization of the compact vertices, so do the bounds
+			const auto& range = renderer.mesh->submeshes[renderer.submeshIndex];
+			const auto bounds = renderer.mesh->positionRange.toQuantizedSpace(*renderer.bounds);
+			m_records.push_back({ bounds.center, as_uint32(m_groups.size() - 1), bounds.extents, group.firstObject,
+				range.indexCount, range.firstIndex, range.vertexOffset, 0u });
+			m_objects.push_back(&renderer);
+		}
+
+		m_buildVersion = renderQueue.getBuildVersion();
+		m_maxGroupSize = maxGroupSize;
+	}
+
+	void GpuCulling::recordCulling(VkCommandBuffer commandBuffer, VkBuffer transforms, VkBuffer indirectCommands, uint32_t firstDraw, const Frustum& frustum)
+	{
+		const auto objectCount = as_uint32(m_objects.size());
+		if (objectCount == 0)
+			return;
+
+		auto& frame = m_frames[m_currentFrame];
+
+		// The buffers of this frame may have been replaced since it was last recorded
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos = {
+			VkDescriptorBufferInfo{ frame.objects, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ transforms, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ indirectCommands, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ frame.counts, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ frame.stats, 0, VK_WHOLE_SIZE }
+		};
+
+		std::array<VkWriteDescriptorSet, 5> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.cullSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(m_device, as_uint32(writes.size()), writes.data(), 0, nullptr);
+
+		vkCmdFillBuffer(commandBuffer, frame.counts, 0, getCountOffset(as_uint32(m_groups.size())), 0u);
+		vkinit::Compute::memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		CullConstants constants{};
+		const auto& planes = frustum.getPlanes();
+		for (size_t i = 0; i < planes.size(); i++)
+			constants.planes[i] = glm::vec4(planes[i].getNormal(), planes[i].getDistance());
+		constants.objectCount = objectCount;
+		constants.firstDraw = firstDraw;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// Both the commands and the counts are read by the indirect draws
+		vkinit::Compute::memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	VkBuffer GpuCulling::getCountBuffer() const { return m_frames[m_currentFrame].counts; }
+
+	bool GpuCulling::ensureCapacity(FrameBuffers& frame)
+	{
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+		const auto objectCount = as_uint32(m_records.size());
+		const auto groupCount = as_uint32(m_groups.size());
+
+		// The previous submission using this frame's buffers has already completed, they can be replaced
+		if (objectCount > frame.objectCapacity)
+		{
+			const auto capacity = growCapacity(frame.objectCapacity, objectCount);
+			if (frame.objects != VK_NULL_HANDLE)
+				vmaDestroyBuffer(allocator, frame.objects, frame.objectsMemory);
+			frame.objectCapacity = 0;
+
+			void* mappedObjects = nullptr;
+			if (!vkinit::MemoryBuffer::allocateMappedBuffer(frame.objects, frame.objectsMemory, &mappedObjects, capacity * sizeof(ObjectRecord),
+				VMA_MEMORY_USAGE_CPU_TO_GPU, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+			{
+				printf("Could not grow the GPU culling object buffer to %u objects.\n", capacity);
+				return false;
+			}
+			frame.mappedObjects = static_cast<ObjectRecord*>(mappedObjects);
+			frame.objectCapacity = capacity;
+			frame.objectsVersion = 0;
+		}
+
+		if (groupCount > frame.countCapacity)
+		{
+			const auto capacity = growCapacity(frame.countCapacity, groupCount);
+			if (frame.counts != VK_NULL_HANDLE)
+				vmaDestroyBuffer(allocator, frame.counts, frame.countsMemory);
+			frame.countCapacity = 0;
+
+			if (!vkinit::MemoryBuffer::allocateMappedBuffer(frame.counts, frame.countsMemory, nullptr, getCountOffset(capacity), VMA_MEMORY_USAGE_GPU_ONLY,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+			{
+				printf("Could not grow the GPU culling draw count buffer to %u groups.\n", capacity);
+				return false;
+			}
+			frame.countCapacity = capacity;
+		}
+
+		return true;
+	}
+
+	bool GpuCulling::allocateStats(FrameBuffers& frame)
+	{
+		void* mappedStats = nullptr;
+		if (!vkinit::MemoryBuffer::allocateMappedBuffer(frame.stats, frame.statsMemory, &mappedStats, sizeof(Stats), VMA_MEMORY_USAGE_GPU_TO_CPU, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+			return false;
+
+		frame.mappedStats = static_cast<Stats*>(mappedStats);
+		*frame.mappedStats = Stats{};
+		vmaFlushAllocation(VkMemoryAllocator::getInstance()->m_allocator, frame.statsMemory, 0, sizeof(Stats));
+		return true;
+	}
+
+	void GpuCulling::releaseFrame(FrameBuffers& frame)
+	{
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+
+		if (frame.objects != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, frame.objects, frame.objectsMemory);
+		if (frame.counts != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, frame.counts, frame.countsMemory);
+		if (frame.stats != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, frame.stats, frame.statsMemory);
+
+		frame.objects = VK_NULL_HANDLE;
+		frame.counts = VK_NULL_HANDLE;
+		frame.stats = VK_NULL_HANDLE;
+		frame.mappedObjects = nullptr;
+		frame.mappedStats = nullptr;
+		frame.objectCapacity = 0;
+		frame.countCapacity = 0;
+		frame.objectsVersion = 0;
+	}
+
+	void GpuCulling::release(VkDevice device)
+	{
+		for (auto& frame : m_frames)
+			releaseFrame(frame);
+
+		m_objects.clear();
+		m_records.clear();
+		m_groups.clear();
+		m_buildVersion = 0;
+
+		vkDestroyPipeline(device, m_cullPipeline, nullptr);
+		vkDestroyPipelineLayout(device, m_cullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, m_cullSetLayout, nullptr);
+		vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+		vkDestroyShaderModule(device, m_cullShader, nullptr);
+
+		m_cullPipeline = VK_NULL_HANDLE;
+		m_cullPipelineLayout = VK_NULL_HANDLE;
+		m_cullSetLayout = VK_NULL_HANDLE;
+		m_descriptorPool = VK_NULL_HANDLE;
+		m_cullShader = VK_NULL_HANDLE;
+	}
+}
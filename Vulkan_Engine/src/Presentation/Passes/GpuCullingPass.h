@@ -0,0 +1,123 @@
+#pragma once
+#include "pch.h"
+#include "Presentation/Passes/Pass.h"
+#include "Interfaces/IRequireInitialization.h"
+
+class RenderQueue;
+struct Frustum;
+struct VkMeshRenderer;
+struct VkMaterialVariant;
+struct VkMeshBuffers;
+
+namespace Presentation
+{
+	// Frustum culling of the forward pass in a compute shader. Every drawable renderer is an object with its local bounds,
+	// the shader transforms them by the model matrix of the object and packs the commands of the survivors to the front
+	// of their group, a group being consecutive objects that share the pipeline and mesh buffers. Each group is
+	// then drawn with a single vkCmdDrawIndexedIndirectCount that reads its draw count from a buffer written by the shader.
+	class GpuCulling : public Pass, IRequireInitialization
+	{
+		static constexpr uint32_t CULL_GROUP_SIZE = 64u;
+
+	public:
+		// Matches ObjectRecord of gpucull.comp
+		struct ObjectRecord
+		{
+			glm::vec3 center;
+			uint32_t groupIndex;
+			glm::vec3 extents;
+			// Relative to the first draw of the pass, the commands of a group start at the command of its first object
+			uint32_t firstCommand;
+			uint32_t indexCount;
+			uint32_t firstIndex;
+			int32_t vertexOffset;
+			uint32_t padding;
+		};
+
+		struct DrawGroup
+		{
+			// The first of the group, the others only differ in their texture index
+			const VkMaterialVariant* variant;
+			const VkMeshBuffers* buffers;
+			uint32_t firstObject;
+			uint32_t objectCount;
+		};
+
+		GpuCulling(VkDevice device, bool isEnabled);
+		~GpuCulling();
+
+		bool isInitialized() const override;
+
+		// Reads back the visible count of the last submission of this frame, regroups the objects when the queue was rebuilt
+		// and uploads them to the buffers of this frame when they are stale. Groups never hold more than maxGroupSize objects.
+		bool startFrame(uint32_t frameIndex, const RenderQueue& renderQueue, uint32_t maxGroupSize);
+
+		// In the order of the objects, the transform of object i has to be written to the draw firstDraw + i.
+		const std::vector<const VkMeshRenderer*>& getObjects() const { return m_objects; }
+		const std::vector<DrawGroup>& getGroups() const { return m_groups; }
+		// Follows the render queue, the objects only change along with it
+		uint32_t getBuildVersion() const { return m_buildVersion; }
+
+		// Has to be recorded outside of a render pass, the draws of the groups have to follow it.
+		void recordCulling(VkCommandBuffer commandBuffer, VkBuffer transforms, VkBuffer indirectCommands, uint32_t firstDraw, const Frustum& frustum);
+
+		VkBuffer getCountBuffer() const;
+		static VkDeviceSize getCountOffset(uint32_t groupIndex) { return groupIndex * static_cast<VkDeviceSize>(sizeof(uint32_t)); }
+
+		// Counted on the GPU, it lags behind by the frames in flight.
+		uint32_t getVisibleCount() const { return m_visibleCount; }
+
+		virtual void release(VkDevice device) override;
+
+	private:
+		struct Stats
+		{
+			uint32_t visibleCount;
+		};
+
+		struct FrameBuffers
+		{
+			VkBuffer objects;
+			VmaAllocation objectsMemory;
+			ObjectRecord* mappedObjects;
+			uint32_t objectCapacity;
+			uint32_t objectsVersion;
+
+			VkBuffer counts;
+			VmaAllocation countsMemory;
+			uint32_t countCapacity;
+
+			VkBuffer stats;
+			VmaAllocation statsMemory;
+			Stats* mappedStats;
+
+			VkDescriptorSet cullSet;
+		};
+
+		bool m_isInitialized;
+		VkDevice m_device;
+
+		VkShaderModule m_cullShader;
+		VkDescriptorSetLayout m_cullSetLayout;
+		VkPipelineLayout m_cullPipelineLayout;
+		VkPipeline m_cullPipeline;
+		VkDescriptorPool m_descriptorPool;
+
+		// Rebuilt along with the render queue
+		std::vector<const VkMeshRenderer*> m_objects;
+		std::vector<ObjectRecord> m_records;
+		std::vector<DrawGroup> m_groups;
+		uint32_t m_buildVersion;
+		uint32_t m_maxGroupSize;
+
+		std::array<FrameBuffers, MAX_FRAMES_IN_FLIGHT> m_frames;
+		uint32_t m_currentFrame;
+		uint32_t m_visibleCount;
+
+		bool createPipeline(VkDevice device);
+		void buildObjects(const RenderQueue& renderQueue, uint32_t maxGroupSize);
+		bool allocateStats(FrameBuffers& frame);
+		bool ensureCapacity(FrameBuffers& frame);
+		void releaseFrame(FrameBuffers& frame);
+	};
+}
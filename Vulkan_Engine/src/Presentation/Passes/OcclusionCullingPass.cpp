@@ -0,0 +1,485 @@
+#include "pch.h"
+#include "OcclusionCullingPass.h"
+#include "VkTypes/InitializersUtility.h"
+#include "VkTypes/PipelineConstructor.h"
+#include "VkTypes/VkShader.h"
+#include "VkTypes/VkMemoryAllocator.h"
+#include "Presentation/FrameTimeline.h"
+
+namespace Presentation
+{
+	namespace
+	{
+		// Matches PyramidLevelBlock of depthpyramid.comp
+		struct PyramidConstants
+		{
+			glm::uvec2 inputSize;
+			glm::uvec2 outputSize;
+		};
+
+		// Matches OcclusionBlock of occlusion.comp
+		struct CullConstants
+		{
+			glm::mat4 viewProjection;
+			glm::vec4 pyramidSize;
+			uint32_t firstPhaseDraw;
+			uint32_t secondPhaseDraw;
+			uint32_t drawCount;
+			uint32_t phase;
+		};
+
+		uint32_t previousPowerOfTwo(uint32_t value)
+		{
+			uint32_t result = 1u;
+			while (result * 2u <= value)
+				result *= 2u;
+			return result;
+		}
+	}
+
+	OcclusionCulling::OcclusionCulling(VkDevice device, bool isEnabled)
+		: Pass(isEnabled), m_isInitialized(false), m_device(device),
+		m_pyramidShader(VK_NULL_HANDLE), m_cullShader(VK_NULL_HANDLE), m_pyramidSetLayout(VK_NULL_HANDLE), m_cullSetLayout(VK_NULL_HANDLE),
+		m_pyramidPipelineLayout(VK_NULL_HANDLE), m_cullPipelineLayout(VK_NULL_HANDLE), m_pyramidPipeline(VK_NULL_HANDLE), m_cullPipeline(VK_NULL_HANDLE),
+		m_descriptorPool(VK_NULL_HANDLE), m_pyramidDescriptorPool(VK_NULL_HANDLE), m_sampler(VK_NULL_HANDLE),
+		m_pyramid(VK_NULL_HANDLE), m_pyramidMemory(VK_NULL_HANDLE), m_pyramidView(VK_NULL_HANDLE), m_pyramidLevelViews(), m_pyramidSets(),
+		m_pyramidExtent(), m_pyramidLevelCount(0), m_depthView(VK_NULL_HANDLE), m_depthExtent(),
+		m_visibility(VK_NULL_HANDLE), m_visibilityMemory(VK_NULL_HANDLE), m_visibilityCapacity(0), m_isVisibilityCleared(false),
+		m_frames(), m_currentFrame(0), m_drawCount(0), m_firstPhaseDraw(0), m_secondPhaseDraw(0), m_occludedCount(0), m_lateVisibleCount(0)
+	{
+		m_isInitialized = createPipelines(device) &&
+			vkinit::Texture::createTextureSampler(m_sampler, device, MAX_PYRAMID_LEVELS, false, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+		if (m_isInitialized)
+		{
+			const std::array<VkDescriptorPoolSize, 2> poolSizes = {
+				VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4u * MAX_FRAMES_IN_FLIGHT },
+				VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT }
+			};
+			const std::array<VkDescriptorPoolSize, 2> pyramidPoolSizes = {
+				VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_PYRAMID_LEVELS },
+				VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_PYRAMID_LEVELS }
+			};
+
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.poolSizeCount = as_uint32(poolSizes.size());
+			poolInfo.pPoolSizes = poolSizes.data();
+			poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+			m_isInitialized = vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) == VK_SUCCESS;
+
+			poolInfo.poolSizeCount = as_uint32(pyramidPoolSizes.size());
+			poolInfo.pPoolSizes = pyramidPoolSizes.data();
+			poolInfo.maxSets = MAX_PYRAMID_LEVELS;
+			m_isInitialized = m_isInitialized && vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_pyramidDescriptorPool) == VK_SUCCESS;
+		}
+
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> cullSets{};
+		m_isInitialized = m_isInitialized && vkinit::Descriptor::createDescriptorSets(cullSets, device, m_descriptorPool, m_cullSetLayout);
+		for (size_t i = 0; i < m_frames.size() && m_isInitialized; i++)
+		{
+			m_frames[i].cullSet = cullSets[i];
+			m_isInitialized = allocateCounters(m_frames[i]);
+		}
+
+		if (!m_isInitialized)
+		{
+			printf("Was not able to initialize the occlusion culling pass.\n");
+			setActive(false);
+		}
+	}
+
+	OcclusionCulling::~OcclusionCulling() = default;
+
+	bool OcclusionCulling::isInitialized() const { return m_isInitialized; }
+
+	bool OcclusionCulling::createPipelines(VkDevice device)
+	{
+		if (!VkShader::loadShaderModule(m_pyramidShader, device, "depthpyramid.comp.spv") || !VkShader::loadShaderModule(m_cullShader, device, "occlusion.comp.spv"))
+			return false;
+
+		const std::array<VkDescriptorSetLayoutBinding, 2> pyramidBindings = {
+			vkinit::Compute::getBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+			vkinit::Compute::getBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+		};
+		const std::array<VkDescriptorSetLayoutBinding, 5> cullBindings = {
+			vkinit::Compute::getBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+			vkinit::Compute::getBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+		};
+
+		if (!vkinit::Compute::createPipelineLayout(m_pyramidSetLayout, m_pyramidPipelineLayout, device, pyramidBindings.data(), as_uint32(pyramidBindings.size()), sizeof(PyramidConstants)) ||
+			!vkinit::Compute::createPipelineLayout(m_cullSetLayout, m_cullPipelineLayout, device, cullBindings.data(), as_uint32(cullBindings.size()), sizeof(CullConstants)))
+		{
+			printf("Could not create the occlusion culling pipeline layouts.\n");
+			return false;
+		}
+
+		if (!PipelineConstruction::createComputePipeline(m_pyramidPipeline, m_pyramidPipelineLayout, device, m_pyramidShader) ||
+			!PipelineConstruction::createComputePipeline(m_cullPipeline, m_cullPipelineLayout, device, m_cullShader))
+		{
+			printf("Could not create the occlusion culling compute pipelines.\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool OcclusionCulling::startFrame(uint32_t frameIndex, uint32_t objectCount, VkImageView depthView, VkExtent2D depthExtent)
+	{
+		m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+		m_drawCount = 0;
+
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+		auto& frame = m_frames[m_currentFrame];
+
+		// GPU_TO_CPU memory doesn't have to be coherent
+		vmaInvalidateAllocation(allocator, frame.countersMemory, 0, sizeof(Counters));
+		m_occludedCount = frame.mappedCounters->occludedCount;
+		m_lateVisibleCount = frame.mappedCounters->lateVisibleCount;
+		*frame.mappedCounters = Counters{};
+		vmaFlushAllocation(allocator, frame.countersMemory, 0, sizeof(Counters));
+
+		if (objectCount > m_visibilityCapacity)
+		{
+			auto capacity = std::max(m_visibilityCapacity, 64u);
+			while (capacity < objectCount)
+				capacity *= 2u;
+
+			// The frames in flight may still read the old buffer, it is released once this frame completed
+			if (m_visibility != VK_NULL_HANDLE)
+			{
+				FrameTimeline::getInstance()->defer([allocator, buffer = m_visibility, memory = m_visibilityMemory]()
+				{
+					vmaDestroyBuffer(allocator, buffer, memory);
+				});
+			}
+
+			// Everything starts out occluded, the first frame draws it all in the second phase
+			if (!vkinit::MemoryBuffer::allocateMappedBuffer(m_visibility, m_visibilityMemory, nullptr, capacity * sizeof(uint32_t),
+				VMA_MEMORY_USAGE_GPU_ONLY, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+			{
+				printf("Could not grow the occlusion visibility buffer to %u renderers.\n", capacity);
+				m_visibilityCapacity = 0;
+				return false;
+			}
+			m_visibilityCapacity = capacity;
+			m_isVisibilityCleared = false;
+		}
+
+		if (objectCount > frame.capacity)
+		{
+			auto capacity = std::max(frame.capacity, 64u);
+			while (capacity < objectCount)
+				capacity *= 2u;
+
+			if (frame.bounds != VK_NULL_HANDLE)
+				vmaDestroyBuffer(allocator, frame.bounds, frame.boundsMemory);
+			frame.capacity = 0;
+
+			if (!allocateBounds(frame, capacity))
+			{
+				printf("Could not grow the occlusion bounds buffer to %u draws.\n", capacity);
+				return false;
+			}
+		}
+
+		return ensurePyramid(depthView, depthExtent);
+	}
+
+	OcclusionCulling::DrawBounds* OcclusionCulling::mapDrawBounds(uint32_t drawCount)
+	{
+		auto& frame = m_frames[m_currentFrame];
+		assert(drawCount <= frame.capacity);
+
+		m_drawCount = drawCount;
+		return frame.mappedBounds;
+	}
+
+	void OcclusionCulling::recordFirstPhase(VkCommandBuffer commandBuffer, VkBuffer indirectCommands, uint32_t firstPhaseDraw, uint32_t secondPhaseDraw)
+	{
+		m_firstPhaseDraw = firstPhaseDraw;
+		m_secondPhaseDraw = secondPhaseDraw;
+
+		auto& frame = m_frames[m_currentFrame];
+		vmaFlushAllocation(VkMemoryAllocator::getInstance()->m_allocator, frame.boundsMemory, 0, m_drawCount * sizeof(DrawBounds));
+
+		// The buffers of this frame may have been replaced since it was last recorded
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos = {
+			VkDescriptorBufferInfo{ frame.bounds, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ indirectCommands, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ m_visibility, 0, VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ frame.counters, 0, VK_WHOLE_SIZE }
+		};
+		VkDescriptorImageInfo pyramidInfo{ m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+
+		std::array<VkWriteDescriptorSet, 5> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.cullSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = i < bufferInfos.size() ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			if (i < bufferInfos.size())
+				writes[i].pBufferInfo = &bufferInfos[i];
+			else
+				writes[i].pImageInfo = &pyramidInfo;
+		}
+		vkUpdateDescriptorSets(m_device, as_uint32(writes.size()), writes.data(), 0, nullptr);
+
+		if (!m_isVisibilityCleared)
+		{
+			vkCmdFillBuffer(commandBuffer, m_visibility, 0, VK_WHOLE_SIZE, 0u);
+			m_isVisibilityCleared = true;
+		}
+
+		// The previous frame wrote the visibility in its second phase
+		vkinit::Compute::memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		// The content of the last pyramid is never read again, it only has to be in the layout the descriptors expect
+		VkImageMemoryBarrier pyramidBarrier{};
+		pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		pyramidBarrier.srcAccessMask = 0;
+		pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.image = m_pyramid;
+		pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevelCount, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+
+		dispatchCull(commandBuffer, glm::mat4(1.0f), 0u);
+
+		vkinit::Compute::memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	void OcclusionCulling::recordSecondPhase(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidPipeline);
+
+		VkImageMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.image = m_pyramid;
+
+		// Each level reduces the one above it, the first one reads the depth attachment
+		auto inputSize = glm::uvec2(m_depthExtent.width, m_depthExtent.height);
+		for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+		{
+			const auto outputSize = glm::uvec2(std::max(m_pyramidExtent.width >> level, 1u), std::max(m_pyramidExtent.height >> level, 1u));
+			const auto constants = PyramidConstants{ inputSize, outputSize };
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidPipelineLayout, 0, 1, &m_pyramidSets[level], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, m_pyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants), &constants);
+			vkCmdDispatch(commandBuffer, (outputSize.x + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (outputSize.y + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+
+			levelBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+			inputSize = outputSize;
+		}
+
+		dispatchCull(commandBuffer, viewProjection, 1u);
+
+		vkinit::Compute::memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	void OcclusionCulling::dispatchCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, uint32_t phase)
+	{
+		if (m_drawCount == 0)
+			return;
+
+		const auto& frame = m_frames[m_currentFrame];
+		const auto constants = CullConstants{ viewProjection,
+			glm::vec4(static_cast<float>(m_pyramidExtent.width), static_cast<float>(m_pyramidExtent.height), static_cast<float>(m_pyramidLevelCount), 0.0f),
+			m_firstPhaseDraw, m_secondPhaseDraw, m_drawCount, phase };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(commandBuffer, (m_drawCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	bool OcclusionCulling::ensurePyramid(VkImageView depthView, VkExtent2D depthExtent)
+	{
+		if (m_pyramid != VK_NULL_HANDLE && m_depthView == depthView && m_depthExtent.width == depthExtent.width && m_depthExtent.height == depthExtent.height)
+			return true;
+
+		// Only happens along with the swapchain, after waiting for the device to be idle
+		releasePyramid();
+
+		m_pyramidExtent = { previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height) };
+		m_pyramidLevelCount = 1u;
+		while (m_pyramidLevelCount < MAX_PYRAMID_LEVELS && (std::max(m_pyramidExtent.width, m_pyramidExtent.height) >> m_pyramidLevelCount) != 0)
+			m_pyramidLevelCount++;
+
+		const auto maci = VkMemoryAllocator::getInstance()->createAllocationDescriptor(VMA_MEMORY_USAGE_GPU_ONLY, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!vkinit::Texture::createImage(m_pyramid, m_pyramidMemory, maci, PYRAMID_FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				m_pyramidExtent.width, m_pyramidExtent.height, m_pyramidLevelCount) ||
+			!vkinit::Texture::createTextureImageView(m_pyramidView, m_device, m_pyramid, PYRAMID_FORMAT, m_pyramidLevelCount))
+		{
+			printf("Could not create the depth pyramid.\n");
+			return false;
+		}
+
+		VkImageViewCreateInfo levelViewInfo{};
+		levelViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		levelViewInfo.image = m_pyramid;
+		levelViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		levelViewInfo.format = PYRAMID_FORMAT;
+		for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+		{
+			levelViewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			if (vkCreateImageView(m_device, &levelViewInfo, nullptr, &m_pyramidLevelViews[level]) != VK_SUCCESS)
+			{
+				printf("Could not create the view of depth pyramid level %u.\n", level);
+				return false;
+			}
+		}
+
+		std::array<VkDescriptorSetLayout, MAX_PYRAMID_LEVELS> setLayouts;
+		setLayouts.fill(m_pyramidSetLayout);
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_pyramidDescriptorPool;
+		allocInfo.descriptorSetCount = m_pyramidLevelCount;
+		allocInfo.pSetLayouts = setLayouts.data();
+		if (vkAllocateDescriptorSets(m_device, &allocInfo, m_pyramidSets.data()) != VK_SUCCESS)
+		{
+			printf("Could not allocate the depth pyramid descriptor sets.\n");
+			return false;
+		}
+
+		for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+		{
+			const auto inputInfo = level == 0 ?
+				VkDescriptorImageInfo{ m_sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } :
+				VkDescriptorImageInfo{ m_sampler, m_pyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+			const auto outputInfo = VkDescriptorImageInfo{ VK_NULL_HANDLE, m_pyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+			std::array<VkWriteDescriptorSet, 2> writes{};
+			for (uint32_t i = 0; i < writes.size(); i++)
+			{
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = m_pyramidSets[level];
+				writes[i].dstBinding = i;
+				writes[i].descriptorCount = 1;
+			}
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].pImageInfo = &inputInfo;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].pImageInfo = &outputInfo;
+			vkUpdateDescriptorSets(m_device, as_uint32(writes.size()), writes.data(), 0, nullptr);
+		}
+
+		m_depthView = depthView;
+		m_depthExtent = depthExtent;
+		return true;
+	}
+
+	void OcclusionCulling::releasePyramid()
+	{
+		for (auto& view : m_pyramidLevelViews)
+		{
+			if (view != VK_NULL_HANDLE)
+				vkDestroyImageView(m_device, view, nullptr);
+			view = VK_NULL_HANDLE;
+		}
+
+		if (m_pyramidView != VK_NULL_HANDLE)
+			vkDestroyImageView(m_device, m_pyramidView, nullptr);
+		if (m_pyramid != VK_NULL_HANDLE)
+			vmaDestroyImage(VkMemoryAllocator::getInstance()->m_allocator, m_pyramid, m_pyramidMemory);
+
+		if (m_pyramidDescriptorPool != VK_NULL_HANDLE)
+			vkResetDescriptorPool(m_device, m_pyramidDescriptorPool, 0);
+
+		m_pyramidView = VK_NULL_HANDLE;
+		m_pyramid = VK_NULL_HANDLE;
+		m_pyramidMemory = VK_NULL_HANDLE;
+		m_depthView = VK_NULL_HANDLE;
+		m_pyramidLevelCount = 0;
+	}
+
+	bool OcclusionCulling::allocateCounters(FrameBuffers& frame)
+	{
+		void* mappedCounters = nullptr;
+		if (!vkinit::MemoryBuffer::allocateMappedBuffer(frame.counters, frame.countersMemory, &mappedCounters, sizeof(Counters), VMA_MEMORY_USAGE_GPU_TO_CPU, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+			return false;
+
+		frame.mappedCounters = static_cast<Counters*>(mappedCounters);
+		*frame.mappedCounters = Counters{};
+		vmaFlushAllocation(VkMemoryAllocator::getInstance()->m_allocator, frame.countersMemory, 0, sizeof(Counters));
+		return true;
+	}
+
+	bool OcclusionCulling::allocateBounds(FrameBuffers& frame, uint32_t capacity)
+	{
+		void* mappedBounds = nullptr;
+		if (!vkinit::MemoryBuffer::allocateMappedBuffer(frame.bounds, frame.boundsMemory, &mappedBounds, capacity * sizeof(DrawBounds), VMA_MEMORY_USAGE_CPU_TO_GPU, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+			return false;
+
+		frame.mappedBounds = static_cast<DrawBounds*>(mappedBounds);
+		frame.capacity = capacity;
+		return true;
+	}
+
+	void OcclusionCulling::releaseFrame(FrameBuffers& frame)
+	{
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+
+		if (frame.bounds != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, frame.bounds, frame.boundsMemory);
+		if (frame.counters != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, frame.counters, frame.countersMemory);
+
+		frame.bounds = VK_NULL_HANDLE;
+		frame.counters = VK_NULL_HANDLE;
+		frame.mappedBounds = nullptr;
+		frame.mappedCounters = nullptr;
+		frame.capacity = 0;
+	}
+
+	void OcclusionCulling::release(VkDevice device)
+	{
+		const auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
+
+		for (auto& frame : m_frames)
+			releaseFrame(frame);
+
+		if (m_visibility != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, m_visibility, m_visibilityMemory);
+		m_visibility = VK_NULL_HANDLE;
+		m_visibilityCapacity = 0;
+
+		releasePyramid();
+
+		vkDestroyPipeline(device, m_pyramidPipeline, nullptr);
+		vkDestroyPipeline(device, m_cullPipeline, nullptr);
+		vkDestroyPipelineLayout(device, m_pyramidPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(device, m_cullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, m_pyramidSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, m_cullSetLayout, nullptr);
+		vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+		vkDestroyDescriptorPool(device, m_pyramidDescriptorPool, nullptr);
+		vkDestroyShaderModule(device, m_pyramidShader, nullptr);
+		vkDestroyShaderModule(device, m_cullShader, nullptr);
+		vkDestroySampler(device, m_sampler, nullptr);
+
+		m_pyramidDescriptorPool = VK_NULL_HANDLE;
+		m_descriptorPool = VK_NULL_HANDLE;
+	}
+}
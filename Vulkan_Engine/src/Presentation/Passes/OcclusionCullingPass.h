@@ -0,0 +1,122 @@
+#pragma once
+#include "pch.h"
+#include "Presentation/Passes/Pass.h"
+#include "Interfaces/IRequireInitialization.h"
+
+namespace Presentation
+{
+	// Two phase occlusion culling of the forward pass on the GPU. The first phase draws what passed the test last frame,
+	// its depth is reduced into a hierarchical max depth pyramid, then every draw is tested against it and the second phase
+	// draws only the ones that turned visible. Both phases take the same draws in the same order, the compute shaders
+	// zero the instance count of the indirect commands that are culled.
+	class OcclusionCulling : public Pass, IRequireInitialization
+	{
+		static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+		static constexpr uint32_t MAX_PYRAMID_LEVELS = 16u;
+		static constexpr uint32_t PYRAMID_GROUP_SIZE = 8u;
+		static constexpr uint32_t CULL_GROUP_SIZE = 64u;
+
+	public:
+		// Matches DrawBounds of occlusion.comp
+		struct DrawBounds
+		{
+			glm::vec3 center;
+			uint32_t objectIndex;
+			glm::vec3 extents;
+			uint32_t padding;
+		};
+
+		OcclusionCulling(VkDevice device, bool isEnabled);
+		~OcclusionCulling();
+
+		bool isInitialized() const override;
+
+		// Reads back the counters of the last submission of this frame, which has completed by now, grows the buffers
+		// to one entry per renderer and rebuilds the pyramid when the depth attachment changed. Culling is skipped on failure.
+		bool startFrame(uint32_t frameIndex, uint32_t objectCount, VkImageView depthView, VkExtent2D depthExtent);
+		// The world bounds and renderer index of each draw, in the order of both phases, at most objectCount of them.
+		DrawBounds* mapDrawBounds(uint32_t drawCount);
+
+		// Enables the draws of the first phase that were visible last frame, disables every draw of the second phase.
+		// Has to be recorded before the first phase render pass, which leaves the depth ready to be read by compute shaders.
+		void recordFirstPhase(VkCommandBuffer commandBuffer, VkBuffer indirectCommands, uint32_t firstPhaseDraw, uint32_t secondPhaseDraw);
+		// Builds the depth pyramid from the first phase depth and enables the draws of the second phase that are no longer occluded.
+		void recordSecondPhase(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+
+		// Counted on the GPU, they lag behind by the frames in flight.
+		uint32_t getOccludedCount() const { return m_occludedCount; }
+		uint32_t getLateVisibleCount() const { return m_lateVisibleCount; }
+
+		virtual void release(VkDevice device) override;
+
+	private:
+		struct Counters
+		{
+			uint32_t occludedCount;
+			uint32_t lateVisibleCount;
+		};
+
+		struct FrameBuffers
+		{
+			VkBuffer bounds;
+			VmaAllocation boundsMemory;
+			DrawBounds* mappedBounds;
+			uint32_t capacity;
+
+			VkBuffer counters;
+			VmaAllocation countersMemory;
+			Counters* mappedCounters;
+
+			VkDescriptorSet cullSet;
+		};
+
+		bool m_isInitialized;
+		VkDevice m_device;
+
+		VkShaderModule m_pyramidShader;
+		VkShaderModule m_cullShader;
+		VkDescriptorSetLayout m_pyramidSetLayout;
+		VkDescriptorSetLayout m_cullSetLayout;
+		VkPipelineLayout m_pyramidPipelineLayout;
+		VkPipelineLayout m_cullPipelineLayout;
+		VkPipeline m_pyramidPipeline;
+		VkPipeline m_cullPipeline;
+		VkDescriptorPool m_descriptorPool;
+		VkDescriptorPool m_pyramidDescriptorPool;
+		VkSampler m_sampler;
+
+		// Rebuilt when the depth attachment changes, level 0 is the depth extent rounded down to a power of two
+		VkImage m_pyramid;
+		VmaAllocation m_pyramidMemory;
+		VkImageView m_pyramidView;
+		std::array<VkImageView, MAX_PYRAMID_LEVELS> m_pyramidLevelViews;
+		std::array<VkDescriptorSet, MAX_PYRAMID_LEVELS> m_pyramidSets;
+		VkExtent2D m_pyramidExtent;
+		uint32_t m_pyramidLevelCount;
+		VkImageView m_depthView;
+		VkExtent2D m_depthExtent;
+
+		// One entry per renderer, shared by every frame like the depth attachment it is tested against
+		VkBuffer m_visibility;
+		VmaAllocation m_visibilityMemory;
+		uint32_t m_visibilityCapacity;
+		bool m_isVisibilityCleared;
+
+		std::array<FrameBuffers, MAX_FRAMES_IN_FLIGHT> m_frames;
+		uint32_t m_currentFrame;
+		uint32_t m_drawCount;
+		uint32_t m_firstPhaseDraw;
+		uint32_t m_secondPhaseDraw;
+
+		uint32_t m_occludedCount;
+		uint32_t m_lateVisibleCount;
+
+		bool createPipelines(VkDevice device);
+		bool allocateCounters(FrameBuffers& frame);
+		bool allocateBounds(FrameBuffers& frame, uint32_t capacity);
+		void releaseFrame(FrameBuffers& frame);
+		bool ensurePyramid(VkImageView depthView, VkExtent2D depthExtent);
+		void releasePyramid();
+		void dispatchCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, uint32_t phase);
+	};
+}
@@ -16,10 +16,13 @@
 
 namespace Presentation
 {
-	ShadowMap::ShadowMap(PresentationTarget& target, VkDevice device, VkPipelineLayout depthOnlyPipelineLayout, bool isEnabled, uint32_t dimensionsXY) : Pass(isEnabled),
+	ShadowMap::ShadowMap(PresentationTarget& target, VkDevice device, VkPipelineLayout depthOnlyPipelineLayout, bool isEnabled, uint32_t dimensionsXY, bool depthClamp) : Pass(isEnabled),
 		m_dimensionsXY(std::clamp(dimensionsXY, MIN_SHADOWMAP_DIMENSION, MAX_SHADOWMAP_DIMENSION)),
-		m_renderPass(), m_frameBuffer(), m_isInitialized(false),
+		m_renderPass(), m_frameBuffer(), m_isDepthClamped(depthClamp), m_isInitialized(false),
 		m_shadowMap(VkTexture2D::createTexture(device, m_dimensionsXY, m_dimensionsXY, FORMAT, USAGE_FLAGS, VIEW_IMAGE_ASPECT_FLAGS)),
+		m_cache(VkTexture::createTexture(device, m_dimensionsXY, m_dimensionsXY, FORMAT, CACHE_USAGE_FLAGS, VIEW_IMAGE_ASPECT_FLAGS)),
+		m_cacheRenderPass(), m_cacheFrameBuffer(), m_compositeRenderPass(),
+		m_cachedLightViewProjection(), m_cachedStaticStateVersion(0), m_isCacheValid(false), m_isMatchingCache(false), m_cacheHits(0), m_cacheMisses(0),
 		m_replacementShader(), m_replacementMaterial()
 	{
 		m_extent = {};
@@ -41,18 +44,24 @@ namespace Presentation
 			m_isInitialized &= vkinit::Surface::createFrameBuffer(fb, device, m_renderPass, m_extent, imageViews, 1u);
 		}
 
+		// The composite pass is compatible with the main one, so it renders through the same framebuffers
+		std::array<VkImageView, SWAPCHAIN_IMAGE_COUNT> cacheImageViews{
+			m_cache.imageView
+		};
+		m_isInitialized &= m_cache.isValid() &&
+			vkinit::Surface::createDepthRenderPass(m_cacheRenderPass, device, false, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) &&
+			vkinit::Surface::createDepthRenderPass(m_compositeRenderPass, device, true, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) &&
+			vkinit::Surface::createFrameBuffer(m_cacheFrameBuffer, device, m_cacheRenderPass, m_extent, cacheImageViews, 1u);
+
 		m_replacementShader = VkShader::findShader(1u);
 		if (m_replacementShader && PipelineConstruction::createPipeline(m_replacementMaterial.m_pipeline, depthOnlyPipelineLayout, device,
-			getRenderPass(), getExtent(), *m_replacementShader, &Mesh::defaultMeshDescriptor, PipelineConstruction::FaceCulling::Front, true))
+			getRenderPass(), getExtent(), *m_replacementShader, &Mesh::defaultMeshDescriptor, PipelineConstruction::FaceCulling::Front, true, m_isDepthClamped))
 		{
 			target.m_globalPipelineState->insertGraphicsPipelineFor(m_replacementShader, m_replacementMaterial);
 		}
 		else m_isInitialized = false;
 
-		{
-			auto pool = DescriptorPoolManager::getInstance()->createNewPool(3u);
-			m_isInitialized &= target.createGraphicsMaterial(m_shadowMapMaterial, device, pool, VkShader::findShader(0u), &m_shadowMap);
-		}
+		m_isInitialized &= target.createGraphicsMaterial(m_shadowMapMaterial, device, DescriptorPoolManager::getInstance()->getPersistent(), VkShader::findShader(0u), &m_shadowMap);
 
 		if (!m_isInitialized)
 		{
@@ -68,14 +77,83 @@ namespace Presentation
 	const VkRect2D& ShadowMap::getScissorRect() const { return m_scissorRect; }
 	const VkExtent2D ShadowMap::getExtent() const { return m_extent; }
 	const VkRenderPass ShadowMap::getRenderPass() const { return m_renderPass; }
-	const VkFramebuffer ShadowMap::getFrameBuffer(uint32_t frameNumber) const { return m_frameBuffer[frameNumber % SWAPCHAIN_IMAGE_COUNT]; }
+	const VkFramebuffer ShadowMap::getFrameBuffer(uint32_t frameIndex) const { return m_frameBuffer[frameIndex % MAX_FRAMES_IN_FLIGHT]; }
 	const VkTexture2D& ShadowMap::getTexture2D() const { return m_shadowMap; }
 	const VkMaterialVariant& ShadowMap::getMaterialVariant() const { return m_shadowMapMaterial->getMaterialVariant(); }
 	VkFormat ShadowMap::getFormat() const { return FORMAT; }
+	bool ShadowMap::isDepthClamped() const { return m_isDepthClamped; }
+	const VkRenderPass ShadowMap::getCacheRenderPass() const { return m_cacheRenderPass; }
+	const VkFramebuffer ShadowMap::getCacheFrameBuffer() const { return m_cacheFrameBuffer; }
+	const VkRenderPass ShadowMap::getCompositeRenderPass() const { return m_compositeRenderPass; }
+
+	bool ShadowMap::tryHitCache(const glm::mat4& lightViewProjection, uint32_t staticStateVersion)
+	{
+		const auto isHit = m_isCacheValid && m_cachedStaticStateVersion == staticStateVersion && m_cachedLightViewProjection == lightViewProjection;
+		if (isHit)
+		{
+			m_cacheHits += 1;
+			return true;
+		}
+
+		m_cachedLightViewProjection = lightViewProjection;
+		m_cachedStaticStateVersion = staticStateVersion;
+		m_isCacheValid = true;
+		m_cacheMisses += 1;
+		return false;
+	}
+
+	void ShadowMap::copyFromCache(VkCommandBuffer commandBuffer) const
+	{
+		VkImageMemoryBarrier barriers[2]{};
+		for (auto& barrier : barriers)
+		{
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0u, 1u, 0u, 1u };
+		}
+
+		// The cache pass left it in the transfer layout, only its writes have to be made visible
+		barriers[0].image = m_cache.image;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		// The previous contents are overwritten whole
+		barriers[1].image = m_shadowMap.image;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 2u, barriers);
+
+		VkImageCopy region{};
+		region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0u, 0u, 1u };
+		region.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0u, 0u, 1u };
+		region.extent = { m_extent.width, m_extent.height, 1u };
+		vkCmdCopyImage(commandBuffer, m_cache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_shadowMap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1u, &region);
+
+		auto& toAttachment = barriers[1];
+		toAttachment.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toAttachment.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		toAttachment.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toAttachment.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			0, 0, nullptr, 0, nullptr, 1u, &toAttachment);
+	}
 
 	void ShadowMap::release(VkDevice device)
 	{
 		m_shadowMap.release(device);
+		m_cache.release(device);
+
+		vkDestroyFramebuffer(device, m_cacheFrameBuffer, nullptr);
+		vkDestroyRenderPass(device, m_cacheRenderPass, nullptr);
+		vkDestroyRenderPass(device, m_compositeRenderPass, nullptr);
 
 		for (auto& fb : m_frameBuffer)
 		{
@@ -98,12 +176,11 @@ namespace Presentation
 		auto texBytes = LoadedTexture(pixels, sizeof(pixels), w, h);
 		auto tex = Texture({ texBytes }, f, w, h, ch);
 
-		StagingBufferPool buffer{};
+		StagingBufferPool buffer(&device);
 		VkTexture2D::tryCreateTexture(m_texture, tex, &device, buffer);
 		buffer.releaseAllResources();
 
-		auto pool = DescriptorPoolManager::getInstance()->createNewPool(SWAPCHAIN_IMAGE_COUNT);
-		target.createGraphicsMaterial(m_shadowMapMaterial, device.getDevice(), pool, shader, m_texture.get());
+		target.createGraphicsMaterial(m_shadowMapMaterial, device.getDevice(), DescriptorPoolManager::getInstance()->getPersistent(), shader, m_texture.get());
 	}
 	EmptyShadowMap::~EmptyShadowMap() = default;
 	const VkMaterialVariant& EmptyShadowMap::getMaterialVariant() const { return m_shadowMapMaterial->getMaterialVariant(); }
@@ -19,11 +19,12 @@ namespace Presentation
 		static constexpr uint32_t MAX_SHADOWMAP_DIMENSION = 2048u;
 
 		static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
-		static constexpr VkImageUsageFlagBits USAGE_FLAGS = static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		static constexpr VkImageUsageFlagBits USAGE_FLAGS = static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+		static constexpr VkImageUsageFlagBits CACHE_USAGE_FLAGS = static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 		static constexpr VkImageAspectFlagBits VIEW_IMAGE_ASPECT_FLAGS = VK_IMAGE_ASPECT_DEPTH_BIT;
 
 	public:
-		ShadowMap(PresentationTarget& target, VkDevice device, VkPipelineLayout depthOnlyPipelineLayout, bool isEnabled, uint32_t dimensionsXY);
+		ShadowMap(PresentationTarget& target, VkDevice device, VkPipelineLayout depthOnlyPipelineLayout, bool isEnabled, uint32_t dimensionsXY, bool depthClamp = false);
 		~ShadowMap();
 
 		bool isInitialized() const override;
@@ -31,10 +32,30 @@ namespace Presentation
 		const VkRect2D& getScissorRect() const;
 		const VkExtent2D getExtent() const;
 		const VkRenderPass getRenderPass() const;
-		const VkFramebuffer getFrameBuffer(uint32_t frameNumber) const;
+		const VkFramebuffer getFrameBuffer(uint32_t frameIndex) const;
 		const VkTexture2D& getTexture2D() const;
 		const VkMaterialVariant& getMaterialVariant() const;
 		VkFormat getFormat() const;
+		// Casters in front of the near plane still write depth, so they don't have to be culled by it.
+		bool isDepthClamped() const;
+
+		// The static casters are rendered into a cache that is only refreshed when the light or the static renderers change,
+		// frames with dynamic casters copy it into the shadow map and draw them on top with the composite pass.
+		const VkRenderPass getCacheRenderPass() const;
+		const VkFramebuffer getCacheFrameBuffer() const;
+		const VkRenderPass getCompositeRenderPass() const;
+
+		// Returns false when the static casters have to be rendered into the cache again, counts a hit or a miss.
+		bool tryHitCache(const glm::mat4& lightViewProjection, uint32_t staticStateVersion);
+		// Copies the cached depth into the shadow map and leaves it ready for the composite pass.
+		void copyFromCache(VkCommandBuffer commandBuffer) const;
+
+		// Whether the shadow map holds exactly the cached depth, nothing drawn on top and nothing missing.
+		bool isMatchingCache() const { return m_isMatchingCache; }
+		void setMatchingCache(bool isMatchingCache) { m_isMatchingCache = isMatchingCache; }
+
+		size_t getCacheHits() const { return m_cacheHits; }
+		size_t getCacheMisses() const { return m_cacheMisses; }
 
 		virtual void release(VkDevice device) override;
 
@@ -47,12 +68,25 @@ namespace Presentation
 		UNQ<VkMaterial> m_shadowMapMaterial;
 
 		VkRenderPass m_renderPass;
-		std::array<VkFramebuffer, SWAPCHAIN_IMAGE_COUNT> m_frameBuffer;
+		std::array<VkFramebuffer, MAX_FRAMES_IN_FLIGHT> m_frameBuffer;
 
 		VkViewport m_viewport;
 		VkRect2D m_scissorRect;
 		VkExtent2D m_extent;
 
+		VkTexture m_cache;
+		VkRenderPass m_cacheRenderPass;
+		VkFramebuffer m_cacheFrameBuffer;
+		VkRenderPass m_compositeRenderPass;
+
+		glm::mat4 m_cachedLightViewProjection;
+		uint32_t m_cachedStaticStateVersion;
+		bool m_isCacheValid;
+		bool m_isMatchingCache;
+		size_t m_cacheHits;
+		size_t m_cacheMisses;
+
+		bool m_isDepthClamped;
 		bool m_isInitialized;
 	};
 
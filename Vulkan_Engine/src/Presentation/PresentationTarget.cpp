@@ -17,27 +17,45 @@
 
 #include "Passes/ShadowmapPass.h"
 #include "Passes/DebugPass.h"
+#include "Passes/OcclusionCullingPass.h"
+#include "Passes/GpuCullingPass.h"
+#include "SecondaryCommandPools.h"
 
 namespace Presentation
 {
 	PresentationTarget::PresentationTarget(const HardwareDevice& presentationHardware, const Device& presentationDevice, Window const* wnd, bool depthAttachment, uint32_t swapchainCount)
-		: m_window(wnd), m_hasDepthAttachment(depthAttachment)
+		: m_window(wnd), m_hasDepthAttachment(depthAttachment),
+		m_supportsIndirectDraw(presentationDevice.supportsIndirectFirstInstance()), m_maxDrawIndirectCount(presentationDevice.getMaxDrawIndirectCount()),
+		m_useTextureTable(presentationDevice.supportsSampledImageArrayDynamicIndexing()), m_drawIndexedIndirectCount(presentationDevice.getDrawIndexedIndirectCount())
 	{
+		// One sampler of the fragment stage is left for the shadow map, without the table the set only holds the texture of one material
+		const auto textureCapacity = m_useTextureTable ? std::min(TextureTable::c_maxCapacity, presentationDevice.getMaxBoundTextures() - 1u) : 1u;
 		m_isInitialized = createPresentationTarget(presentationHardware, presentationDevice, swapchainCount) &&
-			tryInitialize(m_globalPipelineState, presentationDevice.getDevice());
+			tryInitialize(m_globalPipelineState, presentationDevice.getDevice(), textureCapacity,
+				presentationDevice.getMinUniformBufferOffsetAlignment()) &&
+			tryInitialize(m_secondaryCommandPools, presentationDevice.getDevice(), presentationDevice.getQueueFamilyIndices().graphicsFamily.value(), FrameSettings::c_maxRecordingThreads);
 		
 		// Initialize default shaders
-		VkShader::ensureDefaultShader(presentationDevice.getDevice());
+		VkShader::ensureDefaultShader(presentationDevice.getDevice(), m_useTextureTable);
 		
 		m_emptyShadowMap = MAKEUNQ<EmptyShadowMap>(*this, presentationDevice, VkShader::findShader(0u));
 
 		// Creates the pipeline, but doesn't manage its lifetime
-		m_shadowMapModule = MAKEUNQ<ShadowMap>(*this, presentationDevice.getDevice(), m_globalPipelineState->getDepthOnlyPipelineLayout(), true, 2048u);
+		m_shadowMapModule = MAKEUNQ<ShadowMap>(*this, presentationDevice.getDevice(), m_globalPipelineState->getDepthOnlyPipelineLayout(), true, 2048u,
+			presentationDevice.supportsDepthClamp());
 
 		const auto* debugQuadShader = VkShader::findShader(2u);
 		// Creates the pipeline, but doesn't manage its lifetime
 		m_debugModule = MAKEUNQ<DebugPass>(*this, presentationDevice.getDevice(), debugQuadShader, m_globalPipelineState->getForwardPipelineLayout(), 
 			getRenderPass(), getSwapchainExtent(), m_shadowMapModule->getTexture2D());
+
+		m_occlusionModule = MAKEUNQ<OcclusionCulling>(presentationDevice.getDevice(), m_supportsIndirectDraw && hasDepthAttachement());
+
+		// Each group of culled draws goes out as a single indirect draw with its count read from a buffer
+		const auto supportsGpuCulling = m_supportsIndirectDraw && presentationDevice.supportsMultiDrawIndirect() && presentationDevice.supportsDrawIndirectCount();
+		m_gpuCullingModule = MAKEUNQ<GpuCulling>(presentationDevice.getDevice(), supportsGpuCulling);
+		if (!supportsGpuCulling)
+			m_drawIndexedIndirectCount = nullptr;
 	}
 
 	bool PresentationTarget::createPresentationTarget(const HardwareDevice& presentationHardware, const Device& presentationDevice, uint32_t swapchainCount)
@@ -81,7 +99,7 @@ namespace Presentation
 	bool PresentationTarget::createSwapChain(uint32_t imageCount, const HardwareDevice& hardware, const Device& device, bool createDepthAttachement)
 	{
 		auto surfaceFormat = hardware.chooseSwapSurfaceFormat();
-		auto presentationMode = hardware.chooseSwapPresentMode();
+		auto presentationMode = hardware.chooseSwapPresentMode(m_requestedPresentMode);
 		auto extent = chooseSwapExtent(m_window->get());
 
 		imageCount = std::max(imageCount, m_capabilities.minImageCount);
@@ -94,7 +112,9 @@ namespace Presentation
 		if (createDepthAttachement)
 		{
 			auto maci = VkMemoryAllocator::getInstance()->createAllocationDescriptor(VMA_MEMORY_USAGE_GPU_ONLY, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			m_depthImage = MAKEUNQ<VkTexture>(device.getDevice(), maci, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, extent);
+			// Sampled by the occlusion culling to build the depth pyramid
+			m_depthImage = MAKEUNQ<VkTexture>(device.getDevice(), maci, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				VK_IMAGE_ASPECT_DEPTH_BIT, extent);
 		}
 		else m_depthImage = nullptr;
 
@@ -102,6 +122,7 @@ namespace Presentation
 		{
 			m_swapChainExtent = extent;
 			m_swapChainImageFormat = surfaceFormat.format;
+			m_presentMode = presentationMode;
 
 			vkGetSwapchainImagesKHR(device.getDevice(), m_swapchain, &imageCount, nullptr);
 			m_swapChainImages.resize(imageCount);
@@ -123,7 +144,8 @@ namespace Presentation
 
 	bool PresentationTarget::createRenderPass(VkDevice device)
 	{
-		return vkinit::Surface::createRenderPass(m_renderPass, device, m_swapChainImageFormat, hasDepthAttachement());
+		return vkinit::Surface::createRenderPass(m_renderPass, device, m_swapChainImageFormat, hasDepthAttachement()) &&
+			(!hasDepthAttachement() || vkinit::Surface::createOcclusionRenderPasses(m_occlusionFirstPass, m_occlusionSecondPass, device, m_swapChainImageFormat));
 	}
 
 	bool PresentationTarget::createSwapChainImageViews(VkDevice device)
@@ -194,14 +216,20 @@ namespace Presentation
 
 		vkDestroySwapchainKHR(device, m_swapchain, nullptr);
 		vkDestroyRenderPass(device, m_renderPass, nullptr);
+		vkDestroyRenderPass(device, m_occlusionFirstPass, nullptr);
+		vkDestroyRenderPass(device, m_occlusionSecondPass, nullptr);
 
 		m_renderPass = VK_NULL_HANDLE;
+		m_occlusionFirstPass = VK_NULL_HANDLE;
+		m_occlusionSecondPass = VK_NULL_HANDLE;
 		m_swapchain = VK_NULL_HANDLE;
 	}
 
 	void PresentationTarget::releaseAllResources(VkDevice device)
 	{
 		m_globalPipelineState->release(device);
+		if (m_secondaryCommandPools)
+			m_secondaryCommandPools->release();
 		releaseSwapChain(device);
 
 		{
@@ -212,6 +240,18 @@ namespace Presentation
 		m_emptyShadowMap->release(device);
 		m_emptyShadowMap = nullptr;
 
+		if (m_occlusionModule)
+		{
+			m_occlusionModule->release(device);
+			m_occlusionModule = nullptr;
+		}
+
+		if (m_gpuCullingModule)
+		{
+			m_gpuCullingModule->release(device);
+			m_gpuCullingModule = nullptr;
+		}
+
 		if (m_shadowMapModule)
 		{
 			m_shadowMapModule->release(device);
@@ -224,7 +264,8 @@ namespace Presentation
 	VkSwapchainKHR PresentationTarget::getSwapchain() const { return m_swapchain; }
 	VkExtent2D PresentationTarget::getSwapchainExtent() const { return m_swapChainExtent; }
 	VkRenderPass PresentationTarget::getRenderPass() const { return m_renderPass; }
-	VkImage PresentationTarget::getSwapchainImage(uint32_t index) const { return m_swapChainImages[index % SWAPCHAIN_IMAGE_COUNT]; }
-	VkImageView PresentationTarget::getSwapchainImageView(uint32_t index) const { return m_swapChainImageViews[index % SWAPCHAIN_IMAGE_COUNT]; }
-	VkFramebuffer PresentationTarget::getSwapchainFrameBuffers(uint32_t index) const { return m_swapChainFrameBuffers[index % SWAPCHAIN_IMAGE_COUNT]; }
+	// The index comes from vkAcquireNextImageKHR, the driver may have created more images than were requested
+	VkImage PresentationTarget::getSwapchainImage(uint32_t index) const { assert(index < m_swapChainImages.size()); return m_swapChainImages[index]; }
+	VkImageView PresentationTarget::getSwapchainImageView(uint32_t index) const { assert(index < m_swapChainImageViews.size()); return m_swapChainImageViews[index]; }
+	VkFramebuffer PresentationTarget::getSwapchainFrameBuffers(uint32_t index) const { assert(index < m_swapChainFrameBuffers.size()); return m_swapChainFrameBuffers[index]; }
 }
\ No newline at end of file
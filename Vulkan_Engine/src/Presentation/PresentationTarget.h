@@ -13,11 +13,12 @@ struct VkShader;
 struct VkMaterial;
 struct VertexBinding;
 struct VkMeshRenderer;
+class RenderQueue;
 
 class Camera;
-struct BuffersUBO;
-struct BufferHandle;
+struct UniformHandle;
 struct PipelineDescriptor;
+class DescriptorAllocator;
 
 namespace Presentation
 {
@@ -27,6 +28,9 @@ namespace Presentation
 	class ShadowMap;
 	class EmptyShadowMap;
 	class DebugPass;
+	class OcclusionCulling;
+	class GpuCulling;
+	class SecondaryCommandPools;
 
 	class PresentationTarget : IRequireInitialization
 	{
@@ -46,11 +50,24 @@ namespace Presentation
 		bool hasDepthAttachement();
 
 		bool createPresentationTarget(const HardwareDevice& presentationHardware, const Device& presentationDevice, uint32_t swapchainCount = SWAPCHAIN_IMAGE_COUNT);
-		bool createGraphicsMaterial(UNQ<VkMaterial>& material, VkDevice device, VkDescriptorPool descPool, const VkShader* shader, const VkTexture2D* texture);
-
-		FrameStats renderLoop(const std::vector<VkMeshRenderer>& renderers, Camera& cam, DirectionalLightParams& lightTr, VkCommandBuffer commandBuffer, uint32_t frameNumber);
+		// The material binds the texture through descriptor sets of its own, at the shadow map slot.
+		bool createGraphicsMaterial(UNQ<VkMaterial>& material, VkDevice device, DescriptorAllocator& allocator, const VkShader* shader, const VkTexture2D* texture);
+		// The material samples the texture table at textureIndex.
+		bool createGraphicsMaterial(UNQ<VkMaterial>& material, VkDevice device, const VkShader* shader, const VkTexture2D* texture, uint32_t textureIndex);
+		// Without the texture table the material binds its texture through descriptor sets of its own, at the material textures slot.
+		bool createBoundGraphicsMaterial(UNQ<VkMaterial>& material, VkDevice device, DescriptorAllocator& allocator, const VkShader* shader, const VkTexture2D* texture);
+		// False when the device can't index the sampler array of the texture table dynamically, every material binds its own texture then.
+		bool usesTextureTable() const { return m_useTextureTable; }
+
+		FrameStats renderLoop(RenderQueue& renderQueue, Camera& cam, DirectionalLightParams& lightTr, VkCommandBuffer commandBuffer, uint32_t frameNumber, uint32_t frameIndex, uint32_t imageIndex);
 		void applyFrameConfiguration(const FrameSettings* settings);
 
+		// Takes effect when the swapchain is created again
+		VkPresentModeKHR getRequestedPresentMode() const { return m_requestedPresentMode; }
+		void setRequestedPresentMode(VkPresentModeKHR presentMode) { m_requestedPresentMode = presentMode; }
+		// The mode the swapchain was created with, FIFO when the requested one isn't supported
+		VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+
 		void releaseAllResources(VkDevice device);
 		void releaseSwapChain(VkDevice device);
 
@@ -59,8 +76,25 @@ namespace Presentation
 		bool m_isInitialized = false;
 		bool m_hasDepthAttachment = false;
 
+		bool m_useIndirectDraw = false;
+		bool m_supportsIndirectDraw = false;
+		uint32_t m_maxDrawIndirectCount = 1u;
+		bool m_useHierarchicalCulling = true;
+		bool m_useShadowCache = true;
+		bool m_useTextureTable = true;
+		uint32_t m_recordingThreadCount = 1u;
+		bool m_useOcclusionCulling = false;
+		bool m_useGpuCulling = false;
+		bool m_useLods = true;
+		float m_lodScreenSize = 0.25f;
+		float m_lodHysteresis = 0.1f;
+		// Null without VK_KHR_draw_indirect_count
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount = nullptr;
+
 		VkSurfaceCapabilitiesKHR m_capabilities;
 		VkSwapchainKHR m_swapchain;
+		VkPresentModeKHR m_requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+		VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
 		UNQ<VkTexture> m_depthImage;
 
 		VkFormat m_swapChainImageFormat;
@@ -69,9 +103,18 @@ namespace Presentation
 		VkRect2D m_scissorRect;
 
 		VkRenderPass m_renderPass;
+		// The forward pass split around the occlusion culling, only created with a depth attachment
+		VkRenderPass m_occlusionFirstPass = VK_NULL_HANDLE;
+		VkRenderPass m_occlusionSecondPass = VK_NULL_HANDLE;
 		UNQ<ShadowMap> m_shadowMapModule;
 		UNQ<EmptyShadowMap> m_emptyShadowMap;
 		UNQ<DebugPass> m_debugModule;
+		UNQ<OcclusionCulling> m_occlusionModule;
+		UNQ<GpuCulling> m_gpuCullingModule;
+		UNQ<SecondaryCommandPools> m_secondaryCommandPools;
+
+		// Renderers of the pass being recorded, the recording threads only read it
+		std::vector<const VkMeshRenderer*> m_drawList;
 
 		std::vector<VkImage> m_swapChainImages;
 		std::vector<VkImageView> m_swapChainImageViews;
@@ -81,6 +124,8 @@ namespace Presentation
 
 		bool createPipelineIfNotExist(VkGraphicsPipeline& graphicsPipeline, const VkPipelineLayout pipelineLayout,
 			const VkDevice device, const VkShader* shader, const VkRenderPass renderPass, VkExtent2D extent);
+		bool createGraphicsMaterial(UNQ<VkMaterial>& material, VkDevice device, DescriptorAllocator& allocator, const VkDescriptorSetLayout descriptorSetLayout,
+			const VkShader* shader, const VkTexture2D* texture);
 		bool createSwapChain(uint32_t imageCount, const HardwareDevice& hardware, const Device& device, bool createDepthAttachement = true);
 		bool createRenderPass(VkDevice device);
 		bool createSwapChainImageViews(VkDevice device);
@@ -89,7 +134,22 @@ namespace Presentation
 
 		VkExtent2D chooseSwapExtent(const SDL_Window* window);
 
-		void renderIndexedMeshes(FrameStats& stats, const std::vector<VkMeshRenderer>& renderers, Camera& cam,
-			const BufferHandle& lightViewUBO, VkCommandBuffer commandBuffer, uint32_t frameNumber);
+		void renderIndexedMeshes(FrameStats& stats, RenderQueue& renderQueue, Camera& cam, const Camera& lightCam,
+			const UniformHandle& constantsUBO, const UniformHandle& lightViewUBO, const UniformHandle& handleViewUBO, VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex, bool useGpuCulling);
+
+		struct PassTarget
+		{
+			VkRenderPass renderPass;
+			VkFramebuffer frameBuffer;
+			VkExtent2D extent;
+			bool hasColorAttachment, hasDepthAttachment;
+		};
+		typedef std::function<void(VkCommandBuffer, FrameStats&)> RecordCommands;
+		typedef std::function<void(VkCommandBuffer, size_t, size_t, FrameStats&)> RecordDraws;
+
+		// Splits [0, drawCount) in up to m_recordingThreadCount contiguous chunks, each recorded on its own thread into a secondary
+		// command buffer that starts with bindState. A single chunk is recorded inline. The overlay is recorded last, on this thread.
+		void recordPass(FrameStats& stats, VkCommandBuffer commandBuffer, const PassTarget& target, size_t drawCount,
+			const RecordCommands& bindState, const RecordDraws& recordDraws, const RecordCommands& recordOverlay = nullptr);
 	};
 }
\ No newline at end of file
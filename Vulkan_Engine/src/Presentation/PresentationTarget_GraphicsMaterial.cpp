@@ -6,6 +6,7 @@
 #include "PipelineBinding.h"
 #include "VkTypes/VkShader.h"
 #include "VkTypes/PipelineConstructor.h"
+#include "DescriptorAllocator.h"
 
 namespace Presentation
 {
@@ -17,7 +18,7 @@ namespace Presentation
 			graphicsPipeline.m_pipelineLayout = pipelineLayout;
 			if (!PipelineConstruction::createPipeline(graphicsPipeline.m_pipeline, pipelineLayout, device,
 				renderPass, extent, *shader, &Mesh::defaultMeshDescriptor,
-				PipelineConstruction::FaceCulling::Back, hasDepthAttachement()))
+				PipelineConstruction::FaceCulling::Back, hasDepthAttachement(), false, m_globalPipelineState->getTextureTable().getCapacity()))
 				return false;
 
 			m_globalPipelineState->insertGraphicsPipelineFor(shader, graphicsPipeline);
@@ -26,12 +27,23 @@ namespace Presentation
 		return true;
 	}
 
-	bool PresentationTarget::createGraphicsMaterial(UNQ<VkMaterial>& material, const VkDevice device, const VkDescriptorPool descPool, const VkShader* shader, const VkTexture2D* texture)
+	bool PresentationTarget::createGraphicsMaterial(UNQ<VkMaterial>& material, const VkDevice device, DescriptorAllocator& allocator, const VkShader* shader, const VkTexture2D* texture)
 	{
-		VkDescriptorSetLayout descriptorSetLayout = m_globalPipelineState->getDescriptorSetLayout(PipelineDescriptor::BindingSlots::MaterialTextures);
+		return createGraphicsMaterial(material, device, allocator, m_globalPipelineState->getDescriptorSetLayout(PipelineDescriptor::BindingSlots::Shadowmap), shader, texture);
+	}
+
+	bool PresentationTarget::createBoundGraphicsMaterial(UNQ<VkMaterial>& material, const VkDevice device, DescriptorAllocator& allocator, const VkShader* shader, const VkTexture2D* texture)
+	{
+		return createGraphicsMaterial(material, device, allocator, m_globalPipelineState->getDescriptorSetLayout(PipelineDescriptor::BindingSlots::MaterialTextures), shader, texture);
+	}
 
-		std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT> descriptorSets;
-		vkinit::Descriptor::createDescriptorSets(descriptorSets, device, descPool, descriptorSetLayout, *texture);
+	bool PresentationTarget::createGraphicsMaterial(UNQ<VkMaterial>& material, const VkDevice device, DescriptorAllocator& allocator, const VkDescriptorSetLayout descriptorSetLayout,
+		const VkShader* shader, const VkTexture2D* texture)
+	{
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+		if (!allocator.allocate(descriptorSets, descriptorSetLayout))
+			return false;
+		vkinit::Descriptor::updateDescriptorSets(descriptorSets, device, *texture);
 
 		VkGraphicsPipeline graphicsPipeline;
 		if (!createPipelineIfNotExist(graphicsPipeline, m_globalPipelineState->getForwardPipelineLayout(), device, shader, getRenderPass(), getSwapchainExtent()))
@@ -43,4 +55,16 @@ namespace Presentation
 
 		return true;
 	}
+
+	bool PresentationTarget::createGraphicsMaterial(UNQ<VkMaterial>& material, const VkDevice device, const VkShader* shader, const VkTexture2D* texture, uint32_t textureIndex)
+	{
+		VkGraphicsPipeline graphicsPipeline;
+		if (!createPipelineIfNotExist(graphicsPipeline, m_globalPipelineState->getForwardPipelineLayout(), device, shader, getRenderPass(), getSwapchainExtent()))
+			return false;
+
+		material = MAKEUNQ<VkMaterial>(*shader, *texture,
+			graphicsPipeline.m_pipeline, graphicsPipeline.m_pipelineLayout, textureIndex);
+
+		return true;
+	}
 }
\ No newline at end of file
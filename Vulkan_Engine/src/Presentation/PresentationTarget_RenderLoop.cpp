@@ -2,10 +2,10 @@
 #include "PresentationTarget.h"
 #include "vk_types.h"
 #include "VkTypes/InitializersUtility.h"
-#include "VkTypes/PushConstantTypes.h"
 #include "VkTypes/VkMesh.h"
-#include "VertexAttributes.h"
 #include "PipelineBinding.h"
+#include "IndirectDrawBuffers.h"
+#include "RenderQueue.h"
 
 #include "Mesh.h"
 #include "Camera.h"
@@ -15,59 +15,159 @@
 
 #include "Passes/ShadowmapPass.h"
 #include "Passes/DebugPass.h"
+#include "Passes/OcclusionCullingPass.h"
+#include "Passes/GpuCullingPass.h"
+#include "SecondaryCommandPools.h"
 #include "EngineCore/Renderer.h"
 #include "EngineCore/Transform.h"
 #include "VkTypes/VkMeshRenderer.h"
 
 #include "Profiling/ProfileMarker.h"
 #include "Engine/Bitmask.h"
+#include "Engine/JobSystem.h"
 
 namespace Presentation
 {
-	void drawAt(VkCommandBuffer commandBuffer, const VkMeshRenderer& renderer, const glm::mat4& model)
+	// Every draw writes its transform, material and indexed command into the frame's indirect buffers. Consecutive draws sharing
+	// the mesh buffers and the pipeline go out as a single vkCmdDrawIndexedIndirect, or one vkCmdDrawIndexed each
+	// when indirect drawing is disabled. The scene geometry lives in a few shared buffers, they are only rebound on change.
+	// The draw indices come from a range reserved up front, so recorders on different threads never write the same slot.
+	struct DrawRecorder
 	{
-		if (renderer.submeshIndex >= renderer.mesh->iAttributes.size())
-			return;
+		DrawRecorder(VkCommandBuffer commandBuffer, IndirectDrawBuffers& indirectDraws, uint32_t firstDrawIndex, FrameStats& stats, bool useIndirect, uint32_t maxDrawIndirectCount)
+			: m_commandBuffer(commandBuffer), m_indirectDraws(indirectDraws), m_stats(stats), m_useIndirect(useIndirect),
+			m_maxDrawIndirectCount(maxDrawIndirectCount), m_boundBuffers(nullptr), m_nextDrawIndex(firstDrawIndex), m_batchStart(0), m_batchCount(0) { }
+
+		~DrawRecorder() { flush(); }
+
+		void draw(const VkMeshRenderer& renderer, const glm::mat4& model, uint32_t lod = 0u)
+		{
+			if (m_boundBuffers != renderer.mesh->buffers)
+			{
+				flush();
+				renderer.mesh->buffers->bind(m_commandBuffer);
+				m_boundBuffers = renderer.mesh->buffers;
+			}
 
-		TransformPushConstant pushConstant{};
-		pushConstant.model_matrix = model;
+			const auto& range = renderer.mesh->getRange(renderer.submeshIndex, lod);
+			const auto drawIndex = m_nextDrawIndex++;
+			m_indirectDraws.write(drawIndex, model * renderer.mesh->vertexTransform, renderer.variant->getTextureIndex(),
+				range.indexCount, range.firstIndex, range.vertexOffset);
+
+			if (m_useIndirect)
+			{
+				if (m_batchCount == 0)
+					m_batchStart = drawIndex;
+				m_batchCount += 1;
+				return;
+			}
 
-		renderer.mesh->vAttributes->bind(commandBuffer);
+			vkCmdDrawIndexed(m_commandBuffer, range.indexCount, 1, range.firstIndex, range.vertexOffset, drawIndex);
+			m_stats.drawCallCount += 1;
+			m_stats.directDrawCount += 1;
+		}
 
-		auto& indices = renderer.mesh->iAttributes[renderer.submeshIndex];
+		// Has to be called before any state the batched draws depend on changes.
+		void flush()
 		{
-			indices.bind(commandBuffer);
+			if (m_batchCount == 0)
+				return;
+
+			const auto stride = as_uint32(sizeof(VkDrawIndexedIndirectCommand));
+			for (uint32_t first = 0; first < m_batchCount; first += m_maxDrawIndirectCount)
+			{
+				const auto count = std::min(m_batchCount - first, m_maxDrawIndirectCount);
+				vkCmdDrawIndexedIndirect(m_commandBuffer, m_indirectDraws.getCommandBuffer(), IndirectDrawBuffers::getCommandOffset(m_batchStart + first), count, stride);
+				m_stats.drawCallCount += 1;
+			}
 
-			vkCmdPushConstants(commandBuffer, renderer.variant->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TransformPushConstant), &pushConstant);
-			vkCmdDrawIndexed(commandBuffer, indices.getIndexCount(), 1, 0, 0, 0);
+			m_stats.indirectDrawCount += m_batchCount;
+			m_batchCount = 0;
 		}
-	}
 
-	FrameStats PresentationTarget::renderLoop(const std::vector<VkMeshRenderer>& renderers, Camera& cam, DirectionalLightParams& lightTr, VkCommandBuffer commandBuffer, uint32_t frameNumber)
+	private:
+		VkCommandBuffer m_commandBuffer;
+		IndirectDrawBuffers& m_indirectDraws;
+		FrameStats& m_stats;
+
+		bool m_useIndirect;
+		uint32_t m_maxDrawIndirectCount;
+
+		const VkMeshBuffers* m_boundBuffers;
+		uint32_t m_nextDrawIndex;
+		uint32_t m_batchStart;
+		uint32_t m_batchCount;
+	};
+
+	// Renderers pointing past the submeshes of their mesh have nothing to draw, they never take a draw index.
+	static bool hasSubmesh(const VkMeshRenderer& renderer) { return renderer.submeshIndex < renderer.mesh->submeshes.size(); }
+
+	FrameStats PresentationTarget::renderLoop(RenderQueue& renderQueue, Camera& cam, DirectionalLightParams& lightTr, VkCommandBuffer commandBuffer, uint32_t frameNumber, uint32_t frameIndex, uint32_t imageIndex)
 	{
 		FrameStats stats{};
 		const auto injectionMarker = ProfileMarkerInjectResult(stats.renderLoop_ms);
 
 		auto cbs = CommandObjectsWrapper::CommandBufferScope(commandBuffer);
 		{
-			m_globalPipelineState->StartFrame(frameNumber);
-
-			const auto pipelineLayout = m_globalPipelineState->getForwardPipelineLayout();
+			// The uniform blocks and texture slots of this frame slot were last used by the submission the engine just waited on
+			m_globalPipelineState->StartFrame(frameIndex);
+			m_secondaryCommandPools->startFrame(frameIndex);
 
 			VkExtent2D extent{};
 			extent.width = 45u;
 			extent.height = 45u;
 			auto lightCam = Camera(extent);
 			lightCam.centerAround(lightTr.pitch, lightTr.yaw, lightTr.distance);
-			const auto lightViewUBO = m_globalPipelineState->fillCameraUBO(lightCam);
 
-			const auto handleConstantsUBO = m_globalPipelineState->fillGlobalConstantsUBO(lightCam.getViewProjectionMatrix(), lightTr.getBiasAmbient());
+			UniformHandle lightViewUBO, viewUBO, handleConstantsUBO;
+			if (!m_globalPipelineState->fillCameraUBO(lightViewUBO, lightCam) || !m_globalPipelineState->fillCameraUBO(viewUBO, cam) ||
+				!m_globalPipelineState->fillGlobalConstantsUBO(handleConstantsUBO, lightCam.getViewProjectionMatrix(), lightTr.getBiasAmbient()))
+			{
+				// Nothing can be drawn without its uniforms, the swapchain image is only cleared so it still reaches the layout it is presented in
+				const auto target = PassTarget{ m_renderPass, getSwapchainFrameBuffers(imageIndex), getSwapchainExtent(), true, hasDepthAttachement() };
+				recordPass(stats, commandBuffer, target, 0, [](VkCommandBuffer, FrameStats&) {}, [](VkCommandBuffer, size_t, size_t, FrameStats&) {});
+
+				stats.frameNumber = frameNumber;
+				return stats;
+			}
+
+			// The compute shader culls every drawable renderer, their transforms stay resident in the first draws of the frame slot
+			const auto useGpuCulling = m_useGpuCulling && m_gpuCullingModule->startFrame(frameIndex, renderQueue, m_maxDrawIndirectCount);
+			const auto residentCount = useGpuCulling ? as_uint32(m_gpuCullingModule->getObjects().size()) : 0u;
+			const auto residentVersion = useGpuCulling ? m_gpuCullingModule->getBuildVersion() : 0u;
+
+			// Each renderer is drawn at most once per pass, the shadow pass and both phases of the forward pass
+			auto& indirectDraws = m_globalPipelineState->getIndirectDrawBuffers();
+			indirectDraws.startFrame(frameIndex, as_uint32(renderQueue.getRenderers().size() * 3), residentCount, residentVersion);
+			if (useGpuCulling)
+			{
+				// Only the objects that moved since this frame slot was last recorded are uploaded
+				const auto& objects = m_gpuCullingModule->getObjects();
+				for (uint32_t i = 0; i < residentCount; i++)
+				{
+					const auto& transform = *objects[i]->transform;
+					if (indirectDraws.isResidentCurrent(i, transform.getVersion()))
+						continue;
+
+					indirectDraws.writeResident(i, transform.getVersion(), transform.getLocalToWorld() * objects[i]->mesh->vertexTransform,
+						objects[i]->variant->getTextureIndex());
+					stats.transformUploadCount += 1;
+				}
+			}
+
+			// Both passes query the same bounds and hierarchy
+			renderQueue.updateWorldBounds();
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout, PipelineDescriptor::BindingSlots::Constants, 1, &handleConstantsUBO.descriptorSet, 0, nullptr);
-			stats.descriptorSetCount += 1;
+			// The shadow pass draws the LODs picked for the camera as well, except for the cached static casters
+			if (m_useLods)
+				stats.lodReducedCount = renderQueue.updateLods(cam.getPosition(), cam.getPerspectiveMatrix()[1][1], m_lodScreenSize, m_lodHysteresis);
+			else
+				renderQueue.resetLods();
 
-			renderIndexedMeshes(stats, renderers, cam, lightViewUBO, commandBuffer, frameNumber);
+			renderIndexedMeshes(stats, renderQueue, cam, lightCam, handleConstantsUBO, lightViewUBO, viewUBO, commandBuffer, frameIndex, imageIndex, useGpuCulling);
+
+			indirectDraws.flush();
+			stats.uniformByteCount = m_globalPipelineState->getUniformRing().getUsedBytes();
 		}
 
 		stats.frameNumber = frameNumber;
@@ -78,135 +178,418 @@ namespace Presentation
 	{
 		if(m_shadowMapModule) m_shadowMapModule->setActive(settings->enableShadowPass);
 		if(m_debugModule) m_debugModule->setActive(settings->enableDebugShadowMap);
+		m_useIndirectDraw = settings->enableIndirectDraw && m_supportsIndirectDraw;
+		m_useHierarchicalCulling = settings->enableHierarchicalCulling;
+		m_useShadowCache = settings->enableShadowCache;
+		if (m_occlusionModule) m_occlusionModule->setActive(settings->enableOcclusionCulling && m_occlusionModule->isInitialized());
+		m_useOcclusionCulling = m_occlusionModule && m_occlusionModule->getActive();
+		if (m_gpuCullingModule) m_gpuCullingModule->setActive(settings->enableGpuCulling && m_gpuCullingModule->isInitialized() && m_drawIndexedIndirectCount != nullptr);
+		m_useGpuCulling = m_useIndirectDraw && m_gpuCullingModule && m_gpuCullingModule->getActive();
+		m_recordingThreadCount = std::clamp(as_uint32(std::max(settings->recordingThreadCount, 1)), 1u, FrameSettings::c_maxRecordingThreads);
+		m_useLods = settings->enableLods;
+		m_lodScreenSize = settings->lodScreenSize;
+		m_lodHysteresis = settings->lodHysteresis;
 	}
 
-	void PresentationTarget::renderIndexedMeshes(FrameStats& stats, const std::vector<VkMeshRenderer>& renderers, Camera& cam, const BufferHandle& lightViewUBO, VkCommandBuffer commandBuffer, uint32_t frameNumber)
+	void PresentationTarget::recordPass(FrameStats& stats, VkCommandBuffer commandBuffer, const PassTarget& target, size_t drawCount,
+		const RecordCommands& bindState, const RecordDraws& recordDraws, const RecordCommands& recordOverlay)
+	{
+		const auto chunkCount = std::min(static_cast<size_t>(m_recordingThreadCount), drawCount);
+		stats.recordThreadCount = std::max(stats.recordThreadCount, as_uint32(std::max(chunkCount, size_t{ 1 })));
+
+		if (chunkCount <= 1)
+		{
+			auto scopeRenderPass = CommandObjectsWrapper::RenderPassScope(commandBuffer, target.renderPass, target.frameBuffer, target.extent,
+				target.hasColorAttachment, target.hasDepthAttachment);
+
+			int64_t record_us = 0;
+			{
+				const auto marker = ProfileMarkerInjectResult(record_us, true);
+				bindState(commandBuffer, stats);
+				recordDraws(commandBuffer, 0, drawCount, stats);
+			}
+			stats.recordThread_us[0] += record_us;
+
+			if (recordOverlay)
+				recordOverlay(commandBuffer, stats);
+			return;
+		}
+
+		// Slot i only ever records chunk i, so no two threads touch the same command pool
+		std::array<VkCommandBuffer, FrameSettings::c_maxRecordingThreads + 1> secondaries{};
+		std::array<FrameStats, FrameSettings::c_maxRecordingThreads> chunkStats{};
+		std::array<bool, FrameSettings::c_maxRecordingThreads> chunkFailed{};
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			secondaries[chunk] = m_secondaryCommandPools->acquire(as_uint32(chunk));
+
+		JobSystem::parallelFor(chunkCount, [&](size_t chunk)
+			{
+				auto& chunkStat = chunkStats[chunk];
+				const auto marker = ProfileMarkerInjectResult(chunkStat.recordThread_us[chunk], true);
+
+				// Secondary command buffers inherit no state, every chunk binds the whole pass state again
+				auto scopeSecondary = CommandObjectsWrapper::SecondaryCommandBufferScope(secondaries[chunk], target.renderPass, target.frameBuffer);
+				if (!scopeSecondary.isRecording())
+				{
+					chunkFailed[chunk] = true;
+					return;
+				}
+
+				bindState(secondaries[chunk], chunkStat);
+				recordDraws(secondaries[chunk], drawCount * chunk / chunkCount, drawCount * (chunk + 1) / chunkCount, chunkStat);
+			}, as_uint32(chunkCount)
+		);
+
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			// Failing to begin the primary command buffer is fatal as well
+			if (chunkFailed[chunk])
+				throw std::runtime_error("Failed to begin the secondary command buffer of chunk " + std::to_string(chunk) + " of the pass");
+
+			stats.addCommandCounts(chunkStats[chunk]);
+			stats.recordThread_us[chunk] += chunkStats[chunk].recordThread_us[chunk];
+		}
+
+		// A subpass recorded through secondaries can't take inline commands, the overlay gets a secondary of its own
+		auto secondaryCount = chunkCount;
+		if (recordOverlay)
+		{
+			const auto overlay = m_secondaryCommandPools->acquire(0u);
+			{
+				auto scopeSecondary = CommandObjectsWrapper::SecondaryCommandBufferScope(overlay, target.renderPass, target.frameBuffer);
+				if (!scopeSecondary.isRecording())
+					throw std::runtime_error("Failed to begin the secondary command buffer of the pass overlay");
+
+				bindState(overlay, stats);
+				recordOverlay(overlay, stats);
+			}
+			secondaries[secondaryCount++] = overlay;
+		}
+
+		auto scopeRenderPass = CommandObjectsWrapper::RenderPassScope(commandBuffer, target.renderPass, target.frameBuffer, target.extent,
+			target.hasColorAttachment, target.hasDepthAttachment, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(commandBuffer, as_uint32(secondaryCount), secondaries.data());
+	}
+
+	void PresentationTarget::renderIndexedMeshes(FrameStats& stats, RenderQueue& renderQueue, Camera& cam, const Camera& lightCam,
+		const UniformHandle& constantsUBO, const UniformHandle& lightViewUBO, const UniformHandle& handleViewUBO, VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex, bool useGpuCulling)
 	{
 		const auto pipelineLayout = m_globalPipelineState->getForwardPipelineLayout();
+		auto& indirectDraws = m_globalPipelineState->getIndirectDrawBuffers();
 
-		std::vector<VkMeshRenderer> sortedList(renderers.begin(), renderers.end());
+		cam.updateWindowExtent(getSwapchainExtent());
+		const auto cameraFrustum = Frustum(cam);
+
+		// Bound at the start of every pass, so the chunks recorded into secondary command buffers see them as well
+		const auto bindFrameState = [&](VkCommandBuffer cmd, FrameStats& cmdStats)
+		{
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout, PipelineDescriptor::BindingSlots::Constants, 1, &constantsUBO.descriptorSet, 1, &constantsUBO.dynamicOffset);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout, PipelineDescriptor::BindingSlots::Transforms, 1, indirectDraws.getDescriptorSet(), 0, nullptr);
+			cmdStats.descriptorSetCount += 2;
+		};
 
 		auto variant_shadowMap = &m_emptyShadowMap->getMaterialVariant(); 
 		// ShadowMap - pass
 		if(m_shadowMapModule && m_shadowMapModule->getActive())
 		{
-			auto scopeShadowMapRenderPass = CommandObjectsWrapper::RenderPassScope(commandBuffer, m_shadowMapModule->getRenderPass(), 
-				m_shadowMapModule->getFrameBuffer(frameNumber), m_shadowMapModule->getExtent(), false, true);
+			// Casters in front of the near plane still land in the shadow map when the depth is clamped
+			auto lightFrustum = Frustum(lightCam);
+			if (m_shadowMapModule->isDepthClamped())
+				lightFrustum.ignorePlane(Frustum::EPlanes::Near);
+
+			// The light looks down its -Z axis, casters whose shadow can't reach the camera frustum are skipped as well
+			const auto& lightView = lightCam.getViewMatrix();
+			const auto lightDirection = -glm::vec3(lightView[0][2], lightView[1][2], lightView[2][2]);
+			const auto casterFrustum = cameraFrustum.getShadowCasterFrustum(lightDirection);
 
-			vkCmdSetViewport(commandBuffer, 0, 1, &m_shadowMapModule->getViewport());
-			vkCmdSetScissor(commandBuffer, 0, 1, &m_shadowMapModule->getScissorRect());
+			stats.shadowCasterCount = renderQueue.updateShadowVisibility(lightFrustum, casterFrustum, m_useHierarchicalCulling);
+			stats.shadowCulledCount = renderQueue.getRenderers().size() - stats.shadowCasterCount;
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout, PipelineDescriptor::BindingSlots::View, 1, &lightViewUBO.descriptorSet, 0, nullptr);
-			stats.descriptorSetCount += 1;
+			const auto drawCallCount = stats.drawCallCount;
+			const auto drawShadowCasters = [&](VkRenderPass renderPass, VkFramebuffer frameBuffer, RenderQueue::EShadowCasters casters)
+			{
+				m_drawList.clear();
+				renderQueue.forEachShadowCaster([&](const VkMeshRenderer& renderer)
+					{
+						if (hasSubmesh(renderer))
+							m_drawList.push_back(&renderer);
+					}, casters
+				);
+				const auto firstDraw = indirectDraws.reserve(as_uint32(m_drawList.size()));
+				// The cache is only keyed on the light and the static renderers, it can't depend on where the camera is
+				const auto useCameraLods = casters != RenderQueue::EShadowCasters::Static;
+
+				const auto bindShadowState = [&](VkCommandBuffer cmd, FrameStats& cmdStats)
+				{
+					bindFrameState(cmd, cmdStats);
+
+					vkCmdSetViewport(cmd, 0, 1, &m_shadowMapModule->getViewport());
+					vkCmdSetScissor(cmd, 0, 1, &m_shadowMapModule->getScissorRect());
+
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						pipelineLayout, PipelineDescriptor::BindingSlots::View, 1, &lightViewUBO.descriptorSet, 1, &lightViewUBO.dynamicOffset);
+					cmdStats.descriptorSetCount += 1;
+
+					const auto& depthOnly = m_shadowMapModule->m_replacementMaterial;
+					vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnly.m_pipeline);
+					cmdStats.pipelineCount += 1;
+				};
+
+				const auto recordShadowDraws = [&](VkCommandBuffer cmd, size_t begin, size_t end, FrameStats& cmdStats)
+				{
+					auto recorder = DrawRecorder(cmd, indirectDraws, firstDraw + as_uint32(begin), cmdStats, m_useIndirectDraw, m_maxDrawIndirectCount);
+					for (auto i = begin; i < end; i++)
+						recorder.draw(*m_drawList[i], m_drawList[i]->transform->getLocalToWorld(), useCameraLods ? renderQueue.getLod(*m_drawList[i]) : 0u);
+					recorder.flush();
+				};
 
-			const auto& depthOnly = m_shadowMapModule->m_replacementMaterial;
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnly.m_pipeline);
-			stats.pipelineCount += 1;
+				const auto target = PassTarget{ renderPass, frameBuffer, m_shadowMapModule->getExtent(), false, true };
+				recordPass(stats, commandBuffer, target, m_drawList.size(), bindShadowState, recordShadowDraws);
+			};
 
-			for (auto& renderer : sortedList)
+			if (m_useShadowCache)
 			{
-				drawAt(commandBuffer, renderer, renderer.transform->localToWorld);
-				stats.drawCallCount += 1;
+				// The static casters are only redrawn when the light or the static renderers changed, wherever the camera looks
+				if (!m_shadowMapModule->tryHitCache(lightCam.getViewProjectionMatrix(), renderQueue.getStaticStateVersion()))
+				{
+					renderQueue.updateStaticShadowVisibility(lightFrustum, m_useHierarchicalCulling);
+					drawShadowCasters(m_shadowMapModule->getCacheRenderPass(), m_shadowMapModule->getCacheFrameBuffer(), RenderQueue::EShadowCasters::Static);
+					m_shadowMapModule->setMatchingCache(false);
+				}
+
+				// Without dynamic casters the shadow map still holds the depth copied from the cache
+				const auto hasDynamicCasters = renderQueue.getDynamicShadowCasterCount() != 0;
+				if (hasDynamicCasters || !m_shadowMapModule->isMatchingCache())
+				{
+					m_shadowMapModule->copyFromCache(commandBuffer);
+					drawShadowCasters(m_shadowMapModule->getCompositeRenderPass(), m_shadowMapModule->getFrameBuffer(frameIndex), RenderQueue::EShadowCasters::Dynamic);
+				}
+				m_shadowMapModule->setMatchingCache(!hasDynamicCasters);
+			}
+			else
+			{
+				drawShadowCasters(m_shadowMapModule->getRenderPass(), m_shadowMapModule->getFrameBuffer(frameIndex), RenderQueue::EShadowCasters::All);
+				m_shadowMapModule->setMatchingCache(false);
 			}
 
+			stats.shadowDrawCallCount = stats.drawCallCount - drawCallCount;
+			stats.shadowCacheHits = m_shadowMapModule->getCacheHits();
+			stats.shadowCacheMisses = m_shadowMapModule->getCacheMisses();
+
 			variant_shadowMap = &m_shadowMapModule->getMaterialVariant();
 		}
 		
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, variant_shadowMap->getPipelineLayout(),
-			PipelineDescriptor::BindingSlots::Shadowmap, 1, variant_shadowMap->getDescriptorSet(frameNumber), 0, nullptr);
-		stats.descriptorSetCount += 1;
-
-		auto scopeForwardRenderPass = CommandObjectsWrapper::RenderPassScope(commandBuffer, m_renderPass, getSwapchainFrameBuffers(frameNumber), getSwapchainExtent(), true, hasDepthAttachement());
-		
 		// For each camera - Forward pass
 		{
 			auto extent = getSwapchainExtent();
-			cam.updateWindowExtent(extent);
-
 			vkinit::Commands::initViewportAndScissor(m_viewport, m_scissorRect, extent);
-			vkCmdSetViewport(commandBuffer, 0, 1, &m_viewport);
-			vkCmdSetScissor(commandBuffer, 0, 1, &m_scissorRect);
-
-			const auto handleViewUBO = m_globalPipelineState->fillCameraUBO(cam);
+			const auto viewport = m_viewport;
+			const auto scissorRect = m_scissorRect;
 
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout, 1, 1, &handleViewUBO.descriptorSet, 0, nullptr);
-			stats.descriptorSetCount += 1;
+			m_drawList.clear();
+			if (useGpuCulling)
+			{
+				stats.gpuVisibleCount = m_gpuCullingModule->getVisibleCount();
+				stats.visibleCount = stats.gpuVisibleCount;
+			}
+			else
+			{
+				// The queue is already sorted by pipeline, mesh buffers, variant and mesh, only the visibility is refreshed.
+				stats.visibleCount = renderQueue.updateVisibility(cameraFrustum, m_useHierarchicalCulling);
+				stats.visibilityChangeCount = renderQueue.getVisibilityChanges();
 
-			const auto& cameraFrustum = Frustum(cam);
-			// Move the objects that are out of frustum to the end of the vector.
-			auto partition = std::partition(sortedList.begin(), sortedList.end(), [&cameraFrustum](auto& renderer) 
+				for (const auto& batch : renderQueue.getBatches())
+				{
+					renderQueue.forEachVisible(batch, [&](const VkMeshRenderer& renderer)
+						{
+							if (hasSubmesh(renderer))
+								m_drawList.push_back(&renderer);
+						}
+					);
+				}
+			}
+			const auto drawCount = as_uint32(m_drawList.size());
+			const auto firstDraw = indirectDraws.reserve(drawCount);
+			// Culls against the depth of the draws that were visible last frame, which needs the instance counts of the indirect commands
+			const auto useOcclusion = !useGpuCulling && m_useOcclusionCulling && m_useIndirectDraw && hasDepthAttachement() &&
+				m_occlusionModule->startFrame(frameIndex, as_uint32(renderQueue.getRenderers().size()), m_depthImage->imageView, extent);
+
+			// The second phase takes the same draws again, the culling decides which of the two phases draws each of them
+			const auto secondDraw = useOcclusion ? indirectDraws.reserve(drawCount) : firstDraw;
+			if (useOcclusion)
+			{
+				const auto& bounds = renderQueue.getWorldBounds();
+				const auto* renderers = renderQueue.getRenderers().data();
+				auto* drawBounds = m_occlusionModule->mapDrawBounds(drawCount);
+				for (uint32_t i = 0; i < drawCount; i++)
 				{
-					const auto& model = renderer.transform->localToWorld;
-					return renderer.bounds != nullptr && cameraFrustum.isOnFrustum(renderer.bounds->getTransformed(model));
+					const auto index = static_cast<size_t>(m_drawList[i] - renderers);
+					drawBounds[i] = { glm::vec3(bounds.centerX[index], bounds.centerY[index], bounds.centerZ[index]), as_uint32(index),
+						glm::vec3(bounds.extentsX[index], bounds.extentsY[index], bounds.extentsZ[index]), 0u };
 				}
-			);
-			// Cut the end of the vector, preserving only the objects that are in frustum.
-			sortedList.resize(sortedList.size() - static_cast<size_t>(std::distance(partition, sortedList.end())));
+			}
+			// Only changes between the recorded passes, never while one is being recorded
+			auto passFirstDraw = firstDraw;
 
-			auto cameraPosition = cam.getPosition();
-			// Sort the objects in frustum to minimize m_texture state change.
-			std::sort(sortedList.begin(), sortedList.end(), [cameraPosition](const VkMeshRenderer& a, const VkMeshRenderer& b)
+			const auto bindForwardState = [&](VkCommandBuffer cmd, FrameStats& cmdStats)
+			{
+				bindFrameState(cmd, cmdStats);
+
+				vkCmdSetViewport(cmd, 0, 1, &viewport);
+				vkCmdSetScissor(cmd, 0, 1, &scissorRect);
+
+				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, variant_shadowMap->getPipelineLayout(),
+					PipelineDescriptor::BindingSlots::Shadowmap, 1, variant_shadowMap->getDescriptorSet(frameIndex), 0, nullptr);
+				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipelineLayout, PipelineDescriptor::BindingSlots::View, 1, &handleViewUBO.descriptorSet, 1, &handleViewUBO.dynamicOffset);
+				cmdStats.descriptorSetCount += 2;
+				if (m_useTextureTable)
 				{
-					return a.material->getHash() < b.material->getHash();
+					// Every material texture of the scene, the draws pick theirs by the material index next to their transform
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						pipelineLayout, PipelineDescriptor::BindingSlots::MaterialTextures, 1, m_globalPipelineState->getTextureTable().getDescriptorSet(), 0, nullptr);
+					cmdStats.descriptorSetCount += 1;
 				}
-			);
+			};
 
-			const VkMaterialVariant* prevVariant = nullptr;
-			for (auto& renderer : sortedList)
+			// With the texture table the materials only differ in their texture index, which the draws carry themselves.
+			// Without it every material binds its own set.
+			const auto needsRebind = [](const VkMaterialVariant& variant, const VkMaterialVariant* prevVariant)
 			{
-				const auto& variant = *renderer.variant;
-				if (prevVariant != renderer.variant)
+				const auto change = variant.compare(prevVariant);
+				return bitFlagPresent(change, VariantStateChange::Pipeline) || bitFlagPresent(change, VariantStateChange::DescriptorSet);
+			};
+
+			const auto bindVariant = [&](VkCommandBuffer cmd, const VkMaterialVariant& variant, const VkMaterialVariant* prevVariant, FrameStats& cmdStats)
+			{
+				const auto change = variant.compare(prevVariant);
+				if (bitFlagPresent(change, VariantStateChange::Pipeline))
 				{
-					auto stateChange = variant.compare(prevVariant);
+					vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, variant.getPipeline());
+					cmdStats.pipelineCount += 1;
+				}
 
-					if (bitFlagPresent(stateChange, VariantStateChange::Pipeline))
-					{
-						vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, variant.getPipeline());
-						stats.pipelineCount += 1;
-					}
+				if (variant.hasDescriptorSets() && bitFlagPresent(change, VariantStateChange::DescriptorSet))
+				{
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, variant.getPipelineLayout(),
+						PipelineDescriptor::BindingSlots::MaterialTextures, 1, variant.getDescriptorSet(frameIndex), 0, nullptr);
+					cmdStats.descriptorSetCount += 1;
+				}
+			};
 
-					// if (bitFlagPresent(stateChange, VariantStateChange::DescriptorSet))
+			// Every chunk starts without a bound variant, so the first draw of a chunk binds its pipeline
+			const auto recordForwardDraws = [&](VkCommandBuffer cmd, size_t begin, size_t end, FrameStats& cmdStats)
+			{
+				const VkMaterialVariant* prevVariant = nullptr;
+				auto recorder = DrawRecorder(cmd, indirectDraws, passFirstDraw + as_uint32(begin), cmdStats, m_useIndirectDraw, m_maxDrawIndirectCount);
+				for (auto i = begin; i < end; i++)
+				{
+					const auto& renderer = *m_drawList[i];
+					if (prevVariant != renderer.variant)
 					{
-						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, variant.getPipelineLayout(),
-							PipelineDescriptor::BindingSlots::MaterialTextures, 1, variant.getDescriptorSet(frameNumber), 0, nullptr);
-						stats.descriptorSetCount += 1;
+						// The batch only breaks for a different pipeline or material set
+						if (needsRebind(*renderer.variant, prevVariant))
+						{
+							recorder.flush();
+							bindVariant(cmd, *renderer.variant, prevVariant, cmdStats);
+						}
+						prevVariant = renderer.variant;
 					}
 
-					prevVariant = &variant;
+					recorder.draw(renderer, renderer.transform->getLocalToWorld(), renderQueue.getLod(renderer));
 				}
+				recorder.flush();
+			};
 
-				drawAt(commandBuffer, renderer, renderer.transform->localToWorld);
-				stats.drawCallCount += 1;
-			}
-		}
+			const auto recordOverlay = [&](VkCommandBuffer cmd, FrameStats& cmdStats)
+			{
+				if(m_debugModule && m_debugModule->getActive())
+				{
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_debugModule->getPipelineLayout(),
+						PipelineDescriptor::BindingSlots::Shadowmap, 1, m_debugModule->getDescriptorSet(frameIndex), 0, nullptr);
+					cmdStats.descriptorSetCount += 1;
 
-		if(m_debugModule && m_debugModule->getActive())
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_debugModule->getPipelineLayout(),
-				PipelineDescriptor::BindingSlots::Shadowmap, 1, m_debugModule->getDescriptorSet(frameNumber), 0, nullptr);
-			stats.descriptorSetCount += 1;
+					auto swExtent = getSwapchainExtent();
+					auto debugExtent = swExtent;
+					debugExtent.width = static_cast<int32_t>( debugExtent.width * 0.25f );
+					debugExtent.height = static_cast<int32_t>( debugExtent.height * 0.25f );
 
-			auto swExtent = getSwapchainExtent();
-			auto extent = swExtent;
-			extent.width = static_cast<int32_t>( extent.width * 0.25f );
-			extent.height = static_cast<int32_t>( extent.height * 0.25f );
+					vkinit::Commands::initViewportAndScissor(m_viewport, m_scissorRect, debugExtent, 
+						static_cast<int32_t>( swExtent.width * 0.75f ), static_cast<int32_t>( swExtent.height * 0.0f ));
+					vkCmdSetViewport(cmd, 0, 1, &m_viewport);
+					vkCmdSetScissor(cmd, 0, 1, &m_scissorRect);
 
-			vkinit::Commands::initViewportAndScissor(m_viewport, m_scissorRect, extent, 
-				static_cast<int32_t>( swExtent.width * 0.75f ), static_cast<int32_t>( swExtent.height * 0.0f ));
-			vkCmdSetViewport(commandBuffer, 0, 1, &m_viewport);
-			vkCmdSetScissor(commandBuffer, 0, 1, &m_scissorRect);
+					vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_debugModule->getPipeline());
+					cmdStats.pipelineCount += 1;
 
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_debugModule->getPipeline());
-			stats.pipelineCount += 1;
+					vkCmdDraw(cmd, 3, 1, 0, 0);
+				}
 
-			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-		}
+				if (ImGui::GetDrawData())
+				{
+					ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+				}
+			};
 
-		if (ImGui::GetDrawData())
-		{
-			ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+			auto target = PassTarget{ m_renderPass, getSwapchainFrameBuffers(imageIndex), extent, true, hasDepthAttachement() };
+			if (useGpuCulling)
+			{
+				// The compute shader reads the resident transform of object i and writes the commands of its group from gpuFirstDraw + i on
+				const auto gpuFirstDraw = 0u;
+				assert(indirectDraws.getResidentCount() == m_gpuCullingModule->getObjects().size());
+
+				m_gpuCullingModule->recordCulling(commandBuffer, indirectDraws.getTransformBuffer(), indirectDraws.getCommandBuffer(), gpuFirstDraw, cameraFrustum);
+
+				// One draw call per group, however many of its objects survived
+				const auto& groups = m_gpuCullingModule->getGroups();
+				const auto recordGroupDraws = [&](VkCommandBuffer cmd, size_t begin, size_t end, FrameStats& cmdStats)
+				{
+					const auto stride = as_uint32(sizeof(VkDrawIndexedIndirectCommand));
+					const VkMaterialVariant* prevVariant = nullptr;
+					const VkMeshBuffers* boundBuffers = nullptr;
+					for (auto i = begin; i < end; i++)
+					{
+						const auto& group = groups[i];
+						if (prevVariant != group.variant)
+						{
+							if (needsRebind(*group.variant, prevVariant))
+								bindVariant(cmd, *group.variant, prevVariant, cmdStats);
+							prevVariant = group.variant;
+						}
+
+						if (boundBuffers != group.buffers)
+						{
+							group.buffers->bind(cmd);
+							boundBuffers = group.buffers;
+						}
+
+						m_drawIndexedIndirectCount(cmd, indirectDraws.getCommandBuffer(), IndirectDrawBuffers::getCommandOffset(gpuFirstDraw + group.firstObject),
+							m_gpuCullingModule->getCountBuffer(), GpuCulling::getCountOffset(as_uint32(i)), group.objectCount, stride);
+						cmdStats.drawCallCount += 1;
+					}
+				};
+
+				recordPass(stats, commandBuffer, target, groups.size(), bindForwardState, recordGroupDraws, recordOverlay);
+				return;
+			}
+
+			if (useOcclusion)
+			{
+				// The swapchain frame buffers are compatible with both halves of the split forward pass
+				m_occlusionModule->recordFirstPhase(commandBuffer, indirectDraws.getCommandBuffer(), firstDraw, secondDraw);
+				target.renderPass = m_occlusionFirstPass;
+				recordPass(stats, commandBuffer, target, m_drawList.size(), bindForwardState, recordForwardDraws);
+
+				m_occlusionModule->recordSecondPhase(commandBuffer, cam.getViewProjectionMatrix());
+				target.renderPass = m_occlusionSecondPass;
+				passFirstDraw = secondDraw;
+
+				stats.occludedCount = m_occlusionModule->getOccludedCount();
+				stats.lateVisibleCount = m_occlusionModule->getLateVisibleCount();
+			}
+			recordPass(stats, commandBuffer, target, m_drawList.size(), bindForwardState, recordForwardDraws, recordOverlay);
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "SecondaryCommandPools.h"
+#include "VkTypes/InitializersUtility.h"
+
+namespace Presentation
+{
+	SecondaryCommandPools::SecondaryCommandPools(VkDevice device, uint32_t queueFamilyIndex, uint32_t slotCount)
+		: m_isInitialized(true), m_device(device), m_slotCount(slotCount), m_frames(), m_currentFrame(0)
+	{
+		for (auto& frame : m_frames)
+		{
+			frame.resize(slotCount);
+			for (auto& slot : frame)
+			{
+				slot.pool = VK_NULL_HANDLE;
+				slot.usedCount = 0;
+				m_isInitialized = m_isInitialized && vkinit::Commands::createCommandPool(slot.pool, device, queueFamilyIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			}
+		}
+	}
+
+	void SecondaryCommandPools::startFrame(uint32_t frameIndex)
+	{
+		m_currentFrame = frameIndex % MAX_FRAMES_IN_FLIGHT;
+
+		// One reset per pool is cheaper than resetting every buffer on its own
+		for (auto& slot : m_frames[m_currentFrame])
+		{
+			if (slot.usedCount == 0)
+				continue;
+
+			vkResetCommandPool(m_device, slot.pool, 0);
+			slot.usedCount = 0;
+		}
+	}
+
+	VkCommandBuffer SecondaryCommandPools::acquire(uint32_t slot)
+	{
+		auto& slotPool = m_frames[m_currentFrame][slot];
+		if (slotPool.usedCount == slotPool.buffers.size())
+		{
+			std::vector<VkCommandBuffer> buffers;
+			const auto growBy = std::max(as_uint32(slotPool.buffers.size()), 2u);
+			if (!vkinit::Commands::createCommandBuffers(buffers, growBy, slotPool.pool, m_device, VK_COMMAND_BUFFER_LEVEL_SECONDARY))
+				throw std::runtime_error("Failed to allocate secondary command buffers");
+
+			slotPool.buffers.insert(slotPool.buffers.end(), buffers.begin(), buffers.end());
+		}
+
+		return slotPool.buffers[slotPool.usedCount++];
+	}
+
+	void SecondaryCommandPools::release()
+	{
+		// Destroying the pool frees its command buffers as well
+		for (auto& frame : m_frames)
+		{
+			for (auto& slot : frame)
+			{
+				if (slot.pool != VK_NULL_HANDLE)
+					vkDestroyCommandPool(m_device, slot.pool, nullptr);
+			}
+			frame.clear();
+		}
+	}
+}
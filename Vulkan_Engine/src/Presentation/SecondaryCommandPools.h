@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include "Interfaces/IRequireInitialization.h"
+
+namespace Presentation
+{
+	// Command pools are externally synchronized, so every recording slot gets its own transient pool per frame in flight.
+	// A slot is only ever recorded by one thread at a time, its buffers are recycled by resetting the whole pool once per frame.
+	class SecondaryCommandPools : IRequireInitialization
+	{
+	public:
+		SecondaryCommandPools(VkDevice device, uint32_t queueFamilyIndex, uint32_t slotCount);
+
+		bool IRequireInitialization::isInitialized() const override { return m_isInitialized; }
+
+		// The previous submission of this frame has completed, its secondary command buffers can be recorded again.
+		void startFrame(uint32_t frameIndex);
+
+		// Next unused secondary command buffer of the slot, not thread safe within the same slot.
+		VkCommandBuffer acquire(uint32_t slot);
+		uint32_t getSlotCount() const { return m_slotCount; }
+
+		void release();
+
+	private:
+		struct SlotPool
+		{
+			VkCommandPool pool;
+			std::vector<VkCommandBuffer> buffers;
+			uint32_t usedCount;
+		};
+
+		bool m_isInitialized;
+		VkDevice m_device;
+		uint32_t m_slotCount;
+
+		std::array<std::vector<SlotPool>, MAX_FRAMES_IN_FLIGHT> m_frames;
+		uint32_t m_currentFrame;
+	};
+}
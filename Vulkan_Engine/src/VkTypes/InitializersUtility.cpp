@@ -2,7 +2,6 @@
 #include "Engine/Window.h"
 #include "InitializersUtility.h"
 #include "VkTexture.h"
-#include "BuffersUBO.h"
 
 bool vkinit::Surface::createSurface(VkSurfaceKHR& surface, VkInstance instance, const Window* window)
 {
@@ -145,10 +144,120 @@ bool vkinit::Surface::createRenderPass(VkRenderPass& renderPass, VkDevice device
 	return vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) == VK_SUCCESS;
 }
 
-bool vkinit::Descriptor::createDescriptorPool(VkDescriptorPool& descriptorPool, VkDevice device, uint32_t count)
+bool vkinit::Surface::createOcclusionRenderPasses(VkRenderPass& firstPhase, VkRenderPass& secondPhase, VkDevice device, VkFormat swapchainImageFormat)
+{
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	constexpr VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	constexpr VkAccessFlags attachmentAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	std::array<VkAttachmentDescription, 2> attachments = {
+		ColorAttachement(swapchainImageFormat, RenderPassAttachement::LoadTransitionState::Clear, RenderPassAttachement::StoreTransitionState::Store,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL).getAttachement(),
+		DepthAttachment(DepthAttachment::FORMAT, RenderPassAttachement::LoadTransitionState::Clear, RenderPassAttachement::StoreTransitionState::Store,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL).getAttachement()
+	};
+
+	// The first half hands the depth over to the pyramid build, the second waits for it to finish reading
+	std::array<VkSubpassDependency, 2> dependencies{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = attachmentStages;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = attachmentStages;
+	dependencies[0].dstAccessMask = attachmentAccess;
+	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = attachmentStages;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dependencyFlags = 0;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = as_uint32(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = as_uint32(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &firstPhase) != VK_SUCCESS)
+		return false;
+
+	attachments[0] = ColorAttachement(swapchainImageFormat, RenderPassAttachement::LoadTransitionState::Preserve, RenderPassAttachement::StoreTransitionState::Store,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR).getAttachement();
+	attachments[1] = DepthAttachment(DepthAttachment::FORMAT, RenderPassAttachement::LoadTransitionState::Preserve, RenderPassAttachement::StoreTransitionState::Discard,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL).getAttachement();
+
+	dependencies[0].srcStageMask = attachmentStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dependencyFlags = 0;
+	renderPassInfo.dependencyCount = 1u;
+
+	return vkCreateRenderPass(device, &renderPassInfo, nullptr, &secondPhase) == VK_SUCCESS;
+}
+
+bool vkinit::Surface::createDepthRenderPass(VkRenderPass& renderPass, VkDevice device, bool preserveDepth, VkImageLayout finalLayout)
+{
+	const auto attachment = preserveDepth ?
+		DepthAttachment(DepthAttachment::FORMAT, RenderPassAttachement::LoadTransitionState::Preserve, RenderPassAttachement::StoreTransitionState::Store,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, finalLayout) :
+		DepthAttachment(DepthAttachment::FORMAT, RenderPassAttachement::LoadTransitionState::Clear, RenderPassAttachement::StoreTransitionState::Store,
+			VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
+	const auto attachmentDescription = attachment.getAttachement();
+
+	VkAttachmentReference depthAttachment{};
+	depthAttachment.attachment = 0;
+	depthAttachment.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.pDepthStencilAttachment = &depthAttachment;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &attachmentDescription;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	// The attachment may still be read by a copy recorded for an earlier frame
+	VkSubpassDependency dependency;
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependency.srcAccessMask = 0;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+	renderPassInfo.dependencyCount = 1u;
+	renderPassInfo.pDependencies = &dependency;
+
+	return vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) == VK_SUCCESS;
+}
+
+bool vkinit::Descriptor::createDescriptorPool(VkDescriptorPool& descriptorPool, VkDevice device, uint32_t count, VkDescriptorType type)
 {
 	VkDescriptorPoolSize poolSize{};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSize.type = type;
 	poolSize.descriptorCount = count;
 
 	VkDescriptorPoolCreateInfo poolInfo{};
@@ -172,9 +281,26 @@ bool vkinit::Descriptor::createDescriptorSetLayout(VkDescriptorSetLayout& descri
 	return vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &descriptorSetLayout) == VK_SUCCESS;
 }
 
-bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets, VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout)
+bool vkinit::Descriptor::createDescriptorSetLayout(VkDescriptorSetLayout& descriptorSetLayout, VkDevice device, const std::vector<ShaderBinding>& bindings)
 {
-	std::array<VkDescriptorSetLayout, SWAPCHAIN_IMAGE_COUNT> layouts{};
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(bindings.size());
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		layoutBindings[i] = bindings[i].getLayoutBinding();
+		layoutBindings[i].binding = as_uint32(i);
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCI{};
+	layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCI.bindingCount = as_uint32(layoutBindings.size());
+	layoutCI.pBindings = layoutBindings.data();
+
+	return vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &descriptorSetLayout) == VK_SUCCESS;
+}
+
+bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout)
+{
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts{};
 	for (auto& l : layouts)
 	{
 		l = descriptorSetLayout;
@@ -183,7 +309,7 @@ bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCH
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = SWAPCHAIN_IMAGE_COUNT;
+	allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
 	allocInfo.pSetLayouts = layouts.data();
 
 	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
@@ -195,54 +321,14 @@ bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCH
 	return true;
 }
 
-void vkinit::Descriptor::updateDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets, VkDevice device, const BuffersUBO& ubo)
+void vkinit::Descriptor::updateDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, const VkTexture2D& texture)
 {
-	std::array<VkWriteDescriptorSet, SWAPCHAIN_IMAGE_COUNT> descriptorWrites{};
-	std::array<VkDescriptorBufferInfo, SWAPCHAIN_IMAGE_COUNT> bufferInfo{};
-	for (size_t i = 0; i < SWAPCHAIN_IMAGE_COUNT; i++)
-	{
-		bufferInfo[i].buffer = ubo.buffers[i];
-		bufferInfo[i].offset = 0;
-		bufferInfo[i].range = ubo.byteSize;
-
-		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[i].dstSet = descriptorSets[i];
-		descriptorWrites[i].dstBinding = 0;
-		descriptorWrites[i].dstArrayElement = 0;
-		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[i].descriptorCount = 1;
-		descriptorWrites[i].pBufferInfo = &bufferInfo[i];
-	}
-	vkUpdateDescriptorSets(device, SWAPCHAIN_IMAGE_COUNT, descriptorWrites.data(), 0, nullptr);
+	vkinit::Descriptor::updateDescriptorSets(descriptorSets, device, texture.imageView, texture.sampler);
 }
 
-bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets,
-	VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, const VkTexture2D& texture)
+void vkinit::Descriptor::updateDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, VkImageView imageView, VkSampler sampler)
 {
-	return vkinit::Descriptor::createDescriptorSets(descriptorSets, device, descriptorPool, descriptorSetLayout, texture.imageView, texture.sampler);
-}
-
-bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets,
-	VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VkImageView imageView, VkSampler sampler)
-{
-	constexpr auto imageCount = SWAPCHAIN_IMAGE_COUNT;
-	std::array<VkDescriptorSetLayout, imageCount> layouts{};
-	for (auto& l : layouts)
-	{
-		l = descriptorSetLayout;
-	}
-
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = imageCount;
-	allocInfo.pSetLayouts = layouts.data();
-
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-	{
-		printf("Failed to allocate descriptor sets!\n");
-		return false;
-	}
+	constexpr auto imageCount = MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorImageInfo imageInfo{};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -262,8 +348,34 @@ bool vkinit::Descriptor::createDescriptorSets(std::array<VkDescriptorSet, SWAPCH
 
 	}
 	vkUpdateDescriptorSets(device, imageCount, descriptorWrites.data(), 0, nullptr);
+}
 
-	return true;
+void vkinit::Descriptor::updateDescriptorSet(VkDescriptorSet descriptorSet, VkDevice device, VkBuffer buffer, VkDeviceSize byteSize, VkDescriptorType type)
+{
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = byteSize;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = type;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+bool vkinit::Commands::createCommandPool(VkCommandPool& pool, VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = flags;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	return vkCreateCommandPool(device, &poolInfo, nullptr, &pool) == VK_SUCCESS;
 }
 
 bool vkinit::Commands::createSingleCommandBuffer(VkCommandBuffer& commandBuffer, VkCommandPool pool, VkDevice device)
@@ -277,14 +389,14 @@ bool vkinit::Commands::createSingleCommandBuffer(VkCommandBuffer& commandBuffer,
 	return vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) == VK_SUCCESS;
 }
 
-bool vkinit::Commands::createCommandBuffers(std::vector<VkCommandBuffer>& commandBufferCollection, uint32_t count, VkCommandPool pool, VkDevice device)
+bool vkinit::Commands::createCommandBuffers(std::vector<VkCommandBuffer>& commandBufferCollection, uint32_t count, VkCommandPool pool, VkDevice device, VkCommandBufferLevel level)
 {
 	commandBufferCollection.resize(count);
 
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = pool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.level = level;
 	allocInfo.commandBufferCount = count;
 
 	return vkAllocateCommandBuffers(device, &allocInfo, commandBufferCollection.data()) == VK_SUCCESS;
@@ -303,6 +415,16 @@ void vkinit::Commands::initViewportAndScissor(VkViewport& viewport, VkRect2D& sc
 	scissor.extent = extent;
 }
 
+bool vkinit::Commands::createTimestampQueryPool(VkQueryPool& queryPool, VkDevice device, uint32_t queryCount)
+{
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = queryCount;
+
+	return vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) == VK_SUCCESS;
+}
+
 bool vkinit::Synchronization::createSemaphore(VkSemaphore& semaphore, VkDevice device)
 {
 	VkSemaphoreCreateInfo semaphoreInfo{};
@@ -324,6 +446,20 @@ bool vkinit::Synchronization::createFence(VkFence& fence, VkDevice device, bool
 	return vkCreateFence(device, &fenceInfo, nullptr, &fence) == VK_SUCCESS;
 }
 
+bool vkinit::Synchronization::createTimelineSemaphore(VkSemaphore& semaphore, VkDevice device, uint64_t initialValue)
+{
+	VkSemaphoreTypeCreateInfoKHR typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	typeInfo.initialValue = initialValue;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	return vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) == VK_SUCCESS;
+}
+
 bool vkinit::Texture::createSwapchain(VkSwapchainKHR& swapchain, VkDevice device, VkSurfaceKHR surface, uint32_t imageCount, VkExtent2D extent, VkPresentModeKHR presentationMode, VkSurfaceFormatKHR surfaceFormat, VkSurfaceTransformFlagBitsKHR currentTransform)
 {
 	VkSwapchainCreateInfoKHR createInfo{};
@@ -454,6 +590,30 @@ bool vkinit::MemoryBuffer::allocateBufferAndMemory(VkBuffer& buffer, VmaAllocati
 	return vmaCreateBuffer(vmaAllocator, &bufferInfo, &vmaACI, &buffer, &memRange, nullptr) == VK_SUCCESS;
 }
 
+bool vkinit::MemoryBuffer::allocateMappedBuffer(VkBuffer& buffer, VmaAllocation& memRange, void** mappedData, VkDeviceSize totalSizeBytes, VmaMemoryUsage memUsage, VkBufferUsageFlags flags)
+{
+	VmaAllocationCreateInfo vmaACI{};
+	vmaACI.usage = memUsage;
+	vmaACI.flags = mappedData ? VMA_ALLOCATION_CREATE_MAPPED_BIT : 0;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.usage = flags;
+	bufferInfo.size = totalSizeBytes;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationInfo allocationInfo{};
+	if (vmaCreateBuffer(VkMemoryAllocator::getInstance()->m_allocator, &bufferInfo, &vmaACI, &buffer, &memRange, &allocationInfo) != VK_SUCCESS)
+	{
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (mappedData)
+		*mappedData = allocationInfo.pMappedData;
+	return true;
+}
+
 bool vkinit::MemoryBuffer::createBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t bufferSize)
 {
 	VkBufferCreateInfo bufferInfo{};
@@ -505,6 +665,49 @@ int32_t vkinit::MemoryBuffer::findSuitableProperties(const VkPhysicalDeviceMemor
 	return -1;
 }
 
+VkDescriptorSetLayoutBinding vkinit::Compute::getBinding(uint32_t binding, VkDescriptorType type)
+{
+	VkDescriptorSetLayoutBinding layoutBinding{};
+	layoutBinding.binding = binding;
+	layoutBinding.descriptorType = type;
+	layoutBinding.descriptorCount = 1;
+	layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	return layoutBinding;
+}
+
+bool vkinit::Compute::createPipelineLayout(VkDescriptorSetLayout& setLayout, VkPipelineLayout& pipelineLayout, VkDevice device,
+	const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize)
+{
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = bindingCount;
+	setLayoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		return false;
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	return vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) == VK_SUCCESS;
+}
+
+void vkinit::Compute::memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
 // Only works for host coherent memory type
 bool vkinit::MemoryBuffer::fillMemory(VkDevice device, VkDeviceMemory memory, const void* source, uint32_t size)
 {
@@ -528,10 +731,16 @@ VkDescriptorSetLayoutBinding vkinit::ShaderBinding::getLayoutBinding() const
 	return setLayoutBinding;
 }
 
-vkinit::ShaderBinding::ShaderBinding(VkDescriptorType type, VkShaderStageFlags shaderStages) : m_type(type), m_shaderStages(shaderStages), m_descCount(1) { }
+vkinit::ShaderBinding::ShaderBinding(VkDescriptorType type, VkShaderStageFlags shaderStages, uint32_t descriptorCount) : m_type(type), m_shaderStages(shaderStages), m_descCount(descriptorCount) { }
 
 vkinit::BoundBuffer::BoundBuffer(VkShaderStageFlags stageFlags) : ShaderBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, stageFlags) { }
 
+vkinit::BoundDynamicBuffer::BoundDynamicBuffer(VkShaderStageFlags stageFlags) : ShaderBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, stageFlags) { }
+
 vkinit::BoundTexture::BoundTexture(VkShaderStageFlags stageFlags) : ShaderBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stageFlags) { }
 
+vkinit::BoundTextureArray::BoundTextureArray(VkShaderStageFlags stageFlags, uint32_t textureCount) : ShaderBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stageFlags, textureCount) { }
+
+vkinit::BoundStorageBuffer::BoundStorageBuffer(VkShaderStageFlags stageFlags) : ShaderBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stageFlags) { }
+
 vkinit::ShaderBindingArgs::ShaderBindingArgs(VkDescriptorType type, VkShaderStageFlags shaderStages) : type(type), shaderStages(shaderStages) { }
@@ -5,7 +5,6 @@
 class Window;
 struct VkTexture2D;
 class VulkanValidationLayers;
-struct BuffersUBO;
 
 namespace vkinit
 {
@@ -23,21 +22,31 @@ namespace vkinit
 	{
 		static bool createSurface(VkSurfaceKHR& surface, VkInstance instance, const Window* window);
 		static bool createRenderPass(VkRenderPass& renderPass, VkDevice device, VkFormat swapchainImageFormat, bool enableDepthAttachment);
+		// Depth only pass that either clears or keeps the depth already in the attachment, which then has to be in the attachment layout.
+		static bool createDepthRenderPass(VkRenderPass& renderPass, VkDevice device, bool preserveDepth, VkImageLayout finalLayout);
+		// The forward pass split around the occlusion culling, both halves are compatible with createRenderPass with a depth attachment.
+		// The first clears and leaves the depth for compute shaders to read, the second loads both attachments and presents.
+		static bool createOcclusionRenderPasses(VkRenderPass& firstPhase, VkRenderPass& secondPhase, VkDevice device, VkFormat swapchainImageFormat);
 
 		static bool createFrameBuffer(VkFramebuffer& frameBuffer, VkDevice device, VkRenderPass renderPass, VkExtent2D extent, const std::array<VkImageView, SWAPCHAIN_IMAGE_COUNT>& imageViews, uint32_t count = std::numeric_limits<uint32_t>::max());
 	};
 
 	struct Commands
 	{
+		static bool createCommandPool(VkCommandPool& pool, VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 		static bool createSingleCommandBuffer(VkCommandBuffer& commandBuffer, VkCommandPool pool, VkDevice device);
-		static bool createCommandBuffers(std::vector<VkCommandBuffer>& commandBufferCollection, uint32_t count, VkCommandPool pool, VkDevice device);
+		static bool createCommandBuffers(std::vector<VkCommandBuffer>& commandBufferCollection, uint32_t count, VkCommandPool pool, VkDevice device,
+			VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 		static void initViewportAndScissor(VkViewport& viewport, VkRect2D& scissor, VkExtent2D extent, int32_t offsetX = 0, int32_t offsetY = 0);
+		static bool createTimestampQueryPool(VkQueryPool& queryPool, VkDevice device, uint32_t queryCount);
 	};
 
 	struct Synchronization
 	{
 		static bool createSemaphore(VkSemaphore& semaphore, VkDevice device);
 		static bool createFence(VkFence& fence, VkDevice device, bool createSignaled = true);
+		// Needs VK_KHR_timeline_semaphore and its feature enabled on the device.
+		static bool createTimelineSemaphore(VkSemaphore& semaphore, VkDevice device, uint64_t initialValue = 0u);
 	};
 	
 	struct Texture
@@ -62,7 +71,7 @@ namespace vkinit
 	{
 		VkDescriptorSetLayoutBinding getLayoutBinding() const;
 
-		ShaderBinding(VkDescriptorType type, VkShaderStageFlags shaderStages);
+		ShaderBinding(VkDescriptorType type, VkShaderStageFlags shaderStages, uint32_t descriptorCount = 1u);
 	private:
 		VkDescriptorType m_type;
 		VkShaderStageFlags m_shaderStages;
@@ -74,29 +83,56 @@ namespace vkinit
 		BoundBuffer(VkShaderStageFlags stageFlags);
 	};
 
+	// Bound with an offset into the buffer, see UniformRing.
+	struct BoundDynamicBuffer : ShaderBinding
+	{
+		BoundDynamicBuffer(VkShaderStageFlags stageFlags);
+	};
+
 	struct BoundTexture : ShaderBinding
 	{
 		BoundTexture(VkShaderStageFlags stageFlags);
 	};
 
+	struct BoundTextureArray : ShaderBinding
+	{
+		BoundTextureArray(VkShaderStageFlags stageFlags, uint32_t textureCount);
+	};
+
+	struct BoundStorageBuffer : ShaderBinding
+	{
+		BoundStorageBuffer(VkShaderStageFlags stageFlags);
+	};
+
 	struct Descriptor
 	{
-		static bool createDescriptorPool(VkDescriptorPool& descriptorPool, VkDevice device, uint32_t count);
+		static bool createDescriptorPool(VkDescriptorPool& descriptorPool, VkDevice device, uint32_t count, VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 		static bool createDescriptorSetLayout(VkDescriptorSetLayout& descriptorSetLayout, VkDevice device, const ShaderBinding& binding);
-		static bool createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets,
-			VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, const VkTexture2D& texture);
-		static bool createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets,
-			VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VkImageView imageView, VkSampler sampler);
-
-		static bool createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets,
+		// The bindings are numbered in the order they are passed in.
+		static bool createDescriptorSetLayout(VkDescriptorSetLayout& descriptorSetLayout, VkDevice device, const std::vector<ShaderBinding>& bindings);
+		static bool createDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets,
 			VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout);
-		static void updateDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets, VkDevice device, const BuffersUBO& ubo);
+		static void updateDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, const VkTexture2D& texture);
+		static void updateDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, VkImageView imageView, VkSampler sampler);
+		// The buffer from its start, a dynamic descriptor adds the offset it is bound with.
+		static void updateDescriptorSet(VkDescriptorSet descriptorSet, VkDevice device, VkBuffer buffer, VkDeviceSize byteSize, VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	};
+
+	struct Compute
+	{
+		static VkDescriptorSetLayoutBinding getBinding(uint32_t binding, VkDescriptorType type);
+		// One descriptor set and one push constant block, both only visible to the compute stage.
+		static bool createPipelineLayout(VkDescriptorSetLayout& setLayout, VkPipelineLayout& pipelineLayout, VkDevice device,
+			const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize);
+		static void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
 	};
 
 	struct MemoryBuffer
 	{
 		static bool createVmaAllocator(VmaAllocator& vmaAllocator, VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device);
 		static bool allocateBufferAndMemory(VkBuffer& buffer, VmaAllocation& memRange, VmaAllocator vmaAllocator, uint32_t totalSizeBytes, VmaMemoryUsage memUsage, VkBufferUsageFlags flags);
+		// Persistently mapped when mappedData is given, the buffer is left null on failure.
+		static bool allocateMappedBuffer(VkBuffer& buffer, VmaAllocation& memRange, void** mappedData, VkDeviceSize totalSizeBytes, VmaMemoryUsage memUsage, VkBufferUsageFlags flags);
 		static bool createBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t bufferSize);
 		static int32_t findSuitableProperties(const VkPhysicalDeviceMemoryProperties* pMemoryProperties, uint32_t memoryTypeBitsRequirement, VkMemoryPropertyFlags requiredProperties);
 
@@ -30,12 +30,13 @@ void PipelineConstruction::RenderPass::submit(VkGraphicsPipelineCreateInfo& pipe
 	pipelineCI.renderPass = m_renderPass;
 }
 
-PipelineConstruction::ShaderStage::ShaderStage(VkShaderModule shader, SupportedStages stage, const char* fnName)
+PipelineConstruction::ShaderStage::ShaderStage(VkShaderModule shader, SupportedStages stage, const char* fnName, const VkSpecializationInfo* specialization)
 {
 	m_createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	m_createInfo.stage = static_cast<VkShaderStageFlagBits>(stage);
 	m_createInfo.module = shader;
 	m_createInfo.pName = fnName ? fnName : "main";
+	m_createInfo.pSpecializationInfo = specialization;
 }
 bool PipelineConstruction::ShaderStage::isValid() const { return m_createInfo.module != VK_NULL_HANDLE; }
 void PipelineConstruction::ShaderStage::submit(VkGraphicsPipelineCreateInfo& pipelineCI) const { throw std::exception("Should not call submit on ShaderStage."); }
@@ -77,10 +78,10 @@ void PipelineConstruction::InputAssembly::submit(VkGraphicsPipelineCreateInfo& p
 	pipelineCI.pInputAssemblyState = &m_createInfo;
 }
 
-PipelineConstruction::RasterizationState::RasterizationState(FaceCulling faceCullingMode, TriangleWinding winding, PolygonMode polygoneMode)
+PipelineConstruction::RasterizationState::RasterizationState(FaceCulling faceCullingMode, TriangleWinding winding, PolygonMode polygoneMode, bool depthClamp)
 {
 	m_createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	m_createInfo.depthClampEnable = VK_FALSE;
+	m_createInfo.depthClampEnable = depthClamp ? VK_TRUE : VK_FALSE;
 	m_createInfo.rasterizerDiscardEnable = VK_FALSE;
 	m_createInfo.polygonMode = static_cast<VkPolygonMode>(polygoneMode);
 	m_createInfo.lineWidth = 1.0f;
@@ -195,22 +196,6 @@ void PipelineConstruction::DynamicState::submit(VkGraphicsPipelineCreateInfo& pi
 	pipelineCI.pDynamicState = &m_createInfo;
 }
 
-VkFormat pickDataFormat(size_t size)
-{
-	static const VkFormat formats[4]{
-		VkFormat::VK_FORMAT_R32_SFLOAT,
-		VkFormat::VK_FORMAT_R32G32_SFLOAT,
-		VkFormat::VK_FORMAT_R32G32B32_SFLOAT,
-		VkFormat::VK_FORMAT_R32G32B32A32_SFLOAT,
-	};
-
-	auto index = size / sizeof(float) - 1;
-
-	assert((size % sizeof(float) == 0) && index >= 0 && index < 4 && "The vertex attribute data type is not supported.");
-
-	return formats[index];
-}
-
 PipelineConstruction::VertexInputState::VertexInputState(const MeshDescriptor* meshDescriptor) : m_isValid(true)
 {
 	m_createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -229,7 +214,7 @@ PipelineConstruction::VertexInputState::VertexInputState(const MeshDescriptor* m
 
 			attributeDescriptions[i].binding = 0;
 			attributeDescriptions[i].location = i;
-			attributeDescriptions[i].format = pickDataFormat(size);
+			attributeDescriptions[i].format = meshDescriptor->formats[i];
 			attributeDescriptions[i].offset = as_uint32(offset);
 
 			offset += size * std::clamp(meshDescriptor->lengths[i], 0_z, 1_z);
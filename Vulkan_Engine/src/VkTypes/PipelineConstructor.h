@@ -4,6 +4,8 @@
 #include "VkTypes/VkShader.h"
 #include "InitializersUtility.h"
 #include "CollectionUtility.h"
+#include "VkPipelineCacheStore.h"
+#include "Profiling/ProfileMarker.h"
 
 namespace PipelineConstruction
 {
@@ -53,10 +55,12 @@ namespace PipelineConstruction
 		enum class SupportedStages
 		{
 			Vertex = VK_SHADER_STAGE_VERTEX_BIT,
-			Fragment = VK_SHADER_STAGE_FRAGMENT_BIT
+			Fragment = VK_SHADER_STAGE_FRAGMENT_BIT,
+			Compute = VK_SHADER_STAGE_COMPUTE_BIT
 		};
 
-		ShaderStage(VkShaderModule shader, SupportedStages stage, const char* fnName = nullptr);
+		// The specialization info has to outlive the pipeline creation.
+		ShaderStage(VkShaderModule shader, SupportedStages stage, const char* fnName = nullptr, const VkSpecializationInfo* specialization = nullptr);
 
 		bool isValid() const override;
 		const VkPipelineShaderStageCreateInfo getCreateInfo() const;
@@ -106,7 +110,7 @@ namespace PipelineConstruction
 	};
 	struct RasterizationState : ComponentCI<VkPipelineRasterizationStateCreateInfo>
 	{
-		RasterizationState(FaceCulling faceCullingMode, TriangleWinding winding = TriangleWinding::CCW, PolygonMode polygoneMode = PolygonMode::Fill);
+		RasterizationState(FaceCulling faceCullingMode, TriangleWinding winding = TriangleWinding::CCW, PolygonMode polygoneMode = PolygonMode::Fill, bool depthClamp = false);
 
 		bool isValid() const override;
 		void submit(VkGraphicsPipelineCreateInfo& pipelineCI) const override;
@@ -177,21 +181,31 @@ namespace PipelineConstruction
 	};
 
 	static bool createPipeline(VkPipeline& pipelineInstance, const VkPipelineLayout pipelineLayout, const VkDevice device, const VkRenderPass renderPass,
-		VkExtent2D swapchainExtent, const VkShader& shader, const MeshDescriptor* descriptor, FaceCulling faceCullingMode, bool depthStencilAttachement)
+		VkExtent2D swapchainExtent, const VkShader& shader, const MeshDescriptor* descriptor, FaceCulling faceCullingMode, bool depthStencilAttachement, bool depthClamp = false,
+		uint32_t textureTableSize = 1u)
 	{
 		VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
 
 		auto pipeline = GraphicsPipelineCI(pipelineLayout);
 		auto renderPassState = RenderPass(renderPass);
 
-		auto vertStage = ShaderStage(shader.vertShader, ShaderStage::SupportedStages::Vertex);
-		auto fragStage = ShaderStage(shader.fragShader, ShaderStage::SupportedStages::Fragment);
+		// Constant 0 of the vertex shaders tells them the normals are octahedral encoded, as in the compact vertex format
+		const VkBool32 octahedralNormals = descriptor && descriptor->format == MeshDescriptor::EVertexFormat::Compact ? VK_TRUE : VK_FALSE;
+		const VkSpecializationMapEntry vertexFormatEntry{ 0u, 0u, sizeof(VkBool32) };
+		const VkSpecializationInfo vertexSpecialization{ 1u, &vertexFormatEntry, sizeof(VkBool32), &octahedralNormals };
+
+		// Constant 0 of the fragment shaders sizes the material texture array, it has to match the bound texture table
+		const VkSpecializationMapEntry textureCountEntry{ 0u, 0u, sizeof(uint32_t) };
+		const VkSpecializationInfo fragmentSpecialization{ 1u, &textureCountEntry, sizeof(uint32_t), &textureTableSize };
+
+		auto vertStage = ShaderStage(shader.vertShader, ShaderStage::SupportedStages::Vertex, nullptr, &vertexSpecialization);
+		auto fragStage = ShaderStage(shader.fragShader, ShaderStage::SupportedStages::Fragment, nullptr, &fragmentSpecialization);
 		PipelineStageCollection allStages(&vertStage, &fragStage);
 
 		auto vertexInputState = VertexInputState(descriptor);
 		auto inputAssembly = InputAssembly();
 		auto viewportState = ViewportState(swapchainExtent);
-		auto rasterizationState = RasterizationState(faceCullingMode);
+		auto rasterizationState = RasterizationState(faceCullingMode, TriangleWinding::CCW, PolygonMode::Fill, depthClamp);
 		auto multisampleState = MultisampleState();
 		auto depthStencilState = DepthStencilState(depthStencilAttachement);
 		auto colorBlendState = ColorBlendState();
@@ -222,6 +236,36 @@ namespace PipelineConstruction
 			createInfo->submitIfValid(pipelineCreateInfo);
 		}
 
-		return vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipelineInstance) == VK_SUCCESS;
+		int64_t creation_us = 0;
+		VkResult result;
+		{
+			const auto marker = ProfileMarkerInjectResult(creation_us, true);
+			result = vkCreateGraphicsPipelines(device, VkPipelineCacheStore::getHandle(), 1, &pipelineCreateInfo, nullptr, &pipelineInstance);
+		}
+
+		if (auto* cacheStore = VkPipelineCacheStore::getInstance())
+			cacheStore->recordPipelineCreation(creation_us);
+
+		return result == VK_SUCCESS;
+	}
+
+	static bool createComputePipeline(VkPipeline& pipelineInstance, const VkPipelineLayout pipelineLayout, const VkDevice device, VkShaderModule shader)
+	{
+		VkComputePipelineCreateInfo pipelineCreateInfo{};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stage = ShaderStage(shader, ShaderStage::SupportedStages::Compute).getCreateInfo();
+		pipelineCreateInfo.layout = pipelineLayout;
+
+		int64_t creation_us = 0;
+		VkResult result;
+		{
+			const auto marker = ProfileMarkerInjectResult(creation_us, true);
+			result = vkCreateComputePipelines(device, VkPipelineCacheStore::getHandle(), 1, &pipelineCreateInfo, nullptr, &pipelineInstance);
+		}
+
+		if (auto* cacheStore = VkPipelineCacheStore::getInstance())
+			cacheStore->recordPipelineCreation(creation_us);
+
+		return result == VK_SUCCESS;
 	}
 }
\ No newline at end of file
@@ -21,8 +21,3 @@ struct ViewUBO
 
 	glm::vec4 cameraPosition;
 };
-
-struct TransformPushConstant
-{
-	glm::mat4 model_matrix;
-};
@@ -6,28 +6,36 @@
 #include "Material.h"
 #include "Engine/Bitmask.h"
 
-VkMaterialVariant::VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets)
-	: m_pipeline(pipeline), m_pipelineLayout(pipelineLayout), m_descriptorSetLayout(descriptorSetLayout), m_descriptorSets(descriptorSets) { }
+VkMaterialVariant::VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets)
+	: m_pipeline(pipeline), m_pipelineLayout(pipelineLayout), m_descriptorSetLayout(descriptorSetLayout), m_descriptorSets(descriptorSets), m_textureIndex(0u) { }
+
+VkMaterialVariant::VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, uint32_t textureIndex)
+	: m_pipeline(pipeline), m_pipelineLayout(pipelineLayout), m_descriptorSetLayout(VK_NULL_HANDLE), m_descriptorSets(), m_textureIndex(textureIndex) { }
 
 const VkPipeline VkMaterialVariant::getPipeline() const { return m_pipeline; }
 const VkPipelineLayout VkMaterialVariant::getPipelineLayout() const { return m_pipelineLayout; }
 const VkDescriptorSetLayout VkMaterialVariant::getDescriptorSetLayout() const { return m_descriptorSetLayout; }
-const VkDescriptorSet* VkMaterialVariant::getDescriptorSet(uint32_t frameNumber) const { return &m_descriptorSets[frameNumber % SWAPCHAIN_IMAGE_COUNT]; }
+const VkDescriptorSet* VkMaterialVariant::getDescriptorSet(uint32_t frameIndex) const { return &m_descriptorSets[frameIndex % MAX_FRAMES_IN_FLIGHT]; }
+uint32_t VkMaterialVariant::getTextureIndex() const { return m_textureIndex; }
+bool VkMaterialVariant::hasDescriptorSets() const { return m_descriptorSetLayout != VK_NULL_HANDLE; }
+void VkMaterialVariant::setDescriptorSets(const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets) { m_descriptorSets = descriptorSets; }
 
 VariantStateChange VkMaterialVariant::compare(const VkMaterialVariant* other) const
 {
 	VariantStateChange state = VariantStateChange::None;
 
+	// The values are bit indices, not masks
 	if (other == nullptr)
 	{
-		return static_cast<VariantStateChange>(
-			VariantStateChange::Pipeline | VariantStateChange::DescriptorSet_GlobalUBO |
-			VariantStateChange::DescriptorSet_CameraUBO | VariantStateChange::DescriptorSet
-			);
+		state = bitFlagAppend(state, VariantStateChange::Pipeline);
+		state = bitFlagAppend(state, VariantStateChange::DescriptorSet_GlobalUBO);
+		state = bitFlagAppend(state, VariantStateChange::DescriptorSet_CameraUBO);
+		return bitFlagAppend(state, VariantStateChange::DescriptorSet);
 	}
 
 	state = bitFlagAppendIf(state, m_pipeline != other->m_pipeline, VariantStateChange::Pipeline);
-	state = bitFlagAppendIf(state, &m_descriptorSets != &other->m_descriptorSets, VariantStateChange::DescriptorSet);
+	// Variants sampling from the texture table share the set bound for the whole pass
+	state = bitFlagAppendIf(state, (hasDescriptorSets() || other->hasDescriptorSets()) && &m_descriptorSets != &other->m_descriptorSets, VariantStateChange::DescriptorSet);
 
 	return state;
 }
@@ -21,12 +21,19 @@ enum VariantStateChange : uint32_t
 
 struct VkMaterialVariant
 {
-	VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets);
+	VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, const VkDescriptorSetLayout descriptorSetLayout, std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets);
+	// Samples its texture from the texture table at textureIndex, it has no descriptor sets of its own.
+	VkMaterialVariant(const VkPipeline pipeline, const VkPipelineLayout pipelineLayout, uint32_t textureIndex);
 
 	const VkPipeline getPipeline() const;
 	const VkPipelineLayout getPipelineLayout() const;
-	const VkDescriptorSet* getDescriptorSet(uint32_t frameNumber) const;
+	const VkDescriptorSet* getDescriptorSet(uint32_t frameIndex) const;
 	const VkDescriptorSetLayout getDescriptorSetLayout() const;
+	uint32_t getTextureIndex() const;
+	bool hasDescriptorSets() const;
+
+	// Only safe with freshly allocated sets, the previous ones may still be referenced by frames in flight.
+	void setDescriptorSets(const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets);
 
 	VariantStateChange compare(const VkMaterialVariant* other) const;
 
@@ -37,5 +44,6 @@ private:
 	const VkPipelineLayout m_pipelineLayout;
 	const VkDescriptorSetLayout m_descriptorSetLayout;
 
-	std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT> m_descriptorSets;
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_descriptorSets;
+	uint32_t m_textureIndex;
 };
@@ -3,16 +3,38 @@
 #include "IndexAttributes.h"
 #include "VertexAttributes.h"
 
-VkMesh::VkMesh() : vAttributes(nullptr), vCount(0), iAttributes() { }
-VkMesh::VkMesh(VkMesh&& fwdRef) noexcept : vAttributes(std::move(fwdRef.vAttributes)), vCount(fwdRef.vCount), iAttributes(std::move(fwdRef.iAttributes)) {}
-VkMesh::~VkMesh() = default;
+VkMeshBuffers::VkMeshBuffers(UNQ<VertexAttributes>&& vertexAttributes, IndexAttributes&& indexAttributes)
+	: vAttributes(std::move(vertexAttributes)), iAttributes(std::move(indexAttributes)) { }
+VkMeshBuffers::~VkMeshBuffers() = default;
+
+VkBuffer VkMeshBuffers::getVertexBuffer() const { return vAttributes->getBuffer(0); }
+VkBuffer VkMeshBuffers::getIndexBuffer() const { return iAttributes.getBuffer(); }
+VkIndexType VkMeshBuffers::getIndexType() const { return iAttributes.getIndexType(); }
+
+void VkMeshBuffers::bind(VkCommandBuffer commandBuffer) const
+{
+	vAttributes->bind(commandBuffer);
+	iAttributes.bind(commandBuffer);
+}
 
-void VkMesh::release(VmaAllocator allocator)
+void VkMeshBuffers::release(VmaAllocator allocator)
 {
 	vAttributes->destroy(allocator);
+	iAttributes.destroy(allocator);
+}
 
-	for (auto& iAttr : iAttributes)
-	{
-		iAttr.destroy(allocator);
-	}
+VkMesh::VkMesh() : buffers(nullptr), vCount(0), positionRange(), vertexTransform(1.0f), submeshes(), lods() { }
+VkMesh::VkMesh(VkMesh&& fwdRef) noexcept : buffers(fwdRef.buffers), vCount(fwdRef.vCount), positionRange(fwdRef.positionRange), vertexTransform(fwdRef.vertexTransform),
+	submeshes(std::move(fwdRef.submeshes)), lods(std::move(fwdRef.lods)) {}
+VkMesh::~VkMesh() = default;
+
+const VkSubMeshRange& VkMesh::getRange(uint32_t submeshIndex, uint32_t lod) const
+{
+	if (lod == 0 || submeshIndex >= lods.size() || lods[submeshIndex].empty())
+		return submeshes[submeshIndex];
+
+	const auto& submeshLods = lods[submeshIndex];
+	return submeshLods[std::min<size_t>(lod, submeshLods.size()) - 1];
 }
+
+uint32_t VkMesh::getLodCount(uint32_t submeshIndex) const { return submeshIndex < lods.size() ? 1u + as_uint32(lods[submeshIndex].size()) : 1u; }
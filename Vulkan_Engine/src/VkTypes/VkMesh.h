@@ -2,10 +2,37 @@
 #include "pch.h"
 #include "EngineCore/Common.h"
 #include "IndexAttributes.h"
+#include "EngineCore/VertexQuantization.h"
 
 struct VmaAllocator_T;
 struct VertexAttributes;
 
+// Device local vertex and index buffers shared by every mesh packed into them, the meshes all use the index type of the buffers.
+struct VkMeshBuffers
+{
+public:
+	VkMeshBuffers(UNQ<VertexAttributes>&& vertexAttributes, IndexAttributes&& indexAttributes);
+	~VkMeshBuffers();
+
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getIndexBuffer() const;
+	VkIndexType getIndexType() const;
+
+	void bind(VkCommandBuffer commandBuffer) const;
+	void release(VmaAllocator allocator);
+
+private:
+	UNQ<VertexAttributes> vAttributes;
+	IndexAttributes iAttributes;
+};
+
+struct VkSubMeshRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+};
+
 struct VkMesh
 {
 public:
@@ -13,10 +40,20 @@ public:
 	VkMesh(VkMesh&& fwdRef) noexcept;
 	~VkMesh();
 
-	void release(VmaAllocator allocator);
+	bool isValid() const { return buffers != nullptr; }
 
-	UNQ<VertexAttributes> vAttributes;
+	// LOD 0 is the submesh itself, a lod past the coarsest one is clamped to it.
+	const VkSubMeshRange& getRange(uint32_t submeshIndex, uint32_t lod) const;
+	uint32_t getLodCount(uint32_t submeshIndex) const;
+
+	const VkMeshBuffers* buffers;
 	uint32_t vCount;
-	
-	std::vector<IndexAttributes> iAttributes;
+
+	// Identity unless the vertices are in the compact format, the model matrix of every draw is multiplied by the transform
+	VertexQuantization::PositionRange positionRange;
+	glm::mat4 vertexTransform;
+
+	std::vector<VkSubMeshRange> submeshes;
+	// Coarser ranges of each submesh, lods[submesh][lod - 1]
+	std::vector<std::vector<VkSubMeshRange>> lods;
 };
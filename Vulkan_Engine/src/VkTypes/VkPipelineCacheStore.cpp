@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "VkPipelineCacheStore.h"
+#include "FileManager/FileIO.h"
+#include "FileManager/Path.h"
+
+VkPipelineCacheStore::VkPipelineCacheStore(VkDevice device, const VkPhysicalDeviceProperties& properties, const Path& cachePath)
+	: m_isInitialized(false), m_isWarm(false), m_device(device), m_cache(VK_NULL_HANDLE), m_expectedHeader(), m_cachePath(cachePath.value),
+	m_pipelineCount(0), m_creationTime_us(0)
+{
+	m_expectedHeader.magic = c_magic;
+	m_expectedHeader.headerSize = static_cast<uint32_t>(sizeof(FileHeader));
+	m_expectedHeader.vendorID = properties.vendorID;
+	m_expectedHeader.deviceID = properties.deviceID;
+	m_expectedHeader.driverVersion = properties.driverVersion;
+	std::copy(std::begin(properties.pipelineCacheUUID), std::end(properties.pipelineCacheUUID), m_expectedHeader.pipelineCacheUUID);
+
+	std::vector<char> initialData;
+	m_isWarm = tryLoad(initialData);
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = initialData.size();
+	createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	auto result = vkCreatePipelineCache(device, &createInfo, nullptr, &m_cache);
+	if (result != VK_SUCCESS && m_isWarm)
+	{
+		// The driver may still refuse a blob that passed the header checks, start over with an empty cache
+		printf("The pipeline cache '%s' was rejected by the driver, starting cold.\n", m_cachePath.c_str());
+		m_isWarm = false;
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(device, &createInfo, nullptr, &m_cache);
+	}
+
+	m_isInitialized = result == VK_SUCCESS;
+	if (m_isInitialized)
+		m_instance = this;
+}
+
+bool VkPipelineCacheStore::tryLoad(std::vector<char>& initialData) const
+{
+	std::vector<char> file;
+	if (!FileIO::fileExists(m_cachePath) || !FileIO::readFile(file, Path(std::string(m_cachePath))))
+		return false;
+
+	FileHeader header{};
+	if (file.size() < sizeof(FileHeader))
+	{
+		printf("The pipeline cache '%s' is truncated, starting cold.\n", m_cachePath.c_str());
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(FileHeader));
+
+	if (header.magic != m_expectedHeader.magic || header.headerSize != m_expectedHeader.headerSize ||
+		header.dataSize != file.size() - sizeof(FileHeader))
+	{
+		printf("The pipeline cache '%s' is corrupted, starting cold.\n", m_cachePath.c_str());
+		return false;
+	}
+
+	if (header.vendorID != m_expectedHeader.vendorID || header.deviceID != m_expectedHeader.deviceID || header.driverVersion != m_expectedHeader.driverVersion ||
+		std::memcmp(header.pipelineCacheUUID, m_expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		printf("The pipeline cache '%s' was written by another device or driver, starting cold.\n", m_cachePath.c_str());
+		return false;
+	}
+
+	initialData.assign(file.begin() + sizeof(FileHeader), file.end());
+	return !initialData.empty();
+}
+
+bool VkPipelineCacheStore::save() const
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		return false;
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, data.data()) != VK_SUCCESS)
+		return false;
+
+	auto header = m_expectedHeader;
+	header.dataSize = dataSize;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(m_cachePath).parent_path(), error);
+
+	// Written next to the old cache first, so a crash halfway through never leaves a broken file behind
+	const auto tempPath = m_cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+		file.write(data.data(), dataSize);
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tempPath, m_cachePath, error);
+	return !error;
+}
+
+void VkPipelineCacheStore::recordPipelineCreation(int64_t duration_us)
+{
+	m_pipelineCount += 1;
+	m_creationTime_us += duration_us;
+}
+
+void VkPipelineCacheStore::release()
+{
+	if (m_cache == VK_NULL_HANDLE)
+		return;
+
+	if (!save())
+		printf("Failed to write the pipeline cache to '%s'.\n", m_cachePath.c_str());
+
+	vkDestroyPipelineCache(m_device, m_cache, nullptr);
+	m_cache = VK_NULL_HANDLE;
+
+	if (m_instance == this)
+		m_instance = nullptr;
+}
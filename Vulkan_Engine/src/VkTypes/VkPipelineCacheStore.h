@@ -0,0 +1,57 @@
+#pragma once
+#include "pch.h"
+#include "Interfaces/IRequireInitialization.h"
+
+struct Path;
+
+// Process wide VkPipelineCache, loaded from the library directory at startup and written back on release.
+// The file starts with its own header (device identity and driver version) in front of the blob vkGetPipelineCacheData returned,
+// a blob from another GPU or driver is discarded and the cache starts cold.
+class VkPipelineCacheStore : IRequireInitialization
+{
+public:
+	static VkPipelineCacheStore* getInstance() { return m_instance; }
+	// VK_NULL_HANDLE until the store is created, vkCreateGraphicsPipelines then runs without a cache.
+	static VkPipelineCache getHandle() { return m_instance ? m_instance->m_cache : VK_NULL_HANDLE; }
+
+	VkPipelineCacheStore(VkDevice device, const VkPhysicalDeviceProperties& properties, const Path& cachePath);
+	bool isInitialized() const override { return m_isInitialized; }
+
+	// True when the blob on disk matched this device and seeded the cache.
+	bool isWarm() const { return m_isWarm; }
+
+	void recordPipelineCreation(int64_t duration_us);
+	uint32_t getPipelineCount() const { return m_pipelineCount; }
+	int64_t getCreationTime_us() const { return m_creationTime_us; }
+
+	// Writes the cache back to disk, then destroys it.
+	void release();
+
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t headerSize;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+	constexpr static uint32_t c_magic = 0x43504b56u; // VKPC
+
+	inline static VkPipelineCacheStore* m_instance = nullptr;
+
+	bool m_isInitialized;
+	bool m_isWarm;
+	VkDevice m_device;
+	VkPipelineCache m_cache;
+	FileHeader m_expectedHeader;
+	std::string m_cachePath;
+
+	uint32_t m_pipelineCount;
+	int64_t m_creationTime_us;
+
+	bool tryLoad(std::vector<char>& initialData) const;
+	bool save() const;
+};
@@ -2,6 +2,8 @@
 #include "Common.h"
 #include "VkShader.h"
 #include "ShaderSource.h"
+#include "FileManager/FileIO.h"
+#include "FileManager/Directories.h"
 
 VkShader::VkShader(VkDevice device, const ShaderSource& source)
 	: vertShader(VK_NULL_HANDLE), fragShader(VK_NULL_HANDLE)
@@ -30,17 +32,28 @@ bool VkShader::createShaderModule(VkShaderModule& module, const std::vector<char
 	return vkCreateShaderModule(device, &createInfo, nullptr, &module) == VK_SUCCESS;
 }
 
+bool VkShader::loadShaderModule(VkShaderModule& module, VkDevice device, const char* fileName)
+{
+	std::vector<char> code;
+	if (!FileIO::readFile(code, Directories::getShaderLibraryPath().combine(fileName)) || !createShaderModule(module, code, device))
+	{
+		printf("Could not load the shader '%s'.\n", fileName);
+		return false;
+	}
+	return true;
+}
+
 void VkShader::release(VkDevice device)
 {
 	vkDestroyShaderModule(device, vertShader, nullptr);
 	vkDestroyShaderModule(device, fragShader, nullptr);
 }
 
-void VkShader::ensureDefaultShader(VkDevice device)
+void VkShader::ensureDefaultShader(VkDevice device, bool useTextureTable)
 {
 	if (globalShaderList.size() == 0)
 	{
-		VkShader::createGlobalShader(device, ShaderSource::getDefaultShader());
+		VkShader::createGlobalShader(device, ShaderSource::getDefaultShader(useTextureTable));
 
 		VkShader::createGlobalShader(device, ShaderSource::getDepthOnlyShader());
 
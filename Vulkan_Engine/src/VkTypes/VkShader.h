@@ -11,8 +11,10 @@ struct VkShader
 
 	VkShader(VkDevice device, const ShaderSource& source);
 	static bool createShaderModule(VkShaderModule& module, const std::vector<char>& code, VkDevice device);
+	// Loads a single stage, like a compute shader, from the compiled shader library.
+	static bool loadShaderModule(VkShaderModule& module, VkDevice device, const char* fileName);
 
-	static void ensureDefaultShader(VkDevice device);
+	static void ensureDefaultShader(VkDevice device, bool useTextureTable = true);
 
 	//static bool findShader(std::string shaderName);
 	static const VkShader* findShader(uint32_t identifier) { return identifier < globalShaderList.size() ? globalShaderList[identifier].get() : nullptr; }
@@ -60,16 +60,12 @@ bool VkTexture2D::tryCreateTexture(UNQ<VkTexture2D>& tex, const Texture& loadedT
 			return false;
 		}
 
-		void* data;
-		auto allocator = VkMemoryAllocator::getInstance()->m_allocator;
-		vmaMapMemory(allocator, stagingBuffer.allocation, &data);
 		size_t offset = 0;
 		for (auto& mip : loadedTexture.textureMipChain)
 		{
-			mip.copyToMappedBuffer(data, offset);
+			mip.copyToMappedBuffer(stagingBuffer.mapped, offset);
 			offset += mip.getByteSize();
 		}
-		vmaUnmapMemory(allocator, stagingBuffer.allocation);
 	}
 
 	VkImage image;
@@ -90,95 +86,19 @@ bool VkTexture2D::tryCreateTexture(UNQ<VkTexture2D>& tex, const Texture& loadedT
 		return false;
 	}
 
-	Texture::transitionImageLayout(presentationDevice, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
-	Texture::copyBufferToImage(presentationDevice, stagingBuffer.buffer, image, dimensions);
+	// Recorded into the staging batch, the texture can be sampled once the batch is submitted.
+	auto cmd = stagingBufferPool.getBatchCommandBuffer();
+	Texture::transitionImageLayout(cmd, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
+	Texture::copyBufferToImage(cmd, stagingBuffer.buffer, image, dimensions, stagingBuffer.offset);
 
 	if (generateMips)
 	{
-		presentationDevice->submitImmediatelyAndWaitCompletion([=](VkCommandBuffer commandBuffer)
-			{
-				VkImageMemoryBarrier barrier{};
-				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				barrier.image = image;
-				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				barrier.subresourceRange.baseArrayLayer = 0;
-				barrier.subresourceRange.layerCount = 1;
-				barrier.subresourceRange.levelCount = 1;
-
-				int32_t mipWidth = loadedTexture.width,
-					mipHeight = loadedTexture.height;
-				for (uint32_t i = 1; i < mipCount; i++)
-				{
-					// Transfer layout for previous mip
-					barrier.subresourceRange.baseMipLevel = i - 1;
-					barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-					barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-					barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-					vkCmdPipelineBarrier(commandBuffer,
-						VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-						0, nullptr,
-						0, nullptr,
-						1, &barrier);
-
-					VkImageBlit blit{};
-					blit.srcOffsets[0] = { 0, 0, 0 };
-					blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-					blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					blit.srcSubresource.mipLevel = i - 1;
-					blit.srcSubresource.baseArrayLayer = 0;
-					blit.srcSubresource.layerCount = 1;
-
-					blit.dstOffsets[0] = { 0, 0, 0 };
-					blit.dstOffsets[1] = { std::max(mipWidth >> 1, 1), std::max(mipHeight >> 1, 1), 1 };
-					blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					blit.dstSubresource.mipLevel = i;
-					blit.dstSubresource.baseArrayLayer = 0;
-					blit.dstSubresource.layerCount = 1;
-
-					vkCmdBlitImage(commandBuffer,
-						image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-						image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-						1, &blit,
-						VK_FILTER_LINEAR);
-
-					// Transition to shader read for previous mip, we are done with it.
-					barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-					barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-					barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-					barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-					vkCmdPipelineBarrier(commandBuffer,
-						VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-						0, nullptr,
-						0, nullptr,
-						1, &barrier);
-
-					mipWidth = std::max(mipWidth >> 1, 1);
-					mipHeight = std::max(mipHeight >> 1, 1);
-				}
-
-				// The last mip (it isn't sampled from, so doesn't transition)
-				barrier.subresourceRange.baseMipLevel = mipCount - 1;
-				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-				vkCmdPipelineBarrier(commandBuffer,
-					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-					0, nullptr,
-					0, nullptr,
-					1, &barrier);
-			});
+		recordMipChainGeneration(cmd, image, loadedTexture.width, loadedTexture.height, mipCount);
 	}
 	else
 	{
 		// When generating the mipmaps, we do the transition on the whole image, after all mips are generated.
-		Texture::transitionImageLayout(presentationDevice, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipCount);
+		Texture::transitionImageLayout(cmd, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipCount);
 	}
 
 	if (!vkinit::Texture::createTextureImageView(imageView, presentationDevice->getDevice(), image, format, mipCount) ||
@@ -188,12 +108,90 @@ bool VkTexture2D::tryCreateTexture(UNQ<VkTexture2D>& tex, const Texture& loadedT
 		return false;
 	}
 
-	stagingBufferPool.freeBuffer(stagingBuffer);
-
 	tex = MAKEUNQ<VkTexture2D>(image, memoryRange, imageView, sampler, mipCount);
 	return true;
 }
 
+void VkTexture2D::recordMipChainGeneration(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.subresourceRange.levelCount = 1;
+
+	int32_t mipWidth = static_cast<int32_t>(width),
+		mipHeight = static_cast<int32_t>(height);
+	for (uint32_t i = 1; i < mipCount; i++)
+	{
+		// Transfer layout for previous mip
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		VkImageBlit blit{};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { std::max(mipWidth >> 1, 1), std::max(mipHeight >> 1, 1), 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+
+		vkCmdBlitImage(commandBuffer,
+			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR);
+
+		// Transition to shader read for previous mip, we are done with it.
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		mipWidth = std::max(mipWidth >> 1, 1);
+		mipHeight = std::max(mipHeight >> 1, 1);
+	}
+
+	// The last mip (it isn't sampled from, so doesn't transition)
+	barrier.subresourceRange.baseMipLevel = mipCount - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+}
+
 VkTexture2D VkTexture2D::createTexture(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlagBits usage, VkImageAspectFlagBits aspectFlags, bool isReadable, uint32_t mipCount)
 {
 	auto tex = VkTexture::createTexture(device, width, height, format, usage, aspectFlags, isReadable, mipCount);
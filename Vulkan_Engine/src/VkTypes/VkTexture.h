@@ -42,4 +42,7 @@ struct VkTexture2D : public VkTexture
 	static bool tryCreateTexture(UNQ<VkTexture2D>& tex, const TextureSource& texture, const Presentation::Device* presentationDevice, StagingBufferPool& stagingBufferPool);
 	static bool tryCreateTexture(UNQ<VkTexture2D>& tex, const Texture& loadedTexture, const Presentation::Device* presentationDevice, StagingBufferPool& stagingBufferPool, bool generateMips = false);
 	static VkTexture2D createTexture(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlagBits usage, VkImageAspectFlagBits aspectFlags, bool isReadable = false, uint32_t mipCount = 1u);
+
+	// Expects every mip in TRANSFER_DST layout, leaves the whole chain in SHADER_READ_ONLY.
+	static void recordMipChainGeneration(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipCount);
 };
\ No newline at end of file
@@ -6,6 +6,10 @@ struct QueueFamilyIndices : IRequireInitialization
 {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// Dedicated transfer family when the device exposes one, otherwise the graphics family.
+	std::optional<uint32_t> transferFamily;
+
+	bool hasDedicatedTransfer() const { return transferFamily.has_value() && transferFamily != graphicsFamily; }
 
 	bool IRequireInitialization::isInitialized() const override { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
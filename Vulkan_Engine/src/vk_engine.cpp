@@ -15,9 +15,12 @@
 #include "EngineCore/Scene.h"
 #include "Camera.h"
 #include "VkTypes/VkShader.h"
+#include "VkTypes/VkPipelineCacheStore.h"
 #include "Profiling/ProfileMarker.h"
+#include "Engine/FramePacer.h"
 
 #include "EngineCore/Material.h"
+#include "EngineCore/Mesh.h"
 
 VulkanEngine::VulkanEngine(std::string appDir) 
 {
@@ -26,10 +29,16 @@ VulkanEngine::VulkanEngine(std::string appDir)
 
 VulkanEngine::~VulkanEngine() = default;
 
-void VulkanEngine::init(bool requestValidationLayers)
+void VulkanEngine::init(bool requestValidationLayers, const GeometrySettings& geometrySettings)
 {
 	// Window
 	m_window = MAKEUNQ<Window>(static_cast<SDL_WindowFlags>(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE), m_applicationName, m_startingWindowSize.width, m_startingWindowSize.height);
+	// The frame collection is created with the frames in flight of the settings
+	m_frameSettings = MAKEUNQ<FrameSettings>();
+	// The pipelines are created with the vertex format, the scene cache is keyed on it and the index width
+	m_geometrySettings = MAKEUNQ<GeometrySettings>(geometrySettings);
+	Mesh::setVertexFormat(m_geometrySettings->vertexFormat);
+	Mesh::setUse16BitIndices(m_geometrySettings->use16BitIndices);
 
 	// Vulkan
 	if (requestValidationLayers)
@@ -45,20 +54,16 @@ void VulkanEngine::init(bool requestValidationLayers)
 
 	// ImGUI
 	m_imgui = MAKEUNQ<ImGuiHandle>(m_instance, m_presentationHardware->getActiveGPU(), m_presentationDevice.get(), 
-		m_presentationTarget->getRenderPass(), m_framePresentation->getImageCount(), m_window.get());
+		m_presentationTarget->getRenderPass(), MAX_FRAMES_IN_FLIGHT, m_window.get());
 
-	// Descriptor pools
-	auto descPool = m_descriptorPoolManager->createNewPool(SWAPCHAIN_IMAGE_COUNT * 1000);
-	
 	// Scene
 	m_openScene = MAKEUNQ<Scene>(m_presentationDevice.get(), m_presentationTarget.get());
-	if (!m_openScene->load(descPool))
+	if (!m_openScene->load())
 	{
 		printf("Failed to load the scene!");
 	}
 
 	m_lightTransform = MAKEUNQ<DirectionalLightParams>();
-	m_frameSettings = MAKEUNQ<FrameSettings>();
 	// Camera
 	m_cam = MAKEUNQ<Camera>(50.f, m_startingWindowSize);
 	//m_cam->setPosition({ -0.115, 35.8f, -13.2f });
@@ -90,9 +95,10 @@ bool VulkanEngine::init_vulkan()
 	return tryInitialize<Presentation::HardwareDevice>(m_presentationHardware, m_instance, surface) &&
 		tryInitialize<Presentation::Device>(m_presentationDevice, m_presentationHardware->getActiveGPU(), surface, m_window.get(), m_validationLayers.get()) &&
 		tryInitialize<VkMemoryAllocator>(m_memoryAllocator, m_instance, m_presentationHardware->getActiveGPU(), m_presentationDevice->getDevice()) &&
+		tryInitialize<VkPipelineCacheStore>(m_pipelineCache, m_presentationDevice->getDevice(), m_presentationHardware->getProperties(), Directories::getPipelineCachePath()) &&
 		tryInitialize<DescriptorPoolManager>(m_descriptorPoolManager, m_presentationDevice->getDevice()) &&
 		tryInitialize<Presentation::PresentationTarget>(m_presentationTarget, *m_presentationHardware, *m_presentationDevice, m_window.get(), true) &&
-		tryInitialize<Presentation::FrameCollection>(m_framePresentation, m_presentationDevice->getDevice(), m_presentationDevice->getCommandPool());
+		tryInitialize<Presentation::FrameCollection>(m_framePresentation, *m_presentationDevice, as_uint32(m_frameSettings->framesInFlight));
 }
 
 void VulkanEngine::run()
@@ -101,27 +107,24 @@ void VulkanEngine::run()
 	bool quit = false;
 	bool mouseHeld = false;
 
-	float curFrameTime = static_cast<float>(SDL_GetTicks());
-	float prevFrameTime = 0.f;
-	float deltaTime = curFrameTime - prevFrameTime;
-	prevFrameTime = curFrameTime;
-
 	int prevMsX = -1, prevMsY = -1;
 	int deltaMsX = 0, deltaMsY = 0;
 
 	bool isDrawing = true;
 	bool drawOnce = false;
+
+	// Started right before the first frame, the time spent loading would otherwise be its first interval and a missed deadline
+	m_framePacer = MAKEUNQ<FramePacer>();
 	
 	// Main loop
 	while (!quit)
 	{
-		curFrameTime = static_cast<float>(SDL_GetTicks());
-		deltaTime = curFrameTime - prevFrameTime;
-		prevFrameTime = curFrameTime;
+		// The camera moves by the time since the previous frame started
+		const auto deltaTime = m_framePacer->waitForNextFrame(static_cast<FramePacing>(m_frameSettings->framePacing), m_frameSettings->targetFps);
 
-		int64_t frameTime;
+		int64_t inputTime;
 		{
-			ProfileMarkerInjectResult _(frameTime, true);
+			ProfileMarkerInjectResult _(inputTime, true);
 
 			// Handle events on queue
 			while (SDL_PollEvent(&e) != 0)
@@ -181,18 +184,20 @@ void VulkanEngine::run()
 			m_cam->processFrameEvents(deltaTime);
 
 			m_imgui->draw(m_renderLoopStatistics, m_cam.get(), m_lightTransform.get(), m_frameSettings.get());
-
-			if(isDrawing || drawOnce)
-				draw();
-			drawOnce = false;
 		}
 
-		constexpr int64_t target = static_cast<int64_t>( 0.5f * 15.6f * (std::micro::den / std::milli::den) );
-		if (target > frameTime)
-		{
-			const auto waitFor_us = std::chrono::microseconds(target - frameTime);
-			std::this_thread::sleep_for(waitFor_us);
-		}
+		m_recordTime_us = 0;
+		if(isDrawing || drawOnce)
+			draw();
+		drawOnce = false;
+
+		const auto gpuTime_us = m_framePresentation->getLastGpuTime_us();
+		m_framePacer->endFrame(inputTime + m_recordTime_us, gpuTime_us);
+
+		m_renderLoopStatistics.frameInterval_us = m_framePacer->getFrameInterval_us();
+		m_renderLoopStatistics.frameJitter_us = m_framePacer->getJitter_us();
+		m_renderLoopStatistics.missedDeadlineCount = m_framePacer->getMissedDeadlineCount();
+		m_renderLoopStatistics.gpuFrame_us = gpuTime_us;
 	}
 
 	// Wait until all scheduled operations are completed before releasing resources.
@@ -201,7 +206,21 @@ void VulkanEngine::run()
 
 void VulkanEngine::draw()
 {
-	auto frame = m_framePresentation->getNextFrameAndWaitOnFence();
+	const auto presentMode = static_cast<VkPresentModeKHR>(m_frameSettings->presentMode);
+	if (presentMode != m_presentationTarget->getRequestedPresentMode())
+	{
+		m_presentationTarget->setRequestedPresentMode(presentMode);
+		recreateSwapchain();
+	}
+
+	// Changing the count waits for the device to be idle, it only happens from the settings
+	if (as_uint32(m_frameSettings->framesInFlight) != m_framePresentation->getFramesInFlight() &&
+		!m_framePresentation->setFramesInFlight(as_uint32(m_frameSettings->framesInFlight)))
+		throw std::runtime_error("Failed to recreate the frames in flight!");
+
+	auto& timeline = m_framePresentation->getTimeline();
+	const auto pendingFrames = timeline.getSubmittedValue() - timeline.getCompletedValue();
+	auto& frame = m_framePresentation->getNextFrameAndWait();
 
 	uint32_t imageIndex;
 	auto result = m_framePresentation->acquireImageFromSwapchain(imageIndex, m_presentationTarget->getSwapchain());
@@ -209,15 +228,22 @@ void VulkanEngine::draw()
 	if (handleFailedToAcquireImageIfNecessary(result))
 		return;
 
-	auto buffer = frame.getCommandBuffer();
-	vkResetCommandBuffer(buffer, 0);
+	// The pacer predicts from the CPU work alone, the waits above and the present below only depend on the GPU and the display
+	{
+		ProfileMarkerInjectResult _(m_recordTime_us, true);
+
+		auto buffer = frame.getCommandBuffer();
+		vkResetCommandBuffer(buffer, 0);
+
+		m_openScene->updateStreaming();
 	
-	const auto& renderers = m_openScene->getRenderers();
-	m_presentationTarget->applyFrameConfiguration(m_frameSettings.get());
-	m_renderLoopStatistics = m_presentationTarget->renderLoop(renderers, *m_cam, *m_lightTransform, buffer, m_frameNumber);
+		auto& renderQueue = m_openScene->getRenderQueue();
+		m_presentationTarget->applyFrameConfiguration(m_frameSettings.get());
+		m_renderLoopStatistics = m_presentationTarget->renderLoop(renderQueue, *m_cam, *m_lightTransform, buffer, m_frameNumber, m_framePresentation->getFrameIndex(), imageIndex);
+		m_renderLoopStatistics.pendingFrameCount = static_cast<size_t>(pendingFrames);
 
-	frame.resetAcquireFence(m_presentationDevice->getDevice());
-	frame.submitToQueue(m_presentationDevice->getGraphicsQueue());
+		m_framePresentation->submit(m_presentationDevice->getGraphicsQueue());
+	}
 	frame.present(imageIndex, m_presentationTarget->getSwapchain(), m_presentationDevice->getPresentQueue());
 
 	++m_frameNumber;
@@ -227,12 +253,7 @@ bool VulkanEngine::handleFailedToAcquireImageIfNecessary(VkResult imageAcquireRe
 {
 	if (imageAcquireResult == VK_ERROR_OUT_OF_DATE_KHR)
 	{
-		vkDeviceWaitIdle(m_presentationDevice->getDevice());
-
-		m_presentationTarget->releaseSwapChain(m_presentationDevice->getDevice());
-		if (!m_presentationTarget->createPresentationTarget(*m_presentationHardware, *m_presentationDevice))
-			printf("Recreating the swapchain was not successful\n");
-
+		recreateSwapchain();
 		return true;
 	}
 	else if (imageAcquireResult != VK_SUCCESS && imageAcquireResult != VK_SUBOPTIMAL_KHR)
@@ -243,6 +264,15 @@ bool VulkanEngine::handleFailedToAcquireImageIfNecessary(VkResult imageAcquireRe
 	return false;
 }
 
+void VulkanEngine::recreateSwapchain()
+{
+	vkDeviceWaitIdle(m_presentationDevice->getDevice());
+
+	m_presentationTarget->releaseSwapChain(m_presentationDevice->getDevice());
+	if (!m_presentationTarget->createPresentationTarget(*m_presentationHardware, *m_presentationDevice))
+		printf("Recreating the swapchain was not successful\n");
+}
+
 void VulkanEngine::cleanup()
 {
 	if (m_instance)
@@ -258,6 +288,7 @@ void VulkanEngine::cleanup()
 		m_descriptorPoolManager->release();
 
 		m_presentationTarget->releaseAllResources(m_presentationDevice->getDevice());
+		m_pipelineCache->release();
 
 		vmaDestroyAllocator(m_memoryAllocator->m_allocator);
 		m_presentationDevice->release();
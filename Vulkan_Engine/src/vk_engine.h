@@ -7,8 +7,10 @@ class ImGuiHandle;
 class Scene;
 class Camera;
 class DescriptorPoolManager;
+class VkPipelineCacheStore;
 class Material;
 class Window;
+class FramePacer;
 namespace Presentation
 {
 	class Device;
@@ -27,6 +29,7 @@ public:
 
 	VkInstance m_instance{}; // Vulkan library handle
 	UNQ<VkMemoryAllocator> m_memoryAllocator;
+	UNQ<VkPipelineCacheStore> m_pipelineCache;
 
 	UNQ<VulkanValidationLayers> m_validationLayers;
 	//VkDebugUtilsMessengerEXT _debug_messenger; // Vulkan debug output handle
@@ -42,6 +45,8 @@ public:
 	UNQ<Camera> m_cam;
 	UNQ<DirectionalLightParams> m_lightTransform;
 	UNQ<FrameSettings> m_frameSettings;
+	UNQ<GeometrySettings> m_geometrySettings;
+	UNQ<FramePacer> m_framePacer;
 
 	UNQ<DescriptorPoolManager> m_descriptorPoolManager;
 
@@ -51,9 +56,11 @@ public:
 	VkExtent2D m_startingWindowSize{ 800 , 600 };
 	uint32_t m_frameNumber{ 0 };
 	FrameStats m_renderLoopStatistics{};
+	// From the acquired swapchain image to the submit of the last drawn frame
+	int64_t m_recordTime_us{ 0 };
 
 	//initializes everything in the engine
-	void init(bool requestValidationLayers);
+	void init(bool requestValidationLayers, const GeometrySettings& geometrySettings = GeometrySettings());
 
 	//shuts down the engine
 	void cleanup();
@@ -68,5 +75,6 @@ private:
 	bool init_vulkan();
 	
 	bool handleFailedToAcquireImageIfNecessary(VkResult imageAcquireResult);
+	void recreateSwapchain();
 };
 
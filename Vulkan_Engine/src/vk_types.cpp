@@ -14,7 +14,7 @@
 #include "Profiling/ProfileMarker.h"
 
 CommandObjectsWrapper::RenderPassScope::RenderPassScope(VkCommandBuffer commandBuffer, VkRenderPass renderPass, 
-	VkFramebuffer swapChainFramebuffer, VkExtent2D extent, bool hasColorAttachment, bool hasDepthAttachment)
+	VkFramebuffer swapChainFramebuffer, VkExtent2D extent, bool hasColorAttachment, bool hasDepthAttachment, VkSubpassContents contents)
 {
 	assert(hasColorAttachment || hasDepthAttachment);
 	this->commandBuffer = commandBuffer;
@@ -45,7 +45,7 @@ CommandObjectsWrapper::RenderPassScope::RenderPassScope(VkCommandBuffer commandB
 	renderPassInfo.clearValueCount = attachmentCount;
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
 }
 
 CommandObjectsWrapper::RenderPassScope::~RenderPassScope()
@@ -72,6 +72,30 @@ CommandObjectsWrapper::CommandBufferScope::~CommandBufferScope()
 		printf("Failed to record command buffer!\n");
 }
 
+CommandObjectsWrapper::SecondaryCommandBufferScope::SecondaryCommandBufferScope(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer frameBuffer)
+{
+	this->commandBuffer = commandBuffer;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = frameBuffer;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	isBegun = vkBeginCommandBuffer(commandBuffer, &beginInfo) == VK_SUCCESS;
+}
+
+CommandObjectsWrapper::SecondaryCommandBufferScope::~SecondaryCommandBufferScope()
+{
+	if (isBegun && vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		printf("Failed to record secondary command buffer!\n");
+}
+
 void CommandObjectsWrapper::HelloTriangleCommand(VkCommandBuffer buffer, VkPipeline m_pipeline, VkRenderPass m_renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkBuffer vertexBuffer, uint32_t size)
 {
 	auto cbs = CommandBufferScope(buffer);
@@ -93,6 +117,5 @@ void CommandObjectsWrapper::HelloTriangleCommand(VkCommandBuffer buffer, VkPipel
 
 namespace vkinit
 {
-	bool createDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets, VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout);
-	void updateDescriptorSets(std::array<VkDescriptorSet, SWAPCHAIN_IMAGE_COUNT>& descriptorSets, VkDevice device, BuffersUBO ubo, uint32_t binding);
+	bool createDescriptorSets(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets, VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout);
 }
@@ -27,12 +27,30 @@ struct CommandObjectsWrapper
 		VkCommandBuffer commandBuffer;
 
 	public:
-		RenderPassScope(VkCommandBuffer commandBuffer, VkRenderPass m_renderPass, VkFramebuffer swapChainFramebuffer, VkExtent2D extent, bool hasColorAttachment, bool hasDepthAttachment);
+		RenderPassScope(VkCommandBuffer commandBuffer, VkRenderPass m_renderPass, VkFramebuffer swapChainFramebuffer, VkExtent2D extent, bool hasColorAttachment, bool hasDepthAttachment,
+			VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		~RenderPassScope();
 
 		RenderPassScope(const RenderPassScope&) = delete;
 		RenderPassScope& operator=(const RenderPassScope&) = delete;
 	};
 
+	// Secondary command buffer that continues the first subpass of the render pass, it inherits none of the bound state.
+	// Recorded on worker threads, so a failed begin is reported through isRecording instead of an exception.
+	class SecondaryCommandBufferScope
+	{
+		VkCommandBuffer commandBuffer;
+		bool isBegun;
+
+	public:
+		SecondaryCommandBufferScope(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer frameBuffer);
+		~SecondaryCommandBufferScope();
+
+		bool isRecording() const { return isBegun; }
+
+		SecondaryCommandBufferScope(const SecondaryCommandBufferScope&) = delete;
+		SecondaryCommandBufferScope& operator=(const SecondaryCommandBufferScope&) = delete;
+	};
+
 	static void HelloTriangleCommand(VkCommandBuffer buffer, VkPipeline m_pipeline, VkRenderPass m_renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkBuffer vertexBuffer, uint32_t size);
 };
\ No newline at end of file
@@ -21,6 +21,13 @@ namespace vkinit
 				indices.graphicsFamily = i;
 			}
 
+			// Prefer the transfer-only family (copy engine), then any non-graphics family that can transfer.
+			if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+				(!indices.transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)))
+			{
+				indices.transferFamily = i;
+			}
+
 			VkBool32 presentSurfSupport = false;
 			if (vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSurfSupport) != VK_SUCCESS)
 			{
@@ -34,15 +41,28 @@ namespace vkinit
 
 			i++;
 		}
+
+		if (!indices.transferFamily.has_value())
+		{
+			indices.transferFamily = indices.graphicsFamily;
+		}
 	}
 
 	std::vector<VkDeviceQueueCreateInfo> Queue::getQueueCreateInfo(QueueFamilyIndices indices, const float* queuePriority)
 	{
-		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos
+		// A family can only be requested once per device
+		std::set<uint32_t> uniqueFamilies{ indices.graphicsFamily.value(), indices.presentFamily.value() };
+		if (indices.transferFamily.has_value())
 		{
-			deviceQueueCreateInfo(indices.graphicsFamily.value(), queuePriority),
-			deviceQueueCreateInfo(indices.presentFamily.value(), queuePriority)
-		};
+			uniqueFamilies.insert(indices.transferFamily.value());
+		}
+
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		queueCreateInfos.reserve(uniqueFamilies.size());
+		for (auto family : uniqueFamilies)
+		{
+			queueCreateInfos.push_back(deviceQueueCreateInfo(family, queuePriority));
+		}
 
 		return queueCreateInfos;
 	}